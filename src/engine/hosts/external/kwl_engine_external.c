@@ -0,0 +1,58 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "../../kwl_engine.h"
+
+/*
+ A host that opens no audio device. The application owns the audio callback
+ and pulls mixed output from the engine with kwlRender or kwlRenderPlanar, and
+ pushes audio input with kwlProcessInput or kwlProcessInputPlanar.
+ */
+
+/** 
+ * Does nothing, since the application drives the mixer from its own audio callback.
+ * @param engine
+ * @param sampleRate
+ * @param numChannels
+ * @param bufferSize
+ * @return A Kowalski error code.
+ */
+kwlError kwlEngine_hostSpecificInitialize(kwlEngine* engine, int sampleRate, int numOutChannels, int numInChannels, int bufferSize)
+{
+    (void)engine;
+    (void)sampleRate;
+    (void)numOutChannels;
+    (void)numInChannels;
+    (void)bufferSize;
+    return KWL_NO_ERROR;
+}
+
+/**
+ * Does nothing, since there is no audio device to shut down.
+ * @param engine
+ */
+kwlError kwlEngine_hostSpecificDeinitialize(kwlEngine* engine)
+{
+    (void)engine;
+    return KWL_NO_ERROR;
+}
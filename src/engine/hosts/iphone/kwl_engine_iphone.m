@@ -194,6 +194,11 @@ OSStatus coreAudioOutputCallback(void *inRefCon,
     prevDelta = delta;
 #endif
     
+#ifdef KWL_DEBUG_MEMORY
+    /*so that allocations made while mixing can be flagged.*/
+    kwlDebugSetMixerThread();
+#endif /*KWL_DEBUG_MEMORY*/
+    
     kwlMixer* const mixer = (kwlMixer*)inRefCon;
     
     const int numChannels = ioData->mBuffers[0].mNumberChannels;
@@ -23,11 +23,10 @@ freely, subject to the following restrictions:
 
 #include "../../kwl_assert.h"
 #include "../../kwl_engine.h"
+#include "../../kwl_memory.h"
 
 #include "include/portaudio.h"
 
-PaStream *stream;
-
 /**
  * This method gets called by PortAudio when it's 
  * time to fill another output buffer.
@@ -47,48 +46,23 @@ static int paCallback(const void *inputBuffer,
                       PaStreamCallbackFlags statusFlags,
                       void *userData)
 {
+#ifdef KWL_DEBUG_MEMORY
+    /*so that allocations made while mixing can be flagged.*/
+    kwlDebugSetMixerThread();
+#endif /*KWL_DEBUG_MEMORY*/
+    
     /*Get a pointer to the Kowalski mixer responsible for producing
       final output buffers.*/
     kwlMixer *mixer = (kwlMixer*)userData;    
     
-    /*Get the number of output channels.*/
-    const int numOutChannels = mixer->numOutChannels;
+    /*Mix straight into the output buffer. Requests larger than the
+      mixer's internal buffer size, determined by KWL_TEMP_BUFFER_SIZE_IN_FRAMES,
+      are split into multiple calls to kwlMixer_render, each writing to
+      its own region of the output buffer.*/
+    kwlMixer_renderInterleaved(mixer, (float*)outputBuffer, framesPerBuffer);
     
-    /*Fill the output buffer. For efficiency reasons, the 
-      mixer has an internal maximum buffer size determined 
-      by KWL_TEMP_BUFFER_SIZE_IN_FRAMES. If the size of the 
-      requested output buffer exceeds the internal buffer 
-      size, multiple calls to kwlMixer_render 
-      are made. This is typically not the case.*/
-    int currFrame = 0;
-    while (currFrame < framesPerBuffer)
-    {
-        /*Compute the number of frames to mix.*/
-        int numFramesToMix = framesPerBuffer - currFrame;
-        if (numFramesToMix > KWL_TEMP_BUFFER_SIZE_IN_FRAMES)
-        {
-            numFramesToMix = KWL_TEMP_BUFFER_SIZE_IN_FRAMES;
-        }
-        
-        /*Perform mixing.*/
-        kwlMixer_render(mixer, 
-                                          mixer->outBuffer, 
-                                          numFramesToMix);
-        
-        /*Copy mixed samples to the output buffer*/
-        int outIdx = currFrame * numOutChannels;
-        
-        kwlMemcpy(&((float*)outputBuffer)[outIdx], 
-                  mixer->outBuffer, 
-                  sizeof(float) * numOutChannels * numFramesToMix);
-        
-        kwlMixer_processInputBuffer(mixer, 
-                                         &((float*)inputBuffer)[outIdx], 
-                                         numFramesToMix);
-        
-        /*Increment write position*/
-        currFrame += numFramesToMix;
-    }
+    /*Pass the input samples, if any, to the input dsp unit.*/
+    kwlMixer_processInputBuffer(mixer, (const float*)inputBuffer, framesPerBuffer);
     
     /*Return 0 to indicate that everything went well.*/
     return 0;
@@ -104,6 +78,9 @@ static int paCallback(const void *inputBuffer,
  */
 kwlError kwlEngine_hostSpecificInitialize(kwlEngine* engine, int sampleRate, int numOutChannels, int numInChannels, int bufferSize)
 {
+    /*Pa_Initialize and Pa_Terminate calls are reference counted by PortAudio,
+      so each engine context can open a stream of its own.*/
+    PaStream *stream = NULL;
     PaError err = Pa_Initialize();
     KWL_ASSERT(err == paNoError && "error initializing portaudio");
     
@@ -131,6 +108,7 @@ kwlError kwlEngine_hostSpecificInitialize(kwlEngine* engine, int sampleRate, int
 
 	const PaStreamInfo* si = Pa_GetStreamInfo(stream);
 
+    engine->hostData = stream;
     return KWL_NO_ERROR;
 }
 
@@ -140,7 +118,7 @@ kwlError kwlEngine_hostSpecificInitialize(kwlEngine* engine, int sampleRate, int
  */
 kwlError kwlEngine_hostSpecificDeinitialize(kwlEngine* engine)
 {
-    
+    PaStream *stream = (PaStream*)engine->hostData;
     PaError err = Pa_StopStream(stream);
     //printf("PortAudio error: %s\n", Pa_GetErrorText(err));
     KWL_ASSERT(err == paNoError);
@@ -152,5 +130,6 @@ kwlError kwlEngine_hostSpecificDeinitialize(kwlEngine* engine)
     err = Pa_Terminate();
     //printf("PortAudio error: %s\n", Pa_GetErrorText(err));
     KWL_ASSERT(err == paNoError);
+    engine->hostData = NULL;
     return KWL_NO_ERROR;
 }
@@ -29,6 +29,11 @@ freely, subject to the following restrictions:
 void kwlSDLAudioCallback(void *userData, Uint8 *stream, int numBytes)
 {   
     KWL_ASSERT(0 && "the following code is not up to date");
+#ifdef KWL_DEBUG_MEMORY
+    /*so that allocations made while mixing can be flagged.*/
+    kwlDebugSetMixerThread();
+#endif /*KWL_DEBUG_MEMORY*/
+    
     kwlMixer* mixer = (kwlMixer*)userData;
     mixer->numChannels;
     int bytesPerOutSample = 2; /*Always 16 bit = 2 bytes samples.*/
@@ -26,16 +26,39 @@ freely, subject to the following restrictions:
 #include "kowalski_ext.h"
 #include "kwl_audiofileutil.h"
 #include "kwl_dspunit.h"
+#include "kwl_log.h"
 #include "kwl_memory.h"
+#include "kwl_pushstream.h"
 #include "kwl_engine.h"
+#include "kwl_synchronization.h"
 
 #include "kwl_assert.h"
 #include <stdlib.h>
 #include <string.h>
 
-kwlEngine* engine = NULL;
+/** The context created by kwlInitialize.*/
+static kwlEngine* defaultEngine = NULL;
 
-kwlError error = KWL_NO_ERROR;
+/** The context made current on the calling thread, or NULL to use the default context.*/
+static KWL_THREAD_LOCAL kwlEngine* currentEngine = NULL;
+
+/** The number of live contexts, including the default context.*/
+static int numContexts = 0;
+/** Guards \c numContexts, since contexts may be created and destroyed on several threads at once.*/
+static volatile int numContextsLock = 0;
+
+/** The first error raised on the calling thread since the last call to kwlGetError.*/
+static KWL_THREAD_LOCAL kwlError error = KWL_NO_ERROR;
+
+/** The low latency mode settings to apply when a context is created.*/
+static int renderQuantumSize = 0;
+static int numRenderAheadQuanta = 0;
+
+/** Returns the context that API calls made on the calling thread operate on, or NULL if there is none.*/
+static kwlEngine* kwlGetCurrentEngine(void)
+{
+    return currentEngine != NULL ? currentEngine : defaultEngine;
+}
 
 static void kwlSetError(kwlError err)
 {
@@ -59,6 +82,7 @@ kwlError kwlGetError(void)
 
 void kwlEventSetPitch(kwlEventHandle handle, float pitchInPercent)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -69,6 +93,7 @@ void kwlEventSetPitch(kwlEventHandle handle, float pitchInPercent)
 
 void kwlEventSetGain(kwlEventHandle handle, float gain)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -80,6 +105,7 @@ void kwlEventSetGain(kwlEventHandle handle, float gain)
 
 void kwlEventSetLinearGain(kwlEventHandle handle, float gain)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -92,6 +118,7 @@ void kwlEventSetLinearGain(kwlEventHandle handle, float gain)
 
 void kwlEventSetPosition(kwlEventHandle handle, float posX, float posY, float posZ)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -103,6 +130,7 @@ void kwlEventSetPosition(kwlEventHandle handle, float posX, float posY, float po
 
 void kwlEventSetVelocity(kwlEventHandle handle, float velX, float velY, float velZ)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -114,6 +142,7 @@ void kwlEventSetVelocity(kwlEventHandle handle, float velX, float velY, float ve
 
 void kwlEventSetOrientation(kwlEventHandle handle, float directionX, float directionY, float directionZ)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -123,8 +152,39 @@ void kwlEventSetOrientation(kwlEventHandle handle, float directionX, float direc
     kwlSetError(kwlEngine_eventSetOrientation(engine, handle, directionX, directionY, directionZ));
 }
 
+int kwlEventUpdateBatch(const kwlEventUpdate* updates, int numUpdates)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return 0;
+    }
+    
+    int numApplied = 0;
+    kwlSetError(kwlEngine_eventUpdateBatch(engine, updates, numUpdates, &numApplied));
+    return numApplied;
+}
+
+int kwlEventSetPositions(const kwlEventHandle* handles,
+                         const float* x, const float* y, const float* z,
+                         int numEvents)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return 0;
+    }
+    
+    int numApplied = 0;
+    kwlSetError(kwlEngine_eventSetPositions(engine, handles, x, y, z, numEvents, &numApplied));
+    return numApplied;
+}
+
 void kwlEventSetBalance(kwlEventHandle handle, float balance)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -134,8 +194,66 @@ void kwlEventSetBalance(kwlEventHandle handle, float balance)
     kwlSetError(kwlEngine_eventSetBalance(engine, handle, balance));
 }
 
+void kwlEventAutomate(kwlEventHandle handle, 
+                      kwlAutomatedParameter parameter, 
+                      float targetValue, 
+                      float durationSec, 
+                      kwlAutomationCurve curve)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_eventSetEnvelope(engine, handle, parameter, &durationSec, &targetValue, 1, 1, curve, KWL_UNSCHEDULED));
+}
+
+void kwlEventSetEnvelope(kwlEventHandle handle, 
+                         kwlAutomatedParameter parameter,
+                         const float* timesSec, 
+                         const float* values, 
+                         int numBreakpoints,
+                         kwlAutomationCurve curve)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_eventSetEnvelope(engine, handle, parameter, timesSec, values, numBreakpoints, 0, curve, KWL_UNSCHEDULED));
+}
+
+void kwlEventSetEnvelopeAt(kwlEventHandle handle, 
+                           kwlAutomatedParameter parameter,
+                           long long startFrame,
+                           const float* timesSec, 
+                           const float* values, 
+                           int numBreakpoints,
+                           kwlAutomationCurve curve)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    if (startFrame < 0)
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_eventSetEnvelope(engine, handle, parameter, timesSec, values, numBreakpoints, 0, curve, startFrame));
+}
+
 kwlEventHandle kwlEventGetHandle(const char* const eventId)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -149,6 +267,7 @@ kwlEventHandle kwlEventGetHandle(const char* const eventId)
 
 kwlEventDefinitionHandle kwlEventDefinitionGetHandle(const char* const eventDefinitionID)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -164,6 +283,7 @@ kwlEventDefinitionHandle kwlEventDefinitionGetHandle(const char* const eventDefi
 
 kwlEventHandle kwlEventCreateWithFile(const char* const audioFilePath, kwlEventType eventType, int streamFromDisk)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -177,6 +297,7 @@ kwlEventHandle kwlEventCreateWithFile(const char* const audioFilePath, kwlEventT
 
 kwlEventHandle kwlEventCreateWithBuffer(kwlPCMBuffer* buffer, kwlEventType eventType)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -188,8 +309,73 @@ kwlEventHandle kwlEventCreateWithBuffer(kwlPCMBuffer* buffer, kwlEventType event
     return handle;
 }
 
+kwlEventHandle kwlEventCreatePushStream(int numChannels, int capacityInFrames, int latencyInFrames, kwlEventType eventType)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return KWL_INVALID_HANDLE;
+    }
+    
+    kwlEventHandle handle = KWL_INVALID_HANDLE;
+    kwlSetError(kwlEngine_eventCreatePushStream(engine, numChannels, capacityInFrames, latencyInFrames, 
+                                                &handle, eventType));
+    return handle;
+}
+
+kwlPushStreamHandle kwlEventGetPushStream(kwlEventHandle handle)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return NULL;
+    }
+    
+    kwlPushStream* stream = NULL;
+    kwlSetError(kwlEngine_eventGetPushStream(engine, handle, &stream));
+    return stream;
+}
+
+/* 
+ The push stream functions below may be called from a thread other than the one
+ updating the engine, so they touch neither the engine nor the error state.
+ */
+
+int kwlPushStreamWrite(kwlPushStreamHandle stream, const short* frames, int numFrames)
+{
+    if (stream == NULL || frames == NULL || numFrames <= 0)
+    {
+        return 0;
+    }
+    
+    return kwlPushStream_write(stream, frames, numFrames);
+}
+
+int kwlPushStreamWriteFloat(kwlPushStreamHandle stream, const float* frames, int numFrames)
+{
+    if (stream == NULL || frames == NULL || numFrames <= 0)
+    {
+        return 0;
+    }
+    
+    return kwlPushStream_writeFloat(stream, frames, numFrames);
+}
+
+int kwlPushStreamGetNumQueuedFrames(kwlPushStreamHandle stream)
+{
+    return stream != NULL ? kwlPushStream_getNumQueuedFrames(stream) : 0;
+}
+
+int kwlPushStreamGetNumUnderruns(kwlPushStreamHandle stream)
+{
+    return stream != NULL ? kwlAtomicLoadAcquire(&stream->numUnderruns) : 0;
+}
+
 void kwlEventRelease(kwlEventHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -201,17 +387,19 @@ void kwlEventRelease(kwlEventHandle handle)
 
 void kwlEventStart(kwlEventHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
         return;
     }
     
-    kwlSetError(kwlEngine_eventStart(engine, handle, 0));
+    kwlSetError(kwlEngine_eventStart(engine, handle, 0, KWL_UNSCHEDULED));
 }
 
 void kwlEventStartOneShot(kwlEventDefinitionHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -223,6 +411,7 @@ void kwlEventStartOneShot(kwlEventDefinitionHandle handle)
 
 void kwlEventStartOneShotAt(kwlEventDefinitionHandle handle, float x, float y, float z)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -234,6 +423,7 @@ void kwlEventStartOneShotAt(kwlEventDefinitionHandle handle, float x, float y, f
 
 void kwlEventSetCallback(kwlEventHandle handle, kwlEventStoppedCallack callback, void* userData)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -246,6 +436,7 @@ void kwlEventSetCallback(kwlEventHandle handle, kwlEventStoppedCallack callback,
 
 void kwlEventStartOneShotWithCallback(kwlEventDefinitionHandle eventDefinition, kwlEventStoppedCallack callback, void* userData)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -257,6 +448,7 @@ void kwlEventStartOneShotWithCallback(kwlEventDefinitionHandle eventDefinition,
 
 void kwlEventStartOneShotWithCallbackAt(kwlEventDefinitionHandle eventDefinition, float x, float y, float z, kwlEventStoppedCallack callback, void* userData)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -269,39 +461,79 @@ void kwlEventStartOneShotWithCallbackAt(kwlEventDefinitionHandle eventDefinition
 
 void kwlEventStartFade(kwlEventHandle handle, float fadeTime)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
         return;
     }
     
-    kwlSetError(kwlEngine_eventStart(engine, handle, fadeTime));
+    kwlSetError(kwlEngine_eventStart(engine, handle, fadeTime, KWL_UNSCHEDULED));
 }
 
 void kwlEventStop(kwlEventHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
         return;
     }
     
-    kwlSetError(kwlEngine_eventStop(engine, handle, 0));
+    kwlSetError(kwlEngine_eventStop(engine, handle, 0, KWL_UNSCHEDULED));
 }
 
 void kwlEventStopFade(kwlEventHandle handle, float fadeTime)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
         return;
     }
     
-    kwlSetError(kwlEngine_eventStop(engine, handle, fadeTime));
+    kwlSetError(kwlEngine_eventStop(engine, handle, fadeTime, KWL_UNSCHEDULED));
+}
+
+void kwlEventStartAt(kwlEventHandle handle, long long frame, float fadeTime)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    if (frame < 0)
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_eventStart(engine, handle, fadeTime, frame));
+}
+
+void kwlEventStopAt(kwlEventHandle handle, long long frame, float fadeTime)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    if (frame < 0)
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_eventStop(engine, handle, fadeTime, frame));
 }
 
 void kwlEventPause(kwlEventHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -313,6 +545,7 @@ void kwlEventPause(kwlEventHandle handle)
 
 void kwlEventResume(kwlEventHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -324,6 +557,7 @@ void kwlEventResume(kwlEventHandle handle)
 
 int kwlEventIsPlaying(kwlEventHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -340,6 +574,7 @@ int kwlEventIsPlaying(kwlEventHandle handle)
  */
 kwlMixBusHandle kwlMixBusGetHandle(const char* const busId)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -353,6 +588,7 @@ kwlMixBusHandle kwlMixBusGetHandle(const char* const busId)
 
 void kwlMixBusSetGain(kwlMixBusHandle handle, float gain)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -364,6 +600,7 @@ void kwlMixBusSetGain(kwlMixBusHandle handle, float gain)
 
 void kwlMixBusSetLinearGain(kwlMixBusHandle handle, float gain)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -373,8 +610,66 @@ void kwlMixBusSetLinearGain(kwlMixBusHandle handle, float gain)
     kwlSetError(kwlEngine_mixBusSetGain(engine, handle, gain, 1));
 }
 
+void kwlMixBusAutomate(kwlMixBusHandle handle, 
+                       kwlAutomatedParameter parameter, 
+                       float targetValue, 
+                       float durationSec, 
+                       kwlAutomationCurve curve)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_mixBusSetEnvelope(engine, handle, parameter, &durationSec, &targetValue, 1, 1, curve, KWL_UNSCHEDULED));
+}
+
+void kwlMixBusSetEnvelope(kwlMixBusHandle handle, 
+                          kwlAutomatedParameter parameter,
+                          const float* timesSec, 
+                          const float* values, 
+                          int numBreakpoints,
+                          kwlAutomationCurve curve)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_mixBusSetEnvelope(engine, handle, parameter, timesSec, values, numBreakpoints, 0, curve, KWL_UNSCHEDULED));
+}
+
+void kwlMixBusSetEnvelopeAt(kwlMixBusHandle handle, 
+                            kwlAutomatedParameter parameter,
+                            long long startFrame,
+                            const float* timesSec, 
+                            const float* values, 
+                            int numBreakpoints,
+                            kwlAutomationCurve curve)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    if (startFrame < 0)
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_mixBusSetEnvelope(engine, handle, parameter, timesSec, values, numBreakpoints, 0, curve, startFrame));
+}
+
 void kwlMixBusSetPitch(kwlMixBusHandle handle, float pitch)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -384,9 +679,22 @@ void kwlMixBusSetPitch(kwlMixBusHandle handle, float pitch)
     kwlSetError(kwlEngine_mixBusSetPitch(engine, handle, pitch));
 }
 
+void kwlMixBusSetSampleRate(kwlMixBusHandle handle, int sampleRate)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_mixBusSetSampleRate(engine, handle, sampleRate));
+}
+
 
 kwlMixPresetHandle kwlMixPresetGetHandle(const char* const presetId)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -400,6 +708,7 @@ kwlMixPresetHandle kwlMixPresetGetHandle(const char* const presetId)
 
 void kwlMixPresetFadeTo(kwlMixPresetHandle presetHandle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -411,6 +720,7 @@ void kwlMixPresetFadeTo(kwlMixPresetHandle presetHandle)
 
 void kwlMixPresetSet(kwlMixPresetHandle presetHandle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -422,6 +732,7 @@ void kwlMixPresetSet(kwlMixPresetHandle presetHandle)
 
 void kwlListenerSetPosition(float posX, float posY, float posZ)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -433,6 +744,7 @@ void kwlListenerSetPosition(float posX, float posY, float posZ)
 
 void kwlListenerSetVelocity(float velX, float velY, float velZ)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -445,6 +757,7 @@ void kwlListenerSetVelocity(float velX, float velY, float velZ)
 void kwlListenerSetOrientation(float directionX, float directionY, float directionZ,
                                float upX, float upY, float upZ)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -462,6 +775,7 @@ void kwlSetDistanceAttenuationModel(kwlDistanceAttenuationModel type,
                                     float rolloffFactor,
                                     float referenceDistance)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -478,6 +792,7 @@ void kwlSetDistanceAttenuationModel(kwlDistanceAttenuationModel type,
 
 void kwlSetDopplerShiftParameters(float speedOfSound, float dopplerScale)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -489,6 +804,7 @@ void kwlSetDopplerShiftParameters(float speedOfSound, float dopplerScale)
 
 void kwlSetConeAttenuationEnabled(int enableListenerCone, int enableEventCones)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -498,8 +814,45 @@ void kwlSetConeAttenuationEnabled(int enableListenerCone, int enableEventCones)
     kwlSetError(kwlEngine_setConeAttenuationEnabled(engine, enableListenerCone, enableEventCones));
 }
 
+void kwlSetVoiceLODThresholds(float monoThreshold, float halfRateThreshold)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_setVoiceLODThresholds(engine, monoThreshold, halfRateThreshold));
+}
+
+void kwlSetSpatialIndexCellSize(float cellSize)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_setSpatialIndexCellSize(engine, cellSize));
+}
+
+void kwlSetRandomSeed(unsigned int seed)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_setRandomSeed(engine, seed));
+}
+
 void kwlListenerSetConeParameters(float innerConeAngle, float outerConeAngle, float outerConeGain)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -511,6 +864,7 @@ void kwlListenerSetConeParameters(float innerConeAngle, float outerConeAngle, fl
 
 void kwlMixerResume(void)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -522,6 +876,7 @@ void kwlMixerResume(void)
 
 void kwlMixerPause(void)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -533,6 +888,7 @@ void kwlMixerPause(void)
 
 float kwlGetLevelLeft(void)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -547,6 +903,7 @@ float kwlGetLevelLeft(void)
 
 float kwlGetLevelRight(void)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -561,6 +918,7 @@ float kwlGetLevelRight(void)
 
 int kwlHasClipped(void)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -574,6 +932,7 @@ int kwlHasClipped(void)
 
 void kwlLevelMeteringSetEnabled(int enabled)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -586,6 +945,7 @@ void kwlLevelMeteringSetEnabled(int enabled)
 
 void kwlUpdate(float timeStepSec)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -602,6 +962,7 @@ void kwlUpdate(float timeStepSec)
 
 kwlWaveBankHandle kwlWaveBankLoad(const char* const path)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -614,6 +975,7 @@ kwlWaveBankHandle kwlWaveBankLoad(const char* const path)
 
 void kwlWaveBankLoadWithCallback(const char* path, kwlWaveBankFinishedLoadingCallback callback)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -624,6 +986,7 @@ void kwlWaveBankLoadWithCallback(const char* path, kwlWaveBankFinishedLoadingCal
 
 int kwlWaveBankIsLoaded(kwlWaveBankHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -637,6 +1000,7 @@ int kwlWaveBankIsLoaded(kwlWaveBankHandle handle)
 
 int kwlWaveBankIsReferencedByPlayingEvent(kwlWaveBankHandle handle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -650,6 +1014,7 @@ int kwlWaveBankIsReferencedByPlayingEvent(kwlWaveBankHandle handle)
 
 void kwlWaveBankUnload(kwlWaveBankHandle waveBankHandle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -660,6 +1025,7 @@ void kwlWaveBankUnload(kwlWaveBankHandle waveBankHandle)
 
 void kwlWaveBankUnloadBlocking(kwlWaveBankHandle waveBankHandle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -668,8 +1034,23 @@ void kwlWaveBankUnloadBlocking(kwlWaveBankHandle waveBankHandle)
     kwlSetError(kwlEngine_requestUnloadWaveBank(engine, waveBankHandle, 1));
 }
 
+long long kwlGetSampleClock()
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return 0;
+    }
+    
+    long long frame = 0;
+    kwlSetError(kwlEngine_getSampleClock(engine, &frame));
+    return frame;
+}
+
 unsigned int kwlGetNumFramesMixed()
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -683,48 +1064,132 @@ unsigned int kwlGetNumFramesMixed()
 
 int kwlIsEngineInitialized()
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     return engine != NULL;
 }
 
-/** */
-void kwlInitialize(int sampleRate, int numOutputChannels, int numInputChannels, int bufferSize)
+/** Returns non-zero if the given low latency mode settings are valid.*/
+static int kwlIsValidRenderQuantum(int quantumSize, int numQuantaAhead)
+{
+    return quantumSize >= 0 && quantumSize <= KWL_TEMP_BUFFER_SIZE_IN_FRAMES &&
+           numQuantaAhead >= 0 && numQuantaAhead <= KWL_MAX_RENDER_AHEAD_QUANTA;
+}
+
+/** Validates the settings and creates and initializes a context, or returns NULL on failure.*/
+static kwlEngine* kwlCreateEngine(int sampleRate, int numOutputChannels, int numInputChannels, int bufferSize)
 {
-    if (engine != 0)
-    {
-        kwlSetError(KWL_ENGINE_ALREADY_INITIALIZED);
-        return;
-    }
-    
     if (numOutputChannels != 1 && numOutputChannels != 2)
     {
         kwlSetError(KWL_UNSUPPORTED_NUM_OUTPUT_CHANNELS);
-        return;
+        return NULL;
     }
     
     if (numInputChannels < 0 || numInputChannels > 2)
     {
         kwlSetError(KWL_UNSUPPORTED_NUM_INPUT_CHANNELS);
-        return;
+        return NULL;
     }
     
-    if (sampleRate <= 0 || bufferSize <= 0)
+    if (sampleRate <= 0 || bufferSize <= 0 ||
+        !kwlIsValidRenderQuantum(renderQuantumSize, numRenderAheadQuanta))
     {
         kwlSetError(KWL_INVALID_PARAMETER_VALUE);
-        return;
+        return NULL;
     }
 
     /*create the sound engine instance*/
-    engine = (kwlEngine*)KWL_MALLOC((sizeof(kwlEngine)), "kwlInitialize");
+    kwlEngine* engine = (kwlEngine*)KWL_MALLOC((sizeof(kwlEngine)), "kwlCreateEngine");
     kwlMemset(engine, 0, sizeof(kwlEngine));
     kwlEngine_init(engine);
+    /*The low latency mode settings were validated above, so this cannot fail.*/
+    kwlEngine_setRenderQuantum(engine, renderQuantumSize, numRenderAheadQuanta);
     
     /*and initialise it*/
-    kwlSetError(kwlEngine_initialize(engine, sampleRate, numOutputChannels, numInputChannels, bufferSize));
+    const kwlError result = kwlEngine_initialize(engine, sampleRate, numOutputChannels, numInputChannels, bufferSize);
+    if (result != KWL_NO_ERROR)
+    {
+        /*The mixer never started rendering, so it can be freed along with the engine.*/
+        kwlSetError(result);
+        kwlMixer_free(engine->mixer);
+        kwlEngine_free(engine);
+        KWL_FREE(engine);
+        return NULL;
+    }
+    
+    kwlSpinLockAcquire(&numContextsLock);
+    numContexts++;
+    kwlSpinLockRelease(&numContextsLock);
+    return engine;
+}
+
+/** Shuts down and frees a context.*/
+static void kwlDestroyEngine(kwlEngine* engine)
+{
+    /*shut down the sound engine*/
+    kwlEngine_deinitialize(engine);
+    /*delete the sound engine instance*/
+    kwlEngine_free(engine);
+    KWL_FREE(engine);
+    
+    kwlSpinLockAcquire(&numContextsLock);
+    numContexts--;
+    kwlSpinLockRelease(&numContextsLock);
+}
+
+/** */
+void kwlInitialize(int sampleRate, int numOutputChannels, int numInputChannels, int bufferSize)
+{
+    if (defaultEngine != NULL)
+    {
+        kwlSetError(KWL_ENGINE_ALREADY_INITIALIZED);
+        return;
+    }
+    
+    defaultEngine = kwlCreateEngine(sampleRate, numOutputChannels, numInputChannels, bufferSize);
+}
+
+void kwlSetRenderQuantum(int quantumSize, int numQuantaAhead)
+{
+    if (!kwlIsValidRenderQuantum(quantumSize, numQuantaAhead))
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    renderQuantumSize = quantumSize;
+    numRenderAheadQuanta = numQuantaAhead;
+}
+
+void kwlSetAudioMemoryBudget(int numBytes)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_setAudioMemoryBudget(engine, numBytes));
+}
+
+int kwlGetAudioMemoryUsage()
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return 0;
+    }
+    
+    int numBytes = 0;
+    kwlSetError(kwlEngine_getAudioMemoryUsage(engine, &numBytes));
+    return numBytes;
 }
 
 /** */
 void kwlEngineDataLoad(const char* const dataPath)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -737,6 +1202,7 @@ void kwlEngineDataLoad(const char* const dataPath)
 /** */
 void kwlEngineDataUnload()
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -749,6 +1215,7 @@ void kwlEngineDataUnload()
 /** */
 int kwlEngineDataIsLoaded()
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -763,22 +1230,61 @@ int kwlEngineDataIsLoaded()
 /** */
 void kwlDeinitialize()
 {
-    if (engine == NULL)
+    if (defaultEngine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
         return;
     }
     
-    /*shut down the sound engine*/
-    kwlEngine_deinitialize(engine);
-    /*delete the sound engine instance*/
-    kwlEngine_free(engine);
-    engine = NULL;
+    kwlDestroyEngine(defaultEngine);
+    defaultEngine = NULL;
+}
+
+kwlContextHandle kwlContextCreate(int sampleRate, int numOutputChannels, int numInputChannels, int bufferSize)
+{
+    return kwlCreateEngine(sampleRate, numOutputChannels, numInputChannels, bufferSize);
+}
+
+void kwlContextDestroy(kwlContextHandle context)
+{
+    if (context == NULL || context == defaultEngine)
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    if (currentEngine == context)
+    {
+        currentEngine = NULL;
+    }
+    
+    kwlDestroyEngine(context);
+}
+
+void kwlContextMakeCurrent(kwlContextHandle context)
+{
+    currentEngine = context == defaultEngine ? NULL : context;
+}
+
+kwlContextHandle kwlContextGetCurrent()
+{
+    return kwlGetCurrentEngine();
+}
+
+void kwlSetLogLevel(kwlLogLevel level)
+{
+    kwlLog_level = level;
+}
+
+void kwlSetLogCallback(kwlLogCallback callback, void* userData)
+{
+    kwlLog_setCallback(callback, userData);
 }
 
 /** */
 void kwlDSPUnitAttachToEvent(kwlDSPUnit* dspUnit, kwlEventHandle eventHandle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -791,6 +1297,7 @@ void kwlDSPUnitAttachToEvent(kwlDSPUnit* dspUnit, kwlEventHandle eventHandle)
 
 void kwlDSPUnitAttachToMixBus(kwlDSPUnit* dspUnit, kwlMixBusHandle mixBusHandle)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -802,6 +1309,7 @@ void kwlDSPUnitAttachToMixBus(kwlDSPUnit* dspUnit, kwlMixBusHandle mixBusHandle)
 
 void kwlDSPUnitAttachToInput(kwlDSPUnit* dspUnit)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -813,6 +1321,7 @@ void kwlDSPUnitAttachToInput(kwlDSPUnit* dspUnit)
 
 void kwlDSPUnitAttachToOutput(kwlDSPUnit* dspUnit)
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -824,6 +1333,7 @@ void kwlDSPUnitAttachToOutput(kwlDSPUnit* dspUnit)
 
 int kwlIsInputEnabled()
 {
+    kwlEngine* engine = kwlGetCurrentEngine();
     if (engine == NULL)
     {
         kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
@@ -833,6 +1343,54 @@ int kwlIsInputEnabled()
     return engine->isInputEnabled;
 }
 
+void kwlRender(float* buffer, int numFrames)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_render(engine, buffer, numFrames));
+}
+
+void kwlRenderPlanar(float** buffers, int numFrames)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_renderPlanar(engine, buffers, numFrames));
+}
+
+void kwlProcessInput(const float* buffer, int numFrames)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_processInput(engine, buffer, numFrames));
+}
+
+void kwlProcessInputPlanar(const float* const* buffers, int numFrames)
+{
+    kwlEngine* engine = kwlGetCurrentEngine();
+    if (engine == NULL)
+    {
+        kwlSetError(KWL_ENGINE_IS_NOT_INITIALIZED);
+        return;
+    }
+    
+    kwlSetError(kwlEngine_processInputPlanar(engine, buffers, numFrames));
+}
+
 kwlDSPUnitHandle kwlDSPUnitCreateCustom(void* userdata, 
                                         kwlDSPCallback process, 
                                         kwlDSPUpdateCallback updateEngine, 
@@ -854,10 +1412,44 @@ kwlDSPUnitHandle kwlDSPUnitCreateCustom(void* userdata,
     newDSPUnit->dspCallback = process;
     newDSPUnit->updateDSPEngineCallback = updateEngine;
     newDSPUnit->updateDSPMixerCallback = updateMixer;
+    newDSPUnit->tailLengthInFrames = -1;
     
     return newDSPUnit;
 }
 
+void kwlDSPUnitSetTailLength(kwlDSPUnitHandle dspUnit, int numFrames)
+{
+    if (dspUnit == NULL)
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    /*This method can be called regardless of the state of the engine */
+    dspUnit->tailLengthInFrames = numFrames < 0 ? -1 : numFrames;
+}
+
+void kwlSetAllocator(kwlAllocateCallback allocate, kwlDeallocateCallback deallocate, void* userData)
+{
+    kwlSpinLockAcquire(&numContextsLock);
+    const int hasContexts = numContexts > 0;
+    kwlSpinLockRelease(&numContextsLock);
+    if (hasContexts)
+    {
+        /*Blocks allocated with the current allocator are still live.*/
+        kwlSetError(KWL_ENGINE_ALREADY_INITIALIZED);
+        return;
+    }
+    
+    if ((allocate == NULL) != (deallocate == NULL))
+    {
+        kwlSetError(KWL_INVALID_PARAMETER_VALUE);
+        return;
+    }
+    
+    kwlMemory_setAllocator(allocate, deallocate, userData);
+}
+
 kwlError kwlPCMBufferLoad(const char* const path, kwlPCMBuffer* buffer)
 {
     /** Reset input struct. */
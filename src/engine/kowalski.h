@@ -126,7 +126,9 @@ extern "C"
         /** The event is positional but is required to be non-positional.*/
         KWL_EVENT_IS_NOT_NONPOSITIONAL,
         /** The positional freeform event cannot be created from a stereo file.*/
-        KWL_POSITIONAL_EVENT_MUST_BE_MONO
+        KWL_POSITIONAL_EVENT_MUST_BE_MONO,
+        /** A wave bank or audio data entry ID in a wave bank binary file is too long for the engine.*/
+        KWL_WAVE_BANK_ID_TOO_LONG
     } kwlError;
     /** @} */
     
@@ -150,6 +152,31 @@ extern "C"
         KWL_NONPOSITIONAL
     } kwlEventType;
     
+    /** Parameters that can be automated. @see kwlEventAutomate @see kwlMixBusAutomate */
+    typedef enum
+    {
+        /** The linear gain, applied on top of the gain set by the user.*/
+        KWL_PARAMETER_GAIN,
+        /** The pitch, applied on top of the pitch set by the user.*/
+        KWL_PARAMETER_PITCH,
+        /** The balance, combined with the balance set by the user. Only applicable to non-positional events.*/
+        KWL_PARAMETER_BALANCE
+    } kwlAutomatedParameter;
+    
+    /** Curves used to interpolate automated parameters between breakpoints.*/
+    typedef enum
+    {
+        /** The value changes linearly with time.*/
+        KWL_CURVE_LINEAR,
+        /**
+         * The value changes by a constant factor per unit of time, which is a linear
+         * change in decibels for gains. Values below -60 dB are treated as -60 dB.
+         */
+        KWL_CURVE_EXPONENTIAL,
+        /** The value changes slowly at the start and the end and faster in between.*/
+        KWL_CURVE_S
+    } kwlAutomationCurve;
+    
     
     /** The value of invalid handles returned from the Kowalski engine.*/
     static const int KWL_INVALID_HANDLE = 0xffffffff;
@@ -231,7 +258,10 @@ extern "C"
      * If the event handle is associated with a freeform event created with \c kwlEventCreateWithFile or
      * \c kwlEventCreateWithBufer, its audio
      * data will get released. If the handle corresponds to a data driven event instance, it
-     * is returned to the pool of free instances.</p>
+     * is returned to the pool of free instances. The handle is invalid after this call, and
+     * passing it to any function results in a \c KWL_INVALID_EVENT_INSTANCE_HANDLE error, 
+     * even if the event instance gets associated with a new handle. Handles to data driven 
+     * events are also invalidated when the engine data is unloaded.</p>
      * <p>
      * <strong>Error codes:</strong>
      * <ul>
@@ -382,6 +412,98 @@ extern "C"
      */
     void kwlEventSetBalance(kwlEventHandle handle, float balance);
     
+    /**
+     * <p>Automates a parameter of a given event instance, moving it from its current value to 
+     * a target value over a given duration. The automation is evaluated by the mixer once per 
+     * mixed buffer, so the parameter changes smoothly regardless of how often \c kwlUpdate is 
+     * called. Gain changes are additionally ramped per sample. Automated values are applied on 
+     * top of the values set using \c kwlEventSetGain, \c kwlEventSetPitch and 
+     * \c kwlEventSetBalance and persist after the automation has finished. Submitting a new 
+     * automation for a parameter replaces the current one.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * <li>\c KWL_INVALID_EVENT_INSTANCE_HANDLE if the provided handle does not correspond to an event instance.</li>
+     * <li>\c KWL_EVENT_IS_NOT_NONPOSITIONAL if \c parameter is \c KWL_PARAMETER_BALANCE and the event is positional.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c durationSec is negative, if \c targetValue is a negative gain
+     * or pitch or a balance outside [-1, 1], or if \c parameter or \c curve is invalid.</li>
+     * </ul>
+     * </p>
+     * @param handle An event handle corresponding to the event to automate.
+     * @param parameter The parameter to automate.
+     * @param targetValue The value to move to. Gains are linear amplitude scale factors.
+     * @param durationSec The time in seconds it takes to reach the target value.
+     * @param curve The shape of the transition.
+     * @see kwlEventSetEnvelope
+     * @see kwlGetError
+     */
+    void kwlEventAutomate(kwlEventHandle handle, 
+                          kwlAutomatedParameter parameter, 
+                          float targetValue, 
+                          float durationSec, 
+                          kwlAutomationCurve curve);
+    
+    /**
+     * <p>Automates a parameter of a given event instance using a breakpoint envelope of 
+     * up to 8 breakpoints. The parameter holds the first value until the first breakpoint
+     * time, moves between consecutive breakpoints along the given curve and holds the last
+     * value once the envelope has finished. See \c kwlEventAutomate for details on how
+     * automated values are applied.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * <li>\c KWL_INVALID_EVENT_INSTANCE_HANDLE if the provided handle does not correspond to an event instance.</li>
+     * <li>\c KWL_EVENT_IS_NOT_NONPOSITIONAL if \c parameter is \c KWL_PARAMETER_BALANCE and the event is positional.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c numBreakpoints is not in [1, 8], if the breakpoint times are
+     * negative or decreasing, if a value is out of range for the parameter or if \c parameter or \c curve is invalid.</li>
+     * </ul>
+     * </p>
+     * @param handle An event handle corresponding to the event to automate.
+     * @param parameter The parameter to automate.
+     * @param timesSec The breakpoint times in seconds, relative to when the mixer picks up the envelope.
+     * @param values The breakpoint values.
+     * @param numBreakpoints The number of breakpoints.
+     * @param curve The shape of the transitions between breakpoints.
+     * @see kwlEventAutomate
+     * @see kwlGetError
+     */
+    void kwlEventSetEnvelope(kwlEventHandle handle, 
+                             kwlAutomatedParameter parameter,
+                             const float* timesSec, 
+                             const float* values, 
+                             int numBreakpoints,
+                             kwlAutomationCurve curve);
+    
+    /**
+     * <p>Like \c kwlEventSetEnvelope, but the envelope starts at a given frame on the sample clock.
+     * Until then, the parameter keeps its current value.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>See \c kwlEventSetEnvelope.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c startFrame is negative.</li>
+     * </ul>
+     * </p>
+     * @param handle An event handle corresponding to the event to automate.
+     * @param parameter The parameter to automate.
+     * @param startFrame The frame on the sample clock at which the envelope starts.
+     * @param timesSec The breakpoint times in seconds, relative to \c startFrame.
+     * @param values The breakpoint values.
+     * @param numBreakpoints The number of breakpoints.
+     * @param curve The shape of the transitions between breakpoints.
+     * @see kwlGetSampleClock
+     * @see kwlGetError
+     */
+    void kwlEventSetEnvelopeAt(kwlEventHandle handle, 
+                               kwlAutomatedParameter parameter,
+                               long long startFrame,
+                               const float* timesSec, 
+                               const float* values, 
+                               int numBreakpoints,
+                               kwlAutomationCurve curve);
+    
     /**
      * <p>Starts playback of a given event instance. If the instance is already playing, the behaviour
      * is defined by the retrigger mode of its event definition.</p>
@@ -502,6 +624,50 @@ extern "C"
      */
     void kwlEventStopFade(kwlEventHandle handle, float fadeTime);
     
+    /**
+     * <p>Schedules the start of an event instance at a given frame on the sample clock. 
+     * The mixer starts the event on exactly that frame, independently of the engine buffer size,
+     * provided the request reaches the mixer in time. Requests for frames that have already been
+     * mixed start the event as soon as possible. Use \c kwlGetSampleClock plus a margin of at least
+     * one engine buffer and one update interval to schedule events ahead of time.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * <li>\c KWL_INVALID_EVENT_INSTANCE_HANDLE if the provided handle does not correspond to an event instance.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c frame or \c fadeTime is negative.</li>
+     * </ul>
+     * </p>
+     * @param handle An event handle corresponding to the event to start.
+     * @param frame The frame on the sample clock at which to start the event.
+     * @param fadeTime The fade in duration in seconds, 0 for no fade.
+     * @see kwlEventStopAt
+     * @see kwlGetSampleClock
+     * @see kwlGetError
+     */
+    void kwlEventStartAt(kwlEventHandle handle, long long frame, float fadeTime);
+    
+    /**
+     * <p>Schedules the stop of an event instance at a given frame on the sample clock. 
+     * See \c kwlEventStartAt. Stopping an event without a frame cancels any scheduled start
+     * of the event that has not happened yet.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * <li>\c KWL_INVALID_EVENT_INSTANCE_HANDLE if the provided handle does not correspond to an event instance.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c frame or \c fadeTime is negative.</li>
+     * </ul>
+     * </p>
+     * @param handle An event handle corresponding to the event to stop.
+     * @param frame The frame on the sample clock at which to stop the event.
+     * @param fadeTime The fade out duration in seconds, 0 for no fade.
+     * @see kwlEventStartAt
+     * @see kwlGetSampleClock
+     * @see kwlGetError
+     */
+    void kwlEventStopAt(kwlEventHandle handle, long long frame, float fadeTime);
+    
     /**
      * <p>Pauses an event instance, suspending playback but leaving it active in the mixer.
      * If the instance is currently paused or not playing,
@@ -589,6 +755,29 @@ extern "C"
      */
     void kwlMixBusSetPitch(kwlMixBusHandle handle, float pitch);
     
+    /**
+     * <p>Sets the internal sample rate of a given mix bus. The events and sub buses of 
+     * the bus are mixed at this rate and the result is upsampled to the rate of the parent bus,
+     * which saves work for buses holding content without high frequencies, such as ambience or 
+     * distant sounds. Sub buses run at the rate of their parent unless a rate is set for them.</p>
+     * <p>The rate must be the output sample rate divided by an integer and the ratio between the
+     * rates of a bus and its parent may be at most 4. Only lowering the rate is supported, so
+     * a sub bus can not run at a higher rate than its parent. DSP units attached to the bus or
+     * its events process audio at the rate of the bus. The upsampling filter delays the output 
+     * of the bus by about 8 frames at the rate of the bus.</p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * <li>\c KWL_INVALID_MIX_BUS_HANDLE if the given handle does not correspond to a mix bus.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c sampleRate is negative.</li>
+     * <li>\c KWL_UNSUPPORTED_SAMPLE_RATE if the resulting bus rates are not supported.</li>
+     * </ul>
+     * </p>
+     * @param handle A handle to the mix bus to set the sample rate of.
+     * @param sampleRate The new sample rate in Hz, or 0 to use the rate of the parent bus.
+     */
+    void kwlMixBusSetSampleRate(kwlMixBusHandle handle, int sampleRate);
+    
     /**
      * <p>Sets the user gain of a mix bus corresponding to a given handle. The \c gain parameter
      * passed to this method is <strong>not</strong> a linear gain factor, but a parameter that gives an approximately
@@ -629,6 +818,91 @@ extern "C"
      */
     void kwlMixBusSetLinearGain(kwlMixBusHandle handle, float gain);
     
+    /**
+     * <p>Automates the gain or pitch of a given mix bus, moving it from its current value to 
+     * a target value over a given duration. The automation is evaluated by the mixer once per 
+     * mixed buffer and gain changes are ramped per sample. Automated values are applied on 
+     * top of the user and mix preset values and persist after the automation has finished.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * <li>\c KWL_INVALID_MIX_BUS_HANDLE if the given handle does not correspond to a mix bus.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c durationSec or \c targetValue is negative, if \c curve is 
+     * invalid or if \c parameter is not \c KWL_PARAMETER_GAIN or \c KWL_PARAMETER_PITCH.</li>
+     * </ul>
+     * </p>
+     * @param handle A handle to the mix bus to automate.
+     * @param parameter The parameter to automate.
+     * @param targetValue The value to move to. Gains are linear amplitude scale factors.
+     * @param durationSec The time in seconds it takes to reach the target value.
+     * @param curve The shape of the transition.
+     * @see kwlMixBusSetEnvelope
+     * @see kwlGetError
+     */
+    void kwlMixBusAutomate(kwlMixBusHandle handle, 
+                           kwlAutomatedParameter parameter, 
+                           float targetValue, 
+                           float durationSec, 
+                           kwlAutomationCurve curve);
+    
+    /**
+     * <p>Automates the gain or pitch of a given mix bus using a breakpoint envelope of up
+     * to 8 breakpoints. See \c kwlEventSetEnvelope.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * <li>\c KWL_INVALID_MIX_BUS_HANDLE if the given handle does not correspond to a mix bus.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c numBreakpoints is not in [1, 8], if the breakpoint times are
+     * negative or decreasing, if a value is negative, if \c curve is invalid or if \c parameter is not 
+     * \c KWL_PARAMETER_GAIN or \c KWL_PARAMETER_PITCH.</li>
+     * </ul>
+     * </p>
+     * @param handle A handle to the mix bus to automate.
+     * @param parameter The parameter to automate.
+     * @param timesSec The breakpoint times in seconds, relative to when the mixer picks up the envelope.
+     * @param values The breakpoint values.
+     * @param numBreakpoints The number of breakpoints.
+     * @param curve The shape of the transitions between breakpoints.
+     * @see kwlMixBusAutomate
+     * @see kwlGetError
+     */
+    void kwlMixBusSetEnvelope(kwlMixBusHandle handle, 
+                              kwlAutomatedParameter parameter,
+                              const float* timesSec, 
+                              const float* values, 
+                              int numBreakpoints,
+                              kwlAutomationCurve curve);
+    
+    /**
+     * <p>Like \c kwlMixBusSetEnvelope, but the envelope starts at a given frame on the sample clock.
+     * Until then, the parameter keeps its current value.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>See \c kwlMixBusSetEnvelope.</li>
+     * <li>\c KWL_INVALID_PARAMETER_VALUE if \c startFrame is negative.</li>
+     * </ul>
+     * </p>
+     * @param handle A handle to the mix bus to automate.
+     * @param parameter The parameter to automate.
+     * @param startFrame The frame on the sample clock at which the envelope starts.
+     * @param timesSec The breakpoint times in seconds, relative to \c startFrame.
+     * @param values The breakpoint values.
+     * @param numBreakpoints The number of breakpoints.
+     * @param curve The shape of the transitions between breakpoints.
+     * @see kwlGetSampleClock
+     * @see kwlGetError
+     */
+    void kwlMixBusSetEnvelopeAt(kwlMixBusHandle handle, 
+                                kwlAutomatedParameter parameter,
+                                long long startFrame,
+                                const float* timesSec, 
+                                const float* values, 
+                                int numBreakpoints,
+                                kwlAutomationCurve curve);
+    
     /** @} */
     
     /************************************************************************/
@@ -868,6 +1142,24 @@ extern "C"
      */
     unsigned int kwlGetNumFramesMixed();
     
+    /**
+     * <p>Returns the sample clock, i.e the total number of frames mixed since the mixer 
+     * started, as of the last call to \c kwlUpdate. The clock stops while the engine is paused.
+     * Frames on the sample clock are used to schedule event starts and stops and
+     * automation envelopes.</p>
+     * <p>
+     * <strong>Error codes:</strong>
+     * <ul>
+     * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+     * </ul>
+     * </p>
+     * @return The current value of the sample clock.
+     * @see kwlEventStartAt
+     * @see kwlEventStopAt
+     * @see kwlGetError()
+     */
+    long long kwlGetSampleClock();
+    
     /** @} */
     
     /************************************************************************/
@@ -892,6 +1184,8 @@ extern "C"
      * <li>\c KWL_WAVE_BANK_ENTRY_MISMATCH if there is not a one-to-one correspondence between the
      * audio data entryies in the wave bank file and the entries in the corresponding
      * wave bank structure in the engine.</li>
+     * <li>\c KWL_WAVE_BANK_ID_TOO_LONG if the wave bank ID or an audio data entry ID stored 
+     * in the wave bank file is 1024 characters or longer.</li>
      * </ul>
      * </p>
      * @param fileName The path of the wave bank file to load.
@@ -32,6 +32,7 @@ freely, subject to the following restrictions:
  */ 
 
 #include "kowalski.h"
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -153,6 +154,24 @@ kwlDSPUnitHandle kwlDSPUnitCreateCustom(void* userdata,
                                         kwlDSPUpdateCallback updateMixer, 
                                         kwlDSPCleanupCallback cleanup);
     
+/**
+ * <p>Declares the tail length of a DSP unit, i.e the number of frames it keeps producing
+ * output after its input goes silent. A mix bus DSP unit with a known tail is only processed 
+ * while the bus has playing events and for the duration of the tail afterwards, which saves 
+ * mixing time for idle buses. By default, the tail length is unknown and the DSP unit 
+ * is processed on every buffer. Should be called before attaching the DSP unit.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c dspUnit is NULL.</li>
+ * </ul>
+ * </p>
+ * @param dspUnit The DSP unit to set the tail length of.
+ * @param numFrames The tail length in frames. Pass a negative value if the tail length is unknown.
+ * @see kwlDSPUnitAttachToMixBus
+ */
+void kwlDSPUnitSetTailLength(kwlDSPUnitHandle dspUnit, int numFrames);
+    
 /**
  *<p>Returns a non-zero integer if audio input is currently enabled and zero otherwise</p>
  * <p>
@@ -168,6 +187,336 @@ int kwlIsInputEnabled();
 /** @} */ /*End of DSP units group*/
     
     
+/************************************************************************/
+/**
+ * @name Memory management
+ *  Hooks for routing the engine's memory allocations through a custom allocator.
+ */
+/** @{ */
+    
+/**
+ * A callback used by the engine to allocate memory.
+ * @param size The number of bytes to allocate.
+ * @param userData The user data passed to \c kwlSetAllocator.
+ * @return A pointer to the allocated block, or NULL on failure.
+ */
+typedef void* (*kwlAllocateCallback)(size_t size, void* userData);
+    
+/**
+ * A callback used by the engine to release memory allocated by a \c kwlAllocateCallback.
+ * @param pointer The block to release.
+ * @param userData The user data passed to \c kwlSetAllocator.
+ */
+typedef void (*kwlDeallocateCallback)(void* pointer, void* userData);
+
+/**
+ * <p>Sets the allocator that all memory used by the engine is requested from. 
+ * Engine data, wave bank metadata and temporary engine thread allocations are 
+ * grouped into arenas that are carved out of larger blocks, so the callbacks are
+ * invoked far less often than the number of objects allocated. Must be called before
+ * \c kwlInitialize. Passing NULL callbacks restores the default allocator (malloc and free).</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_ALREADY_INITIALIZED if the engine or any other context is initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if exactly one of the callbacks is NULL.</li>
+ * </ul>
+ * </p> 
+ * @param allocate The allocation callback.
+ * @param deallocate The deallocation callback.
+ * @param userData Optional user data passed to the callbacks.
+ */
+void kwlSetAllocator(kwlAllocateCallback allocate, kwlDeallocateCallback deallocate, void* userData);
+    
+/** @} */ /* End of memory management block */
+    
+    
+/************************************************************************/
+/**
+ * @name Pull mode rendering
+ *  Functions for driving the mixer from an audio callback owned by the host application.
+ *  These are meant for builds using the external host (hosts/external), which opens no
+ *  audio device of its own. All of them must be called from the same thread, typically
+ *  the application's audio thread, and must not be used alongside a device host.
+ */
+/** @{ */
+    
+/**
+ * <p>Mixes the next \c numFrames frames of output directly into \c buffer, with the 
+ * channels interleaved. Any number of frames can be requested and no intermediate 
+ * copy of the mixed output is made.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c buffer is NULL or \c numFrames is negative.</li>
+ * </ul>
+ * </p>
+ * @param buffer A buffer of at least \c numFrames times the number of output channels samples.
+ * @param numFrames The number of frames to mix.
+ * @see kwlRenderPlanar
+ */
+void kwlRender(float* buffer, int numFrames);
+    
+/**
+ * <p>Mixes the next \c numFrames frames of output into one buffer per output channel.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c buffers or any of the channel buffers is NULL, or
+ * if \c numFrames is negative.</li>
+ * </ul>
+ * </p>
+ * @param buffers An array with one buffer of at least \c numFrames samples per output channel.
+ * @param numFrames The number of frames to mix.
+ * @see kwlRender
+ */
+void kwlRenderPlanar(float** buffers, int numFrames);
+    
+/**
+ * <p>Passes \c numFrames frames of interleaved audio input to the input DSP unit, if any.
+ * Has no effect if audio input is not enabled.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c buffer is NULL or \c numFrames is negative.</li>
+ * </ul>
+ * </p>
+ * @param buffer A buffer of \c numFrames times the number of input channels samples.
+ * @param numFrames The number of input frames.
+ * @see kwlDSPUnitAttachToInput
+ */
+void kwlProcessInput(const float* buffer, int numFrames);
+    
+/**
+ * <p>Passes \c numFrames frames of audio input, one buffer per input channel, to the 
+ * input DSP unit, if any. Has no effect if audio input is not enabled.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c buffers or any of the channel buffers is NULL, or
+ * if \c numFrames is negative.</li>
+ * </ul>
+ * </p>
+ * @param buffers An array with one buffer of \c numFrames samples per input channel.
+ * @param numFrames The number of input frames.
+ * @see kwlProcessInput
+ */
+void kwlProcessInputPlanar(const float* const* buffers, int numFrames);
+    
+/** @} */ /* End of pull mode rendering block */
+    
+    
+/************************************************************************/
+/**
+ * @name Low latency mode
+ *  Settings for rendering small, fixed size buffers efficiently.
+ */
+/** @{ */
+    
+/**
+ * <p>Makes the mixer render output in fixed size quanta of \c quantumSize frames. In this mode,
+ * incoming messages from the engine thread are processed and mixing parameters are synced
+ * once every 256 frames instead of once per buffer, so that the cost is shared by the quanta 
+ * rendered in between. This lets the engine keep up with very small audio buffers, at the 
+ * price of up to 256 frames of extra latency for parameter changes and non-scheduled starts 
+ * and stops. Events scheduled with \c kwlEventStartAt and \c kwlEventStopAt remain sample 
+ * accurate.</p>
+ * <p>If \c numQuantaAhead is greater than zero, that many quanta are kept rendered ahead of
+ * the output. Buffers can then be served from this queue without mixing, which absorbs
+ * jitter in the timing of the audio callback, but adds \c numQuantaAhead times \c quantumSize
+ * frames of output latency.</p>
+ * <p>The settings are shared by all threads and are applied to contexts created after the
+ * call, by \c kwlInitialize or \c kwlContextCreate. Contexts that already exist keep the 
+ * settings they were created with.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c quantumSize is not in the range [0, 1024] or
+ * if \c numQuantaAhead is not in the range [0, 8].</li>
+ * </ul>
+ * </p> 
+ * @param quantumSize The quantum size in frames, typically 32 to 128. Pass 0 to disable low
+ * latency mode, which is the default.
+ * @param numQuantaAhead The number of quanta to render ahead of the output.
+ * @see kwlInitialize
+ */
+void kwlSetRenderQuantum(int quantumSize, int numQuantaAhead);
+    
+/** @} */ /* End of low latency mode block */
+    
+    
+/************************************************************************/
+/**
+ * @name Contexts
+ *  Functions for running several independent engines in one process, e.g for rendering
+ *  many sessions offline on a server. Each context has its own engine data, wave banks, 
+ *  events and mixer, while identical wave bank audio data is loaded once and shared by all
+ *  contexts. All other functions operate on the context that is current on the calling 
+ *  thread, which is the default context created by \c kwlInitialize unless another context 
+ *  has been made current using \c kwlContextMakeCurrent. Errors are tracked per thread.
+ *  Contexts must be created and destroyed from one thread at a time. The PortAudio and external
+ *  hosts support any number of contexts, the latter letting each context be rendered with 
+ *  \c kwlRender on its own thread. The SDL and iPhone hosts support a single context.
+ */
+/** @{ */
+    
+/** A reference to an engine context.*/
+typedef struct kwlEngine* kwlContextHandle;
+    
+/**
+ * <p>Creates and initializes a new context. The new context does not become current.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_UNSUPPORTED_NUM_OUTPUT_CHANNELS if \c numOutputChannels is not 1 or 2.</li>
+ * <li>\c KWL_UNSUPPORTED_NUM_INPUT_CHANNELS if \c numInputChannels is not in the range [0, 2].</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c sampleRate or \c bufferSize is not positive.</li>
+ * </ul>
+ * </p>
+ * @param sampleRate The output sample rate.
+ * @param numOutputChannels The number of output channels.
+ * @param numInputChannels The number of input channels.
+ * @param bufferSize The host buffer size in frames.
+ * @return The new context, or NULL if it could not be created.
+ * @see kwlInitialize
+ */
+kwlContextHandle kwlContextCreate(int sampleRate, int numOutputChannels, int numInputChannels, int bufferSize);
+    
+/**
+ * <p>Unloads any engine data and wave banks loaded by a context, shuts it down and frees it.
+ * The context must not be current on any other thread. Use \c kwlDeinitialize to destroy 
+ * the default context.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c context is NULL or the default context.</li>
+ * </ul>
+ * </p>
+ * @param context The context to destroy.
+ */
+void kwlContextDestroy(kwlContextHandle context);
+    
+/**
+ * <p>Makes subsequent calls on the calling thread operate on \c context.
+ * Passing NULL makes the default context current.</p>
+ * @param context The context to make current, or NULL.
+ * @see kwlContextGetCurrent
+ */
+void kwlContextMakeCurrent(kwlContextHandle context);
+    
+/**
+ * @return The context current on the calling thread, or NULL if the default
+ * context is current but not initialized.
+ * @see kwlContextMakeCurrent
+ */
+kwlContextHandle kwlContextGetCurrent();
+    
+/** @} */ /* End of contexts block */
+    
+    
+/************************************************************************/
+/**
+ * @name Logging
+ *  Diagnostic messages from the engine. Messages are queued in a lock-free ring buffer
+ *  when they are raised, on any thread, and passed on to the log callback from \c kwlUpdate, 
+ *  so logging never blocks the mixer. Messages more verbose than \c KWL_LOG_MAX_LEVEL, 
+ *  which defaults to \c KWL_LOG_LEVEL_INFO, are compiled out of the engine.
+ */
+/** @{ */
+    
+/** Log message levels, from least to most verbose.*/
+typedef enum
+{
+    /** No messages.*/
+    KWL_LOG_LEVEL_NONE = 0,
+    /** Errors, e.g failures that cannot be reported through an error code.*/
+    KWL_LOG_LEVEL_ERROR,
+    /** Problems that may cause audible glitches, e.g decoders falling behind.*/
+    KWL_LOG_LEVEL_WARNING,
+    /** Infrequent state changes, e.g data being unloaded.*/
+    KWL_LOG_LEVEL_INFO,
+    /** Per event messages, e.g events being started and stopped.*/
+    KWL_LOG_LEVEL_DEBUG
+} kwlLogLevel;
+    
+/**
+ * A callback receiving log messages. Invoked on the thread calling \c kwlUpdate.
+ * @param level The level of the message.
+ * @param message The null terminated message, without a trailing newline. Only valid during the call.
+ * @param userData The user data passed to \c kwlSetLogCallback.
+ */
+typedef void (*kwlLogCallback)(kwlLogLevel level, const char* message, void* userData);
+    
+/**
+ * <p>Sets the most verbose level of messages to log. The default is \c KWL_LOG_LEVEL_WARNING.
+ * Levels above the compile time maximum have no effect.</p>
+ * @param level The log level.
+ */
+void kwlSetLogLevel(kwlLogLevel level);
+    
+/**
+ * <p>Sets the callback that receives log messages. By default, messages are printed to stdout.
+ * Must not be called while another thread is calling \c kwlUpdate.</p>
+ * @param callback The callback, or NULL to restore the default.
+ * @param userData Optional user data passed to the callback.
+ */
+void kwlSetLogCallback(kwlLogCallback callback, void* userData);
+    
+/** @} */ /* End of logging block */
+    
+    
+/************************************************************************/
+/**
+ * @name Audio memory budget
+ *  Functions for limiting the memory used by wave bank audio data.
+ */
+/** @{ */
+    
+/**
+ * <p>Sets the number of bytes of non-streaming wave bank audio data the engine keeps resident.
+ * When loaded wave banks exceed the budget, audio data that is not used by any playing event
+ * is evicted, least recently played first. Evicted audio data stays loaded as far as the
+ * wave bank API is concerned. It is reloaded on a separate thread when an event using it is
+ * started, and events started before it has been reloaded stream it from the wave bank file
+ * instead, provided there is a free decoder. Audio data used by playing events is never evicted,
+ * so usage may temporarily exceed the budget.</p>
+ * <p>The default is 0, meaning that there is no budget and nothing is ever evicted.</p>
+ * <p>The budget applies to the current context, but is compared against the audio data resident
+ * in all contexts since identical audio data is shared between them. Only audio data loaded by 
+ * the current context is evicted.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the engine is not initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c numBytes is negative.</li>
+ * </ul>
+ * </p> 
+ * @param numBytes The budget in bytes, or 0 to disable eviction.
+ * @see kwlGetAudioMemoryUsage
+ */
+void kwlSetAudioMemoryBudget(int numBytes);
+
+/**
+ * <p>Returns the number of bytes of resident wave bank audio data in all contexts. Audio data 
+ * shared by several wave banks is only counted once.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the engine is not initialized.</li>
+ * </ul>
+ * </p> 
+ * @return The number of bytes of resident audio data.
+ * @see kwlSetAudioMemoryBudget
+ */
+int kwlGetAudioMemoryUsage();
+    
+/** @} */ /* End of audio memory budget block */
+    
+    
 /************************************************************************/
 /**
  * @name Audio file utilities
@@ -272,6 +621,97 @@ typedef void (*kwlEventStoppedCallack)(void* userData);
  */    
 kwlEventHandle kwlEventCreateWithBuffer(kwlPCMBuffer* buffer, kwlEventType eventType);
 
+/**
+ * A handle to the ring buffer of a push stream event, used to feed it audio.
+ */
+typedef struct kwlPushStream* kwlPushStreamHandle;
+    
+/**
+ * <p>Creates a freeform event that plays audio the application feeds it incrementally, for 
+ * example generated audio, voice chat or text to speech. The audio is queued in a ring buffer 
+ * of \c capacityInFrames frames that the mixer plays from in place. The event plays like any 
+ * other freeform event, with pitch, DSP units and automation, until it is stopped.</p>
+ * <p>Playback starts once \c latencyInFrames frames have been queued. If the queue runs 
+ * empty, the event plays silence until \c latencyInFrames frames have been queued again.
+ * A larger latency makes such underruns less likely at the cost of delay. The most recently
+ * queued frame is only played once the next one has been queued, so playback needs at
+ * least two queued frames.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_POSITIONAL_EVENT_MUST_BE_MONO if \c numChannels is 2 and \c eventType is \c KWL_POSITIONAL.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c numChannels is not 1 or 2, if \c capacityInFrames
+ * is less than 2 or if \c latencyInFrames is not in the range [0, capacityInFrames].</li>
+ * </ul>
+ * </p> 
+ * @param numChannels The number of channels of the queued audio, 1 or 2.
+ * @param capacityInFrames The maximum number of queued frames.
+ * @param latencyInFrames The number of frames to queue before starting or resuming playback.
+ * @param eventType The type of the event.
+ * @return An event handle corresponding to the created event or \c KWL_INVALID_HANDLE if an error occurred.
+ * @see kwlEventGetPushStream
+ */    
+kwlEventHandle kwlEventCreatePushStream(int numChannels, int capacityInFrames, int latencyInFrames, kwlEventType eventType);
+    
+/**
+ * <p>Returns the push stream that feeds a given push stream event. The stream stays valid
+ * until the event is released, and must not be written to after that.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_EVENT_INSTANCE_HANDLE if the provided handle does not correspond to an event instance.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if the event was not created with \c kwlEventCreatePushStream.</li>
+ * </ul>
+ * </p> 
+ * @param event The push stream event.
+ * @return The push stream of the event or NULL if an error occurred.
+ * @see kwlPushStreamWrite
+ */
+kwlPushStreamHandle kwlEventGetPushStream(kwlEventHandle event);
+    
+/**
+ * <p>Queues interleaved 16 bit frames for playback, as many as there is room for. The frames 
+ * are copied, so the buffer can be reused as soon as this function returns. Wait-free and 
+ * safe to call from any single thread, independently of the thread updating the engine.
+ * Does not set an error code.</p>
+ * @param stream The push stream.
+ * @param frames The interleaved frames to queue.
+ * @param numFrames The number of frames to queue.
+ * @return The number of frames queued, which is less than \c numFrames if the ring buffer 
+ * is full, or 0 if \c stream or \c frames is NULL.
+ * @see kwlPushStreamWriteFloat
+ */
+int kwlPushStreamWrite(kwlPushStreamHandle stream, const short* frames, int numFrames);
+    
+/**
+ * <p>Like \c kwlPushStreamWrite, but queues interleaved floating point frames in the range
+ * [-1, 1]. Values outside this range are clamped.</p>
+ * @param stream The push stream.
+ * @param frames The interleaved frames to queue.
+ * @param numFrames The number of frames to queue.
+ * @return The number of frames queued.
+ * @see kwlPushStreamWrite
+ */
+int kwlPushStreamWriteFloat(kwlPushStreamHandle stream, const float* frames, int numFrames);
+    
+/**
+ * <p>Returns the number of queued frames that have not been played yet. Can be called 
+ * from any thread. Does not set an error code.</p>
+ * @param stream The push stream.
+ * @return The number of queued frames, or 0 if \c stream is NULL.
+ */
+int kwlPushStreamGetNumQueuedFrames(kwlPushStreamHandle stream);
+    
+/**
+ * <p>Returns the number of times playback has run out of queued frames. Can be called 
+ * from any thread. Does not set an error code.</p>
+ * @param stream The push stream.
+ * @return The number of underruns, or 0 if \c stream is NULL.
+ */
+int kwlPushStreamGetNumUnderruns(kwlPushStreamHandle stream);
+
 /**
  * <p>Specifies a callback to invoke when a given event instance stops playing.</p>
  * <p>
@@ -336,6 +776,203 @@ void kwlEventStartOneShotWithCallback(kwlEventDefinitionHandle handle, kwlEventS
 void kwlEventStartOneShotWithCallbackAt(kwlEventDefinitionHandle eventDefinition, float x, float y, float z, kwlEventStoppedCallack callback, void* userData);
  
 /** @} */ /*End of event interface extensions group*/
+
+/************************************************************************/
+/**
+ * @name Batched event updates
+ *  Functions for updating the parameters of many event instances in a single call,
+ *  e.g from arrays of emitter transforms kept by the application. A batch is applied
+ *  in one pass over the records. Records that fail validation are skipped without
+ *  modifying their event instance and the remaining records are still applied. The
+ *  error reported by \c kwlGetError is that of the first failing record.
+ */
+/** @{ */
+
+/** Flags selecting which fields of a \c kwlEventUpdate to apply.*/
+typedef enum
+{
+    /** Apply \c position, see \c kwlEventSetPosition.*/
+    KWL_UPDATE_POSITION = 1 << 0,
+    /** Apply \c velocity, see \c kwlEventSetVelocity.*/
+    KWL_UPDATE_VELOCITY = 1 << 1,
+    /** Apply \c orientation, see \c kwlEventSetOrientation.*/
+    KWL_UPDATE_ORIENTATION = 1 << 2,
+    /** Apply \c gain as a perceptual gain, see \c kwlEventSetGain.*/
+    KWL_UPDATE_GAIN = 1 << 3,
+    /** Apply \c gain as a linear gain, see \c kwlEventSetLinearGain.*/
+    KWL_UPDATE_LINEAR_GAIN = 1 << 4,
+    /** Apply \c pitch, see \c kwlEventSetPitch.*/
+    KWL_UPDATE_PITCH = 1 << 5
+} kwlEventUpdateFlags;
+
+/** A set of parameter changes for a single event instance.*/
+typedef struct kwlEventUpdate
+{
+    /** The event instance to update.*/
+    kwlEventHandle handle;
+    /** A bitwise OR of \c kwlEventUpdateFlags selecting the fields to apply.*/
+    unsigned int fields;
+    /** The x, y and z components of the position.*/
+    float position[3];
+    /** The x, y and z components of the velocity.*/
+    float velocity[3];
+    /** The x, y and z components of the facing direction. Does not need to be normalized.*/
+    float orientation[3];
+    /** The user gain.*/
+    float gain;
+    /** The pitch. 1 is unit pitch.*/
+    float pitch;
+} kwlEventUpdate;
+
+/**
+ * <p>Applies an array of event instance updates. Each record is validated and applied
+ * like the corresponding individual setters would.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c updates is NULL and \c numUpdates is positive, or
+ * if a record has a negative gain or pitch, a zero length orientation or both gain flags set.</li>
+ * <li>\c KWL_INVALID_EVENT_INSTANCE_HANDLE if a record handle does not correspond to an event instance.</li>
+ * <li>\c KWL_EVENT_IS_NOT_POSITIONAL if a record sets position, velocity or orientation
+ * of a non-positional event.</li>
+ * </ul>
+ * </p>
+ * @param updates The update records.
+ * @param numUpdates The number of update records.
+ * @return The number of records that were applied.
+ * @see kwlEventSetPositions
+ * @see kwlGetError
+ */
+int kwlEventUpdateBatch(const kwlEventUpdate* updates, int numUpdates);
+
+/**
+ * <p>Sets the positions of a number of event instances from separate arrays of
+ * x, y and z components, where element \c i of each array belongs to \c handles[i].</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if any of the arrays is NULL and \c numEvents is positive.</li>
+ * <li>\c KWL_INVALID_EVENT_INSTANCE_HANDLE if a handle does not correspond to an event instance.</li>
+ * <li>\c KWL_EVENT_IS_NOT_POSITIONAL if a handle corresponds to a non-positional event.</li>
+ * </ul>
+ * </p>
+ * @param handles The event instances to update.
+ * @param x The x components of the positions.
+ * @param y The y components of the positions.
+ * @param z The z components of the positions.
+ * @param numEvents The number of elements in each array.
+ * @return The number of event instances that were updated.
+ * @see kwlEventUpdateBatch
+ * @see kwlGetError
+ */
+int kwlEventSetPositions(const kwlEventHandle* handles,
+                         const float* x, const float* y, const float* z,
+                         int numEvents);
+
+/** @} */ /* End of batched event updates block */
+
+/************************************************************************/
+/**
+ * @name Voice level of detail
+ *  Quiet and distant events can be rendered at reduced quality to save mixer time,
+ *  e.g for crowds and ambient swarms. Each update, the loudest channel gain of every 
+ *  playing event, including distance attenuation, picks one of three rendering tiers:
+ *  <ul>
+ *  <li>Full quality, where every source channel is pitched and mixed separately.</li>
+ *  <li>Mono, where stereo sources are summed to mono before being pitched and panned.</li>
+ *  <li>Half rate, which is like mono but renders at half the output sample rate. The half rate
+ * *  output of all events in a mix bus is upsampled once, with linear interpolation, and delayed by one frame.
+ *  Buffers with an odd number of frames are rendered in mono instead.</li>
+ *  </ul>
+ *  An event keeps its playback position and gain ramp when changing tiers, and must get 
+ *  about 3.5 dB louder than a threshold before moving back to a better tier. Events with
+ *  DSP units are never rendered at half rate.
+ */
+/** @{ */
+
+/**
+ * <p>Sets the linear gains below which events are rendered at reduced quality. 
+ * A threshold of 0, the default, disables the corresponding tier.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if a threshold is negative or if \c halfRateThreshold
+ * is greater than \c monoThreshold.</li>
+ * </ul>
+ * </p>
+ * @param monoThreshold Events quieter than this are rendered in mono.
+ * @param halfRateThreshold Events quieter than this are rendered in mono at half the output sample rate.
+ * @see kwlGetError
+ */
+void kwlSetVoiceLODThresholds(float monoThreshold, float halfRateThreshold);
+
+/** @} */ /* End of voice level of detail block */
+
+/****/
+/** @name Spatial index
+ *  Functions for scaling positional audio to large numbers of events, e.g open worlds 
+ *  with thousands of emitters. The spatial index is a uniform grid of cubic cells that 
+ *  playing positional events are sorted into as their positions change. Each update, 
+ *  only events in cells within the maximum distance of the listener, as set by 
+ *  \c kwlSetDistanceAttenuationModel, get their gain, pan and cone attenuation computed. 
+ *  Events further away are inaudible anyway, so they are silenced and, once silent, 
+ *  made virtual: they are not mixed and their event DSP units are not run. Their pitch, 
+ *  including doppler shift, is still updated, so their playback position advances 
+ *  at the same rate as without the index. Without the index, such events are rendered 
+ *  at the cheapest voice LOD tier instead, so output with and without the index matches 
+ *  up to rounding of the playback positions of distant events, but is not bit identical.
+ *  The index has no effect if the maximum distance is 0 or less.
+ */
+/** @{ */
+
+/**
+ * <p>Enables the spatial index with a given cell size, or disables it. The index is 
+ * disabled by default. Cells about as large as the maximum distance usually work well.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * <li>\c KWL_INVALID_PARAMETER_VALUE if \c cellSize is negative.</li>
+ * </ul>
+ * </p>
+ * @param cellSize The edge length of a grid cell, in the same unit as event positions. 
+ * 0 disables the index.
+ * @see kwlGetError
+ */
+void kwlSetSpatialIndexCellSize(float cellSize);
+
+/** @} */ /* End of spatial index block */
+
+/****/
+/** @name Deterministic playback
+ *  Random choices made during playback, i.e audio data picked by sounds with random 
+ *  playback modes, gain and pitch variations and instances picked by \c KWL_STEAL_RANDOM,
+ *  come from a seeded random number generator. Every event instance gets its own generator, 
+ *  seeded by the engine when the instance starts. Given the same seed, engine data and 
+ *  sequence of API calls, and with audio rendered through an external host, e.g by calling 
+ *  \c kwlRender from a test, playback is therefore repeatable down to the sample. This makes it 
+ *  possible to compare rendered output against previously recorded output.
+ */
+/** @{ */
+
+/**
+ * <p>Reseeds the random number generator of the engine. Only events started after the
+ * call are affected. Initializing the engine resets the generator to a fixed default seed.</p>
+ * <p>
+ * <strong>Error codes:</strong>
+ * <ul>
+ * <li>\c KWL_ENGINE_IS_NOT_INITIALIZED if the Kowalski engine has not been initialized.</li>
+ * </ul>
+ * </p>
+ * @param seed The seed. Any value is valid.
+ * @see kwlGetError
+ */
+void kwlSetRandomSeed(unsigned int seed);
+
+/** @} */ /* End of deterministic playback block */
     
 #ifdef __cplusplus
 }
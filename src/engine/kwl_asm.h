@@ -185,6 +185,31 @@ extern "C"
         }
     }
     
+    /**
+     * Mixes a given source buffer into a given target buffer, applying 
+     * a gain that changes linearly from frame to frame.
+     * @param sourceBuffer The buffer of source samples.
+     * @param targetBuffer The buffer to mix into.
+     * @param size The size of \c sourceBuffer and \c targetBuffer.
+     * @param offset The index of the first sample to mix.
+     * @param stride The distance between samples to mix.
+     * @param startGain The gain to apply to the first mixed sample.
+     * @param gainIncr The gain increment between consecutive mixed samples.
+     */
+    static inline void kwlMixFloatBufferWithGainRamp(float* sourceBuffer, float* targetBuffer,
+                                                     int size, int offset, int stride, 
+                                                     float startGain, float gainIncr)
+    {
+        float gain = startGain;
+        int i = offset;
+        while (i < size)
+        {
+            targetBuffer[i] += gain * sourceBuffer[i];
+            gain += gainIncr;
+            i += stride;
+        }
+    }
+    
     static inline void kwlApplyGainRamp(float* outBuffer,
                                         int numOutChannels,
                                         int numFrames,
@@ -310,6 +335,270 @@ extern "C"
         *pitchAccumulator = pitchAccum;
     }
     
+    /**
+     * Converts signed shorts to floats and adds them to a target buffer, applying a linear gain ramp.
+     * This fuses conversion, gain, panning and mixing into a single pass over the target buffer.
+     * @param sourceBuffer The buffer of source samples.
+     * @param targetBuffer The buffer to mix into.
+     * @param maxTargetPosPlusOne The target position at which to stop.
+     * @param sourceReadPos The source read position, updated on return.
+     * @param sourceStride The distance between source samples to read.
+     * @param targetReadPos The target write position, updated on return.
+     * @param targetStride The distance between target samples to write.
+     * @param gain The gain of the first sample, including the 1/32767 scaling. Updated on return.
+     * @param gainIncrPerFrame The gain increment per target sample.
+     */
+    static inline void kwlInt16MixWithGainRamp(short* sourceBuffer,
+                                               float* targetBuffer,
+                                               int maxTargetPosPlusOne,
+                                               int* sourceReadPos,
+                                               int sourceStride,
+                                               int* targetReadPos,
+                                               int targetStride,
+                                               float* gain,
+                                               float gainIncrPerFrame)
+    {
+        KWL_ASSERT(sourceBuffer != NULL);
+        KWL_ASSERT(targetBuffer != NULL);
+        KWL_ASSERT(*sourceReadPos >= 0);
+        KWL_ASSERT(*targetReadPos >= 0);
+        KWL_ASSERT(sourceStride >= 0);
+        KWL_ASSERT(targetStride >= 0);
+        
+        int srcPos = *sourceReadPos;
+        int targetPos = *targetReadPos;
+        float g = *gain;
+        if (gainIncrPerFrame == 0.0f)
+        {
+            while (targetPos < maxTargetPosPlusOne)
+            {
+                targetBuffer[targetPos] += g * sourceBuffer[srcPos];
+                targetPos += targetStride;
+                srcPos += sourceStride;
+            }
+        }
+        else
+        {
+            while (targetPos < maxTargetPosPlusOne)
+            {
+                targetBuffer[targetPos] += g * sourceBuffer[srcPos];
+                g += gainIncrPerFrame;
+                targetPos += targetStride;
+                srcPos += sourceStride;
+            }
+        }
+        
+        *sourceReadPos = srcPos;
+        *targetReadPos = targetPos;
+        *gain = g;
+    }
+    
+    /**
+     * Like \c kwlInt16MixWithGainRamp, but with linear interpolation pitch shifting.
+     * @see kwlInt16MixWithGainRamp
+     * @param pitch The pitch.
+     * @param pitchAccumulator The fractional source position, updated on return.
+     */
+    static inline void kwlInt16MixWithGainRampAndPitch(short* sourceBuffer,
+                                                       float* targetBuffer,
+                                                       int maxTargetPosPlusOne,
+                                                       int* sourceReadPos,
+                                                       int sourceStride,
+                                                       int* targetReadPos,
+                                                       int targetStride,
+                                                       float* gain,
+                                                       float gainIncrPerFrame,
+                                                       float pitch,
+                                                       float* pitchAccumulator)
+    {
+        KWL_ASSERT(sourceBuffer != NULL);
+        KWL_ASSERT(targetBuffer != NULL);
+        KWL_ASSERT(*sourceReadPos >= 0);
+        KWL_ASSERT(*targetReadPos >= 0);
+        KWL_ASSERT(sourceStride >= 0);
+        KWL_ASSERT(targetStride >= 0);
+        KWL_ASSERT(pitch > 0);
+        
+        int srcPos = *sourceReadPos;
+        int targetPos = *targetReadPos;
+        float pitchAccum = *pitchAccumulator;
+        float g = *gain;
+        
+        while (targetPos < maxTargetPosPlusOne)
+        {
+            const float s0 = sourceBuffer[srcPos];
+            const float s1 = sourceBuffer[srcPos + sourceStride];
+            targetBuffer[targetPos] += g * (s0 + pitchAccum * (s1 - s0));
+            g += gainIncrPerFrame;
+            pitchAccum += pitch;
+            const int accumulatorIntegerPart = (int)(pitchAccum);
+            srcPos += accumulatorIntegerPart * sourceStride;
+            pitchAccum -= accumulatorIntegerPart;
+            targetPos += targetStride;
+        }
+        
+        *sourceReadPos = srcPos;
+        *targetReadPos = targetPos;
+        *pitchAccumulator = pitchAccum;
+        *gain = g;
+    }
+
+    /**
+     * Returns the source frame at a given position as a single value. Stereo
+     * frames are summed to mono.
+     */
+    static inline float kwlInt16GetMonoSample(const short* sourceBuffer, int pos, int numSourceChannels)
+    {
+        return numSourceChannels == 1 ?
+               (float)sourceBuffer[pos] :
+               0.5f * ((float)sourceBuffer[pos] + (float)sourceBuffer[pos + 1]);
+    }
+
+    /**
+     * Like \c kwlInt16MixWithGainRamp, but reads each source frame once as a mono
+     * sample and mixes it into both channels of a stereo target buffer, with a
+     * gain ramp per channel. Stereo source frames are summed to mono.
+     * @param sourceBuffer The buffer of source samples.
+     * @param targetBuffer The interleaved stereo buffer to mix into.
+     * @param maxTargetPosPlusOne The target sample position at which to stop.
+     * @param sourceReadPos The source read position of the first channel of a frame, updated on return.
+     * @param numSourceChannels The number of source channels, 1 or 2.
+     * @param targetReadPos The target write position of the left channel of a frame, updated on return.
+     * @param gains The left and right gains of the first frame, including the 1/32767 scaling. Updated on return.
+     * @param gainIncrPerFrame The left and right gain increments per target frame.
+     */
+    static inline void kwlInt16MixToStereoWithGainRamp(short* sourceBuffer,
+                                                       float* targetBuffer,
+                                                       int maxTargetPosPlusOne,
+                                                       int* sourceReadPos,
+                                                       int numSourceChannels,
+                                                       int* targetReadPos,
+                                                       float* gains,
+                                                       const float* gainIncrPerFrame)
+    {
+        KWL_ASSERT(sourceBuffer != NULL);
+        KWL_ASSERT(targetBuffer != NULL);
+        KWL_ASSERT(*sourceReadPos >= 0);
+        KWL_ASSERT(*targetReadPos >= 0);
+        KWL_ASSERT(numSourceChannels == 1 || numSourceChannels == 2);
+
+        int srcPos = *sourceReadPos;
+        int targetPos = *targetReadPos;
+        float gLeft = gains[0];
+        float gRight = gains[1];
+        const float gLeftIncr = gainIncrPerFrame[0];
+        const float gRightIncr = gainIncrPerFrame[1];
+
+        while (targetPos < maxTargetPosPlusOne)
+        {
+            const float s = kwlInt16GetMonoSample(sourceBuffer, srcPos, numSourceChannels);
+            targetBuffer[targetPos] += gLeft * s;
+            targetBuffer[targetPos + 1] += gRight * s;
+            gLeft += gLeftIncr;
+            gRight += gRightIncr;
+            targetPos += 2;
+            srcPos += numSourceChannels;
+        }
+
+        *sourceReadPos = srcPos;
+        *targetReadPos = targetPos;
+        gains[0] = gLeft;
+        gains[1] = gRight;
+    }
+
+    /**
+     * Like \c kwlInt16MixToStereoWithGainRamp, but with linear interpolation pitch shifting.
+     * The interpolation is done once per frame and shared by both target channels.
+     * @see kwlInt16MixToStereoWithGainRamp
+     * @param pitch The pitch.
+     * @param pitchAccumulator The fractional source position, updated on return.
+     */
+    static inline void kwlInt16MixToStereoWithGainRampAndPitch(short* sourceBuffer,
+                                                               float* targetBuffer,
+                                                               int maxTargetPosPlusOne,
+                                                               int* sourceReadPos,
+                                                               int numSourceChannels,
+                                                               int* targetReadPos,
+                                                               float* gains,
+                                                               const float* gainIncrPerFrame,
+                                                               float pitch,
+                                                               float* pitchAccumulator)
+    {
+        KWL_ASSERT(sourceBuffer != NULL);
+        KWL_ASSERT(targetBuffer != NULL);
+        KWL_ASSERT(*sourceReadPos >= 0);
+        KWL_ASSERT(*targetReadPos >= 0);
+        KWL_ASSERT(numSourceChannels == 1 || numSourceChannels == 2);
+        KWL_ASSERT(pitch > 0);
+
+        int srcPos = *sourceReadPos;
+        int targetPos = *targetReadPos;
+        float pitchAccum = *pitchAccumulator;
+        float gLeft = gains[0];
+        float gRight = gains[1];
+        const float gLeftIncr = gainIncrPerFrame[0];
+        const float gRightIncr = gainIncrPerFrame[1];
+
+        while (targetPos < maxTargetPosPlusOne)
+        {
+            const float s0 = kwlInt16GetMonoSample(sourceBuffer, srcPos, numSourceChannels);
+            const float s1 = kwlInt16GetMonoSample(sourceBuffer, srcPos + numSourceChannels, numSourceChannels);
+            const float s = s0 + pitchAccum * (s1 - s0);
+            targetBuffer[targetPos] += gLeft * s;
+            targetBuffer[targetPos + 1] += gRight * s;
+            gLeft += gLeftIncr;
+            gRight += gRightIncr;
+            pitchAccum += pitch;
+            const int accumulatorIntegerPart = (int)(pitchAccum);
+            srcPos += accumulatorIntegerPart * numSourceChannels;
+            pitchAccum -= accumulatorIntegerPart;
+            targetPos += 2;
+        }
+
+        *sourceReadPos = srcPos;
+        *targetReadPos = targetPos;
+        *pitchAccumulator = pitchAccum;
+        gains[0] = gLeft;
+        gains[1] = gRight;
+    }
+
+    /**
+     * Upsamples an interleaved buffer by a factor of two using linear interpolation
+     * and adds the result to a target buffer. The output lags the input by one target
+     * frame, which lets consecutive buffers be converted without looking ahead.
+     * @param sourceBuffer The interleaved buffer to upsample.
+     * @param targetBuffer The interleaved buffer to mix into, twice the length of the source buffer.
+     * @param numChannels The number of channels of both buffers.
+     * @param numSourceFrames The number of source frames.
+     * @param history The last source frame of the previous buffer, updated on return.
+     */
+    static inline void kwlUpsample2xAndMix(const float* sourceBuffer,
+                                           float* targetBuffer,
+                                           int numChannels,
+                                           int numSourceFrames,
+                                           float* history)
+    {
+        KWL_ASSERT(sourceBuffer != NULL);
+        KWL_ASSERT(targetBuffer != NULL);
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            float prev = history[ch];
+            int srcPos = ch;
+            int targetPos = ch;
+            for (int i = 0; i < numSourceFrames; i++)
+            {
+                const float s = sourceBuffer[srcPos];
+                targetBuffer[targetPos] += 0.5f * (prev + s);
+                targetBuffer[targetPos + numChannels] += s;
+                prev = s;
+                srcPos += numChannels;
+                targetPos += 2 * numChannels;
+            }
+            history[ch] = prev;
+        }
+    }
+
     /**
      * Converts a buffer of signed short values to a buffer of floats
      * in the range [-1, 1].
@@ -33,5 +33,8 @@ void kwlAudioData_free(kwlAudioData* audioData)
     }
     
     audioData->isLoaded = 0;
+    audioData->isEvicted = 0;
+    audioData->isReloadPending = 0;
+    audioData->lastUseUpdate = 0;
 }
 
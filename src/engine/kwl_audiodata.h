@@ -88,6 +88,11 @@ typedef struct kwlAudioData
     int numFrames;
     /** The number of channels of the audio. Only used for PCM data. */
     int numChannels;
+    /** 
+     * The sample rate of the audio in Hz, or 0 if unknown, in which case the audio
+     * is played as if it had the same rate as the engine output.
+     */
+    int sampleRate;
     /** The total number of bytes of loaded audio data. A value of 0 indicates that no data is loaded. */
     int numBytes;
     /** */
@@ -101,6 +106,33 @@ typedef struct kwlAudioData
     int isLoaded;
     /** */
     int isBigEndian;
+    /** The content hash of the audio data bytes. Only valid for loaded, non-streaming wave bank entries.*/
+    unsigned long long contentHash;
+    /** 
+     * Non-zero if \c bytes is a payload owned by the audio data store of the engine and 
+     * possibly shared with other wave banks, in which case it must be released through the store.
+     */
+    int isInAudioDataStore;
+    /** 
+     * Non-zero if the residency manager evicted the audio data to stay within the audio memory 
+     * budget. Evicted audio data is still considered loaded, but has no bytes until it is reloaded. 
+     * Written by the engine thread with release semantics and read by the mixer thread with 
+     * acquire semantics, so that the mixer never sees a reloaded \c bytes pointer before its contents.
+     */
+    volatile int isEvicted;
+    /** Non-zero if the audio data is evicted and a reload has been requested. Engine thread only.*/
+    int isReloadPending;
+    /** The number of times the mixer has picked the audio data for playback. Only written by the mixer thread.*/
+    volatile int numUses;
+    /** The value of \c numUses at the previous residency update. Engine thread only.*/
+    int numUsesSeen;
+    /** The residency manager update at which the audio data was last used. Engine thread only.*/
+    int lastUseUpdate;
+    /** 
+     * The residency manager update at which the audio data was last found to be referenced 
+     * by a playing event. Engine thread only.
+     */
+    int playingMarkUpdate;
 } kwlAudioData;
 
 /** Releasesa any resources associated with a given audio data instance.*/
@@ -0,0 +1,256 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "kwl_audiodatastore.h"
+#include "kwl_memory.h"
+#include "kwl_assert.h"
+
+unsigned long long kwlAudioDataStore_computeContentHash(const void* bytes, int numBytes)
+{
+    const unsigned char* b = (const unsigned char*)bytes;
+    unsigned long long hash = KWL_CONTENT_HASH_OFFSET_BASIS;
+    int i;
+    for (i = 0; i < numBytes; i++)
+    {
+        hash ^= b[i];
+        hash *= KWL_CONTENT_HASH_PRIME;
+    }
+    return hash;
+}
+
+/** Returns the home slot of a given hash.*/
+static int kwlAudioDataStore_getSlot(kwlAudioDataStore* store, unsigned long long hash)
+{
+    return (int)((unsigned int)(hash ^ (hash >> 32)) & (unsigned int)(store->tableSize - 1));
+}
+
+/** Returns the slot holding the payload with a given hash, or -1 if there is no such slot.*/
+static int kwlAudioDataStore_findSlot(kwlAudioDataStore* store, unsigned long long hash)
+{
+    const int mask = store->tableSize - 1;
+    int slot = kwlAudioDataStore_getSlot(store, hash);
+    while (store->entries[slot].bytes != NULL)
+    {
+        if (store->entries[slot].hash == hash)
+        {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static void kwlAudioDataStore_allocateTable(kwlAudioDataStore* store, int tableSize)
+{
+    store->tableSize = tableSize;
+    store->entries = (kwlAudioDataStoreEntry*)KWL_MALLOC(tableSize * sizeof(kwlAudioDataStoreEntry), 
+                                                         "audio data store");
+    kwlMemset(store->entries, 0, tableSize * sizeof(kwlAudioDataStoreEntry));
+}
+
+/** Doubles the size of the hash table, keeping the load factor at most 0.5.*/
+static void kwlAudioDataStore_grow(kwlAudioDataStore* store)
+{
+    kwlAudioDataStoreEntry* oldEntries = store->entries;
+    const int oldTableSize = store->tableSize;
+    kwlAudioDataStore_allocateTable(store, 2 * oldTableSize);
+    
+    const int mask = store->tableSize - 1;
+    int i;
+    for (i = 0; i < oldTableSize; i++)
+    {
+        if (oldEntries[i].bytes != NULL)
+        {
+            int slot = kwlAudioDataStore_getSlot(store, oldEntries[i].hash);
+            while (store->entries[slot].bytes != NULL)
+            {
+                slot = (slot + 1) & mask;
+            }
+            store->entries[slot] = oldEntries[i];
+        }
+    }
+    
+    KWL_FREE(oldEntries);
+}
+
+/** The store shared by all engine contexts in the process.*/
+static kwlAudioDataStore sharedStore;
+/** The number of engine contexts referencing \c sharedStore.*/
+static int sharedStoreRefCount = 0;
+/** Guards \c sharedStoreRefCount and the creation and destruction of \c sharedStore.*/
+static volatile int sharedStoreLock = 0;
+
+void kwlAudioDataStore_init(kwlAudioDataStore* store)
+{
+    kwlAudioDataStore_allocateTable(store, KWL_AUDIO_DATA_STORE_INITIAL_SIZE);
+    store->numEntries = 0;
+    store->numResidentBytes = 0;
+    kwlMutexLockInit(&store->lock);
+}
+
+void kwlAudioDataStore_free(kwlAudioDataStore* store)
+{
+    int i;
+    for (i = 0; i < store->tableSize; i++)
+    {
+        if (store->entries[i].bytes != NULL)
+        {
+            KWL_FREE(store->entries[i].bytes);
+        }
+    }
+    KWL_FREE(store->entries);
+    store->entries = NULL;
+    store->tableSize = 0;
+    store->numEntries = 0;
+    store->numResidentBytes = 0;
+}
+
+void* kwlAudioDataStore_acquire(kwlAudioDataStore* store, unsigned long long hash, int numBytes)
+{
+    void* bytes = NULL;
+    kwlMutexLockAcquire(&store->lock);
+    const int slot = kwlAudioDataStore_findSlot(store, hash);
+    if (slot >= 0 && store->entries[slot].numBytes == numBytes)
+    {
+        store->entries[slot].refCount++;
+        bytes = store->entries[slot].bytes;
+    }
+    kwlMutexLockRelease(&store->lock);
+    return bytes;
+}
+
+void* kwlAudioDataStore_insert(kwlAudioDataStore* store, unsigned long long hash, void* bytes, int numBytes)
+{
+    KWL_ASSERT(bytes != NULL);
+    
+    kwlMutexLockAcquire(&store->lock);
+    const int existingSlot = kwlAudioDataStore_findSlot(store, hash);
+    if (existingSlot >= 0)
+    {
+        kwlAudioDataStoreEntry* entry = &store->entries[existingSlot];
+        void* residentBytes = NULL;
+        if (entry->numBytes == numBytes)
+        {
+            entry->refCount++;
+            residentBytes = entry->bytes;
+        }
+        kwlMutexLockRelease(&store->lock);
+        return residentBytes;
+    }
+    
+    if (2 * (store->numEntries + 1) > store->tableSize)
+    {
+        kwlAudioDataStore_grow(store);
+    }
+    
+    const int mask = store->tableSize - 1;
+    int slot = kwlAudioDataStore_getSlot(store, hash);
+    while (store->entries[slot].bytes != NULL)
+    {
+        slot = (slot + 1) & mask;
+    }
+    
+    kwlAudioDataStoreEntry* entry = &store->entries[slot];
+    entry->hash = hash;
+    entry->bytes = bytes;
+    entry->numBytes = numBytes;
+    entry->refCount = 1;
+    store->numEntries++;
+    store->numResidentBytes += numBytes;
+    
+    kwlMutexLockRelease(&store->lock);
+    return bytes;
+}
+
+void kwlAudioDataStore_release(kwlAudioDataStore* store, unsigned long long hash)
+{
+    kwlMutexLockAcquire(&store->lock);
+    int slot = kwlAudioDataStore_findSlot(store, hash);
+    KWL_ASSERT(slot >= 0 && "releasing a payload that is not in the audio data store");
+    if (slot < 0)
+    {
+        kwlMutexLockRelease(&store->lock);
+        return;
+    }
+    
+    kwlAudioDataStoreEntry* entry = &store->entries[slot];
+    KWL_ASSERT(entry->refCount > 0);
+    entry->refCount--;
+    if (entry->refCount > 0)
+    {
+        kwlMutexLockRelease(&store->lock);
+        return;
+    }
+    
+    KWL_FREE(entry->bytes);
+    store->numEntries--;
+    store->numResidentBytes -= entry->numBytes;
+    
+    /*Remove the entry and shift any following entries of the same cluster back 
+      into the vacated slot, so that no tombstones are needed.*/
+    const int mask = store->tableSize - 1;
+    int emptySlot = slot;
+    int nextSlot = (slot + 1) & mask;
+    while (store->entries[nextSlot].bytes != NULL)
+    {
+        const int homeSlot = kwlAudioDataStore_getSlot(store, store->entries[nextSlot].hash);
+        /*Move the entry if its home slot is not cyclically in (emptySlot, nextSlot].*/
+        const int distanceToNext = (nextSlot - homeSlot) & mask;
+        const int distanceToEmpty = (nextSlot - emptySlot) & mask;
+        if (distanceToNext >= distanceToEmpty)
+        {
+            store->entries[emptySlot] = store->entries[nextSlot];
+            emptySlot = nextSlot;
+        }
+        nextSlot = (nextSlot + 1) & mask;
+    }
+    kwlMemset(&store->entries[emptySlot], 0, sizeof(kwlAudioDataStoreEntry));
+    
+    kwlMutexLockRelease(&store->lock);
+}
+
+kwlAudioDataStore* kwlAudioDataStore_retainShared(void)
+{
+    /*Contexts may be created on several threads at once.*/
+    kwlSpinLockAcquire(&sharedStoreLock);
+    if (sharedStoreRefCount == 0)
+    {
+        kwlAudioDataStore_init(&sharedStore);
+    }
+    sharedStoreRefCount++;
+    kwlSpinLockRelease(&sharedStoreLock);
+    return &sharedStore;
+}
+
+void kwlAudioDataStore_releaseShared(void)
+{
+    kwlSpinLockAcquire(&sharedStoreLock);
+    KWL_ASSERT(sharedStoreRefCount > 0);
+    sharedStoreRefCount--;
+    if (sharedStoreRefCount == 0)
+    {
+        KWL_ASSERT(sharedStore.numEntries == 0 && "audio data still referenced by a wave bank");
+        kwlAudioDataStore_free(&sharedStore);
+    }
+    kwlSpinLockRelease(&sharedStoreLock);
+}
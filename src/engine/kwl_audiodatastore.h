@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef KWL__AUDIO_DATA_STORE_H
+#define KWL__AUDIO_DATA_STORE_H
+
+/*! \file */ 
+
+#include "kwl_synchronization.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/** The FNV-1a 64 bit offset basis, i.e the content hash of an empty payload.*/
+#define KWL_CONTENT_HASH_OFFSET_BASIS 0xcbf29ce484222325ULL
+    
+/** The FNV-1a 64 bit prime.*/
+#define KWL_CONTENT_HASH_PRIME 0x100000001b3ULL
+
+/** The initial number of slots in the audio data store hash table. Must be a power of two.*/
+#define KWL_AUDIO_DATA_STORE_INITIAL_SIZE 64
+
+/** An entry in the audio data store.*/
+typedef struct kwlAudioDataStoreEntry
+{
+    /** The content hash of the payload.*/
+    unsigned long long hash;
+    /** The payload. NULL for empty slots.*/
+    void* bytes;
+    /** The size of the payload in bytes.*/
+    int numBytes;
+    /** The number of audio data entries referencing the payload.*/
+    int refCount;
+} kwlAudioDataStoreEntry;
+    
+/**
+ * A reference counted collection of resident audio data payloads keyed by content hash,
+ * letting wave banks that contain identical audio data share a single copy of it. 
+ * Accessed from the engine thread and wave bank loading threads.
+ */
+typedef struct kwlAudioDataStore
+{
+    /** An open addressing hash table of payloads. */
+    kwlAudioDataStoreEntry* entries;
+    /** The number of slots in \c entries. Always a power of two.*/
+    int tableSize;
+    /** The number of resident payloads.*/
+    int numEntries;
+    /** The total size in bytes of the resident payloads.*/
+    int numResidentBytes;
+    /** Protects the table from concurrent wave bank loads.*/
+    kwlMutexLock lock;
+} kwlAudioDataStore;
+
+/** Returns the FNV-1a 64 bit hash of a payload, matching the hashes emitted by the wave bank builder.*/
+unsigned long long kwlAudioDataStore_computeContentHash(const void* bytes, int numBytes);
+
+/** */
+void kwlAudioDataStore_init(kwlAudioDataStore* store);
+
+/** Frees the store and any payloads still resident.*/
+void kwlAudioDataStore_free(kwlAudioDataStore* store);
+
+/**
+ * Looks up a resident payload and adds a reference to it.
+ * @param store The store.
+ * @param hash The content hash of the payload.
+ * @param numBytes The expected payload size, used to reject hash collisions.
+ * @return The resident payload or NULL if there is no matching payload.
+ */
+void* kwlAudioDataStore_acquire(kwlAudioDataStore* store, unsigned long long hash, int numBytes);
+
+/**
+ * Adds a reference to a payload. If an identical payload is already resident, a reference 
+ * to that payload is returned and the caller should free \c bytes. Otherwise the store takes 
+ * ownership of \c bytes, which must have been allocated using \c KWL_MALLOC.
+ * @param store The store.
+ * @param hash The content hash of the payload.
+ * @param bytes The payload.
+ * @param numBytes The payload size.
+ * @return The resident payload, or NULL if a payload of a different size has the same hash,
+ * in which case ownership of \c bytes stays with the caller.
+ */
+void* kwlAudioDataStore_insert(kwlAudioDataStore* store, unsigned long long hash, void* bytes, int numBytes);
+
+/**
+ * Removes a reference to a resident payload, freeing the payload when its last reference is removed.
+ */
+void kwlAudioDataStore_release(kwlAudioDataStore* store, unsigned long long hash);
+
+/**
+ * Returns the process wide store shared by all engine contexts, initializing it 
+ * on first use. Must not be called concurrently with \c kwlAudioDataStore_releaseShared.
+ */
+kwlAudioDataStore* kwlAudioDataStore_retainShared(void);
+
+/**
+ * Removes a reference to the process wide store, freeing it when the last engine context releases it.
+ */
+void kwlAudioDataStore_releaseShared(void);
+    
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__AUDIO_DATA_STORE_H*/
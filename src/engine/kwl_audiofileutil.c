@@ -22,9 +22,11 @@ freely, subject to the following restrictions:
 */
 #include "kwl_audiofileutil.h"
 #include "kwl_asm.h"
+#include "kwl_log.h"
 #include "kwl_memory.h"
 
 #include "assert.h"
+#include <math.h>
 
 void* kwlAllocateBufferWithEntireStream(kwlInputStream* stream, int* fileSize)
 {
@@ -135,8 +137,12 @@ kwlError kwlLoadAIFFFromStream(kwlInputStream* stream, kwlAudioData* audioData,
             numChannels = kwlInputStream_readShortBE(stream);
             numFrames = kwlInputStream_readIntBE(stream);
             sampleSize = kwlInputStream_readShortBE(stream);
-            /*Ignore the the sample rate for now, so skip those 10 bits.*/
-            kwlInputStream_skip(stream, chunkSize - (2 + 4 + 2));
+            /*The sample rate is an 80 bit extended precision float. The low 32 bits 
+              of the mantissa do not matter for integer sample rates.*/
+            const int exponent = (kwlInputStream_readShortBE(stream) & 0x7fff) - 16383;
+            const unsigned int mantissaHigh = (unsigned int)kwlInputStream_readIntBE(stream);
+            kwlInputStream_skip(stream, chunkSize - (2 + 4 + 2 + 2 + 4));
+            audioData->sampleRate = (int)(ldexp((double)mantissaHigh, exponent - 31) + 0.5);
             commonChunkFound = 1;
             
             int unsupportedSampleSize = sampleSize != 8 &&
@@ -184,7 +190,7 @@ kwlError kwlLoadAIFFFromStream(kwlInputStream* stream, kwlAudioData* audioData,
         {
             int chunkSize = kwlInputStream_readIntBE(stream);
             kwlInputStream_skip(stream, chunkSize);
-            //printf("skipping %c%c%c%c chunk\n", c1, c2, c3, c4);
+            //KWL_LOG_DEBUG("skipping %c%c%c%c chunk", c1, c2, c3, c4);
         }
     }
     
@@ -322,6 +328,7 @@ kwlError kwlLoadWAVFromStreamWithOptionalIMA4Params(kwlInputStream* stream,
             audioFormat = kwlInputStream_readShortLE(stream);
             numChannels = kwlInputStream_readShortLE(stream);
             const int sampleRate = kwlInputStream_readIntLE(stream);
+            audioData->sampleRate = sampleRate;
             const int  byteRate = kwlInputStream_readIntLE(stream);
             nBlockAlign = kwlInputStream_readShortLE(stream);
             if (nBlockAlignOut != NULL)    
@@ -449,7 +456,7 @@ kwlError kwlLoadWAVFromStreamWithOptionalIMA4Params(kwlInputStream* stream,
         }
         else
         {
-            printf("skipping %c%c%c%c chunk\n", c1, c2, c3, c4);
+            KWL_LOG_DEBUG("skipping %c%c%c%c chunk", c1, c2, c3, c4);
             const int chunkSize = kwlInputStream_readIntLE(stream);
             kwlInputStream_skip(stream, chunkSize);
         }
@@ -601,6 +608,7 @@ kwlError kwlLoadAUFromStream(kwlInputStream* stream, kwlAudioData* audioData, kw
     
     audioData->numFrames = numSamples / numChannels;
     audioData->numChannels = numChannels;
+    audioData->sampleRate = sampleRate;
     audioData->numBytes = numSamples * 2;
     audioData->bytes = finalSamples;
     audioData->isLoaded = mode != KWL_SKIP_AUDIO_DATA ? 1 : 0;
@@ -0,0 +1,158 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "kwl_automation.h"
+#include "kwl_memory.h"
+#include "kwl_messagequeue.h"
+
+#include <math.h>
+
+/** Returns the value of a curve between two values at a normalized position in [0, 1].*/
+static float kwlAutomation_interpolate(char curve, float startValue, float endValue, float t)
+{
+    if (curve == KWL_CURVE_S)
+    {
+        t = t * t * (3.0f - 2.0f * t);
+    }
+    else if (curve == KWL_CURVE_EXPONENTIAL && startValue >= 0.0f && endValue >= 0.0f)
+    {
+        /*Interpolate linearly in the log domain.*/
+        const float start = startValue < KWL_AUTOMATION_MIN_EXPONENTIAL_VALUE ? 
+                            KWL_AUTOMATION_MIN_EXPONENTIAL_VALUE : startValue;
+        const float end = endValue < KWL_AUTOMATION_MIN_EXPONENTIAL_VALUE ? 
+                          KWL_AUTOMATION_MIN_EXPONENTIAL_VALUE : endValue;
+        return start * powf(end / start, t);
+    }
+    
+    return startValue + (endValue - startValue) * t;
+}
+
+void kwlAutomation_init(kwlAutomation* automation, float value)
+{
+    kwlMemset(automation, 0, sizeof(kwlAutomation));
+    automation->value = value;
+    automation->segmentStartValue = value;
+}
+
+void kwlAutomation_setEnvelope(kwlAutomation* automation,
+                               const float* times,
+                               const float* values,
+                               int numBreakpoints,
+                               int startsAtCurrentValue,
+                               kwlAutomationCurve curve,
+                               long long startFrame)
+{
+    kwlAutomationEnvelope* envelope = &automation->envelopeEngine;
+    envelope->serial++;
+    envelope->numBreakpoints = numBreakpoints;
+    envelope->startsAtCurrentValue = (char)startsAtCurrentValue;
+    envelope->curve = (char)curve;
+    envelope->startFrame = startFrame;
+    kwlMemcpy(envelope->times, times, numBreakpoints * sizeof(float));
+    kwlMemcpy(envelope->values, values, numBreakpoints * sizeof(float));
+}
+
+void kwlAutomation_updateShared(kwlAutomation* automation)
+{
+    if (automation->envelopeShared.serial != automation->envelopeEngine.serial)
+    {
+        kwlMemcpy(&automation->envelopeShared, &automation->envelopeEngine, sizeof(kwlAutomationEnvelope));
+    }
+}
+
+void kwlAutomation_updateMixer(kwlAutomation* automation, float sampleRate, long long currentFrame)
+{
+    const kwlAutomationEnvelope* envelope = &automation->envelopeShared;
+    if (automation->serialMixer == envelope->serial)
+    {
+        return;
+    }
+    
+    /*The number of frames to wait before a scheduled envelope starts.*/
+    int delay = 0;
+    if (envelope->startFrame != KWL_UNSCHEDULED && envelope->startFrame > currentFrame)
+    {
+        delay = (int)(envelope->startFrame - currentFrame);
+    }
+    
+    automation->serialMixer = envelope->serial;
+    automation->numBreakpoints = envelope->numBreakpoints;
+    automation->curve = envelope->curve;
+    for (int i = 0; i < envelope->numBreakpoints; i++)
+    {
+        automation->breakpointFrames[i] = delay + (int)(envelope->times[i] * sampleRate);
+        automation->breakpointValues[i] = envelope->values[i];
+    }
+    
+    automation->frame = 0;
+    automation->segmentStartFrame = delay;
+    automation->nextBreakpoint = 0;
+    if (envelope->startsAtCurrentValue == 0)
+    {
+        /*
+         Hold the first value until the first breakpoint is reached. Scheduled
+         envelopes hold the current value until then instead.
+         */
+        if (delay == 0)
+        {
+            automation->value = automation->breakpointValues[0];
+        }
+        automation->segmentStartFrame = automation->breakpointFrames[0];
+    }
+    automation->segmentStartValue = automation->value;
+}
+
+void kwlAutomation_advance(kwlAutomation* automation, int numFrames)
+{
+    if (automation->nextBreakpoint >= automation->numBreakpoints)
+    {
+        /*The envelope has finished, or there is none.*/
+        return;
+    }
+    
+    automation->frame += numFrames;
+    
+    /*Skip past any breakpoints reached during the interval.*/
+    while (automation->nextBreakpoint < automation->numBreakpoints &&
+           automation->frame >= automation->breakpointFrames[automation->nextBreakpoint])
+    {
+        automation->segmentStartFrame = automation->breakpointFrames[automation->nextBreakpoint];
+        automation->segmentStartValue = automation->breakpointValues[automation->nextBreakpoint];
+        automation->nextBreakpoint++;
+    }
+    
+    if (automation->nextBreakpoint >= automation->numBreakpoints ||
+        automation->frame <= automation->segmentStartFrame)
+    {
+        automation->value = automation->segmentStartValue;
+        return;
+    }
+    
+    const int segmentEndFrame = automation->breakpointFrames[automation->nextBreakpoint];
+    const float t = (automation->frame - automation->segmentStartFrame) / 
+                    (float)(segmentEndFrame - automation->segmentStartFrame);
+    automation->value = kwlAutomation_interpolate(automation->curve,
+                                                  automation->segmentStartValue, 
+                                                  automation->breakpointValues[automation->nextBreakpoint], 
+                                                  t);
+}
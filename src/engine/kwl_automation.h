@@ -0,0 +1,140 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+#ifndef KWL__AUTOMATION_H
+#define KWL__AUTOMATION_H
+
+/*! \file */ 
+
+#include "kowalski.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/** The maximum number of breakpoints in an automation envelope.*/
+#define KWL_MAX_AUTOMATION_BREAKPOINTS 8
+    
+/** 
+ * Exponential curves can't pass through zero, so values below this
+ * are clamped when interpolating exponentially. Corresponds to -60 dB.
+ */
+#define KWL_AUTOMATION_MIN_EXPONENTIAL_VALUE 0.001f
+
+/** A breakpoint envelope describing how a parameter should change over time. */
+typedef struct kwlAutomationEnvelope
+{
+    /** Incremented each time a new envelope is submitted. Used to detect changes.*/
+    int serial;
+    /** The number of breakpoints.*/
+    int numBreakpoints;
+    /** 
+     * Non-zero if the envelope starts at the current value of the parameter,
+     * zero if it starts at the first breakpoint.
+     */
+    char startsAtCurrentValue;
+    /** The curve used between breakpoints, one of the \c kwlAutomationCurve values.*/
+    char curve;
+    /** 
+     * The frame on the mixer sample clock at which the envelope starts, or \c KWL_UNSCHEDULED
+     * to start as soon as the mixer picks it up. The parameter keeps its current value until then.
+     */
+    long long startFrame;
+    /** Breakpoint times in seconds, relative to the start of the envelope. Non-decreasing.*/
+    float times[KWL_MAX_AUTOMATION_BREAKPOINTS];
+    /** Breakpoint values.*/
+    float values[KWL_MAX_AUTOMATION_BREAKPOINTS];
+} kwlAutomationEnvelope;
+
+/** 
+ * An automated parameter. Envelopes are submitted on the engine thread, copied 
+ * to the mixer thread like any other shared value and evaluated once per mixed buffer.
+ */
+typedef struct kwlAutomation
+{
+    //engine->mixer
+    /** The most recently submitted envelope. Engine thread only.*/
+    kwlAutomationEnvelope envelopeEngine;
+    /** Accessed from both threads while holding the engine/mixer lock.*/
+    kwlAutomationEnvelope envelopeShared;
+    
+    /** Mixer thread only. The serial of the envelope being evaluated.*/
+    int serialMixer;
+    /** Mixer thread only. The number of breakpoints of the envelope being evaluated.*/
+    int numBreakpoints;
+    /** Mixer thread only. The curve of the envelope being evaluated.*/
+    char curve;
+    /** Mixer thread only. Breakpoint times in frames.*/
+    int breakpointFrames[KWL_MAX_AUTOMATION_BREAKPOINTS];
+    /** Mixer thread only. Breakpoint values.*/
+    float breakpointValues[KWL_MAX_AUTOMATION_BREAKPOINTS];
+    /** Mixer thread only. The index of the next breakpoint to reach.*/
+    int nextBreakpoint;
+    /** Mixer thread only. The number of frames evaluated since the envelope started.*/
+    int frame;
+    /** Mixer thread only. The frame at which the current segment starts.*/
+    int segmentStartFrame;
+    /** Mixer thread only. The value at the start of the current segment.*/
+    float segmentStartValue;
+    /** Mixer thread only. The current value of the parameter.*/
+    float value;
+} kwlAutomation;
+
+/** Resets an automation to a constant value. */
+void kwlAutomation_init(kwlAutomation* automation, float value);
+
+/** 
+ * Submits a new envelope. Called from the engine thread. 
+ * The parameters are assumed to have been validated.
+ */
+void kwlAutomation_setEnvelope(kwlAutomation* automation,
+                               const float* times,
+                               const float* values,
+                               int numBreakpoints,
+                               int startsAtCurrentValue,
+                               kwlAutomationCurve curve,
+                               long long startFrame);
+
+/** Copies a newly submitted envelope to the shared data. Called while holding the engine/mixer lock.*/
+void kwlAutomation_updateShared(kwlAutomation* automation);
+
+/** 
+ * Starts evaluating the shared envelope if it has changed. Called from 
+ * the mixer thread while holding the engine/mixer lock.
+ * @param automation The automation to update.
+ * @param sampleRate The sample rate of the mixer.
+ * @param currentFrame The current frame on the mixer sample clock.
+ */
+void kwlAutomation_updateMixer(kwlAutomation* automation, float sampleRate, long long currentFrame);
+
+/** 
+ * Advances an automation by a number of frames, updating its value to 
+ * the value at the end of the advanced interval. Called from the mixer thread.
+ */
+void kwlAutomation_advance(kwlAutomation* automation, int numFrames);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */    
+    
+#endif /*KWL__AUTOMATION_H*/
@@ -26,6 +26,7 @@ freely, subject to the following restrictions:
 #include "kwl_decoder.h"
 #include "kwl_decoder_imaadpcm.h"
 #include "kwl_decoder_pcm.h"
+#include "kwl_log.h"
 #ifdef KWL_IPHONE
 #include "kwl_decoder_iphone.h"
 #endif /*KWL_IPHONE*/
@@ -41,16 +42,24 @@ void kwlDecoder_swapBuffers(kwlDecoder* decoder)
 
 kwlError kwlDecoder_init(kwlDecoder* decoder, kwlEventInstance* event)
 {
-    kwlAudioData* audioData = event->definition_engine->streamAudioData;
+    return kwlDecoder_initWithAudioData(decoder, 
+                                        event, 
+                                        event->definition_engine->streamAudioData, 
+                                        event->definition_engine->loopIfStreaming);
+}
+
+kwlError kwlDecoder_initWithAudioData(kwlDecoder* decoder, kwlEventInstance* event, kwlAudioData* audioData, int loop)
+{
     /*reset the decoder struct.*/
     kwlMemset(decoder, 0, sizeof(kwlDecoder));
     
-    decoder->loop = event->definition_engine->loopIfStreaming;
+    decoder->loop = loop;
     
     /*
-     * Hook up audio data, that could either be from a file or from an already loaded buffer
+     * Hook up audio data, that could either be from a file or from an already loaded buffer.
+     * Audio data evicted by the residency manager is read from the wave bank file.
      */
-    if (audioData->streamFromDisk != 0)
+    if (audioData->streamFromDisk != 0 || audioData->isEvicted != 0)
     {
         KWL_ASSERT(audioData->fileOffset >= 0);
         kwlError result = kwlInputStream_initWithFileRegion(&decoder->audioDataStream,
@@ -68,8 +77,10 @@ kwlError kwlDecoder_init(kwlDecoder* decoder, kwlEventInstance* event)
     }
     
     /*
-     * do codec specific initialization.
+     * do codec specific initialization. Codecs that know the sample rate 
+     * of the stream override the one stored with the audio data.
      */
+    decoder->sampleRate = audioData->sampleRate;
     kwlError result = KWL_UNSUPPORTED_ENCODING;
     
     if (audioData->encoding == KWL_ENCODING_IMA_ADPCM)
@@ -80,6 +91,13 @@ kwlError kwlDecoder_init(kwlDecoder* decoder, kwlEventInstance* event)
     {
         result = kwlInitDecoderOggVorbis(decoder);
     }
+    else if (audioData->encoding == KWL_ENCODING_SIGNED_16BIT_PCM &&
+             audioData->streamFromDisk == 0 && 
+             audioData->numChannels > 0)
+    {
+        /*Non-streaming PCM wave bank entries are stored as raw samples.*/
+        result = kwlInitDecoderRawPCM(decoder, audioData->numChannels);
+    }
     else if (audioData->encoding == KWL_ENCODING_UNSIGNED_8BIT_PCM ||
              audioData->encoding == KWL_ENCODING_SIGNED_8BIT_PCM ||
              audioData->encoding == KWL_ENCODING_SIGNED_16BIT_PCM ||
@@ -121,6 +139,7 @@ kwlError kwlDecoder_init(kwlDecoder* decoder, kwlEventInstance* event)
     event->currentPCMBufferSize = decoder->currentDecodedBufferSizeInBytes / (2 * decoder->numChannels);
     
     event->currentNumChannels = decoder->numChannels;
+    event->currentSampleRate = decoder->sampleRate;
     
     
     /*Create a semaphore with a unique name based on the addess of the decoder*/
@@ -211,7 +230,7 @@ int kwlDecoder_decodeNewBufferForEvent(kwlDecoder* decoder, kwlEventInstance* ev
 {
     if (decoder->isDecoding)
     {
-        printf("still decoding, missed buffer!\n");
+        KWL_LOG_WARNING("still decoding, missed buffer!");
         return 0;
     }
 
@@ -223,6 +242,7 @@ int kwlDecoder_decodeNewBufferForEvent(kwlDecoder* decoder, kwlEventInstance* ev
     
     event->currentPCMBufferSize = decoder->currentDecodedBufferSizeInBytes / (2 * decoder->numChannels);
     event->currentNumChannels = decoder->numChannels;
+    event->currentSampleRate = decoder->sampleRate;
     
     kwlSemaphorePost(decoder->semaphore);
     //printf("assigned front buffer %d\n", (int)decoder->currentDecodedBufferFront);
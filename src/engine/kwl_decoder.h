@@ -36,6 +36,9 @@ extern "C"
 {
 #endif /* __cplusplus */
     
+/*kwl_eventinstance.h includes this header, so the event struct may not be declared yet.*/
+struct kwlEventInstance;
+    
 /** An audio decoder. */
 typedef struct kwlDecoder
 {
@@ -61,6 +64,8 @@ typedef struct kwlDecoder
     int maxDecodedBufferSize;    
     /** The number of decoded audio channels.*/
     int numChannels;
+    /** The sample rate of the decoded audio in Hz, or 0 if it matches the output rate.*/
+    int sampleRate;
     /** Codec specific state data.*/
     void* codecData;
     /** A codec specific callback that fills the decoder's buffer of decoded samples. */
@@ -81,6 +86,18 @@ typedef struct kwlDecoder
  * @param audioData
  */
 kwlError kwlDecoder_init(kwlDecoder* decoder, struct kwlEventInstance* event);
+
+/** 
+ * Initializes a given decoder instance to decode a given piece of audio data for an event.
+ * @param decoder
+ * @param event The event to decode audio data for.
+ * @param audioData The audio data to decode.
+ * @param loop Non-zero if decoding should restart at the end of the audio data.
+ */
+kwlError kwlDecoder_initWithAudioData(kwlDecoder* decoder, 
+                                      struct kwlEventInstance* event, 
+                                      kwlAudioData* audioData, 
+                                      int loop);
     
 void kwlDecoder_deinit(kwlDecoder* decoder);
 
@@ -48,6 +48,10 @@ kwlError kwlInitDecoderIMAADPCM(kwlDecoder* decoder)
       a decoded one is 16, so we need nBlockAlign * 4 bytes to hold a decoded datablock.*/
     decoder->maxDecodedBufferSize = data->nBlockAlign * 4;
     decoder->numChannels = data->adpcmDataDescription.numChannels;
+    if (data->adpcmDataDescription.sampleRate > 0)
+    {
+        decoder->sampleRate = data->adpcmDataDescription.sampleRate;
+    }
     KWL_ASSERT((data->dataSize % data->nBlockAlign) == 0);
     
     KWL_ASSERT(decoder->numChannels > 0);
@@ -62,6 +62,7 @@ kwlError kwlInitDecoderOggVorbis(kwlDecoder* decoder)
     vorbis_info* info = ov_info(&data->oggVorbisFile, -1);
      
     decoder->numChannels = info->channels;
+    decoder->sampleRate = (int)info->rate;
     KWL_ASSERT(decoder->numChannels == 1 || decoder->numChannels == 2);
     /*printf("opened ov stream, %d channels\n", decoder->numChannels);*/
     
@@ -96,12 +96,44 @@ kwlError kwlInitDecoderPCM(kwlDecoder* decoder)
     
     decoder->maxDecodedBufferSize = 4096 >> 1;
     decoder->numChannels = data->pcmDataDescription.numChannels;
+    if (data->pcmDataDescription.sampleRate > 0)
+    {
+        decoder->sampleRate = data->pcmDataDescription.sampleRate;
+    }
     data->scratchBufferNumBytes = decoder->maxDecodedBufferSize;//TODO:make this work for all encodings!
     data->scratchBuffer = (char*)KWL_MALLOC(data->scratchBufferNumBytes, "pcm decoder scratch buffer");
     
     return KWL_NO_ERROR;
 }
 
+kwlError kwlInitDecoderRawPCM(kwlDecoder* decoder, int numChannels)
+{
+    /*Allocate decoder data.*/
+    kwlPCMDecoderData* data = 
+        (kwlPCMDecoderData*)KWL_MALLOC(sizeof(kwlPCMDecoderData), "pcm decoder data");
+    kwlMemset(data, 0, sizeof(kwlPCMDecoderData));
+    
+    /* Hook up data and callbacks to the decoder.*/
+    decoder->codecData = data;
+    decoder->decodeBuffer = kwlDecodeBufferPCM;
+    decoder->deinit = kwlDeinitDecoderPCM;
+    decoder->rewind = kwlRewindDecoderPCM;
+    
+    /*There is no header, so the first sample is at the start of the stream.*/
+    data->pcmDataDescription.encoding = KWL_ENCODING_SIGNED_16BIT_PCM;
+    data->pcmDataDescription.numChannels = numChannels;
+    data->pcmDataDescription.isBigEndian = 0;
+    data->pcmDataDescription.fileOffset = 0;
+    data->bytesPerSample = 2;
+    
+    decoder->maxDecodedBufferSize = 4096 >> 1;
+    decoder->numChannels = numChannels;
+    data->scratchBufferNumBytes = decoder->maxDecodedBufferSize;
+    data->scratchBuffer = (char*)KWL_MALLOC(data->scratchBufferNumBytes, "pcm decoder scratch buffer");
+    
+    return KWL_NO_ERROR;
+}
+
 void kwlDeinitDecoderPCM(kwlDecoder* decoder)
 {
     kwlPCMDecoderData* data = (kwlPCMDecoderData*)decoder->codecData;
@@ -194,8 +226,8 @@ int kwlRewindDecoderPCM(kwlDecoder* decoder)
 {
     kwlPCMDecoderData* data = (kwlPCMDecoderData*)decoder->codecData;
     
-    /*seek to the first sample*/
-    KWL_ASSERT(data->pcmDataDescription.fileOffset > 0);
+    /*seek to the first sample. Raw streams have no header.*/
+    KWL_ASSERT(data->pcmDataDescription.fileOffset >= 0);
     kwlInputStream_seek(&decoder->audioDataStream, 
                         data->pcmDataDescription.fileOffset, 
                         SEEK_SET);
@@ -54,6 +54,15 @@ typedef struct
  */
 kwlError kwlInitDecoderPCM(kwlDecoder* decoder);
 
+/** 
+ * Initializes a given PCM decoder for a headerless stream of signed, 
+ * interleaved, little endian 16 bit samples.
+ * @param decoder The decoder to initialize.
+ * @param numChannels The number of channels of the stream.
+ * @return A Kowalski error code.
+ */
+kwlError kwlInitDecoderRawPCM(kwlDecoder* decoder, int numChannels);
+
 /** 
  * Deinitializes a given PCM decoder, releasing all associated resoures.
  * @param decoder The decoder to deinitialize.
@@ -72,6 +72,13 @@ typedef struct kwlDSPUnit
      * Perform as little work as possible in this callback. 
      */        
     kwlDSPUpdateCallback updateDSPEngineCallback;
+    /**
+     * The number of frames the unit keeps producing output after its input goes silent,
+     * e.g the decay time of a reverb. A mix bus DSP unit with a non-negative tail length 
+     * stops being processed once the tail has elapsed. A negative value means the tail
+     * is unknown and the unit is processed on every buffer.
+     */
+    int tailLengthInFrames;
     
 } kwlDSPUnit;
     
@@ -23,14 +23,19 @@ freely, subject to the following restrictions:
 
 #include "kwl_asm.h"
 #include "kwl_audiodata.h"
+#include "kwl_automation.h"
 #include "kwl_audiofileutil.h"
 #include "kwl_synchronization.h"
 #include "kwl_decoder.h"
 #include "kwl_eventinstance.h"
 #include "kwl_eventdefinition.h"
+#include "kwl_log.h"
 #include "kwl_memory.h"
 #include "kwl_messagequeue.h"
 #include "kwl_positionalaudiolistener.h"
+#include "kwl_pushstream.h"
+#include "kwl_random.h"
+#include "kwl_rateconverter.h"
 #include "kwl_mixer.h"
 #include "kwl_sound.h"
 #include "kwl_engine.h"
@@ -41,86 +46,19 @@ freely, subject to the following restrictions:
 #include <stdlib.h>
 #include <string.h>
 
-int kwlEngine_isFreeformEventHandle(kwlEngine* engine, kwlEventHandle handle)
-{
-    int mask = 1 << 31;
-    int isFreeForm = handle & mask;
-    return isFreeForm;
-}
-
-int kwlEngine_getFreeformIndexFromHandle(kwlEngine* engine, kwlEventHandle handle)
-{
-    return handle & 0xffff;
-}
-
 kwlEventInstance* kwlEngine_getEventFromHandle(kwlEngine* engine, kwlEventHandle handle)
 {
-    kwlEventInstance* event = NULL;
-    
-    if (kwlEngine_isFreeformEventHandle(engine, handle))
-    {
-        int freeformEventIndex = handle & 0xffff;
-        if (freeformEventIndex >= 0 &&
-            freeformEventIndex < engine->freeformEventArraySize)
-        {
-            event = engine->freeformEvents[freeformEventIndex];
-        }
-    }
-    else
-    {
-        int eventDefinitionIndex = handle & 0xffff;
-        int eventInstanceIndex = (handle & 0x7fff) >> 16;
-        
-        if (eventDefinitionIndex >= 0 && 
-            eventDefinitionIndex < engine->engineData.numEventDefinitions)
-        {
-            if (eventInstanceIndex >= 0 && 
-                eventInstanceIndex < engine->engineData.eventDefinitions[eventDefinitionIndex].instanceCount)
-            {
-                event = &engine->engineData.events[eventDefinitionIndex][eventInstanceIndex];
-            }
-        }
-    }    
     /* A return value of NULL is valid and means that the event handle was invalid.*/
-    return event;
+    return (kwlEventInstance*)kwlHandleTable_lookup(&engine->eventHandles, handle);
 }
 
-/** */
-kwlEventHandle computeEventHandle(int eventDefinitionOrFreeformIndex, int eventInstanceIndex, int isFreeForm)
+int kwlEngine_isFreeformEvent(kwlEngine* engine, kwlEventInstance* event)
 {
-    /*
-     The event handle uniquely indentifies an event instance that could either 
-     be loaded from data or created in code as a freeform event. A data event
-     is uniquely defined by an event definition index and an event instance index
-     and a freeform event by its index into the array of freeform events.
-     
-     An event handle is a 32 bit int encoded as follows:
-     
-     bit number |        32             |  31  |  ...  |  17  |  16  |  ...  |  1  |
-                |-----------------------|-------------------------------------------
-                |0 for data events      |these 15 bits encode |these 16 bits encode the 
-                |1 for freeform events  |the event instance   |event definition index for data
-                |                       |index and are zero   |events and the array index for 
-                |                       |for freeform events  |freeform events.
-     
-     This encoding scheme means that the maximum number of event instances per definition is 32767
-     and the maximum number of event definitions and freeform events is 65535.
-     
-     KWL_INVALID_HANDLE = 0xffffffff is used to represent invalid handles.
-     */
-    
-    KWL_ASSERT(eventDefinitionOrFreeformIndex >= 0);
-    KWL_ASSERT(eventInstanceIndex >= 0);
-    KWL_ASSERT(eventDefinitionOrFreeformIndex < (1 << 16));
-    KWL_ASSERT(eventInstanceIndex < (1 << 15));
-    
-    int bit32 = (isFreeForm != 0 ? 1 : 0) << 31;
-    int bits31To17 = eventInstanceIndex << 16;
-    int bits1To16 = eventDefinitionOrFreeformIndex;
-    
-    int handle = bit32 | bits31To17 | bits1To16;
-    /*printf("computing event handle: dIdx=%d, iIdx=%d, handle=%d\n", eventDefinitionIndex, eventInstanceIndex, handle);*/
-    return handle;
+    /*Data driven events are instances of the event definitions in the engine data.*/
+    const kwlEventDefinition* definitions = engine->engineData.eventDefinitions;
+    return definitions == NULL ||
+           event->definition_engine < definitions ||
+           event->definition_engine >= definitions + engine->engineData.numEventDefinitions;
 }
 
 kwlWaveBankHandle kwlEngine_getHandleFromWaveBank(kwlEngine* engine, kwlWaveBank* waveBank)
@@ -160,12 +98,21 @@ void kwlEngine_init(kwlEngine* engine)
     
     engine->engineData.isLoaded = 0;
     engine->playingEventList = NULL;
+    engine->playingEventListTail = NULL;
     engine->engineData.numMixBuses = 0;
     engine->engineData.mixBuses = NULL;    
     engine->engineData.masterBus = NULL;
     
-    engine->freeformEventArraySize = 0;
-    engine->freeformEvents = NULL;
+    kwlHandleTable_init(&engine->eventHandles);
+    
+    engine->numEventStarts = 0;
+    engine->randomState = KWL_RANDOM_DEFAULT_STATE;
+    
+    engine->voiceLODMonoThreshold = 0.0f;
+    engine->voiceLODHalfRateThreshold = 0.0f;
+    
+    kwlSpatialGrid_init(&engine->spatialGrid);
+    engine->spatialQueryStamp = 0;
     
     int KWL_NUM_DECODERS = 10;
     engine->numDecoders = KWL_NUM_DECODERS;
@@ -175,6 +122,11 @@ void kwlEngine_init(kwlEngine* engine)
     //set up main mutex lock
     kwlMutexLockInit(&engine->mixerEngineMutexLock);
     engine->mixer->mixerEngineMutexLock = &engine->mixerEngineMutexLock;
+    
+    kwlArena_init(&engine->scratchArena, KWL_ENGINE_SCRATCH_ARENA_BLOCK_SIZE, "engine scratch arena");
+    
+    engine->audioDataStore = kwlAudioDataStore_retainShared();
+    kwlResidencyManager_init(&engine->residencyManager);
 }
 
 void kwlEngine_free(kwlEngine* engine)
@@ -186,6 +138,12 @@ void kwlEngine_free(kwlEngine* engine)
     kwlMessageQueue_free(&engine->fromMixerQueue);
     
     KWL_FREE(engine->decoders);
+    kwlHandleTable_free(&engine->eventHandles);
+    kwlSpatialGrid_free(&engine->spatialGrid);
+    kwlArena_free(&engine->scratchArena);
+    kwlResidencyManager_free(&engine->residencyManager);
+    kwlAudioDataStore_releaseShared();
+    engine->audioDataStore = NULL;
 }
 
 kwlError kwlEngine_loadWaveBank(kwlEngine* engine, 
@@ -199,7 +157,8 @@ kwlError kwlEngine_loadWaveBank(kwlEngine* engine,
         return KWL_ENGINE_DATA_NOT_LOADED;
     }
     
-    /*TODO: handle the case of more than one wave bank sharing a piece of audio data.*/
+    /*Audio data shared by more than one wave bank is only kept resident once, 
+      through the audio data store of the engine.*/
 
     /* Check that we have a valid wave bank binary file and that its entries match those
        in engine data.*/
@@ -339,7 +298,7 @@ kwlError kwlEngine_requestUnloadWaveBank(kwlEngine* engine, kwlWaveBankHandle ha
          returning.*/
         while (waveBankToUnload->isLoaded != 0)
         {
-            kwlUpdate(0);
+            kwlEngine_update(engine, 0);
         }
     }
     
@@ -371,8 +330,13 @@ kwlError kwlEngine_eventGetHandle(kwlEngine* engine, const char* const eventID,
                 kwlEventInstance* const eventj = &engine->engineData.events[i][j];
                 if (eventj->isAssociatedWithHandle == 0)
                 {
-                    *handle = computeEventHandle(i, j, 0);
+                    *handle = kwlHandleTable_add(&engine->eventHandles, eventj);
+                    if (*handle == KWL_INVALID_HANDLE)
+                    {
+                        return KWL_NO_FREE_EVENT_INSTANCES;
+                    }
                     eventj->isAssociatedWithHandle = 1;
+                    kwlEventDefinition_updateInstancePool(eventj->definition_engine, eventj);
                     return KWL_NO_ERROR;
                 }
             }
@@ -408,36 +372,16 @@ kwlError kwlEngine_eventDefinitionGetHandle(kwlEngine* engine,
     return KWL_UNKNOWN_EVENT_DEFINITION_ID;
 }
 
-void kwlEngine_addFreeformEvent(kwlEngine* engine, kwlEventInstance* event, kwlEventHandle* handle)
+kwlError kwlEngine_addFreeformEvent(kwlEngine* engine, kwlEventInstance* event, kwlEventHandle* handle)
 {
-    /*find a free slot in the freeform event array. reallocate the array if needed */
-    int slotIdx = -1;
-    int i;
-    for (i = 0; i < engine->freeformEventArraySize; i++)
+    *handle = kwlHandleTable_add(&engine->eventHandles, event);
+    if (*handle == KWL_INVALID_HANDLE)
     {
-        if (engine->freeformEvents[i] == NULL)
-        {
-            slotIdx = i;
-            break;
-        }
-    }
-    
-    if (slotIdx < 0)
-    {
-        /*no free slots, reallocate the array 
-         and pick the newly allocated slot*/
-        engine->freeformEventArraySize++;
-        engine->freeformEvents = (kwlEventInstance**)realloc(engine->freeformEvents, 
-                                                     engine->freeformEventArraySize * sizeof(kwlEventInstance*));
-        engine->freeformEvents[engine->freeformEventArraySize - 1] = NULL;
-        
-        slotIdx = engine->freeformEventArraySize - 1;
+        kwlEventInstance_releaseFreeformEvent(event);
+        return KWL_NO_FREE_EVENT_INSTANCES;
     }
     
-    *handle = computeEventHandle(slotIdx, 0, 1);
-    //printf("slot idx %d, handle %d, event %d\n", slotIdx, *handle, createdEvent);
-    
-    engine->freeformEvents[slotIdx] = event;
+    return KWL_NO_ERROR;
 }
 
 kwlError kwlEngine_eventCreateWithBuffer(kwlEngine* engine, kwlPCMBuffer* buffer, 
@@ -450,7 +394,7 @@ kwlError kwlEngine_eventCreateWithBuffer(kwlEngine* engine, kwlPCMBuffer* buffer
     if (result == KWL_NO_ERROR)
     {
         KWL_ASSERT(createdEvent != NULL);
-        kwlEngine_addFreeformEvent(engine, createdEvent, handle);
+        result = kwlEngine_addFreeformEvent(engine, createdEvent, handle);
     }
     
     return result;
@@ -465,32 +409,53 @@ kwlError kwlEngine_eventCreateWithFile(kwlEngine* engine, const char* const audi
     if (result == KWL_NO_ERROR)
     {
         KWL_ASSERT(createdEvent != NULL);
-        kwlEngine_addFreeformEvent(engine, createdEvent, handle);
+        result = kwlEngine_addFreeformEvent(engine, createdEvent, handle);
     }
     
     return result;
 }
 
-kwlError kwlEngine_unloadFreeformEvent(kwlEngine* engine, kwlEventInstance* event)
+kwlError kwlEngine_eventCreatePushStream(kwlEngine* engine, int numChannels, int capacity, int latency,
+                                         kwlEventHandle* handle, kwlEventType type)
 {
-    /*printf("kwlEngine_unloadFreeformEvent: %s\n", event->definition_engine->id);*/
-    KWL_ASSERT(event != NULL);
-    KWL_ASSERT(event->isPlaying == 0);
+    *handle = KWL_INVALID_HANDLE;
+    kwlEventInstance* createdEvent = NULL;
+    kwlError result = kwlEventInstance_createFreeformEventFromPushStream(&createdEvent, numChannels, 
+                                                                        capacity, latency, type);
     
-    int matchFound = 0;
-    int eventIndex;
-    for (eventIndex = 0; eventIndex < engine->freeformEventArraySize; eventIndex++)
+    if (result == KWL_NO_ERROR)
     {
-        if (engine->freeformEvents[eventIndex] == event)
-        {
-            matchFound = 1;
-            break;
-        }
+        KWL_ASSERT(createdEvent != NULL);
+        result = kwlEngine_addFreeformEvent(engine, createdEvent, handle);
+    }
+    
+    return result;
+}
+
+kwlError kwlEngine_eventGetPushStream(kwlEngine* engine, kwlEventHandle handle, kwlPushStream** stream)
+{
+    *stream = NULL;
+    kwlEventInstance* event = kwlEngine_getEventFromHandle(engine, handle);
+    if (event == NULL)
+    {
+        return KWL_INVALID_EVENT_INSTANCE_HANDLE;
+    }
+    
+    if (event->pushStream == NULL)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
     }
     
-    KWL_ASSERT(matchFound != 0 && "trying to free a freeform event that is not in the engine's list");
-    /*Clear the event slot so it can be reused. */
-    engine->freeformEvents[eventIndex] = NULL;
+    *stream = event->pushStream;
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_unloadFreeformEvent(kwlEngine* engine, kwlEventInstance* event)
+{
+    /*printf("kwlEngine_unloadFreeformEvent: %s\n", event->definition_engine->id);*/
+    (void)engine;
+    KWL_ASSERT(event != NULL);
+    KWL_ASSERT(event->isPlaying == 0);
     
     /*Release event data.*/
     kwlEventInstance_releaseFreeformEvent(event);
@@ -501,14 +466,19 @@ kwlError kwlEngine_unloadFreeformEvent(kwlEngine* engine, kwlEventInstance* even
 
 kwlError kwlEngine_eventRelease(kwlEngine* engine, kwlEventHandle handle)
 {
-    kwlEventInstance* eventToRelease = kwlEngine_getEventFromHandle(engine, handle);
+    /*Invalidate the handle. Any later use of it is detected as stale.*/
+    kwlEventInstance* eventToRelease = (kwlEventInstance*)kwlHandleTable_remove(&engine->eventHandles, handle);
     if (eventToRelease == NULL)
     {
         return KWL_INVALID_EVENT_INSTANCE_HANDLE;
     }
     
+    /*Clear callbacks. This must happen before a freeform event is unloaded below.*/
+    eventToRelease->stoppedCallback = NULL;
+    eventToRelease->stoppedCallbackUserData = NULL;
+    
     /*If this is a freeform event, dispose of any data allocated for it.*/
-    if (kwlEngine_isFreeformEventHandle(engine, handle))
+    if (kwlEngine_isFreeformEvent(engine, eventToRelease))
     {   
         if (eventToRelease->isPlaying == 0)
         {
@@ -537,12 +507,9 @@ kwlError kwlEngine_eventRelease(kwlEngine* engine, kwlEventHandle handle)
         eventToRelease->userPitch = 1.0f;
         eventToRelease->dspUnit.valueEngine = NULL;
         eventToRelease->isAssociatedWithHandle = 0;
+        kwlEventDefinition_updateInstancePool(eventToRelease->definition_engine, eventToRelease);
     }
     
-    /*Clear callbacks*/
-    eventToRelease->stoppedCallback = NULL;
-    eventToRelease->stoppedCallbackUserData = NULL;
-    
     return KWL_NO_ERROR;
 }
 
@@ -624,6 +591,165 @@ kwlError kwlEngine_mixBusSetPitch(kwlEngine* engine, kwlMixBusHandle handle, flo
     return KWL_NO_ERROR;
 }
 
+/** 
+ * Returns non-zero if each bus in a subtree runs at its parent rate divided by a 
+ * supported factor, given the sample rate divisor of the parent of the subtree root.
+ */
+static int kwlEngine_validateMixBusRates(kwlMixBus* bus, int parentDivisor)
+{
+    const int divisor = bus->sampleRateDivisor > 0 ? bus->sampleRateDivisor : parentDivisor;
+    if (divisor % parentDivisor != 0 || divisor > KWL_MAX_RATE_CONVERSION_FACTOR)
+    {
+        return 0;
+    }
+    
+    for (int i = 0; i < bus->numSubBuses; i++)
+    {
+        if (!kwlEngine_validateMixBusRates(bus->subBuses[i], divisor))
+        {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+/** 
+ * Sets the rate conversion factors of the buses in a subtree, given the sample 
+ * rate divisor of the parent of the subtree root. Converters are created the first
+ * time a bus needs a given factor.
+ */
+static void kwlEngine_applyMixBusRates(kwlEngine* engine, kwlMixBus* bus, int parentDivisor)
+{
+    const int divisor = bus->sampleRateDivisor > 0 ? bus->sampleRateDivisor : parentDivisor;
+    const int factor = divisor / parentDivisor;
+    
+    if (factor > 1 && bus->rateConverters[factor] == NULL)
+    {
+        kwlArena* arena = &engine->engineData.arena;
+        kwlRateConverter* converter = 
+            (kwlRateConverter*)kwlArena_alloc(arena, sizeof(kwlRateConverter));
+        kwlRateConverter_init(converter, 
+                              factor, 
+                              engine->mixer->numOutChannels, 
+                              KWL_TEMP_BUFFER_SIZE_IN_FRAMES, 
+                              arena);
+        bus->rateConverters[factor] = converter;
+    }
+    bus->rateConversionFactor.valueEngine = factor;
+    
+    for (int i = 0; i < bus->numSubBuses; i++)
+    {
+        kwlEngine_applyMixBusRates(engine, bus->subBuses[i], divisor);
+    }
+}
+
+kwlError kwlEngine_mixBusSetSampleRate(kwlEngine* engine, kwlMixBusHandle handle, int sampleRate)
+{
+    kwlMixBus* const mixBus = kwlEngine_getMixBusFromHandle(engine, handle);
+    if (mixBus == NULL)
+    {
+        return KWL_INVALID_MIX_BUS_HANDLE;
+    }
+    if (sampleRate < 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    /*Only integer fractions of the output rate are supported.*/
+    int divisor = 0;
+    if (sampleRate > 0)
+    {
+        const int outputRate = (int)engine->mixer->sampleRate;
+        if (sampleRate > outputRate || outputRate % sampleRate != 0)
+        {
+            return KWL_UNSUPPORTED_SAMPLE_RATE;
+        }
+        divisor = outputRate / sampleRate;
+    }
+    
+    /*Check the whole tree, since buses inheriting the rate of this bus are affected too.*/
+    const int previousDivisor = mixBus->sampleRateDivisor;
+    mixBus->sampleRateDivisor = divisor;
+    if (!kwlEngine_validateMixBusRates(engine->engineData.masterBus, 1))
+    {
+        mixBus->sampleRateDivisor = previousDivisor;
+        return KWL_UNSUPPORTED_SAMPLE_RATE;
+    }
+    
+    kwlEngine_applyMixBusRates(engine, engine->engineData.masterBus, 1);
+    
+    return KWL_NO_ERROR;
+}
+
+/** Checks that an automation envelope is valid for a given parameter.*/
+static kwlError kwlEngine_validateEnvelope(kwlAutomatedParameter parameter,
+                                           const float* times, 
+                                           const float* values, 
+                                           int numBreakpoints, 
+                                           kwlAutomationCurve curve)
+{
+    if (numBreakpoints < 1 || numBreakpoints > KWL_MAX_AUTOMATION_BREAKPOINTS ||
+        times == NULL || values == NULL)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    if (curve != KWL_CURVE_LINEAR && 
+        curve != KWL_CURVE_EXPONENTIAL && 
+        curve != KWL_CURVE_S)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    for (int i = 0; i < numBreakpoints; i++)
+    {
+        if (times[i] < 0.0f || (i > 0 && times[i] < times[i - 1]))
+        {
+            return KWL_INVALID_PARAMETER_VALUE;
+        }
+        
+        const float minValue = parameter == KWL_PARAMETER_BALANCE ? -1.0f : 0.0f;
+        if (values[i] < minValue || 
+            (parameter == KWL_PARAMETER_BALANCE && values[i] > 1.0f))
+        {
+            return KWL_INVALID_PARAMETER_VALUE;
+        }
+    }
+    
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_mixBusSetEnvelope(kwlEngine* engine, kwlMixBusHandle handle, 
+                                     kwlAutomatedParameter parameter,
+                                     const float* times, const float* values, int numBreakpoints, 
+                                     int startsAtCurrentValue, kwlAutomationCurve curve,
+                                     long long startFrame)
+{
+    kwlMixBus* const mixBus = kwlEngine_getMixBusFromHandle(engine, handle);
+    if (mixBus == NULL)
+    {
+        return KWL_INVALID_MIX_BUS_HANDLE;
+    }
+    
+    if (parameter != KWL_PARAMETER_GAIN && parameter != KWL_PARAMETER_PITCH)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    kwlError result = kwlEngine_validateEnvelope(parameter, times, values, numBreakpoints, curve);
+    if (result != KWL_NO_ERROR)
+    {
+        return result;
+    }
+    
+    kwlAutomation* automation = parameter == KWL_PARAMETER_GAIN ? 
+                                &mixBus->gainAutomation : &mixBus->pitchAutomation;
+    kwlAutomation_setEnvelope(automation, times, values, numBreakpoints, startsAtCurrentValue, curve, startFrame);
+    
+    return KWL_NO_ERROR;
+}
+
 kwlError kwlEngine_mixPresetGetHandle(kwlEngine* engine, const char* const presetId, kwlMixBusHandle* handle)
 {
     int i;
@@ -660,6 +786,11 @@ kwlError kwlEngine_mixPresetSetActive(kwlEngine* engine, kwlMixPresetHandle hand
         }
     }
     
+    if (doFade == 0)
+    {
+        engine->engineData.mixPresetsNeedFullBlend = 1;
+    }
+    
     return KWL_NO_ERROR;
 }
 
@@ -729,8 +860,9 @@ kwlError kwlEngine_setDistanceAttenuationModel(kwlEngine* engine,
         return KWL_INVALID_PARAMETER_VALUE;
     }
     
+    engine->positionalAudioSettings.distanceModel = type;
     engine->positionalAudioSettings.clamp = clamp;
-    engine->positionalAudioSettings.referenceDistance = referenceDistance;
+    engine->positionalAudioSettings.maxDistance = maxDistance;
     engine->positionalAudioSettings.rolloffFactor = rolloffFactor;
     engine->positionalAudioSettings.referenceDistance = referenceDistance;
     
@@ -762,6 +894,134 @@ kwlError kwlEngine_setConeAttenuationEnabled(kwlEngine* engine, int listenerCone
     return KWL_NO_ERROR;
 }
 
+kwlError kwlEngine_setVoiceLODThresholds(kwlEngine* engine, float monoThreshold, float halfRateThreshold)
+{
+    if (monoThreshold < 0.0f || halfRateThreshold < 0.0f || halfRateThreshold > monoThreshold)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    engine->voiceLODMonoThreshold = monoThreshold;
+    engine->voiceLODHalfRateThreshold = halfRateThreshold;
+    
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_setSpatialIndexCellSize(kwlEngine* engine, float cellSize)
+{
+    if (!(cellSize >= 0.0f))
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    /*Take all events out of the current grid, if any, and rebuild it with the new cell size.*/
+    kwlEventInstance* event = engine->playingEventList;
+    while (event != NULL)
+    {
+        kwlSpatialGrid_remove(&engine->spatialGrid, event);
+        event = event->nextEvent_engine;
+    }
+    kwlSpatialGrid_free(&engine->spatialGrid);
+    
+    if (cellSize > 0.0f)
+    {
+        kwlSpatialGrid_enable(&engine->spatialGrid, cellSize);
+        event = engine->playingEventList;
+        while (event != NULL)
+        {
+            if (event->definition_engine->isPositional)
+            {
+                kwlSpatialGrid_insert(&engine->spatialGrid, event);
+            }
+            event = event->nextEvent_engine;
+        }
+    }
+    
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_setRandomSeed(kwlEngine* engine, unsigned int seed)
+{
+    engine->randomState = kwlRandom_seed(seed);
+    return KWL_NO_ERROR;
+}
+
+/** Sets the position of a positional event, keeping the spatial index up to date.*/
+static void kwlEngine_setEventPosition(kwlEngine* engine, kwlEventInstance* event, float x, float y, float z)
+{
+    event->positionX = x;
+    event->positionY = y;
+    event->positionZ = z;
+    
+    if (engine->spatialGrid.buckets != NULL)
+    {
+        kwlSpatialGrid_update(&engine->spatialGrid, event);
+    }
+}
+
+/** 
+ * Returns the doppler shift of a given positional event, i.e the factor to scale its pitch by.
+ * @param dx The x component of the normalized vector from the listener to the event.
+ * @param dy The y component of the normalized vector from the listener to the event.
+ * @param dz The z component of the normalized vector from the listener to the event.
+ */
+static float kwlEngine_getDopplerShift(kwlEngine* engine, kwlEventInstance* event, float dx, float dy, float dz)
+{
+    const float speedOfSound = engine->positionalAudioSettings.speedOfSound;
+    const float dopplerScale = engine->positionalAudioSettings.dopplerScale;
+    
+    /*project velocities onto the unit vector 
+      pointing from the listener to the event*/
+    float vListener = engine->listener.velocityX * dx +    
+                      engine->listener.velocityY * dy + 
+                      engine->listener.velocityZ * dz;
+    float vEvent = event->velocityX * dx +    
+                   event->velocityY * dy + 
+                   event->velocityZ * dz;
+    
+    float dopplerShift = (1 - dopplerScale) + dopplerScale * (speedOfSound - vListener) / (speedOfSound - vEvent);
+    if (dopplerShift < 0)
+    {
+        dopplerShift = 0.0001f;/*TODO: handle this properly*/
+    }
+    
+    return dopplerShift;
+}
+
+/** 
+ * Returns the level of detail to render an event at given its current tier and its loudest
+ * channel gain. Moving to a better tier requires the gain to exceed the threshold by a margin,
+ * so that events hovering around a threshold do not switch tiers every update.
+ */
+static int kwlEngine_getVoiceLODTier(kwlEngine* engine, int currentTier, float gain)
+{
+    const float hysteresis = 1.5f;
+    const float monoThreshold = engine->voiceLODMonoThreshold;
+    const float halfRateThreshold = engine->voiceLODHalfRateThreshold;
+    
+    int tier = KWL_VOICE_LOD_FULL;
+    if (gain < halfRateThreshold)
+    {
+        tier = KWL_VOICE_LOD_HALF_RATE;
+    }
+    else if (gain < monoThreshold)
+    {
+        tier = KWL_VOICE_LOD_MONO;
+    }
+    
+    if (tier < currentTier && currentTier != KWL_VOICE_LOD_VIRTUAL)
+    {
+        const float currentThreshold = 
+            currentTier == KWL_VOICE_LOD_HALF_RATE ? halfRateThreshold : monoThreshold;
+        if (gain < hysteresis * currentThreshold)
+        {
+            tier = currentTier;
+        }
+    }
+    
+    return tier;
+}
+
 kwlError kwlEngine_setListenerConeParameters(kwlEngine* engine, 
                                                   float innerAngle, 
                                                   float outerAngle, 
@@ -843,22 +1103,48 @@ float kwlEngine_getDistanceGain(kwlEngine* engine, float distanceInv)
     return 1.0f;
 }
 
+/** 
+ * Recomputes the linear mix preset gains and pitch of a mix bus from the default 
+ * parameters and the weighted differences accumulated for it.
+ */
+static void kwlEngine_applyBlendedMixPresetParameters(kwlEngineData* data, int mixBusIndex)
+{
+    const kwlMixBusParameters* base = &data->mixPresetBaseParameters[mixBusIndex];
+    const kwlMixBusParameters* difference = &data->mixPresetBlendedDifferences[mixBusIndex];
+    const float weightSum = data->mixPresetWeightSum;
+    kwlMixBus* bus = &data->mixBuses[mixBusIndex];
+    
+    /*Blend in the logarithmic domain, then convert from adjusted gain to linear gain.*/
+    bus->mixPresetGainLeft = logGainToLinGain(weightSum * base->logGainLeft + difference->logGainLeft);
+    bus->mixPresetGainRight = logGainToLinGain(weightSum * base->logGainRight + difference->logGainRight);
+    bus->mixPresetPitch = weightSum * base->pitch + difference->pitch;
+}
+
 void kwlEngine_updateMixPresets(kwlEngine* engine, float timeStepSec)
 {
+    kwlEngineData* data = &engine->engineData;
+    
     /*TODO: read from project data?*/
-    engine->engineData.mixPresetFadeTime = 1.0f;
+    data->mixPresetFadeTime = 1.0f;
+    
+    /*
+     Each preset is stored as its differences from the default preset, so 
+     the blended value of a bus is the default value scaled by the sum of all
+     weights plus the weighted differences of the presets touching the bus.
+     */
     
     /*update mix preset weights towards the target values*/
-    float dWeight = engine->engineData.mixPresetFadeTime > 0.0f ? timeStepSec / engine->engineData.mixPresetFadeTime : 1.0f;
+    float dWeight = data->mixPresetFadeTime > 0.0f ? timeStepSec / data->mixPresetFadeTime : 1.0f;
+    int isFading = 0;
+    float weightSum = 0.0f;
     int i;
-    for (i = 0; i < engine->engineData.numMixPresets; i++)
+    for (i = 0; i < data->numMixPresets; i++)
     {
-        kwlMixPreset* preseti = &engine->engineData.mixPresets[i];
-        //printf("updating %s to weight ", preseti->id);
+        kwlMixPreset* preseti = &data->mixPresets[i];
         
-        float delta = preseti->weight < preseti->targetWeight ? dWeight : - dWeight;
         if (preseti->weight != preseti->targetWeight)
         {
+            float delta = preseti->weight < preseti->targetWeight ? dWeight : - dWeight;
             preseti->weight += delta;
             if (preseti->weight < 0)
             {
@@ -868,73 +1154,106 @@ void kwlEngine_updateMixPresets(kwlEngine* engine, float timeStepSec)
             {
                 preseti->weight = 1;
             }
+            isFading = 1;
         }
-        //printf("%f by %f\n", preseti->weight, delta);
-    }
-    
-    if (0)
-    {
-        for (i = 0; i < engine->engineData.numMixPresets; i++)
-        {
-            kwlMixPreset* preseti = &engine->engineData.mixPresets[i];
-            
-            printf("%s weight %f        ", preseti->id, preseti->weight);
-        }
-        printf("\n");
+        weightSum += preseti->weight;
     }
     
-    /* Blend mix preset parameter sets.  
-       First reset all mix bus parameters...*/
-    int mixBusIndex;
-    for (mixBusIndex = 0; mixBusIndex < engine->engineData.numMixBuses; mixBusIndex++)
+    /*Nothing to do in steady state.*/
+    if (isFading == 0 && data->mixPresetsNeedFullBlend == 0)
     {
-        engine->engineData.mixBuses[mixBusIndex].mixPresetGainLeft = 0.0f;
-        engine->engineData.mixBuses[mixBusIndex].mixPresetGainRight = 0.0f;
-        engine->engineData.mixBuses[mixBusIndex].mixPresetPitch = 0.0f;
+        return;
     }
     
-    /*...then accumulate the values from each mix preset.*/
-    float debugWeightSum[7] = {0, 0, 0, 0, 0, 0, 0};
-    int j;
-    for (j = 0; j < engine->engineData.numMixPresets; j++)
+    /*
+     The default values of all buses scale with the weight sum, so if it changed
+     or if all fades just finished, blend everything from scratch. The latter keeps
+     the incremental sums from drifting.
+     */
+    int fadesFinished = 1;
+    for (i = 0; i < data->numMixPresets; i++)
     {
-        float presetweight = engine->engineData.mixPresets[j].weight;
-        for (int paramSetIndex = 0; paramSetIndex < engine->engineData.numMixBuses; paramSetIndex++)
+        if (data->mixPresets[i].weight != data->mixPresets[i].targetWeight)
         {
-            kwlMixBusParameters* params = &engine->engineData.mixPresets[j].parameterSets[paramSetIndex];
-            int busIndex = params->mixBusIndex;
-            KWL_ASSERT(busIndex < engine->engineData.numMixBuses && busIndex >= 0);
-            engine->engineData.mixBuses[busIndex].mixPresetGainLeft += params->logGainLeft * presetweight;
-            engine->engineData.mixBuses[busIndex].mixPresetGainRight += params->logGainRight * presetweight;
-            engine->engineData.mixBuses[busIndex].mixPresetPitch += params->pitch * presetweight;
-            debugWeightSum[busIndex] += presetweight;
+            fadesFinished = 0;
+            break;
         }
     }
-    /*
-    printf("debug weight sums: ");
-    for (int b = 0; b < 7; b++)sfsdf
-    {
-        df
-        printf("%f, ", debugWeightSum[b]);
-    }
-    printf("\n");*/
     
-    /*Finally, convert from adjusted gain to linear gain.*/
-    for (mixBusIndex = 0; mixBusIndex < engine->engineData.numMixBuses; mixBusIndex++)
+    const float weightSumEps = 1e-6f;
+    const float weightSumChange = weightSum - data->mixPresetWeightSum;
+    data->mixPresetWeightSum = weightSum;
+    
+    if (data->mixPresetsNeedFullBlend != 0 || fadesFinished != 0 ||
+        weightSumChange > weightSumEps || weightSumChange < -weightSumEps)
     {
-        engine->engineData.mixBuses[mixBusIndex].mixPresetGainLeft = 
-            logGainToLinGain(engine->engineData.mixBuses[mixBusIndex].mixPresetGainLeft);
-        engine->engineData.mixBuses[mixBusIndex].mixPresetGainRight = 
-            logGainToLinGain(engine->engineData.mixBuses[mixBusIndex].mixPresetGainRight);
+        int mixBusIndex;
+        for (mixBusIndex = 0; mixBusIndex < data->numMixBuses; mixBusIndex++)
+        {
+            kwlMixBusParameters* blended = &data->mixPresetBlendedDifferences[mixBusIndex];
+            blended->logGainLeft = 0.0f;
+            blended->logGainRight = 0.0f;
+            blended->pitch = 0.0f;
+        }
         
-        /*printf("setting gain of bus %s to %f\n", 
-               engine->mixBuses[mixBusIndex].id,
-               engine->mixBuses[mixBusIndex].mixPresetGainLeft);*/
-    }
-}
+        for (i = 0; i < data->numMixPresets; i++)
+        {
+            kwlMixPreset* preseti = &data->mixPresets[i];
+            const float presetWeight = preseti->weight;
+            preseti->blendedWeight = presetWeight;
+            if (presetWeight == 0.0f)
+            {
+                continue;
+            }
+            
+            int j;
+            for (j = 0; j < preseti->numSparseParameterSets; j++)
+            {
+                const kwlMixBusParameters* difference = &preseti->sparseParameterSets[j];
+                KWL_ASSERT(difference->mixBusIndex < data->numMixBuses && difference->mixBusIndex >= 0);
+                kwlMixBusParameters* blended = &data->mixPresetBlendedDifferences[difference->mixBusIndex];
+                blended->logGainLeft += presetWeight * difference->logGainLeft;
+                blended->logGainRight += presetWeight * difference->logGainRight;
+                blended->pitch += presetWeight * difference->pitch;
+            }
+        }
+        
+        for (mixBusIndex = 0; mixBusIndex < data->numMixBuses; mixBusIndex++)
+        {
+            kwlEngine_applyBlendedMixPresetParameters(data, mixBusIndex);
+        }
+        
+        data->mixPresetsNeedFullBlend = 0;
+        return;
+    }
+    
+    /*Otherwise, only update and re-evaluate the buses touched by fading presets.*/
+    for (i = 0; i < data->numMixPresets; i++)
+    {
+        kwlMixPreset* preseti = &data->mixPresets[i];
+        const float weightChange = preseti->weight - preseti->blendedWeight;
+        if (weightChange == 0.0f)
+        {
+            continue;
+        }
+        preseti->blendedWeight = preseti->weight;
+        
+        int j;
+        for (j = 0; j < preseti->numSparseParameterSets; j++)
+        {
+            const kwlMixBusParameters* difference = &preseti->sparseParameterSets[j];
+            kwlMixBusParameters* blended = &data->mixPresetBlendedDifferences[difference->mixBusIndex];
+            blended->logGainLeft += weightChange * difference->logGainLeft;
+            blended->logGainRight += weightChange * difference->logGainRight;
+            blended->pitch += weightChange * difference->pitch;
+            kwlEngine_applyBlendedMixPresetParameters(data, difference->mixBusIndex);
+        }
+    }
+}
 
 float kwlEngine_getConeGain(kwlEngine* engine, float cosAngle, float cosInner, float cosOuter, float outerGain)
 {
+    (void)engine;
     float coneGain = 1.0f;
     if (cosAngle < cosOuter)
     {
@@ -971,27 +1290,71 @@ void kwlEngine_updateEvents(kwlEngine* engine)
     const float rightYListener = engine->listener.rightY;
     const float rightZListener = engine->listener.rightZ;
     
-    const float velXListener = engine->listener.velocityX;
-    const float velYListener = engine->listener.velocityY;
-    const float velZListener = engine->listener.velocityZ;
-    
     const float cosInnerListener = engine->listener.innerConeCosAngle;
     const float cosOuterListener = engine->listener.outerConeCosAngle;
     const float outerGainListener = engine->listener.outerConeGain;
     
-    const float speedOfSound = engine->positionalAudioSettings.speedOfSound;
     const float dopplerScale = engine->positionalAudioSettings.dopplerScale;
     
     const int eventConesEnabled = engine->positionalAudioSettings.isEventConeAttenuationEnabled;
     const int isDirectionalListener = engine->positionalAudioSettings.isListenerConeAttenuationEnabled &&
                                       engine->listener.outerConeGain != 1.0f; 
     
+    /*Find the positional events within range of the listener, if the spatial index is enabled.*/
+    const float maxDistance = engine->positionalAudioSettings.maxDistance;
+    const int isSpatialQueryEnabled = engine->spatialGrid.buckets != NULL && maxDistance > 0.0f;
+    if (isSpatialQueryEnabled)
+    {
+        engine->spatialQueryStamp++;
+        kwlSpatialGrid_markEventsInRange(&engine->spatialGrid, 
+                                         posXListener, posYListener, posZListener, 
+                                         maxDistance, 
+                                         engine->spatialQueryStamp);
+    }
+    
     /*recalculate positional gain and pitch of currently playing events*/
     kwlEventInstance* eventList = engine->playingEventList;
     while (eventList != NULL)
     {   
         kwlEventDefinition* definition = eventList->definition_engine;
-        if (definition->isPositional)
+        /*Only the quietest stealing mode orders the steal heap by gain.*/
+        const int isStealOrderedByGain = eventList->stealHeapIndex >= 0 && 
+                                         definition->stealingMode == KWL_STEAL_QUIETEST;
+        const float previousStealGain = eventList->gainLeft.valueEngine + eventList->gainRight.valueEngine;
+        
+        const int isCulled = definition->isPositional && isSpatialQueryEnabled && 
+                             eventList->spatialQueryStamp != engine->spatialQueryStamp;
+        if (isCulled)
+        {
+            /*
+             The event is beyond the maximum distance, where the distance gain is 0.
+             Skip pan and cone attenuation and silence it. Once the mixer has had an update 
+             to ramp the event to silence, stop mixing it altogether. The pitch, including 
+             doppler shift, still sets the playback speed, so the event advances just like 
+             it would without the spatial index.
+             */
+            float dopplerShift = 1.0f;
+            if (dopplerScale > 0.0f)
+            {
+                float dx = posXListener - eventList->positionX;
+                float dy = posYListener - eventList->positionY;
+                float dz = posZListener - eventList->positionZ;
+                const float distInv = kwlFastInverseSqrt(dx * dx + dy * dy + dz * dz);
+                dopplerShift = kwlEngine_getDopplerShift(engine, eventList, dx * distInv, dy * distInv, dz * distInv);
+            }
+            
+            const int isSilent = eventList->gainLeft.valueEngine == 0.0f && 
+                                 eventList->gainRight.valueEngine == 0.0f;
+            eventList->gainLeft.valueEngine = 0.0f;
+            eventList->gainRight.valueEngine = 0.0f;
+            eventList->pitch.valueEngine = 
+                eventList->definition_engine->pitch * eventList->userPitch * dopplerShift;
+            if (isSilent)
+            {
+                eventList->lodTier.valueEngine = KWL_VOICE_LOD_VIRTUAL;
+            }
+        }
+        else if (definition->isPositional)
         {
             /*compute a a normalized vector from the listener to the event*/
             float dx = posXListener - eventList->positionX;
@@ -1048,21 +1411,8 @@ void kwlEngine_updateEvents(kwlEngine* engine)
                 coneGain *= listenerConeGain;
             }
             
-            /*doppler shift:
-             project velocities onto the unit vector 
-             pointing from the listener to the event*/
-            float vListener = velXListener * dx +    
-                              velYListener * dy + 
-                              velZListener * dz;
-            float vEvent = eventList->velocityX * dx +    
-            eventList->velocityY * dy + 
-            eventList->velocityZ * dz;
-            
-            float dopplerShift = (1 - dopplerScale) + dopplerScale * (speedOfSound - vListener) / (speedOfSound - vEvent);
-            if (dopplerShift < 0)
-            {
-                dopplerShift = 0.0001f;/*TODO: handle this properly*/
-            }
+            /*doppler shift*/
+            const float dopplerShift = kwlEngine_getDopplerShift(engine, eventList, dx, dy, dz);
             
             float positionalGainLeft = coneGain * distanceAttenuation * panLeft;
             float positionalGainRight = coneGain * distanceAttenuation * panRight;
@@ -1087,6 +1437,22 @@ void kwlEngine_updateEvents(kwlEngine* engine)
                 eventList->definition_engine->pitch * eventList->userPitch;
         }
         
+        if (isStealOrderedByGain &&
+            eventList->gainLeft.valueEngine + eventList->gainRight.valueEngine != previousStealGain)
+        {
+            /*The quietest instance may be a different one now.*/
+            definition->isStealHeapDirty = 1;
+        }
+        
+        /*Distance attenuation is part of the gains, so distant events end up in cheaper tiers too.*/
+        if (!isCulled)
+        {
+            const float maxGain = eventList->gainLeft.valueEngine > eventList->gainRight.valueEngine ?
+                                  eventList->gainLeft.valueEngine : eventList->gainRight.valueEngine;
+            eventList->lodTier.valueEngine = 
+                kwlEngine_getVoiceLODTier(engine, eventList->lodTier.valueEngine, maxGain);
+        }
+        
         if (eventList->dspUnit.valueMixer != NULL)
         {
             kwlDSPUnit* dspUnit = (kwlDSPUnit*)eventList->dspUnit.valueMixer;
@@ -1100,6 +1466,9 @@ void kwlEngine_updateEvents(kwlEngine* engine)
 
 kwlError kwlEngine_update(kwlEngine* engine, float timeStepSec)
 {
+    /*Temporary allocations from the previous update are no longer valid.*/
+    kwlArena_reset(&engine->scratchArena);
+    
     kwlEngine_updateEvents(engine);        
     kwlEngine_updateMixPresets(engine, timeStepSec);
         
@@ -1136,6 +1505,10 @@ kwlError kwlEngine_update(kwlEngine* engine, float timeStepSec)
         eventList->gainLeft.valueShared = eventList->gainLeft.valueEngine;
         eventList->gainRight.valueShared = eventList->gainRight.valueEngine;
         eventList->pitch.valueShared = eventList->pitch.valueEngine;
+        eventList->lodTier.valueShared = eventList->lodTier.valueEngine;
+        kwlAutomation_updateShared(&eventList->gainAutomation);
+        kwlAutomation_updateShared(&eventList->pitchAutomation);
+        kwlAutomation_updateShared(&eventList->balanceAutomation);
         eventList->dspUnit.valueShared = eventList->dspUnit.valueEngine;
         
         eventList = eventList->nextEvent_engine;
@@ -1149,6 +1522,9 @@ kwlError kwlEngine_update(kwlEngine* engine, float timeStepSec)
         busi->totalGainLeft.valueShared = busi->mixPresetGainLeft * busi->userGainLeft;
         busi->totalGainRight.valueShared = busi->mixPresetGainRight * busi->userGainRight;
         busi->totalPitch.valueShared = busi->mixPresetPitch * busi->userPitch;
+        busi->rateConversionFactor.valueShared = busi->rateConversionFactor.valueEngine;
+        kwlAutomation_updateShared(&busi->gainAutomation);
+        kwlAutomation_updateShared(&busi->pitchAutomation);
         busi->dspUnit.valueShared = busi->dspUnit.valueEngine;
     }
     
@@ -1192,45 +1568,66 @@ kwlError kwlEngine_update(kwlEngine* engine, float timeStepSec)
         {
             kwlEventInstance* event = (kwlEventInstance*)messageData;
             event->isPlaying = 0;
+            kwlEventDefinition_updateInstancePool(event->definition_engine, event);
             if (event->decoder != NULL)
             {
                 kwlDecoder_deinit(event->decoder);
             }
-            printf("    %s: %s\n", type == KWL_EVENT_STOPPED ? "event stopped" : "unload freeform event", 
-                   event->definition_engine->id);
+            KWL_LOG_DEBUG("%s: %s", type == KWL_EVENT_STOPPED ? "event stopped" : "unload freeform event", 
+                          event->definition_engine->id);
             kwlEngine_removeEventFromPlayingList(engine, event);
             
-            if (type == KWL_UNLOAD_FREEFORM_EVENT)
+            if (event->stoppedCallback != NULL)
             {
-                kwlEngine_unloadFreeformEvent(engine, event);
+                event->stoppedCallback(event->stoppedCallbackUserData);
             }
             
-            if (event->stoppedCallback != NULL)
+            /*Unloading frees the event, so this has to come last.*/
+            if (type == KWL_UNLOAD_FREEFORM_EVENT)
             {
-                event->stoppedCallback(event->stoppedCallbackUserData);
+                kwlEngine_unloadFreeformEvent(engine, event);
             }
         }
         else if (type == KWL_UNLOAD_WAVEBANK)
         {
             kwlWaveBank* waveBank = (kwlWaveBank*)messageData;
-            printf("    unload wave bank: %s\n", waveBank->id);
+            KWL_LOG_INFO("unload wave bank: %s", waveBank->id);
             kwlWaveBank_unload(waveBank);
         }
         else if (type == KWL_UNLOAD_ENGINE_DATA)
         {
             /*Unload engine data after all messages have been processed.*/
             KWL_ASSERT(unloadEngineDataRequested == 0);
-            printf("received KWL_UNLOAD_ENGINE_DATA\n");
+            KWL_LOG_INFO("received KWL_UNLOAD_ENGINE_DATA");
             unloadEngineDataRequested = 1;
         }
     }
     
     if (unloadEngineDataRequested != 0)
     {
+        /*Invalidate the handles of data driven events, which are about to be freed.*/
+        for (i = 0; i < engine->eventHandles.size; i++)
+        {
+            kwlEventInstance* event = (kwlEventInstance*)engine->eventHandles.slots[i].item;
+            if (event != NULL && !kwlEngine_isFreeformEvent(engine, event))
+            {
+                kwlHandleTable_removeAt(&engine->eventHandles, i);
+            }
+        }
+        
+        kwlResidencyManager_cancelReloads(&engine->residencyManager);
         kwlEngineData_unload(&engine->engineData);
     }
     
     engine->fromMixerQueue.numMessages = 0;
+    
+    /*Install reloaded audio data and evict audio data if over budget. Done after 
+      processing the messages from the mixer, so that stopped events no longer 
+      keep their audio data resident.*/
+    kwlResidencyManager_update(&engine->residencyManager, engine);
+    
+    /*Pass messages logged since the last update, on any thread, to the log callback.*/
+    kwlLog_drain();
 
     return KWL_NO_ERROR;
 }
@@ -1249,15 +1646,32 @@ kwlError kwlEngine_pause(kwlEngine* engine)
 
 kwlError kwlEngine_startEventInstance(kwlEngine* engine, 
                                            kwlEventInstance* eventToPlay, 
-                                           float fadeInTimeSec)
+                                           float fadeInTimeSec,
+                                           long long startFrame)
 {
     /* If the event is not playing. */
     if (eventToPlay->isPlaying == 0)
     {
+        kwlAudioData* streamAudioData = eventToPlay->definition_engine->streamAudioData;
+        int loop = eventToPlay->definition_engine->loopIfStreaming;
+        if (streamAudioData != NULL)
+        {
+            kwlResidencyManager_prepareAudioData(&engine->residencyManager, streamAudioData);
+        }
+        else if (eventToPlay->definition_engine->sound != NULL)
+        {
+            /*If none of the audio data of the sound is resident, stream a piece of 
+              it from disk while it is being reloaded.*/
+            streamAudioData = kwlResidencyManager_prepareSound(&engine->residencyManager, 
+                                                               eventToPlay->definition_engine->sound);
+            loop = 0;
+        }
+        eventToPlay->decoder = NULL;
+        
         /* If this is a streaming event...*/
-        if (eventToPlay->definition_engine->streamAudioData != NULL)
+        if (streamAudioData != NULL)
         {
-            if (eventToPlay->definition_engine->streamAudioData->isLoaded == 0)
+            if (streamAudioData->isLoaded == 0)
             {
                 return KWL_NO_ERROR; /*TODO: return some other error here?*/
             }
@@ -1277,8 +1691,10 @@ kwlError kwlEngine_startEventInstance(kwlEngine* engine,
                 return KWL_NO_FREE_DECODERS;
             }
             eventToPlay->decoder = &engine->decoders[freeDecoderIdx];
-            kwlError initResult = kwlDecoder_init(eventToPlay->decoder, 
-                                                  eventToPlay);
+            kwlError initResult = kwlDecoder_initWithAudioData(eventToPlay->decoder, 
+                                                               eventToPlay,
+                                                               streamAudioData,
+                                                               loop);
 
             if (initResult != KWL_NO_ERROR)
             {
@@ -1286,13 +1702,24 @@ kwlError kwlEngine_startEventInstance(kwlEngine* engine,
             }
         }
             
+        /*
+         Give the event its own random number generator for the mixer thread to use, 
+         seeded from the engine generator. This keeps the random choices of each 
+         event reproducible regardless of the order in which the mixer renders events.
+         The mixer is done with the event, so the state can be written here.
+         */
+        eventToPlay->randomState = kwlRandom_seed(kwlRandom_next(&engine->randomState));
+        
         /*mark the event as playing and send a start message to the mixer.*/
         eventToPlay->isPlaying = 1;
+        eventToPlay->startOrder = engine->numEventStarts++;
+        kwlEventDefinition_updateInstancePool(eventToPlay->definition_engine, eventToPlay);
         kwlEngine_addEventToPlayingList(engine, eventToPlay);
-        int result = kwlMessageQueue_addMessageWithParam(&engine->toMixerQueue, 
+        int result = kwlMessageQueue_addScheduledMessage(&engine->toMixerQueue, 
                                                          KWL_EVENT_START, 
                                                          eventToPlay, 
-                                                         fadeInTimeSec);
+                                                         fadeInTimeSec,
+                                                         startFrame);
         
         if (result == 0)
         {
@@ -1308,11 +1735,14 @@ kwlError kwlEngine_startEventInstance(kwlEngine* engine,
         
         /*mark the event as playing and send a retrigger message to the mixer.*/
         eventToPlay->isPlaying = 1;
+        eventToPlay->startOrder = engine->numEventStarts++;
+        kwlEventDefinition_updateInstancePool(eventToPlay->definition_engine, eventToPlay);
         //kwlEngine_addEventToPlayingList(engine, eventToPlay);
-        int result = kwlMessageQueue_addMessageWithParam(&engine->toMixerQueue, 
+        int result = kwlMessageQueue_addScheduledMessage(&engine->toMixerQueue, 
                                                          KWL_EVENT_RETRIGGER, 
                                                          eventToPlay, 
-                                                         fadeInTimeSec);
+                                                         fadeInTimeSec,
+                                                         startFrame);
         
         if (result == 0)
         {
@@ -1323,7 +1753,7 @@ kwlError kwlEngine_startEventInstance(kwlEngine* engine,
     return KWL_NO_ERROR;
 }
 
-kwlError kwlEngine_eventStart(kwlEngine* engine, const int handle, float fadeInTimeSec)
+kwlError kwlEngine_eventStart(kwlEngine* engine, const int handle, float fadeInTimeSec, long long startFrame)
 {
     kwlEventInstance* eventToPlay = kwlEngine_getEventFromHandle(engine, handle);
     
@@ -1337,7 +1767,7 @@ kwlError kwlEngine_eventStart(kwlEngine* engine, const int handle, float fadeInT
         return KWL_INVALID_PARAMETER_VALUE;
     }
     
-    return kwlEngine_startEventInstance(engine, eventToPlay, fadeInTimeSec);
+    return kwlEngine_startEventInstance(engine, eventToPlay, fadeInTimeSec, startFrame);
     
 }
 
@@ -1370,83 +1800,27 @@ kwlError kwlEngine_eventStartOneShot(kwlEngine* engine,
         z = 0.0f;
     }
     
-    /* Look for a free event instance that is not currently playing.*/
-    int instanceCount = definition->instanceCount;
+    /* Pick an idle instance, or one to steal if there is none.*/
     kwlEventInstance* instanceToStart = NULL;
-    int numStealableInstances = 0;
-    int i;
-    for (i = 0; i < instanceCount; i++)
+    if (definition->numFreeInstances > 0)
     {
-        if (engine->engineData.events[handle][i].isAssociatedWithHandle == 0)
-        {
-            numStealableInstances++;
-            if (engine->engineData.events[handle][i].isPlaying == 0)
-            {
-                instanceToStart = &engine->engineData.events[handle][i];
-            }
-        }
+        instanceToStart = definition->freeInstances[definition->numFreeInstances - 1];
     }
-    
-    /*printf("instance to start: %d, n stealable=%d\n", 
-             instanceToStart, 
-             numStealableInstances);*/
-    
-    if (numStealableInstances == 0)
+    else if (definition->numStealableInstances == 0)
     {
         /*All instances of the event definition are currently associated with
           handles.*/
         return KWL_NO_FREE_EVENT_INSTANCES;
     }
-    
-    if (instanceToStart == NULL)
+    else
     {
-        /*No free instance was found, but there are instances to steal.*/
-        kwlEventInstanceStealingMode stealingMode = definition->stealingMode;
-        if (stealingMode == KWL_DONT_STEAL)
+        instanceToStart = kwlEventDefinition_pickInstanceToSteal(definition, &engine->randomState);
+        if (instanceToStart == NULL)
         {
             /*Fail silently if instance stealing is not allowed.*/
+            KWL_ASSERT(definition->stealingMode == KWL_DONT_STEAL);
             return KWL_NO_ERROR;
         }
-        else if (stealingMode == KWL_STEAL_RANDOM)
-        {
-            /*Steal a randomly selected instance.*/
-            int stealIndex = rand() % numStealableInstances;
-            int stealableIndex = 0;
-
-            for (i = 0; i < instanceCount; i++)
-            {
-                if (engine->engineData.events[handle][i].isAssociatedWithHandle == 0 &&
-                    engine->engineData.events[handle][i].isPlaying == 1)
-                {
-                    if (stealableIndex == stealIndex)
-                    {
-                        instanceToStart = &engine->engineData.events[handle][i];
-                        break;
-                    }
-                    stealableIndex++;
-                }
-            }
-        }
-        else if (stealingMode == KWL_STEAL_QUIETEST)
-        {
-            /*Find the instance with the lowest gain and steal it.*/
-            float minGain = -1;
-
-            for (i = 0; i < instanceCount; i++)
-            {
-                if (engine->engineData.events[handle][i].isAssociatedWithHandle == 0 &&
-                    engine->engineData.events[handle][i].isPlaying == 1)
-                {
-                    /*Compare against the average channel gain of the instance.*/
-                    float gain = engine->engineData.events[handle][i].gainLeft.valueEngine +
-                                 engine->engineData.events[handle][i].gainRight.valueEngine;
-                    if (minGain < 0 || gain < minGain)
-                    {
-                        instanceToStart = &engine->engineData.events[handle][i];
-                    }
-                }
-            }
-        }
         
         //since this instance is about to be stolen and thus stopped,
         //fire the stopped callback
@@ -1459,9 +1833,7 @@ kwlError kwlEngine_eventStartOneShot(kwlEngine* engine,
     KWL_ASSERT(instanceToStart != NULL && "no one-shot instance found");
     if (startAtPosition)
     {
-        instanceToStart->positionX = x;
-        instanceToStart->positionY = y;
-        instanceToStart->positionZ = z;
+        kwlEngine_setEventPosition(engine, instanceToStart, x, y, z);
         
         instanceToStart->velocityX = 0.0f;
         instanceToStart->velocityY = 0.0f;
@@ -1471,7 +1843,7 @@ kwlError kwlEngine_eventStartOneShot(kwlEngine* engine,
     instanceToStart->stoppedCallback = stoppedCallback;
     instanceToStart->stoppedCallbackUserData = stoppedCallbackUserData;
     
-    return kwlEngine_startEventInstance(engine, instanceToStart, 0.0f);
+    return kwlEngine_startEventInstance(engine, instanceToStart, 0.0f, KWL_UNSCHEDULED);
 }
 
 kwlError kwlEngine_eventSetStoppedCallback(kwlEngine* engine, const int handle, 
@@ -1496,7 +1868,7 @@ kwlError kwlEngine_eventSetStoppedCallback(kwlEngine* engine, const int handle,
 }
 
 /** */
-kwlError kwlEngine_eventStop(kwlEngine* engine, const int handle, float fadeOutTimeSec)
+kwlError kwlEngine_eventStop(kwlEngine* engine, const int handle, float fadeOutTimeSec, long long stopFrame)
 {
     kwlEventInstance* eventToStop = kwlEngine_getEventFromHandle(engine, handle);
     if (eventToStop == NULL)
@@ -1509,7 +1881,8 @@ kwlError kwlEngine_eventStop(kwlEngine* engine, const int handle, float fadeOutT
         return KWL_INVALID_PARAMETER_VALUE;
     }
     
-    int result = kwlMessageQueue_addMessageWithParam(&engine->toMixerQueue, KWL_EVENT_STOP, eventToStop, fadeOutTimeSec);
+    int result = kwlMessageQueue_addScheduledMessage(&engine->toMixerQueue, KWL_EVENT_STOP, 
+                                                     eventToStop, fadeOutTimeSec, stopFrame);
     if (result == 0)
     {
         return KWL_MESSAGE_QUEUE_FULL;
@@ -1599,9 +1972,7 @@ kwlError kwlEngine_eventSetPosition(kwlEngine* engine, kwlEventHandle handle, fl
         return KWL_EVENT_IS_NOT_POSITIONAL;
     }
     
-    event->positionX = posX;
-    event->positionY = posY;
-    event->positionZ = posZ;
+    kwlEngine_setEventPosition(engine, event, posX, posY, posZ);
     
     return KWL_NO_ERROR;
 }
@@ -1624,11 +1995,11 @@ kwlError kwlEngine_eventSetOrientation(kwlEngine* engine, kwlEventHandle handle,
         return KWL_INVALID_PARAMETER_VALUE;
     }
     
-    float length = kwlFastInverseSqrt(directionX * directionX + directionY * directionY + directionZ * directionZ);
+    float invLength = kwlFastInverseSqrt(directionX * directionX + directionY * directionY + directionZ * directionZ);
     
-    event->directionX = directionX / length;
-    event->directionY = directionY / length;
-    event->directionZ = directionZ / length;
+    event->directionX = directionX * invLength;
+    event->directionY = directionY * invLength;
+    event->directionZ = directionZ * invLength;
     
     return KWL_NO_ERROR;
 }
@@ -1694,6 +2065,195 @@ kwlError kwlEngine_eventSetGain(kwlEngine* engine, kwlEventHandle eventHandle, f
     return KWL_NO_ERROR;
 }
 
+kwlError kwlEngine_eventUpdateBatch(kwlEngine* engine, const kwlEventUpdate* updates, int numUpdates, int* numApplied)
+{
+    const unsigned int positionalFields = KWL_UPDATE_POSITION | KWL_UPDATE_VELOCITY | KWL_UPDATE_ORIENTATION;
+    kwlError firstError = KWL_NO_ERROR;
+    int applied = 0;
+    
+    *numApplied = 0;
+    if (updates == NULL && numUpdates > 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    for (int i = 0; i < numUpdates; i++)
+    {
+        const kwlEventUpdate* update = &updates[i];
+        const unsigned int fields = update->fields;
+        kwlError result = KWL_NO_ERROR;
+        float invLength = 0.0f;
+        
+        /*Validate the whole record before touching the event, so that a
+          failing record leaves its event unchanged.*/
+        kwlEventInstance* event = kwlEngine_getEventFromHandle(engine, update->handle);
+        if (event == NULL)
+        {
+            result = KWL_INVALID_EVENT_INSTANCE_HANDLE;
+        }
+        else if ((fields & positionalFields) != 0 && event->definition_engine->isPositional == 0)
+        {
+            result = KWL_EVENT_IS_NOT_POSITIONAL;
+        }
+        else if ((fields & KWL_UPDATE_GAIN) != 0 && (fields & KWL_UPDATE_LINEAR_GAIN) != 0)
+        {
+            result = KWL_INVALID_PARAMETER_VALUE;
+        }
+        else if ((fields & (KWL_UPDATE_GAIN | KWL_UPDATE_LINEAR_GAIN)) != 0 && update->gain < 0.0f)
+        {
+            result = KWL_INVALID_PARAMETER_VALUE;
+        }
+        else if ((fields & KWL_UPDATE_PITCH) != 0 && update->pitch < 0.0f)
+        {
+            result = KWL_INVALID_PARAMETER_VALUE;
+        }
+        else if ((fields & KWL_UPDATE_ORIENTATION) != 0)
+        {
+            const float* d = update->orientation;
+            const float lengthSquared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            if (lengthSquared == 0.0f)
+            {
+                result = KWL_INVALID_PARAMETER_VALUE;
+            }
+            else
+            {
+                invLength = kwlFastInverseSqrt(lengthSquared);
+            }
+        }
+        
+        if (result != KWL_NO_ERROR)
+        {
+            if (firstError == KWL_NO_ERROR)
+            {
+                firstError = result;
+            }
+            continue;
+        }
+        
+        if ((fields & KWL_UPDATE_POSITION) != 0)
+        {
+            kwlEngine_setEventPosition(engine, event, 
+                                       update->position[0], update->position[1], update->position[2]);
+        }
+        if ((fields & KWL_UPDATE_VELOCITY) != 0)
+        {
+            event->velocityX = update->velocity[0];
+            event->velocityY = update->velocity[1];
+            event->velocityZ = update->velocity[2];
+        }
+        if ((fields & KWL_UPDATE_ORIENTATION) != 0)
+        {
+            event->directionX = update->orientation[0] * invLength;
+            event->directionY = update->orientation[1] * invLength;
+            event->directionZ = update->orientation[2] * invLength;
+        }
+        if ((fields & KWL_UPDATE_GAIN) != 0)
+        {
+            event->userGain = logGainToLinGain(update->gain);
+        }
+        else if ((fields & KWL_UPDATE_LINEAR_GAIN) != 0)
+        {
+            event->userGain = update->gain;
+        }
+        if ((fields & KWL_UPDATE_PITCH) != 0)
+        {
+            event->userPitch = update->pitch;
+        }
+        applied++;
+    }
+    
+    *numApplied = applied;
+    return firstError;
+}
+
+kwlError kwlEngine_eventSetPositions(kwlEngine* engine, const kwlEventHandle* handles,
+                                     const float* x, const float* y, const float* z,
+                                     int numEvents, int* numApplied)
+{
+    kwlError firstError = KWL_NO_ERROR;
+    int applied = 0;
+    
+    *numApplied = 0;
+    if ((handles == NULL || x == NULL || y == NULL || z == NULL) && numEvents > 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    for (int i = 0; i < numEvents; i++)
+    {
+        kwlEventInstance* event = kwlEngine_getEventFromHandle(engine, handles[i]);
+        kwlError result = KWL_NO_ERROR;
+        if (event == NULL)
+        {
+            result = KWL_INVALID_EVENT_INSTANCE_HANDLE;
+        }
+        else if (event->definition_engine->isPositional == 0)
+        {
+            result = KWL_EVENT_IS_NOT_POSITIONAL;
+        }
+        
+        if (result != KWL_NO_ERROR)
+        {
+            if (firstError == KWL_NO_ERROR)
+            {
+                firstError = result;
+            }
+            continue;
+        }
+        
+        kwlEngine_setEventPosition(engine, event, x[i], y[i], z[i]);
+        applied++;
+    }
+    
+    *numApplied = applied;
+    return firstError;
+}
+
+kwlError kwlEngine_eventSetEnvelope(kwlEngine* engine, kwlEventHandle handle, 
+                                    kwlAutomatedParameter parameter,
+                                    const float* times, const float* values, int numBreakpoints, 
+                                    int startsAtCurrentValue, kwlAutomationCurve curve,
+                                    long long startFrame)
+{
+    kwlEventInstance* event = kwlEngine_getEventFromHandle(engine, handle);
+    if (event == NULL)
+    {
+        return KWL_INVALID_EVENT_INSTANCE_HANDLE;
+    }
+    
+    kwlAutomation* automation = NULL;
+    if (parameter == KWL_PARAMETER_GAIN)
+    {
+        automation = &event->gainAutomation;
+    }
+    else if (parameter == KWL_PARAMETER_PITCH)
+    {
+        automation = &event->pitchAutomation;
+    }
+    else if (parameter == KWL_PARAMETER_BALANCE)
+    {
+        if (event->definition_engine->isPositional != 0)
+        {
+            return KWL_EVENT_IS_NOT_NONPOSITIONAL;
+        }
+        automation = &event->balanceAutomation;
+    }
+    else
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    kwlError result = kwlEngine_validateEnvelope(parameter, times, values, numBreakpoints, curve);
+    if (result != KWL_NO_ERROR)
+    {
+        return result;
+    }
+    
+    kwlAutomation_setEnvelope(automation, times, values, numBreakpoints, startsAtCurrentValue, curve, startFrame);
+    
+    return KWL_NO_ERROR;
+}
+
 kwlError kwlEngine_attachDSPUnitToEvent(kwlEngine* engine, kwlEventHandle eventHandle, kwlDSPUnit* dspUnit)
 {
     kwlEventInstance* event = kwlEngine_getEventFromHandle(engine, eventHandle);
@@ -1732,120 +2292,61 @@ kwlError kwlEngine_attachDSPUnitToOutput(kwlEngine* engine, kwlDSPUnit* dspUnit)
     return KWL_NO_ERROR;
 }
 
-
-void debugPrintEventList(kwlEventInstance* event)
-{
-    kwlEventInstance* temp = event;
-    while (temp != NULL)
-    {
-        printf("    %s\n", temp->definition_engine->id);
-        temp  = temp->nextEvent_engine;
-    }
-}
-
 /** */
 void kwlEngine_addEventToPlayingList(kwlEngine* engine, kwlEventInstance* eventToAdd)
 {
-    printf("about to add %s to list:\n", eventToAdd->definition_engine->id);
-    //debugPrintEventList(engine->playingEventList);
+    KWL_LOG_DEBUG("adding %s to the playing list", eventToAdd->definition_engine->id);
     
-    /*verify that the event is not already in the list*/
-    /*kwlEventInstance* temp = engine->playingEventList;
-    if (temp != NULL)
-    {
-        while (temp != NULL)
-        {
-            KWL_ASSERT(temp != eventToAdd && "event is already in the 'playing' list");
-            temp = temp->nextEvent_engine;
-        }
-    }*/
-    
-    /*add the event to the linked list of playing events*/
+    /*append the event to the doubly linked list of playing events*/
     KWL_ASSERT(eventToAdd->nextEvent_mixer == NULL);
-    if (engine->playingEventList == NULL)        
+    KWL_ASSERT(eventToAdd->prevEvent_engine == NULL && eventToAdd != engine->playingEventList &&
+               "event is already in the 'playing' list");
+    eventToAdd->prevEvent_engine = engine->playingEventListTail;
+    eventToAdd->nextEvent_engine = NULL;
+    if (engine->playingEventListTail == NULL)        
     {
         engine->playingEventList = eventToAdd;
     }
     else
     {
-        kwlEventInstance* e = engine->playingEventList;
-        while (e->nextEvent_engine != NULL)
-        {
-            e = e->nextEvent_engine;
-        }
-        e->nextEvent_engine = eventToAdd;
+        engine->playingEventListTail->nextEvent_engine = eventToAdd;
     }
+    engine->playingEventListTail = eventToAdd;
     
-    eventToAdd->nextEvent_engine = NULL;
-    
-    //printf("added %s to list:\n", eventToAdd->definition_engine->id);
-    //debugPrintEventList(engine->playingEventList);
+    if (engine->spatialGrid.buckets != NULL && eventToAdd->definition_engine->isPositional)
+    {
+        kwlSpatialGrid_insert(&engine->spatialGrid, eventToAdd);
+    }
 }
 
 /** */
 void kwlEngine_removeEventFromPlayingList(kwlEngine* engine, kwlEventInstance* event)
 {
-    kwlEventInstance* prevEvent = NULL;
-    kwlEventInstance* eventi = engine->playingEventList;
-    
-    while (eventi != event)
-    {
-        prevEvent = eventi;
-        eventi = eventi->nextEvent_engine;
-    }
+    KWL_ASSERT((event->prevEvent_engine != NULL || event == engine->playingEventList) &&
+               "event to be removed is not in the 'playing' list");
     
-    if (prevEvent == NULL)
+    if (event->prevEvent_engine == NULL)
     {
-        engine->playingEventList = eventi->nextEvent_engine;
+        engine->playingEventList = event->nextEvent_engine;
     }
     else
     {
-        prevEvent->nextEvent_engine = eventi->nextEvent_engine;
+        event->prevEvent_engine->nextEvent_engine = event->nextEvent_engine;
     }
     
-    event->nextEvent_engine = NULL;
-    
-    //printf("about to remove %s from list:\n", event->definition_engine->id);
-    /*
-    debugPrintEventList(engine->playingEventList);
-    
-    //verify that the event is already in the list
-    kwlEventInstance* temp = engine->playingEventList;
-    KWL_ASSERT(temp != NULL && "trying to remove event from empty list");
-    
-    int foundMatch = 0;
-    if (temp != NULL)
+    if (event->nextEvent_engine == NULL)
     {
-        while (temp != NULL)
-        {
-            if (temp == eventToRemove)
-            {
-                foundMatch = 1;
-                break;
-            }
-            temp = temp->nextEvent_engine;
-        }
+        engine->playingEventListTail = event->prevEvent_engine;
     }
-    KWL_ASSERT(foundMatch && "event to be removed is not in the 'playing' list");
-    
-    //remove the event from the linked list of playing events.
-    kwlEventInstance* event = engine->playingEventList;
-    if (event == eventToRemove)
-    {
-        engine->playingEventList = event->nextEvent_engine;
-    }
-    else 
+    else
     {
-        while (event->nextEvent_engine != eventToRemove)
-        {
-            event = event->nextEvent_engine;
-        }
-        KWL_ASSERT(event->nextEvent_engine == eventToRemove);
-        event->nextEvent_engine = eventToRemove->nextEvent_engine;
+        event->nextEvent_engine->prevEvent_engine = event->prevEvent_engine;
     }
     
-    printf("removed %s from list:\n", eventToRemove->definition_engine->id);
-    debugPrintEventList(engine->playingEventList);*/
+    event->nextEvent_engine = NULL;
+    event->prevEvent_engine = NULL;
+    
+    kwlSpatialGrid_remove(&engine->spatialGrid, event);
 }
 
 /*****************************************************************************
@@ -1878,6 +2379,36 @@ kwlError kwlEngine_initialize(kwlEngine* engine,
     return result;
 }
 
+kwlError kwlEngine_setRenderQuantum(kwlEngine* engine, int quantumSize, int numQuantaAhead)
+{
+    if (quantumSize < 0 || quantumSize > KWL_TEMP_BUFFER_SIZE_IN_FRAMES ||
+        numQuantaAhead < 0 || numQuantaAhead > KWL_MAX_RENDER_AHEAD_QUANTA)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    kwlMixer_setRenderQuantum(engine->mixer, quantumSize, numQuantaAhead);
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_setAudioMemoryBudget(kwlEngine* engine, int numBytes)
+{
+    if (numBytes < 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    /*Any eviction happens on the next update.*/
+    engine->residencyManager.budget = numBytes;
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_getAudioMemoryUsage(kwlEngine* engine, int* numBytes)
+{
+    *numBytes = engine->audioDataStore->numResidentBytes;
+    return KWL_NO_ERROR;
+}
+
 kwlError kwlEngine_isLoaded(kwlEngine* engine, int* ret)
 {
     *ret = engine->engineData.isLoaded;
@@ -1939,7 +2470,7 @@ kwlError kwlEngine_unloadEngineDataBlocking(kwlEngine* engine)
     while (engine->engineData.isLoaded != 0)
     {
         /*printf("waiting for mixer to stop data driven events and clear mix buses\n");*/
-        kwlUpdate(0);
+        kwlEngine_update(engine, 0);
     }
     
     return KWL_NO_ERROR;
@@ -1949,9 +2480,77 @@ kwlError kwlEngine_unloadEngineDataBlocking(kwlEngine* engine)
 void kwlEngine_deinitialize(kwlEngine* engine)
 {
     /* Unload any engine data and wave banks*/
-    kwlEngineDataUnload();
+    kwlEngine_unloadEngineDataBlocking(engine);
     /* Shut down the sound system.*/
     kwlEngine_hostSpecificDeinitialize(engine);
+    /* Flush any remaining log messages.*/
+    kwlLog_drain();
+}
+
+kwlError kwlEngine_getSampleClock(kwlEngine* engine, long long* frame)
+{
+    *frame = engine->mixer->numFramesMixed.valueEngine;
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_render(kwlEngine* engine, float* buffer, int numFrames)
+{
+    if (buffer == NULL || numFrames < 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    kwlMixer_renderInterleaved(engine->mixer, buffer, numFrames);
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_renderPlanar(kwlEngine* engine, float** buffers, int numFrames)
+{
+    if (buffers == NULL || numFrames < 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    for (int i = 0; i < engine->mixer->numOutChannels; i++)
+    {
+        if (buffers[i] == NULL)
+        {
+            return KWL_INVALID_PARAMETER_VALUE;
+        }
+    }
+    
+    kwlMixer_renderPlanar(engine->mixer, buffers, numFrames);
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_processInput(kwlEngine* engine, const float* buffer, int numFrames)
+{
+    if (buffer == NULL || numFrames < 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    kwlMixer_processInputBuffer(engine->mixer, buffer, numFrames);
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEngine_processInputPlanar(kwlEngine* engine, const float* const* buffers, int numFrames)
+{
+    if (buffers == NULL || numFrames < 0)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    for (int i = 0; i < engine->mixer->numInChannels; i++)
+    {
+        if (buffers[i] == NULL)
+        {
+            return KWL_INVALID_PARAMETER_VALUE;
+        }
+    }
+    
+    kwlMixer_processInputPlanar(engine->mixer, buffers, numFrames);
+    return KWL_NO_ERROR;
 }
 
 kwlError kwlEngine_getNumFramesMixed(kwlEngine* engine, unsigned int* numFrames)
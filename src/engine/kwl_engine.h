@@ -27,7 +27,9 @@ freely, subject to the following restrictions:
 
 #include "kowalski.h"
 #include "kwl_audiodata.h"
+#include "kwl_audiodatastore.h"
 #include "kwl_enginedata.h"
+#include "kwl_handletable.h"
 #include "kwl_dspunit.h"
 #include "kwl_eventinstance.h"
 #include "kwl_inputstream.h"
@@ -35,8 +37,10 @@ freely, subject to the following restrictions:
 #include "kwl_mixpreset.h"
 #include "kwl_positionalaudiolistener.h"
 #include "kwl_positionalaudiosettings.h"
+#include "kwl_residencymanager.h"
 #include "kwl_mixer.h"
 #include "kwl_sound.h"
+#include "kwl_spatialgrid.h"
 #include "kwl_wavebank.h"
 
 #ifdef __cplusplus
@@ -71,10 +75,29 @@ typedef struct kwlEngine
     /** A struct containing information about the current 3D audio listener. */
     kwlPositionalAudioListener listener;
     
-    /** The current size of the array of freeform events, i.e events created in code.*/
-    int freeformEventArraySize;
-    /** An array of freeform events, i.e events created in code. This array is dynamically resized and may contain null entries. */
-    struct kwlEventInstance** freeformEvents;
+    /** 
+     * Maps event handles to the data driven and freeform event instances associated with them.
+     * Handles are removed when released, so stale handles are detected.
+     */
+    kwlHandleTable eventHandles;
+    
+    /** Incremented every time an event is started. Orders instances for \c KWL_STEAL_OLDEST.*/
+    unsigned int numEventStarts;
+    /** 
+     * The state of the random number generator used for \c KWL_STEAL_RANDOM and for
+     * seeding the generators of event instances when they start. Accessed only from the engine thread.
+     */
+    unsigned int randomState;
+    
+    /** Events with a linear gain below this are rendered at \c KWL_VOICE_LOD_MONO. 0 disables the tier.*/
+    float voiceLODMonoThreshold;
+    /** Events with a linear gain below this are rendered at \c KWL_VOICE_LOD_HALF_RATE. 0 disables the tier.*/
+    float voiceLODHalfRateThreshold;
+    
+    /** Indexes playing positional events by position. Disabled if its buckets are NULL.*/
+    kwlSpatialGrid spatialGrid;
+    /** Incremented before every spatial index query, marking the events found in range.*/
+    unsigned int spatialQueryStamp;
     
     int isInputEnabled;
     
@@ -85,19 +108,42 @@ typedef struct kwlEngine
     struct kwlDecoder* decoders;
     
     /** 
-     * A linked list of currently playing events, ie events for which a 'start event' message has been sent and
+     * A doubly linked list of currently playing events, ie events for which a 'start event' message has been sent and
      * an 'event stopped' message has not yet been received. 
      */
     struct kwlEventInstance* playingEventList;
+    /** The last event in \c playingEventList, letting events be appended in constant time.*/
+    struct kwlEventInstance* playingEventListTail;
     
     /** A collection of positional audio parameters.*/
     kwlPositionalAudioSettings positionalAudioSettings;
     
     /** The currently loaded engine data.*/
     kwlEngineData engineData;
+    
+    /** 
+     * Reference counted audio data payloads shared by all loaded wave banks. The store is
+     * process wide, so identical audio data is shared between engine contexts too.
+     */
+    kwlAudioDataStore* audioDataStore;
+    
+    /** Keeps the resident audio data within the audio memory budget.*/
+    kwlResidencyManager residencyManager;
+    
+    /** 
+     * An arena for temporary allocations made on the engine thread. Reset at the start 
+     * of every call to \c kwlEngine_update, so allocations must not outlive the update.
+     */
+    kwlArena scratchArena;
+    
+    /** Host specific per engine state, e.g an audio stream. NULL for hosts without such state.*/
+    void* hostData;
 
 } kwlEngine; 
     
+/** The block size of the engine scratch arena.*/
+#define KWL_ENGINE_SCRATCH_ARENA_BLOCK_SIZE 8192
+    
 /** Initializes a newly allocated sound engine instance. */
 void kwlEngine_init(kwlEngine* engine);
     
@@ -123,6 +169,13 @@ kwlError kwlEngine_eventCreateWithBuffer(kwlEngine* engine, kwlPCMBuffer* buffer
 kwlError kwlEngine_eventCreateWithFile(kwlEngine* engine, const char* const audioFilePath, 
                                             kwlEventHandle* handle, kwlEventType type, int streamFromDisk);
     
+/** */
+kwlError kwlEngine_eventCreatePushStream(kwlEngine* engine, int numChannels, int capacity, int latency,
+                                         kwlEventHandle* handle, kwlEventType type);
+    
+/** */
+kwlError kwlEngine_eventGetPushStream(kwlEngine* engine, kwlEventHandle handle, struct kwlPushStream** stream);
+    
 /** */
 kwlError kwlEngine_eventRelease(kwlEngine* engine, kwlEventHandle handle);
 
@@ -130,13 +183,13 @@ kwlError kwlEngine_eventRelease(kwlEngine* engine, kwlEventHandle handle);
 kwlError kwlEngine_unloadFreeformEvent(kwlEngine* engine, struct kwlEventInstance* event);
 
 /** */
-kwlError kwlEngine_eventStart(kwlEngine* engine, const int handle, float fadeInTimeSec);
+kwlError kwlEngine_eventStart(kwlEngine* engine, const int handle, float fadeInTimeSec, long long startFrame);
     
 /** */
-kwlError kwlEngine_startEventInstance(kwlEngine* engine, struct kwlEventInstance* event, float fadeInTimeSec);
+kwlError kwlEngine_startEventInstance(kwlEngine* engine, struct kwlEventInstance* event, float fadeInTimeSec, long long startFrame);
     
 /** */
-kwlError kwlEngine_eventStop(kwlEngine* engine, const int handle, float fadeOutTimeSec);
+kwlError kwlEngine_eventStop(kwlEngine* engine, const int handle, float fadeOutTimeSec, long long stopFrame);
 
 /** */
 kwlError kwlEngine_eventStartOneShot(kwlEngine* engine, 
@@ -176,6 +229,28 @@ kwlError kwlEngine_eventSetBalance(kwlEngine* engine, kwlEventHandle handle, flo
     
 /** */
 kwlError kwlEngine_eventSetGain(kwlEngine* engine, kwlEventHandle eventHandle, float gain, int isLinearGain);
+
+/** 
+ * Applies an array of update records, skipping records that fail validation. 
+ * Returns the error of the first failing record and stores the number of
+ * applied records in \c numApplied.
+ */
+kwlError kwlEngine_eventUpdateBatch(kwlEngine* engine, const kwlEventUpdate* updates, int numUpdates, int* numApplied);
+
+/** Sets the positions of a number of events from SoA component arrays. @see kwlEngine_eventUpdateBatch */
+kwlError kwlEngine_eventSetPositions(kwlEngine* engine, const kwlEventHandle* handles,
+                                     const float* x, const float* y, const float* z,
+                                     int numEvents, int* numApplied);
+    
+/** 
+ * Submits an automation envelope for a parameter of an event. If \c startsAtCurrentValue 
+ * is non-zero, the envelope starts at the current value of the parameter.
+ */
+kwlError kwlEngine_eventSetEnvelope(kwlEngine* engine, kwlEventHandle handle, 
+                                    kwlAutomatedParameter parameter,
+                                    const float* times, const float* values, int numBreakpoints, 
+                                    int startsAtCurrentValue, kwlAutomationCurve curve,
+                                    long long startFrame);
     
 /** Adds a given event to the linked list of currently playing events. */
 void kwlEngine_addEventToPlayingList(kwlEngine* engine, struct kwlEventInstance* eventToAdd);
@@ -186,11 +261,8 @@ void kwlEngine_removeEventFromPlayingList(kwlEngine* engine, struct kwlEventInst
 /** Returns the event corresponding to a given handle or NULL if the handle is invalid.*/
 struct kwlEventInstance* kwlEngine_getEventFromHandle(kwlEngine* engine, kwlEventHandle handle);
     
-/** Returns non-zero if the given handle corresponds to a freeform event, zero otherwise.*/
-int kwlEngine_isFreeformEventHandle(kwlEngine* engine, kwlEventHandle handle);   
-
-/** */
-int kwlEngine_getFreeformIndexFromHandle(kwlEngine* engine, kwlEventHandle handle);
+/** Returns non-zero if the given event is a freeform event, zero if it is data driven.*/
+int kwlEngine_isFreeformEvent(kwlEngine* engine, struct kwlEventInstance* event);
     
 /** */
 void kwlEngine_updateEvents(kwlEngine* engine);
@@ -220,6 +292,19 @@ kwlError kwlEngine_mixBusSetGain(kwlEngine* engine, kwlMixBusHandle handle, floa
 /** */
 kwlError kwlEngine_mixBusSetPitch(kwlEngine* engine, kwlMixBusHandle handle, float pitch);
 
+/** 
+ * Sets the internal sample rate of a mix bus, or makes it run at the rate of its parent
+ * if \c sampleRate is 0. @see kwlMixBusSetSampleRate 
+ */
+kwlError kwlEngine_mixBusSetSampleRate(kwlEngine* engine, kwlMixBusHandle handle, int sampleRate);
+
+/** Submits an automation envelope for a parameter of a mix bus. @see kwlEngine_eventSetEnvelope */
+kwlError kwlEngine_mixBusSetEnvelope(kwlEngine* engine, kwlMixBusHandle handle, 
+                                     kwlAutomatedParameter parameter,
+                                     const float* times, const float* values, int numBreakpoints, 
+                                     int startsAtCurrentValue, kwlAutomationCurve curve,
+                                     long long startFrame);
+
 /** */
 kwlError kwlEngine_mixPresetGetHandle(kwlEngine* engine, const char* const busId, kwlMixBusHandle* handle);
     
@@ -255,6 +340,19 @@ kwlError kwlEngine_setDopplerShiftParameters(kwlEngine* engine, float speedOfSou
 
 /** */
 kwlError kwlEngine_setConeAttenuationEnabled(kwlEngine* engine, int listenerCone, int eventCones);
+
+/** Sets the gains below which events are moved to cheaper rendering tiers. @see kwlVoiceLODTier */
+kwlError kwlEngine_setVoiceLODThresholds(kwlEngine* engine, float monoThreshold, float halfRateThreshold);
+
+/** 
+ * Enables the spatial index of playing positional events with the given cell size, 
+ * or disables it if \c cellSize is 0. While enabled, events beyond the maximum 
+ * distance of the listener are culled without computing their positional parameters.
+ */
+kwlError kwlEngine_setSpatialIndexCellSize(kwlEngine* engine, float cellSize);
+
+/** Reseeds the random number generator of the engine. @see kwl_random.h */
+kwlError kwlEngine_setRandomSeed(kwlEngine* engine, unsigned int seed);
     
 /** */
 kwlError kwlEngine_setListenerConeParameters(kwlEngine* engine, 
@@ -278,6 +376,9 @@ kwlError kwlEngine_update(kwlEngine* engine, float timeStep);
     
 /** */
 kwlError kwlEngine_initialize(kwlEngine* engine, int sampleRate, int numOutChannels, int numInChannels, int bufferSize);
+
+/** Sets the low latency mode quantum size and render ahead. Must be called before \c kwlEngine_initialize.*/
+kwlError kwlEngine_setRenderQuantum(kwlEngine* engine, int quantumSize, int numQuantaAhead);
     
 /** */
 kwlError kwlEngine_isLoaded(kwlEngine* engine, int* ret);
@@ -321,6 +422,27 @@ kwlWaveBankHandle kwlEngine_getHandleFromWaveBank(kwlEngine* engine, kwlWaveBank
 
 /** */
 kwlError kwlEngine_getNumFramesMixed(kwlEngine* engine, unsigned int* numFrames);
+
+/** Gets the number of frames mixed since the mixer started, as of the last engine update.*/
+kwlError kwlEngine_getSampleClock(kwlEngine* engine, long long* frame);
+
+/** Mixes \c numFrames interleaved output frames into a caller provided buffer.*/
+kwlError kwlEngine_render(kwlEngine* engine, float* buffer, int numFrames);
+
+/** Mixes \c numFrames output frames into one caller provided buffer per channel.*/
+kwlError kwlEngine_renderPlanar(kwlEngine* engine, float** buffers, int numFrames);
+
+/** Passes \c numFrames interleaved input frames to the input DSP unit, if any.*/
+kwlError kwlEngine_processInput(kwlEngine* engine, const float* buffer, int numFrames);
+
+/** Passes \c numFrames input frames, one buffer per channel, to the input DSP unit, if any.*/
+kwlError kwlEngine_processInputPlanar(kwlEngine* engine, const float* const* buffers, int numFrames);
+    
+/** Sets the number of bytes of non-streaming wave bank audio data to keep resident, or 0 for no limit.*/
+kwlError kwlEngine_setAudioMemoryBudget(kwlEngine* engine, int numBytes);
+
+/** Gets the number of bytes of resident wave bank audio data.*/
+kwlError kwlEngine_getAudioMemoryUsage(kwlEngine* engine, int* numBytes);
     
 /** */
 kwlError kwlEngine_getOutLevels(kwlEngine* engine, float* leftLevel, float* rightLevel);
@@ -47,17 +47,37 @@ kwlError kwlEngineData_load(kwlEngineData* data, kwlInputStream* stream)
         }
     }
     
+    kwlArena_init(&data->arena, KWL_ENGINE_DATA_ARENA_BLOCK_SIZE, "engine data arena");
+    
+    /*Read the table of contents, if any.*/
+    kwlError result = kwlEngineData_loadTableOfContents(data, stream);
+    if (result != KWL_NO_ERROR)
+    {
+        kwlArena_free(&data->arena);
+        return result;
+    }
+    
+    /*Version 2 binaries are read into memory in one go, so parse the chunks from there.*/
+    kwlInputStream imageStream;
+    kwlInputStream* chunkStream = stream;
+    if (data->binaryImage != NULL)
+    {
+        kwlInputStream_initWithBuffer(&imageStream, data->binaryImage, 0, data->binaryImageSize);
+        chunkStream = &imageStream;
+    }
+    
     /*Load chunks*/
     
-    kwlEngineData_loadMixBusData(data, stream);
-    kwlEngineData_loadMixPresetData(data, stream);
-    kwlEngineData_loadWaveBankData(data, stream);
+    kwlEngineData_loadMixBusData(data, chunkStream);
+    kwlEngineData_loadMixPresetData(data, chunkStream);
+    kwlEngineData_loadWaveBankData(data, chunkStream);
     
     /*must happen after wave bank loading*/
-    kwlEngineData_loadSoundData(data, stream);
+    kwlEngineData_loadSoundData(data, chunkStream);
     
     /*must happen after sound, wave bank and mix bus loading.*/
-    kwlEngineData_loadEventData(data, stream);
+    kwlEngineData_loadEventData(data, chunkStream);
+    kwlEngineData_loadEventStealingModes(data, chunkStream);
     
     data->isLoaded = 1;
     
@@ -79,13 +99,17 @@ void kwlEngineData_unload(kwlEngineData* data)
     kwlEngineData_freeMixPresetData(data);
     kwlEngineData_freeMixBusData(data);
     kwlEngineData_freeWaveBankData(data);
+    kwlEngineData_freeTableOfContents(data);
+    
+    /*Release all engine data memory in one go.*/
+    kwlArena_free(&data->arena);
     
     data->isLoaded = 0;
 }
 
 kwlError kwlEngineData_loadMixBusData(kwlEngineData* data, kwlInputStream* stream)
 {
-    kwlEngineData_seekToEngineDataChunk(stream, KWL_MIX_BUSES_CHUNK_ID);
+    kwlEngineData_seekToEngineDataChunk(data, stream, KWL_MIX_BUSES_CHUNK_ID);
     KWL_ASSERT(data->mixBuses == NULL);
     
     /*allocate memory for the mix bus data*/
@@ -93,8 +117,7 @@ kwlError kwlEngineData_loadMixBusData(kwlEngineData* data, kwlInputStream* strea
     KWL_ASSERT(numMixBuses > 0);
     data->numMixBuses = numMixBuses;
     data->mixBuses = 
-    (kwlMixBus*)KWL_MALLOC(numMixBuses * sizeof(kwlMixBus), 
-                           "kwlEngineData_loadMixBusData: mixer bus array");
+    (kwlMixBus*)kwlArena_alloc(&data->arena, numMixBuses * sizeof(kwlMixBus));
     kwlMemset(data->mixBuses, 0, numMixBuses * sizeof(kwlMixBus));
     
     /*read mix bus data*/
@@ -104,7 +127,7 @@ kwlError kwlEngineData_loadMixBusData(kwlEngineData* data, kwlInputStream* strea
         kwlMixBus* const mixBusi = &data->mixBuses[i];
         kwlMixBus_init(mixBusi);
         
-        mixBusi->id = kwlInputStream_readASCIIString(stream);
+        mixBusi->id = kwlEngineData_readString(data, stream);
         if (strcmp(mixBusi->id, "master") == 0)
         {
             KWL_ASSERT(data->masterBus == NULL && "multiple master buses found");
@@ -118,8 +141,7 @@ kwlError kwlEngineData_loadMixBusData(kwlEngineData* data, kwlInputStream* strea
         mixBusi->subBuses = NULL;
         if (numSubBuses > 0)
         {
-            mixBusi->subBuses = (kwlMixBus**)KWL_MALLOC(numSubBuses * sizeof(kwlMixBus*), 
-                                                        "kwlEngineData_loadMixBusData: sub buses");
+            mixBusi->subBuses = (kwlMixBus**)kwlArena_alloc(&data->arena, numSubBuses * sizeof(kwlMixBus*));
             int j;
             for (j = 0; j < numSubBuses; j++)
             {
@@ -132,40 +154,30 @@ kwlError kwlEngineData_loadMixBusData(kwlEngineData* data, kwlInputStream* strea
     
     KWL_ASSERT(data->masterBus != NULL);
     
-    return KWL_NO_ERROR;
-}
-
-void kwlEngineData_freeMixBusData(kwlEngineData* data)
-{
-    if (data->mixBuses == NULL)
-    {
-        return;
-    }
-    
-    /*free the mix bus IDs*/
-    const int numMixBuses = data->numMixBuses;
-    int i;
+    /*link sub buses to their parents. done once all buses are initialized.*/
     for (i = 0; i < numMixBuses; i++)
     {
-        if (data->mixBuses[i].subBuses != NULL)
+        int j;
+        for (j = 0; j < data->mixBuses[i].numSubBuses; j++)
         {
-            KWL_FREE(data->mixBuses[i].subBuses);
+            data->mixBuses[i].subBuses[j]->parent = &data->mixBuses[i];
         }
-        KWL_FREE(data->mixBuses[i].id);
     }
     
-    /*free the mix bus array*/
-    KWL_FREE(data->mixBuses);
+    return KWL_NO_ERROR;
+}
+
+void kwlEngineData_freeMixBusData(kwlEngineData* data)
+{
+    /*The mix buses, their IDs and sub bus arrays live in the engine data arena.*/
     data->mixBuses = NULL;
-    data->masterBus = NULL;
-    data->mixBuses = NULL;;
-    data->numMixBuses = 0;;
+    data->numMixBuses = 0;
     data->masterBus = NULL;
 }
 
 kwlError kwlEngineData_loadMixPresetData(kwlEngineData* data, kwlInputStream* stream)
 {
-    kwlEngineData_seekToEngineDataChunk(stream, KWL_MIX_PRESETS_CHUNK_ID);
+    kwlEngineData_seekToEngineDataChunk(data, stream, KWL_MIX_PRESETS_CHUNK_ID);
     KWL_ASSERT(data->mixBuses != 0); /*needed for mix bus lookup per param set*/
     
     /*allocate memory for the mix preset data*/
@@ -174,14 +186,13 @@ kwlError kwlEngineData_loadMixPresetData(kwlEngineData* data, kwlInputStream* st
     data->numMixPresets = numMixPresets;
     const int numParameterSets = data->numMixBuses;
     int defaultPresetIndex = -1;
-    data->mixPresets = (kwlMixPreset*)KWL_MALLOC(sizeof(kwlMixPreset) * numMixPresets,
-                                                              "kwlEngineData_loadMixPresetData");
+    data->mixPresets = (kwlMixPreset*)kwlArena_alloc(&data->arena, sizeof(kwlMixPreset) * numMixPresets);
     
     /*read data*/
     int i;
     for (i = 0; i < numMixPresets; i++)
     {
-        data->mixPresets[i].id = kwlInputStream_readASCIIString(stream);
+        data->mixPresets[i].id = kwlEngineData_readString(data, stream);
         const int isDefault = kwlInputStream_readIntBE(stream);
         if (isDefault != 0)
         {
@@ -198,8 +209,7 @@ kwlError kwlEngineData_loadMixPresetData(kwlEngineData* data, kwlInputStream* st
         
         data->mixPresets[i].numParameterSets = numParameterSets;
         data->mixPresets[i].parameterSets = 
-        (kwlMixBusParameters*)KWL_MALLOC(sizeof(kwlMixBusParameters) * numParameterSets, 
-                                         "kwlEngineData_loadMixPresetData");
+        (kwlMixBusParameters*)kwlArena_alloc(&data->arena, sizeof(kwlMixBusParameters) * numParameterSets);
         int j;
         for (j = 0; j < numParameterSets; j++)
         {
@@ -213,35 +223,92 @@ kwlError kwlEngineData_loadMixPresetData(kwlEngineData* data, kwlInputStream* st
     }
     KWL_ASSERT(defaultPresetIndex >= 0);
     
-    return KWL_NO_ERROR;
-}
-
-void kwlEngineData_freeMixPresetData(kwlEngineData* data)
-{
-    if (data->mixPresets == NULL)
+    /*Build a per mix bus table of the default parameters...*/
+    const int numMixBuses = data->numMixBuses;
+    data->mixPresetBaseParameters = 
+        (kwlMixBusParameters*)kwlArena_alloc(&data->arena, sizeof(kwlMixBusParameters) * numMixBuses);
+    data->mixPresetBlendedDifferences = 
+        (kwlMixBusParameters*)kwlArena_alloc(&data->arena, sizeof(kwlMixBusParameters) * numMixBuses);
+    kwlMemset(data->mixPresetBaseParameters, 0, sizeof(kwlMixBusParameters) * numMixBuses);
+    kwlMemset(data->mixPresetBlendedDifferences, 0, sizeof(kwlMixBusParameters) * numMixBuses);
+    for (i = 0; i < numMixBuses; i++)
     {
-        return;
+        data->mixPresetBaseParameters[i].mixBusIndex = i;
+        data->mixPresetBlendedDifferences[i].mixBusIndex = i;
     }
     
-    const int numMixPresets = data->numMixPresets;
+    const kwlMixPreset* defaultPreset = &data->mixPresets[defaultPresetIndex];
+    for (i = 0; i < defaultPreset->numParameterSets; i++)
+    {
+        const kwlMixBusParameters* params = &defaultPreset->parameterSets[i];
+        data->mixPresetBaseParameters[params->mixBusIndex] = *params;
+    }
     
-    /*free any memory allocated per mix preset*/
-    int i;
+    /*...and store each preset as its differences from it. Most presets only touch a few buses.*/
     for (i = 0; i < numMixPresets; i++)
     {
-        KWL_FREE(data->mixPresets[i].id);
-        KWL_FREE(data->mixPresets[i].parameterSets);
+        kwlMixPreset* preseti = &data->mixPresets[i];
+        int numDifferences = 0;
+        int j;
+        for (j = 0; j < preseti->numParameterSets; j++)
+        {
+            const kwlMixBusParameters* params = &preseti->parameterSets[j];
+            const kwlMixBusParameters* base = &data->mixPresetBaseParameters[params->mixBusIndex];
+            if (params->logGainLeft != base->logGainLeft || 
+                params->logGainRight != base->logGainRight ||
+                params->pitch != base->pitch)
+            {
+                numDifferences++;
+            }
+        }
+        
+        preseti->numSparseParameterSets = numDifferences;
+        preseti->sparseParameterSets = NULL;
+        preseti->blendedWeight = 0.0f;
+        if (numDifferences > 0)
+        {
+            preseti->sparseParameterSets = 
+                (kwlMixBusParameters*)kwlArena_alloc(&data->arena, sizeof(kwlMixBusParameters) * numDifferences);
+        }
+        
+        numDifferences = 0;
+        for (j = 0; j < preseti->numParameterSets; j++)
+        {
+            const kwlMixBusParameters* params = &preseti->parameterSets[j];
+            const kwlMixBusParameters* base = &data->mixPresetBaseParameters[params->mixBusIndex];
+            if (params->logGainLeft != base->logGainLeft || 
+                params->logGainRight != base->logGainRight ||
+                params->pitch != base->pitch)
+            {
+                kwlMixBusParameters* difference = &preseti->sparseParameterSets[numDifferences];
+                difference->mixBusIndex = params->mixBusIndex;
+                difference->logGainLeft = params->logGainLeft - base->logGainLeft;
+                difference->logGainRight = params->logGainRight - base->logGainRight;
+                difference->pitch = params->pitch - base->pitch;
+                numDifferences++;
+            }
+        }
     }
     
-    /*free the mix preset array*/
-    KWL_FREE(data->mixPresets);
+    data->mixPresetWeightSum = 0.0f;
+    data->mixPresetsNeedFullBlend = 1;
+    
+    return KWL_NO_ERROR;
+}
+
+void kwlEngineData_freeMixPresetData(kwlEngineData* data)
+{
+    /*The mix presets and their parameter sets live in the engine data arena.*/
     data->mixPresets = NULL;
     data->numMixPresets = 0;
+    data->mixPresetBaseParameters = NULL;
+    data->mixPresetBlendedDifferences = NULL;
+    data->mixPresetsNeedFullBlend = 0;
 }
 
 kwlError kwlEngineData_loadWaveBankData(kwlEngineData* data, kwlInputStream* stream)
 {
-    kwlEngineData_seekToEngineDataChunk(stream, KWL_WAVE_BANKS_CHUNK_ID);
+    kwlEngineData_seekToEngineDataChunk(data, stream, KWL_WAVE_BANKS_CHUNK_ID);
     
     /*deserialize wave bank structures*/
     const int totalnumAudioDataEntries = kwlInputStream_readIntBE(stream);
@@ -250,11 +317,11 @@ kwlError kwlEngineData_loadWaveBankData(kwlEngineData* data, kwlInputStream* str
     KWL_ASSERT(numWaveBanks > 0);
     
     data->totalNumAudioDataEntries = totalnumAudioDataEntries;
-    data->audioDataEntries = (kwlAudioData*)KWL_MALLOC(totalnumAudioDataEntries * sizeof(kwlAudioData), "kwlEngineData_loadWaveBankData");
+    data->audioDataEntries = (kwlAudioData*)kwlArena_alloc(&data->arena, totalnumAudioDataEntries * sizeof(kwlAudioData));
     kwlMemset(data->audioDataEntries, 0, totalnumAudioDataEntries * sizeof(kwlAudioData)); 
     
     data->numWaveBanks = numWaveBanks;
-    data->waveBanks = (kwlWaveBank*)KWL_MALLOC(numWaveBanks * sizeof(kwlWaveBank), "kwlEngineData_loadWaveBankData");
+    data->waveBanks = (kwlWaveBank*)kwlArena_alloc(&data->arena, numWaveBanks * sizeof(kwlWaveBank));
     kwlMemset(data->waveBanks, 0, numWaveBanks * sizeof(kwlWaveBank)); 
     
     int i;
@@ -262,7 +329,7 @@ kwlError kwlEngineData_loadWaveBankData(kwlEngineData* data, kwlInputStream* str
     for (i = 0; i < numWaveBanks; i++)
     {
         kwlWaveBank* waveBanki = &data->waveBanks[i];
-        waveBanki->id = kwlInputStream_readASCIIString(stream);
+        waveBanki->id = kwlEngineData_readString(data, stream);
         const int numAudioDataEntries = kwlInputStream_readIntBE(stream);
         KWL_ASSERT(numAudioDataEntries > 0);
         waveBanki->numAudioDataEntries = numAudioDataEntries;
@@ -270,10 +337,11 @@ kwlError kwlEngineData_loadWaveBankData(kwlEngineData* data, kwlInputStream* str
         int j;
         for (j = 0; j < numAudioDataEntries; j++)
         {
-            data->audioDataEntries[audioDataItemIdx].filePath = kwlInputStream_readASCIIString(stream);
+            data->audioDataEntries[audioDataItemIdx].filePath = kwlEngineData_readString(data, stream);
             data->audioDataEntries[audioDataItemIdx].waveBank = waveBanki;
             audioDataItemIdx++;
         }
+        kwlWaveBank_buildEntryLookupTable(waveBanki, &data->arena);
     }
     
     return KWL_NO_ERROR;
@@ -281,40 +349,23 @@ kwlError kwlEngineData_loadWaveBankData(kwlEngineData* data, kwlInputStream* str
 
 void kwlEngineData_freeWaveBankData(kwlEngineData* data)
 {
-    if (data->waveBanks != NULL)
-    {
-        const int numWaveBanks = data->numWaveBanks;
-        int i;
-        for (i = 0; i < numWaveBanks; i++)
-        {
-            KWL_FREE((void*)data->waveBanks[i].id);
-        }
-        KWL_FREE(data->waveBanks);
-        data->waveBanks = NULL;
-    }
-    
-    if (data->audioDataEntries != NULL)
-    {
-        const int numAudioDataEntries = data->totalNumAudioDataEntries;
-        int i;
-        for (i = 0; i < numAudioDataEntries; i++)
-        {
-            KWL_FREE((void*)data->audioDataEntries[i].filePath);
-        }
-        KWL_FREE(data->audioDataEntries);
-        data->audioDataEntries = NULL;
-    }
+    /*The wave bank and audio data structs, their IDs and entry 
+      lookup tables live in the engine data arena.*/
+    data->waveBanks = NULL;
+    data->numWaveBanks = 0;
+    data->audioDataEntries = NULL;
+    data->totalNumAudioDataEntries = 0;
 }
 
 kwlError kwlEngineData_loadSoundData(kwlEngineData* data, kwlInputStream* stream)
 {
-    kwlEngineData_seekToEngineDataChunk(stream, KWL_SOUNDS_CHUNK_ID);
+    kwlEngineData_seekToEngineDataChunk(data, stream, KWL_SOUNDS_CHUNK_ID);
     
     /*allocate memory for sound definitions*/
     const int numSoundDefinitions = kwlInputStream_readIntBE(stream);
     KWL_ASSERT(numSoundDefinitions >= 0 && "the number of sound definitions must be non-negative");
     data->numSoundDefinitions = numSoundDefinitions;
-    data->sounds = (kwlSound*)KWL_MALLOC(numSoundDefinitions * sizeof(kwlSound), "sound definitions");
+    data->sounds = (kwlSound*)kwlArena_alloc(&data->arena, numSoundDefinitions * sizeof(kwlSound));
     kwlMemset(data->sounds, 0, numSoundDefinitions * sizeof(kwlSound));
     
     /*read sound definitions*/
@@ -332,8 +383,7 @@ kwlError kwlEngineData_loadSoundData(kwlEngineData* data, kwlInputStream* stream
         
         const int numWaveReferences = kwlInputStream_readIntBE(stream);
         KWL_ASSERT(numWaveReferences > 0);
-        data->sounds[i].audioDataEntries = (kwlAudioData**)KWL_MALLOC(numWaveReferences * sizeof(kwlAudioData*), 
-                                                                                   "kwlEngineData_loadSoundData: wave list");
+        data->sounds[i].audioDataEntries = (kwlAudioData**)kwlArena_alloc(&data->arena, numWaveReferences * sizeof(kwlAudioData*));
         data->sounds[i].numAudioDataEntries = numWaveReferences;
         
         int j;
@@ -356,25 +406,14 @@ kwlError kwlEngineData_loadSoundData(kwlEngineData* data, kwlInputStream* stream
 
 void kwlEngineData_freeSoundData(kwlEngineData* data)
 {
-    if (data->sounds == NULL)
-    {
-        return;
-    }
-    
-    int i;
-    for (i = 0; i < data->numSoundDefinitions; i++)
-    {
-        KWL_FREE(data->sounds[i].audioDataEntries);
-    }
-    KWL_FREE(data->sounds);    
+    /*The sounds and their audio data arrays live in the engine data arena.*/
     data->sounds = NULL;
     data->numSoundDefinitions = 0;
-    
 }
 
 kwlError kwlEngineData_loadEventData(kwlEngineData* data, kwlInputStream* stream)
 {
-    kwlEngineData_seekToEngineDataChunk(stream, KWL_EVENTS_CHUNK_ID);
+    kwlEngineData_seekToEngineDataChunk(data, stream, KWL_EVENTS_CHUNK_ID);
     KWL_ASSERT(data->sounds != NULL);
     KWL_ASSERT(data->events == NULL);
     KWL_ASSERT(data->eventDefinitions == NULL);
@@ -384,10 +423,10 @@ kwlError kwlEngineData_loadEventData(kwlEngineData* data, kwlInputStream* stream
     KWL_ASSERT(numEventDefinitions > 0);
     data->numEventDefinitions = numEventDefinitions;
     data->events = 
-    (kwlEventInstance**)KWL_MALLOC(numEventDefinitions * sizeof(kwlEventInstance*), "kwlEngineData_loadEventData");
+    (kwlEventInstance**)kwlArena_alloc(&data->arena, numEventDefinitions * sizeof(kwlEventInstance*));
     kwlMemset(data->events, 0, numEventDefinitions * sizeof(kwlEventInstance*));
     data->eventDefinitions = 
-    (kwlEventDefinition*)KWL_MALLOC(numEventDefinitions * sizeof(kwlEventDefinition), "kwlEngineData_loadEventData");
+    (kwlEventDefinition*)kwlArena_alloc(&data->arena, numEventDefinitions * sizeof(kwlEventDefinition));
     kwlMemset(data->eventDefinitions, 0, numEventDefinitions * sizeof(kwlEventDefinition));
     
     int i;
@@ -395,14 +434,14 @@ kwlError kwlEngineData_loadEventData(kwlEngineData* data, kwlInputStream* stream
     {
         kwlEventDefinition* definitioni = &data->eventDefinitions[i];
         /*read the id of this event definition*/
-        definitioni->id = kwlInputStream_readASCIIString(stream);
+        definitioni->id = kwlEngineData_readString(data, stream);
         
         const int instanceCount = kwlInputStream_readIntBE(stream);
         KWL_ASSERT(instanceCount >= -1);
         definitioni->instanceCount = instanceCount;
         const int numInstancesToAllocate = instanceCount < 1 ? 1 : instanceCount;
         data->events[i] = 
-        (kwlEventInstance*)KWL_MALLOC(numInstancesToAllocate * sizeof(kwlEventInstance), "kwlEngineData_loadEventData");
+        (kwlEventInstance*)kwlArena_alloc(&data->arena, numInstancesToAllocate * sizeof(kwlEventInstance));
         kwlMemset(data->events[i], 0, numInstancesToAllocate * sizeof(kwlEventInstance));
         
         definitioni->gain = kwlInputStream_readFloatBE(stream);
@@ -464,7 +503,7 @@ kwlError kwlEngineData_loadEventData(kwlEngineData* data, kwlInputStream* stream
         definitioni->numReferencedWaveBanks = kwlInputStream_readIntBE(stream);
         KWL_ASSERT(definitioni->numReferencedWaveBanks < 10000 && definitioni->numReferencedWaveBanks >= 0);
         definitioni->referencedWaveBanks = 
-        (kwlWaveBank**)KWL_MALLOC(definitioni->numReferencedWaveBanks * sizeof(kwlWaveBank*), "wave bank refs");
+        (kwlWaveBank**)kwlArena_alloc(&data->arena, definitioni->numReferencedWaveBanks * sizeof(kwlWaveBank*));
         int j;
         for (j = 0; j < definitioni->numReferencedWaveBanks; j++)
         {
@@ -478,40 +517,213 @@ kwlError kwlEngineData_loadEventData(kwlEngineData* data, kwlInputStream* stream
         {
             kwlMemcpy(&data->events[i][j], &data->events[i][0], sizeof(kwlEventInstance));
         }
+        
+        /*all instances start out idle.*/
+        kwlEventDefinition_initInstancePool(definitioni, data->events[i], &data->arena);
     }
     
     return KWL_NO_ERROR;
     
 }
 
-void kwlEngineData_freeEventData(kwlEngineData* data)
+kwlError kwlEngineData_loadEventStealingModes(kwlEngineData* data, kwlInputStream* stream)
 {
-    if (data->events == NULL && 
-        data->eventDefinitions == NULL)
+    if (!kwlEngineData_hasChunk(data, KWL_EVENT_STEALING_MODES_CHUNK_ID))
     {
-        return;
+        return KWL_NO_ERROR;
     }
     
-    const int numEventDefinitions = data->numEventDefinitions;
+    kwlEngineData_seekToEngineDataChunk(data, stream, KWL_EVENT_STEALING_MODES_CHUNK_ID);
+    const int numModes = kwlInputStream_readIntBE(stream);
+    KWL_ASSERT(numModes == data->numEventDefinitions);
     
     int i;
-    for (i = 0; i < numEventDefinitions; i++)
+    for (i = 0; i < numModes && i < data->numEventDefinitions; i++)
     {
-        kwlEventDefinition* defi = &data->eventDefinitions[i];
-        KWL_FREE(data->events[i]);
-        KWL_FREE(defi->referencedWaveBanks);
-        KWL_FREE(defi->id);
+        const int stealingMode = kwlInputStream_readIntBE(stream);
+        KWL_ASSERT(stealingMode >= KWL_STEAL_QUIETEST && stealingMode <= KWL_STEAL_OLDEST);
+        data->eventDefinitions[i].stealingMode = (kwlEventInstanceStealingMode)stealingMode;
     }
     
-    KWL_FREE(data->events);
+    return KWL_NO_ERROR;
+}
+
+void kwlEngineData_freeEventData(kwlEngineData* data)
+{
+    /*The event definitions and instances live in the engine data arena.*/
     data->events = NULL;
-    KWL_FREE(data->eventDefinitions);
     data->eventDefinitions = NULL;
     data->numEventDefinitions = 0;
 }
 
-void kwlEngineData_seekToEngineDataChunk(kwlInputStream* stream, int chunkId)
+kwlError kwlEngineData_loadTableOfContents(kwlEngineData* data, kwlInputStream* stream)
+{
+    data->formatVersion = 1;
+    data->numChunks = 0;
+    data->binaryImage = NULL;
+    data->binaryImageSize = 0;
+    data->stringTable = NULL;
+    data->stringTableSize = 0;
+    
+    /*The size of the whole binary, which every chunk must lie within.*/
+    kwlInputStream_seek(stream, 0, SEEK_END);
+    const int totalSize = kwlInputStream_tell(stream);
+    
+    /*If present, the table of contents is the first chunk.*/
+    kwlInputStream_reset(stream);
+    kwlInputStream_skip(stream, KWL_ENGINE_DATA_BINARY_FILE_IDENTIFIER_LENGTH);
+    const int firstChunkId = kwlInputStream_readIntBE(stream);
+    const int firstChunkSize = kwlInputStream_readIntBE(stream);
+    if (firstChunkId != KWL_TABLE_OF_CONTENTS_CHUNK_ID)
+    {
+        /*A version 1 binary.*/
+        return KWL_NO_ERROR;
+    }
+    
+    const int formatVersion = kwlInputStream_readIntBE(stream);
+    const int numChunks = kwlInputStream_readIntBE(stream);
+    if (formatVersion < 2 || formatVersion > KWL_ENGINE_DATA_FORMAT_VERSION)
+    {
+        return KWL_UNKNOWN_FILE_FORMAT;
+    }
+    if (numChunks < 0 || numChunks > KWL_MAX_NUM_ENGINE_DATA_CHUNKS)
+    {
+        return KWL_CORRUPT_BINARY_DATA;
+    }
+    
+    const int tableOfContentsStart = KWL_ENGINE_DATA_BINARY_FILE_IDENTIFIER_LENGTH + 8;
+    if (firstChunkSize < 0 || firstChunkSize > totalSize - tableOfContentsStart)
+    {
+        return KWL_CORRUPT_BINARY_DATA;
+    }
+    
+    const int tableOfContentsEnd = tableOfContentsStart + firstChunkSize;
+    int imageSize = tableOfContentsEnd;
+    int i;
+    for (i = 0; i < numChunks; i++)
+    {
+        kwlEngineDataChunkInfo* chunki = &data->chunks[i];
+        chunki->chunkId = kwlInputStream_readIntBE(stream);
+        chunki->offset = kwlInputStream_readIntBE(stream);
+        chunki->size = kwlInputStream_readIntBE(stream);
+        /*Compare without adding offset and size, which could overflow for corrupt values.*/
+        if (chunki->offset < tableOfContentsEnd || 
+            chunki->offset > totalSize ||
+            chunki->size < 0 ||
+            chunki->size > totalSize - chunki->offset)
+        {
+            return KWL_CORRUPT_BINARY_DATA;
+        }
+        if (chunki->offset + chunki->size > imageSize)
+        {
+            imageSize = chunki->offset + chunki->size;
+        }
+    }
+    
+    /*Read the entire binary in a single block. Chunks are then parsed 
+      from memory and strings are used in place.*/
+    char* binaryImage = (char*)kwlArena_alloc(&data->arena, imageSize);
+    kwlInputStream_reset(stream);
+    const int bytesRead = kwlInputStream_read(stream, (signed char*)binaryImage, imageSize);
+    if (bytesRead != imageSize)
+    {
+        return KWL_CORRUPT_BINARY_DATA;
+    }
+    
+    data->formatVersion = formatVersion;
+    data->numChunks = numChunks;
+    data->binaryImage = binaryImage;
+    data->binaryImageSize = imageSize;
+    
+    for (i = 0; i < numChunks; i++)
+    {
+        if (data->chunks[i].chunkId == KWL_STRINGS_CHUNK_ID)
+        {
+            data->stringTable = &binaryImage[data->chunks[i].offset];
+            data->stringTableSize = data->chunks[i].size;
+        }
+    }
+    
+    /*All strings are null terminated, so the table must end with a zero.*/
+    if (data->stringTable == NULL || 
+        data->stringTableSize <= 0 ||
+        data->stringTable[data->stringTableSize - 1] != '\0')
+    {
+        kwlEngineData_freeTableOfContents(data);
+        return KWL_CORRUPT_BINARY_DATA;
+    }
+    
+    return KWL_NO_ERROR;
+}
+
+void kwlEngineData_freeTableOfContents(kwlEngineData* data)
+{
+    /*The binary image lives in the engine data arena.*/
+    data->binaryImage = NULL;
+    data->binaryImageSize = 0;
+    data->stringTable = NULL;
+    data->stringTableSize = 0;
+    data->numChunks = 0;
+    data->formatVersion = 1;
+}
+
+char* kwlEngineData_readString(kwlEngineData* data, kwlInputStream* stream)
+{
+    if (data->stringTable == NULL)
+    {
+        const int stringLength = kwlInputStream_readIntBE(stream);
+        KWL_ASSERT(stringLength > 0);
+        KWL_ASSERT(stringLength < 10000 && "sanity check");
+        char* string = (char*)kwlArena_alloc(&data->arena, stringLength + 1);
+        const int bytesRead = kwlInputStream_read(stream, (signed char*)string, stringLength);
+        string[bytesRead > 0 ? bytesRead : 0] = '\0';
+        return string;
+    }
+    
+    const int offset = kwlInputStream_readIntBE(stream);
+    KWL_ASSERT(offset >= 0 && offset < data->stringTableSize && "string table offset out of range");
+    if (offset < 0 || offset >= data->stringTableSize)
+    {
+        /*the last byte of the table is always zero, ie an empty string.*/
+        return (char*)&data->stringTable[data->stringTableSize - 1];
+    }
+    
+    return (char*)&data->stringTable[offset];
+}
+
+int kwlEngineData_hasChunk(kwlEngineData* data, int chunkId)
 {
+    int i;
+    for (i = 0; i < data->numChunks; i++)
+    {
+        if (data->chunks[i].chunkId == chunkId)
+        {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+void kwlEngineData_seekToEngineDataChunk(kwlEngineData* data, kwlInputStream* stream, int chunkId)
+{
+    if (data->numChunks > 0)
+    {
+        /*Look the chunk up in the table of contents.*/
+        int i;
+        for (i = 0; i < data->numChunks; i++)
+        {
+            if (data->chunks[i].chunkId == chunkId)
+            {
+                kwlInputStream_seek(stream, data->chunks[i].offset, SEEK_SET);
+                return;
+            }
+        }
+        
+        KWL_ASSERT(0 && "no matching chunk id found in the table of contents");
+        return;
+    }
+    
     /*move to the start of the stream*/
     kwlInputStream_reset(stream);
     /*move to first chunk*/
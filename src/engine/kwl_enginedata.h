@@ -27,6 +27,7 @@
 /*! \file */ 
 
 #include "kwl_audiodata.h"
+#include "kwl_memory.h"
 #include "kwl_mixbus.h"
 #include "kwl_mixpreset.h"
 
@@ -55,6 +56,31 @@ struct kwlWaveBank;
 /** The ID of the wave bank data chunk in an engine data binary file. */
 #define KWL_WAVE_BANKS_CHUNK_ID 0x736b6277
     
+/** 
+ * The ID of the table of contents chunk in an engine data binary file. Only present
+ * in version 2 and later binaries, where it is always the first chunk.
+ */
+#define KWL_TABLE_OF_CONTENTS_CHUNK_ID 0x636f7463
+
+/** The ID of the string table chunk in an engine data binary file (version 2 and later). */
+#define KWL_STRINGS_CHUNK_ID 0x73727473
+
+/** 
+ * The ID of the optional chunk holding the instance stealing mode of each event definition,
+ * in the order of the event data chunk (version 2 and later). Event definitions default to 
+ * \c KWL_STEAL_QUIETEST if it is missing.
+ */
+#define KWL_EVENT_STEALING_MODES_CHUNK_ID 0x6d6c7473
+
+/** The most recent engine data format version. */
+#define KWL_ENGINE_DATA_FORMAT_VERSION 2
+
+/** The maximum number of entries in the table of contents of an engine data binary. */
+#define KWL_MAX_NUM_ENGINE_DATA_CHUNKS 16
+
+/** The block size of the engine data arena.*/
+#define KWL_ENGINE_DATA_ARENA_BLOCK_SIZE 65536
+    
 /** 
  * The file identifier for engine binaries, ie the sequence of bytes
  * that all engine data binary files start with.
@@ -65,6 +91,20 @@ static const char KWL_ENGINE_DATA_BINARY_FILE_IDENTIFIER[KWL_ENGINE_DATA_BINARY_
 };
     
     
+/**
+ * A table of contents entry, describing the location of a chunk 
+ * within an engine data binary.
+ */
+typedef struct kwlEngineDataChunkInfo
+{
+    /** The chunk ID.*/
+    int chunkId;
+    /** The offset in bytes from the start of the binary to the chunk payload.*/
+    int offset;
+    /** The size in bytes of the chunk payload. */
+    int size;
+} kwlEngineDataChunkInfo;
+
 /**
  * A struct containing engine data loaded from a binary file.
  */
@@ -72,6 +112,11 @@ typedef struct kwlEngineData
 {
     /** Zero if no engine data is loaded, non-zero otherwise. */
     int isLoaded;
+    /** 
+     * The arena holding all memory allocated while loading engine data. 
+     * Unloading releases it in one go.
+     */
+    kwlArena arena;
     /** The number of mix buses.*/
     int numMixBuses;
     /** */
@@ -89,6 +134,17 @@ typedef struct kwlEngineData
     kwlMixPreset* mixPresets;
     /** The number of seconds it takes to fade between mix presets.*/
     float mixPresetFadeTime;
+    /** The parameter sets of the default mix preset, indexed by mix bus index. */
+    kwlMixBusParameters* mixPresetBaseParameters;
+    /** 
+     * For each mix bus, the sum of the sparse parameter differences of all presets
+     * scaled by their current weights.
+     */
+    kwlMixBusParameters* mixPresetBlendedDifferences;
+    /** The sum of the preset weights at the last blend.*/
+    float mixPresetWeightSum;
+    /** Non-zero if all mix buses need to be blended from scratch on the next update.*/
+    int mixPresetsNeedFullBlend;
     
     /** The total number of audio data entries. */
     int totalNumAudioDataEntries;
@@ -107,6 +163,24 @@ typedef struct kwlEngineData
     /** An array of sound definitions. */
     struct kwlSound* sounds;
     
+    /** The format version of the loaded binary. 1 for binaries without a table of contents.*/
+    int formatVersion;
+    /** The number of entries in \c chunks. Zero for version 1 binaries. */
+    int numChunks;
+    /** The table of contents of the loaded binary.*/
+    kwlEngineDataChunkInfo chunks[KWL_MAX_NUM_ENGINE_DATA_CHUNKS];
+    /** 
+     * The entire contents of a version 2 binary, read in a single block. NULL for 
+     * version 1 binaries. Strings in the engine data point into this block.
+     */
+    char* binaryImage;
+    /** The size in bytes of \c binaryImage.*/
+    int binaryImageSize;
+    /** The string table of a version 2 binary, within \c binaryImage.*/
+    const char* stringTable;
+    /** The size in bytes of \c stringTable. */
+    int stringTableSize;
+    
 } kwlEngineData;
 
 /** */
@@ -145,8 +219,33 @@ kwlError kwlEngineData_loadEventData(kwlEngineData* data, kwlInputStream* stream
 /** */
 void kwlEngineData_freeEventData(kwlEngineData* data);
 
-/** */
-void kwlEngineData_seekToEngineDataChunk(kwlInputStream* stream, int chunkId);
+/** Reads the event instance stealing modes, if present. Must happen after event loading.*/
+kwlError kwlEngineData_loadEventStealingModes(kwlEngineData* data, kwlInputStream* stream);
+
+/** 
+ * Reads the table of contents of a version 2 binary into memory. Version 1
+ * binaries have no table of contents and are left untouched.
+ */
+kwlError kwlEngineData_loadTableOfContents(kwlEngineData* data, kwlInputStream* stream);
+
+/** Clears the binary image and string table of version 2 engine data, if any.*/
+void kwlEngineData_freeTableOfContents(kwlEngineData* data);
+
+/** 
+ * Reads a string from an engine data chunk. Version 1 binaries store strings inline and
+ * the string is copied to the engine data arena. Version 2 binaries store an offset into 
+ * the string table and a pointer into the binary image is returned.
+ */
+char* kwlEngineData_readString(kwlEngineData* data, kwlInputStream* stream);
+
+/** 
+ * Moves the read position of a stream to the start of the payload of a given chunk.
+ * Uses the table of contents if there is one and scans the chunks otherwise.
+ */
+void kwlEngineData_seekToEngineDataChunk(kwlEngineData* data, kwlInputStream* stream, int chunkId);
+
+/** Returns non-zero if the table of contents lists a chunk with a given ID, zero otherwise.*/
+int kwlEngineData_hasChunk(kwlEngineData* data, int chunkId);
 
 #ifdef __cplusplus
 }
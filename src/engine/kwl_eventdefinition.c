@@ -22,8 +22,213 @@ freely, subject to the following restrictions:
 */
 
 #include "kwl_eventdefinition.h"
+#include "kwl_eventinstance.h"
+#include "kwl_random.h"
+#include "kwl_assert.h"
 
 void kwlEventDefinition_init(kwlEventDefinition* eventDefinition)
 {
     kwlMemset(eventDefinition, 0, sizeof(kwlEventDefinition));
 }
+
+void kwlEventDefinition_initInstancePool(kwlEventDefinition* eventDefinition, 
+                                         kwlEventInstance* instances,
+                                         kwlArena* arena)
+{
+    /*Definitions with a negative instance count have a single, unusable instance.*/
+    const int instanceCount = eventDefinition->instanceCount < 0 ? 0 : eventDefinition->instanceCount;
+    eventDefinition->freeInstances = 
+        (kwlEventInstance**)kwlArena_alloc(arena, instanceCount * sizeof(kwlEventInstance*));
+    eventDefinition->stealableInstances = 
+        (kwlEventInstance**)kwlArena_alloc(arena, instanceCount * sizeof(kwlEventInstance*));
+    eventDefinition->numStealableInstances = 0;
+    eventDefinition->isStealHeapDirty = 0;
+    
+    /*Push the instances in reverse order, so that the first instance is picked first.*/
+    int i;
+    eventDefinition->numFreeInstances = instanceCount;
+    for (i = 0; i < instanceCount; i++)
+    {
+        kwlEventInstance* instance = &instances[instanceCount - 1 - i];
+        eventDefinition->freeInstances[i] = instance;
+        instance->freeListIndex = i;
+        instance->stealHeapIndex = -1;
+    }
+}
+
+/** Returns non-zero if instance \c a should be stolen before instance \c b.*/
+static int kwlEventDefinition_stealBefore(kwlEventDefinition* eventDefinition, 
+                                          kwlEventInstance* a, 
+                                          kwlEventInstance* b)
+{
+    if (eventDefinition->stealingMode == KWL_STEAL_QUIETEST)
+    {
+        /*Compare the summed channel gains of the instances.*/
+        return a->gainLeft.valueEngine + a->gainRight.valueEngine < 
+               b->gainLeft.valueEngine + b->gainRight.valueEngine;
+    }
+    else if (eventDefinition->stealingMode == KWL_STEAL_OLDEST)
+    {
+        /*The start counter may wrap around, so compare by difference.*/
+        return (int)(a->startOrder - b->startOrder) < 0;
+    }
+    
+    /*No ordering is needed to steal randomly.*/
+    return 0;
+}
+
+static void kwlEventDefinition_setHeapSlot(kwlEventDefinition* eventDefinition, int index, kwlEventInstance* instance)
+{
+    eventDefinition->stealableInstances[index] = instance;
+    instance->stealHeapIndex = index;
+}
+
+static void kwlEventDefinition_siftUp(kwlEventDefinition* eventDefinition, int index)
+{
+    kwlEventInstance* instance = eventDefinition->stealableInstances[index];
+    while (index > 0)
+    {
+        const int parentIndex = (index - 1) / 2;
+        kwlEventInstance* parent = eventDefinition->stealableInstances[parentIndex];
+        if (!kwlEventDefinition_stealBefore(eventDefinition, instance, parent))
+        {
+            break;
+        }
+        kwlEventDefinition_setHeapSlot(eventDefinition, index, parent);
+        index = parentIndex;
+    }
+    kwlEventDefinition_setHeapSlot(eventDefinition, index, instance);
+}
+
+static void kwlEventDefinition_siftDown(kwlEventDefinition* eventDefinition, int index)
+{
+    const int size = eventDefinition->numStealableInstances;
+    kwlEventInstance* instance = eventDefinition->stealableInstances[index];
+    for (;;)
+    {
+        int childIndex = 2 * index + 1;
+        if (childIndex >= size)
+        {
+            break;
+        }
+        if (childIndex + 1 < size &&
+            kwlEventDefinition_stealBefore(eventDefinition, 
+                                           eventDefinition->stealableInstances[childIndex + 1], 
+                                           eventDefinition->stealableInstances[childIndex]))
+        {
+            childIndex++;
+        }
+        kwlEventInstance* child = eventDefinition->stealableInstances[childIndex];
+        if (!kwlEventDefinition_stealBefore(eventDefinition, child, instance))
+        {
+            break;
+        }
+        kwlEventDefinition_setHeapSlot(eventDefinition, index, child);
+        index = childIndex;
+    }
+    kwlEventDefinition_setHeapSlot(eventDefinition, index, instance);
+}
+
+static void kwlEventDefinition_removeFromFreeList(kwlEventDefinition* eventDefinition, kwlEventInstance* instance)
+{
+    const int index = instance->freeListIndex;
+    KWL_ASSERT(eventDefinition->freeInstances[index] == instance);
+    kwlEventInstance* last = eventDefinition->freeInstances[--eventDefinition->numFreeInstances];
+    eventDefinition->freeInstances[index] = last;
+    last->freeListIndex = index;
+    instance->freeListIndex = -1;
+}
+
+static void kwlEventDefinition_removeFromStealHeap(kwlEventDefinition* eventDefinition, kwlEventInstance* instance)
+{
+    const int index = instance->stealHeapIndex;
+    KWL_ASSERT(eventDefinition->stealableInstances[index] == instance);
+    kwlEventInstance* last = eventDefinition->stealableInstances[--eventDefinition->numStealableInstances];
+    instance->stealHeapIndex = -1;
+    if (last != instance)
+    {
+        /*Move the last instance into the hole and restore the heap property around it.*/
+        kwlEventDefinition_setHeapSlot(eventDefinition, index, last);
+        kwlEventDefinition_siftUp(eventDefinition, index);
+        kwlEventDefinition_siftDown(eventDefinition, last->stealHeapIndex);
+    }
+}
+
+void kwlEventDefinition_updateInstancePool(kwlEventDefinition* eventDefinition, kwlEventInstance* instance)
+{
+    if (eventDefinition->freeInstances == NULL)
+    {
+        /*Freeform events have no instance pool.*/
+        return;
+    }
+    
+    const int shouldBeFree = instance->isAssociatedWithHandle == 0 && instance->isPlaying == 0;
+    const int shouldBeStealable = instance->isAssociatedWithHandle == 0 && instance->isPlaying != 0;
+    
+    if (instance->freeListIndex >= 0 && !shouldBeFree)
+    {
+        kwlEventDefinition_removeFromFreeList(eventDefinition, instance);
+    }
+    else if (instance->freeListIndex < 0 && shouldBeFree)
+    {
+        instance->freeListIndex = eventDefinition->numFreeInstances;
+        eventDefinition->freeInstances[eventDefinition->numFreeInstances++] = instance;
+    }
+    
+    if (instance->stealHeapIndex >= 0 && !shouldBeStealable)
+    {
+        kwlEventDefinition_removeFromStealHeap(eventDefinition, instance);
+    }
+    else if (instance->stealHeapIndex < 0 && shouldBeStealable)
+    {
+        kwlEventDefinition_setHeapSlot(eventDefinition, eventDefinition->numStealableInstances++, instance);
+        kwlEventDefinition_siftUp(eventDefinition, instance->stealHeapIndex);
+    }
+    else if (shouldBeStealable)
+    {
+        /*The instance was restarted, so its start order and gain may have changed.*/
+        kwlEventDefinition_siftUp(eventDefinition, instance->stealHeapIndex);
+        kwlEventDefinition_siftDown(eventDefinition, instance->stealHeapIndex);
+    }
+}
+
+kwlEventInstance* kwlEventDefinition_pickInstanceToSteal(kwlEventDefinition* eventDefinition, 
+                                                         unsigned int* randomState)
+{
+    const int numStealable = eventDefinition->numStealableInstances;
+    if (numStealable == 0)
+    {
+        return NULL;
+    }
+    
+    switch (eventDefinition->stealingMode)
+    {
+        case KWL_STEAL_RANDOM:
+        {
+            const int index = kwlRandom_nextInt(randomState, numStealable);
+            return eventDefinition->stealableInstances[index];
+        }
+        case KWL_STEAL_QUIETEST:
+        {
+            if (eventDefinition->isStealHeapDirty)
+            {
+                /*Gains have changed since the heap was ordered. Rebuild it bottom up.*/
+                int i;
+                for (i = numStealable / 2 - 1; i >= 0; i--)
+                {
+                    kwlEventDefinition_siftDown(eventDefinition, i);
+                }
+                eventDefinition->isStealHeapDirty = 0;
+            }
+            return eventDefinition->stealableInstances[0];
+        }
+        case KWL_STEAL_OLDEST:
+        {
+            return eventDefinition->stealableInstances[0];
+        }
+        default:
+        {
+            return NULL;
+        }
+    }
+}
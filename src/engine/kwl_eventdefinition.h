@@ -27,6 +27,7 @@ freely, subject to the following restrictions:
 /*! \file */ 
 
 #include "kwl_decoder.h"
+#include "kwl_memory.h"
 #include "kwl_sound.h"
 
 #ifdef __cplusplus
@@ -55,7 +56,9 @@ typedef enum
     /** */
     KWL_STEAL_RANDOM,
     /** */
-    KWL_DONT_STEAL
+    KWL_DONT_STEAL,
+    /** Steal the instance that was started the longest time ago.*/
+    KWL_STEAL_OLDEST
 } kwlEventInstanceStealingMode;
 
 /**
@@ -99,9 +102,58 @@ typedef struct kwlEventDefinition
      * stop before unloading a given wavebank. Accessed from the mixer thread.
      */
     kwlWaveBank** referencedWaveBanks;
+    
+    /** 
+     * A stack of the idle instances of the definition, i.e instances that are neither 
+     * playing nor associated with a handle. Data driven events only. Accessed from the engine thread.
+     */
+    struct kwlEventInstance** freeInstances;
+    /** The number of instances in \c freeInstances.*/
+    int numFreeInstances;
+    /** 
+     * A binary min-heap of the playing instances of the definition that are not associated 
+     * with a handle, i.e the instances a one-shot may steal, with the next instance to steal 
+     * at the root. Only ordered for the quietest and oldest stealing modes. Data driven events only.
+     * Accessed from the engine thread.
+     */
+    struct kwlEventInstance** stealableInstances;
+    /** The number of instances in \c stealableInstances.*/
+    int numStealableInstances;
+    /** 
+     * Non-zero if the gain of a stealable instance has changed since \c stealableInstances 
+     * was last ordered, in which case the heap is rebuilt before stealing the quietest instance.
+     * Only set for the quietest stealing mode, since the other modes do not order by gain.
+     */
+    int isStealHeapDirty;
 } kwlEventDefinition;
 
 void kwlEventDefinition_init(kwlEventDefinition* eventDefinition);
+
+/** 
+ * Sets up the free list and steal heap of a data driven event definition, 
+ * initially holding all of its \c instanceCount instances in the free list.
+ */
+void kwlEventDefinition_initInstancePool(kwlEventDefinition* eventDefinition, 
+                                         struct kwlEventInstance* instances,
+                                         kwlArena* arena);
+
+/**
+ * Moves an instance of a data driven event definition to the free list or steal heap depending
+ * on whether it is playing and associated with a handle. Must be called whenever any of these
+ * states or the start order of the instance changes.
+ */
+void kwlEventDefinition_updateInstancePool(kwlEventDefinition* eventDefinition, 
+                                           struct kwlEventInstance* instance);
+
+/**
+ * Picks the instance a one-shot should steal according to the stealing mode of a definition. 
+ * @param eventDefinition The event definition.
+ * @param randomState The state of the random number generator used by \c KWL_STEAL_RANDOM.
+ * @return The instance to steal, or NULL if there are no stealable instances or the 
+ * definition does not allow stealing.
+ */
+struct kwlEventInstance* kwlEventDefinition_pickInstanceToSteal(kwlEventDefinition* eventDefinition, 
+                                                                unsigned int* randomState);
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */    
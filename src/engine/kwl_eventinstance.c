@@ -24,6 +24,7 @@ freely, subject to the following restrictions:
 #include "kwl_asm.h"
 #include "kwl_audiofileutil.h"
 #include "kwl_eventinstance.h"
+#include "kwl_pushstream.h"
 #include "kwl_synchronization.h"
 #include "kwl_sound.h"
 
@@ -55,6 +56,14 @@ void kwlEventInstance_init(kwlEventInstance* event)
     event->userPitch = 1.0f;    
     event->balance = 0.0f;
     
+    kwlAutomation_init(&event->gainAutomation, 1.0f);
+    kwlAutomation_init(&event->pitchAutomation, 1.0f);
+    kwlAutomation_init(&event->balanceAutomation, 0.0f);
+    
+    event->freeListIndex = -1;
+    event->stealHeapIndex = -1;
+    event->gridBucket = -1;
+    
     event->numBuffersPlayed = 0;
     event->currentAudioDataIndex = 0;
     event->pitchAccumulator = 0.0f;
@@ -76,6 +85,19 @@ void kwlEventInstance_start(kwlEventInstance* event)
     event->prevEffectiveGain[1] = -1.0f;
 }
 
+/** 
+ * All memory owned by a freeform event. Allocated as a single block that lives 
+ * as long as the event. The event instance must be the first member.
+ */
+typedef struct kwlFreeformEventData
+{
+    kwlEventInstance instance;
+    kwlEventDefinition definition;
+    kwlSound sound;
+    kwlAudioData* audioDataEntries[1];
+    kwlAudioData audioData;
+} kwlFreeformEventData;
+
 kwlError kwlEventInstance_createFreeformEventFromBuffer(kwlEventInstance** event, kwlPCMBuffer* buffer, kwlEventType type)
 {
     if (buffer->numFrames < 1 ||
@@ -86,19 +108,18 @@ kwlError kwlEventInstance_createFreeformEventFromBuffer(kwlEventInstance** event
         return KWL_INVALID_PARAMETER_VALUE;
     }
     
-    kwlAudioData* audioData = (kwlAudioData*)KWL_MALLOC(sizeof(kwlAudioData), 
-                                                        "freeform event audio data struct");
-    kwlMemset(audioData, 0, sizeof(kwlAudioData));
+    kwlAudioData audioData;
+    kwlMemset(&audioData, 0, sizeof(kwlAudioData));
     
-    audioData->numChannels = buffer->numChannels;
-    audioData->numFrames = buffer->numFrames;
-    audioData->numBytes = buffer->numFrames * buffer->numChannels * 2;/*2 bytes per 16 bit sample*/
-    audioData->bytes = buffer->pcmData;
-    audioData->encoding = KWL_ENCODING_SIGNED_16BIT_PCM;
+    audioData.numChannels = buffer->numChannels;
+    audioData.numFrames = buffer->numFrames;
+    audioData.numBytes = buffer->numFrames * buffer->numChannels * 2;/*2 bytes per 16 bit sample*/
+    audioData.bytes = buffer->pcmData;
+    audioData.encoding = KWL_ENCODING_SIGNED_16BIT_PCM;
     
     /*The id "freeform buffer event" is used later to indicate that the sample data should not be released.
       This should really be handled in a better way.*/
-    return kwlEventInstance_createFreeformEventFromAudioData(event, audioData, type, "freeform buffer event");
+    return kwlEventInstance_createFreeformEventFromAudioData(event, &audioData, type, "freeform buffer event");
 }
 
 kwlError kwlEventInstance_createFreeformEventFromFile(kwlEventInstance** event, const char* const audioFilePath, 
@@ -108,47 +129,84 @@ kwlError kwlEventInstance_createFreeformEventFromFile(kwlEventInstance** event,
     KWL_ASSERT(streamFromDisk == 0 && "stream flag not supported yet");
     
     /*try to load the audio file data*/
-    kwlAudioData* audioData = (kwlAudioData*)KWL_MALLOC(sizeof(kwlAudioData), 
-                                                        "freeform event audio data struct");
-    kwlMemset(audioData, 0, sizeof(kwlAudioData));
+    kwlAudioData audioData;
+    kwlMemset(&audioData, 0, sizeof(kwlAudioData));
     
-    kwlError error = kwlLoadAudioFile(audioFilePath, audioData, KWL_CONVERT_TO_INT16_OR_FAIL);
+    kwlError error = kwlLoadAudioFile(audioFilePath, &audioData, KWL_CONVERT_TO_INT16_OR_FAIL);
     if (error != KWL_NO_ERROR)
     {
-        KWL_FREE(audioData);
         return error;
     }
     
     if (type == KWL_POSITIONAL &&
-        audioData->numChannels != 1)
+        audioData.numChannels != 1)
     {
-        kwlAudioData_free(audioData);
-        KWL_FREE(audioData);
+        kwlAudioData_free(&audioData);
         return KWL_POSITIONAL_EVENT_MUST_BE_MONO;
     }
     
-    return kwlEventInstance_createFreeformEventFromAudioData(event, audioData, type, "freeform event");
+    return kwlEventInstance_createFreeformEventFromAudioData(event, &audioData, type, "freeform event");
+}
+
+/**
+ * Initializes the event definition of a freeform event and associates it with the event.
+ */
+static void kwlEventInstance_initFreeformDefinition(kwlFreeformEventData* eventData, 
+                                                    const char* eventId, 
+                                                    kwlEventType type, 
+                                                    kwlSound* sound, 
+                                                    kwlAudioData* streamAudioData)
+{
+    kwlEventDefinition* eventDefinition = &eventData->definition;
+    kwlEventDefinition_init(eventDefinition);
+    
+    eventDefinition->id = (char*)eventId;
+    eventDefinition->instanceCount = 1;
+    eventDefinition->isPositional = type == KWL_POSITIONAL ? 1 : 0;
+    eventDefinition->gain = 1.0f;
+    eventDefinition->pitch = 1.0f;
+    eventDefinition->innerConeCosAngle = 1.0f;
+    eventDefinition->outerConeCosAngle = -1.0f;
+    eventDefinition->outerConeGain = 1.0f;
+    eventDefinition->retriggerMode = KWL_RETRIGGER;
+    eventDefinition->stealingMode = KWL_DONT_STEAL;
+    eventDefinition->streamAudioData = streamAudioData;
+    eventDefinition->sound = sound;
+    eventDefinition->numReferencedWaveBanks = 0;
+    eventDefinition->referencedWaveBanks = NULL;
+    /*Set the mix bus to NULL. This is how the mixer knows this is a freeform event.
+     TODO: solve this in some better way?*/
+    eventDefinition->mixBus = NULL;
+    
+    eventData->instance.definition_mixer = eventDefinition;
+    eventData->instance.definition_engine = eventDefinition;
 }
 
 kwlError kwlEventInstance_createFreeformEventFromAudioData(kwlEventInstance** event, kwlAudioData* audioData, kwlEventType type, const char* eventId)
 {
     /*create the event. as opposed to a data driven event, a freeform event does
      not reference sounds and event definitions in the engine, but own its local data
-     that is freed when the event is released.*/
-    kwlEventInstance* createdEvent = (kwlEventInstance*)KWL_MALLOC(sizeof(kwlEventInstance), "freeform event instance");
+     that is freed when the event is released. All of it is allocated in one block.*/
+    kwlFreeformEventData* eventData = 
+        (kwlFreeformEventData*)KWL_MALLOC(sizeof(kwlFreeformEventData), "freeform event");
+    kwlMemset(eventData, 0, sizeof(kwlFreeformEventData));
+    
+    kwlEventInstance* createdEvent = &eventData->instance;
     kwlEventInstance_init(createdEvent);
     
+    /*the event owns a copy of the audio data struct (but not necessarily the samples).*/
+    kwlMemcpy(&eventData->audioData, audioData, sizeof(kwlAudioData));
+    
     kwlSound* sound = NULL;
     kwlAudioData* streamAudioData = NULL;
     
     /*create a sound if we loaded a PCM file.*/
     if (audioData->encoding == KWL_ENCODING_SIGNED_16BIT_PCM)
     {
-        sound = (kwlSound*)KWL_MALLOC(sizeof(kwlSound), "freeform event: sound");
+        sound = &eventData->sound;
         kwlSound_init(sound);
-        sound->audioDataEntries = (kwlAudioData**)KWL_MALLOC(sizeof(kwlAudioData*), 
-                                                             "freeform event: sound audio data array list");
-        sound->audioDataEntries[0] = audioData;
+        sound->audioDataEntries = eventData->audioDataEntries;
+        sound->audioDataEntries[0] = &eventData->audioData;
         sound->numAudioDataEntries = 1;
         sound->playbackMode = KWL_SEQUENTIAL;
         sound->playbackCount = 1;
@@ -163,32 +221,44 @@ kwlError kwlEventInstance_createFreeformEventFromAudioData(kwlEventInstance** ev
         KWL_ASSERT(0 && "TODO: support creating non-pcm events");
     }
     
-    /*create an event definition*/
-    kwlEventDefinition* eventDefinition = 
-    (kwlEventDefinition*)KWL_MALLOC(sizeof(kwlEventDefinition), 
-                                    "freeform event definition");
-    kwlEventDefinition_init(eventDefinition);
+    kwlEventInstance_initFreeformDefinition(eventData, eventId, type, sound, streamAudioData);
     
-    eventDefinition->id = eventId;
-    eventDefinition->instanceCount = 1;
-    eventDefinition->isPositional = type == KWL_POSITIONAL ? 1 : 0;
-    eventDefinition->gain = 1.0f;
-    eventDefinition->pitch = 1.0f;
-    eventDefinition->innerConeCosAngle = 1.0f;
-    eventDefinition->outerConeCosAngle = -1.0f;
-    eventDefinition->outerConeGain = 1.0f;
-    eventDefinition->retriggerMode = KWL_RETRIGGER;
-    eventDefinition->stealingMode = KWL_DONT_STEAL;
-    eventDefinition->streamAudioData = streamAudioData;
-    eventDefinition->sound = sound;
-    eventDefinition->numReferencedWaveBanks = 0;
-    eventDefinition->referencedWaveBanks = NULL;
-    /*Set the mix bus to NULL. This is how the mixer knows this is a freeform event.
-     TODO: solve this in some better way?*/
-    eventDefinition->mixBus = NULL;
+    *event = createdEvent;
     
-    createdEvent->definition_mixer = eventDefinition;
-    createdEvent->definition_engine = eventDefinition;
+    return KWL_NO_ERROR;
+}
+
+kwlError kwlEventInstance_createFreeformEventFromPushStream(kwlEventInstance** event, 
+                                                   int numChannels,
+                                                   int capacity,
+                                                   int latency,
+                                                   kwlEventType type)
+{
+    if (numChannels < 1 || 
+        numChannels > 2 ||
+        capacity < 2 ||
+        latency < 0 ||
+        latency > capacity)
+    {
+        return KWL_INVALID_PARAMETER_VALUE;
+    }
+    
+    if (type == KWL_POSITIONAL &&
+        numChannels != 1)
+    {
+        return KWL_POSITIONAL_EVENT_MUST_BE_MONO;
+    }
+    
+    kwlFreeformEventData* eventData = 
+        (kwlFreeformEventData*)KWL_MALLOC(sizeof(kwlFreeformEventData), "freeform push stream event");
+    kwlMemset(eventData, 0, sizeof(kwlFreeformEventData));
+    
+    kwlEventInstance* createdEvent = &eventData->instance;
+    kwlEventInstance_init(createdEvent);
+    createdEvent->pushStream = kwlPushStream_new(numChannels, capacity, latency);
+    
+    /*The event has neither a sound nor stream audio data. It plays from the push stream.*/
+    kwlEventInstance_initFreeformDefinition(eventData, "freeform push stream event", type, NULL, NULL);
     
     *event = createdEvent;
     
@@ -198,34 +268,28 @@ kwlError kwlEventInstance_createFreeformEventFromAudioData(kwlEventInstance** ev
 void kwlEventInstance_releaseFreeformEvent(kwlEventInstance* event)
 {
     /*Free all data associated with the freeform event.*/
+    kwlFreeformEventData* eventData = (kwlFreeformEventData*)event;
     kwlEventDefinition* eventDefinition = event->definition_engine;
-    if (eventDefinition->streamAudioData != NULL)
+    KWL_ASSERT(eventDefinition == &eventData->definition);
+    
+    /*TODO: this check could be more robust. it will cause a memory
+     leak for freeform events created from files with the name
+     "freeform buffer event"*/
+    if (strcmp(eventDefinition->id, "freeform buffer event") == 0)
     {
-        KWL_ASSERT(0); /* double check this*/
-        kwlAudioData_free(eventDefinition->streamAudioData);
-        KWL_FREE(eventDefinition->streamAudioData);
+        /*don't release audio data buffer for freeform buffer events.*/
+        eventData->audioData.bytes = NULL;
     }
-    else if (eventDefinition->sound != NULL)
+    /* Free loaded audio data */
+    kwlAudioData_free(&eventData->audioData);
+    
+    if (event->pushStream != NULL)
     {
-        /*TODO: this check could be more robust. it will cause a memory
-         leak for freeform events created from files with the name
-         "freeform buffer event"*/
-        if (strcmp(eventDefinition->id, "freeform buffer event") == 0)
-        {
-            /*don't release audio data buffer for freeform buffer events.*/
-            eventDefinition->sound->audioDataEntries[0]->bytes = NULL;
-        }
-        /* Free loaded audio data */
-        kwlAudioData_free(eventDefinition->sound->audioDataEntries[0]);
-        /* Free allocated audio data and sound structs */
-        KWL_FREE(eventDefinition->sound->audioDataEntries[0]);
-        KWL_FREE(eventDefinition->sound->audioDataEntries);
-        KWL_FREE(eventDefinition->sound);
+        kwlPushStream_free(event->pushStream);
     }
     
-    /* Finally, free the event instance and the event definition. */
-    KWL_FREE(eventDefinition);
-    KWL_FREE(event);
+    /* Finally, free the block holding the event instance, definition and sound. */
+    KWL_FREE(eventData);
 }
 
 
@@ -245,16 +309,30 @@ int kwlEventInstance_getNumRemainingOutFrames(kwlEventInstance* event, float pit
     }
     else
     {
-        int numRemaining = (int)((event->currentPCMBufferSize - event->currentPCMFrameIndex - event->pitchAccumulator) / pitch); 
-        KWL_ASSERT(numRemaining >= 0 && "kwlEventInstance_getNumRemainingOutFrames: negative num frames");
+        const float exactNumRemaining = 
+            (event->currentPCMBufferSize - event->currentPCMFrameIndex - event->pitchAccumulator) / pitch;
+        int numRemaining = (int)exactNumRemaining;
+        /*
+         The caller renders one frame past the returned count. If that frame falls exactly on the
+         end of the buffer, e.g for pitches like 0.5, it would interpolate towards the frame after
+         the end, so stop one frame earlier and let the next buffer pick up from there.
+         */
+        if (numRemaining == exactNumRemaining)
+        {
+            numRemaining--;
+        }
+        KWL_ASSERT(numRemaining >= -1 && "kwlEventInstance_getNumRemainingOutFrames: negative num frames");
         return numRemaining;
     }
 }
 
 int kwlEventInstance_render(kwlEventInstance* event, 
                     float* outBuffer,
+                    float* halfRateBuffer,
+                    float* scratchBuffer,
                     const int numOutChannels,
                     const int numFrames,
+                    const int numOutputRateFrames,
                     const float accumulatedBusPitch)
 {
     /* initial playback logic checks */
@@ -281,7 +359,7 @@ int kwlEventInstance_render(kwlEventInstance* event,
             int allowsImmediateStop = 
                 event->definition_mixer->sound != NULL ? 
                 event->definition_mixer->sound->deferStop == 0 : 1;
-            if (allowsImmediateStop != 0)
+            if (allowsImmediateStop != 0 && event->decoder == NULL)
             {
                 kwlSound_pickNextBufferForEvent(event->definition_mixer->sound, 
                                                 event, 0);
@@ -289,7 +367,6 @@ int kwlEventInstance_render(kwlEventInstance* event,
         }        
         else if (event->isPaused != 0)
         {
-            kwlClearFloatBuffer(outBuffer, numFrames * numOutChannels);
             return 0;
         }
         else if (event->pitch.valueMixer < PITCH_EPSILON)
@@ -299,9 +376,14 @@ int kwlEventInstance_render(kwlEventInstance* event,
         }
     }
     
+    /*Advance automated parameters to the end of this buffer.*/
+    kwlAutomation_advance(&event->gainAutomation, numOutputRateFrames);
+    kwlAutomation_advance(&event->pitchAutomation, numOutputRateFrames);
+    kwlAutomation_advance(&event->balanceAutomation, numOutputRateFrames);
+    
     /*Update fade progress*/
     {
-        event->fadeGain += event->fadeGainIncrPerFrame * numFrames;
+        event->fadeGain += event->fadeGainIncrPerFrame * numOutputRateFrames;
         if (event->fadeGain > 1.0f)
         {
             event->fadeGain = 1.0f;
@@ -314,6 +396,76 @@ int kwlEventInstance_render(kwlEventInstance* event,
         }
     }
     
+    /* 
+       Compute the per channel gain ramp for this buffer. Without an event DSP unit,
+       the ramp is applied while mixing straight into the out buffer. Otherwise the 
+       event is rendered to the scratch buffer at sound gain, so that the DSP unit 
+       sees the signal before the ramp, and then mixed into the out buffer.
+     */
+    kwlDSPUnit* dspUnit = outBuffer != NULL ? (kwlDSPUnit*)event->dspUnit.valueMixer : NULL;
+    float* targetBuffer = outBuffer;
+    
+    /*
+       Pick the level of detail for this buffer. Half rate rendering needs the bus half 
+       rate buffer and an even number of frames, and is not used with DSP units since 
+       they expect output rate input. The source position and the gain ramp carry over
+       between tiers, so a tier change does not interrupt the event.
+     */
+    int lodTier = event->lodTier.valueMixer;
+    if (lodTier == KWL_VOICE_LOD_HALF_RATE && 
+        (halfRateBuffer == NULL || dspUnit != NULL || (numFrames & 1) != 0))
+    {
+        lodTier = KWL_VOICE_LOD_MONO;
+    }
+    
+    int numRenderFrames = numFrames;
+    float renderPitchScale = 1.0f;
+    if (lodTier == KWL_VOICE_LOD_HALF_RATE)
+    {
+        targetBuffer = halfRateBuffer;
+        numRenderFrames = numFrames / 2;
+        renderPitchScale = 2.0f;
+    }
+    
+    const float automatedGain = event->fadeGain * event->gainAutomation.value;
+    const float automatedBalance = event->balanceAutomation.value;
+    float effectiveGain[2] = 
+    {
+        automatedGain * (1.0f - automatedBalance) * event->gainLeft.valueMixer,
+        automatedGain * (1.0f + automatedBalance) * event->gainRight.valueMixer
+    };
+    
+    if (event->prevEffectiveGain[0] < 0.0f)
+    {
+        event->prevEffectiveGain[0] = effectiveGain[0];
+        event->prevEffectiveGain[1] = effectiveGain[1];
+    }
+    
+    float rampStartGain[2] = { event->prevEffectiveGain[0], event->prevEffectiveGain[1] };
+    float rampGainIncrPerFrame[2] = { 0.0f, 0.0f };
+    
+    if (dspUnit != NULL)
+    {
+        targetBuffer = scratchBuffer;
+        kwlClearFloatBuffer(scratchBuffer, numFrames * numOutChannels);
+        rampStartGain[0] = 1.0f;
+        rampStartGain[1] = 1.0f;
+    }
+    else
+    {
+        /*
+         If the gain difference between consecutive frames is less than this,
+         a gain ramp will not be applied.
+         */
+        const float eps = 1e-7f;
+        int ch;
+        for (ch = 0; ch < 2; ch++)
+        {
+            const float incr = (effectiveGain[ch] - rampStartGain[ch]) / numRenderFrames;
+            rampGainIncrPerFrame[ch] = incr < eps && incr > -eps ? 0.0f : incr;
+        }
+    }
+    
     /*gets set to a non-zero value when the out buffer has been completely filled*/
     int endOfOutBufferReached = 0;
     /*the index of the current frame in the out buffer*/
@@ -322,14 +474,27 @@ int kwlEventInstance_render(kwlEventInstance* event,
     int endOfSourceBufferReached = 0;
     
     /* 
-       During this loop, the output buffer is filled with samples from 
-       either a sound or a decoder.     
+       During this loop, samples from either a sound or a decoder are 
+       mixed into the target buffer.     
      */
     int donePlaying = 0;
     while (!endOfOutBufferReached)
     {
+        /*
+         Sources with a different sample rate than the output are played at their native rate
+         by scaling the pitch. Checked for every buffer, since the next buffer of a sound may 
+         come from audio data with another rate.
+         */
+        float sourceRateScale = 1.0f;
+        if (event->currentSampleRate > 0 && event->outputSampleRate > 0.0f)
+        {
+            sourceRateScale = event->currentSampleRate / event->outputSampleRate;
+        }
+        
         /*if the event pitch is close enough to 1, pitch shifting is not applied.*/
-        float effectivePitch = event->pitch.valueMixer * event->soundPitch * accumulatedBusPitch;
+        float effectivePitch = event->pitch.valueMixer * event->pitchAutomation.value * 
+                               event->soundPitch * accumulatedBusPitch * renderPitchScale * 
+                               sourceRateScale;
         if (effectivePitch < PITCH_EPSILON)
         {
             effectivePitch = PITCH_EPSILON;
@@ -339,8 +504,8 @@ int kwlEventInstance_render(kwlEventInstance* event,
         
         /*Check if we have enough source frames to fill the output buffer. */
         int numOutFramesLeft = kwlEventInstance_getNumRemainingOutFrames(event, effectivePitch);
-        int maxOutFrameIdx = numFrames;
-        if (numOutFramesLeft < numFrames - outFrameIdx) 
+        int maxOutFrameIdx = numRenderFrames;
+        if (numOutFramesLeft < numRenderFrames - outFrameIdx) 
         {
             maxOutFrameIdx = outFrameIdx + numOutFramesLeft + (unitPitch == 0 ? 1 : 0);/*TODO: ugly*/
             endOfSourceBufferReached = 1;
@@ -353,65 +518,127 @@ int kwlEventInstance_render(kwlEventInstance* event,
         const float soundGain = event->definition_mixer->sound != NULL ? 
                                 event->definition_mixer->sound->gain : 1.0f;
         
-        /*This loop is where the actual mixing takes place.*/
-        //printf("about to mix event buffer, event->currentPCMFrameIndex %d, ep %f\n", event->currentPCMFrameIndex, effectivePitch);
+        /*
+         Mono sources, and stereo sources below full quality, are read once per frame 
+         as a mono sample that is mixed into both output channels.
+         */
+        const int mixMonoToStereo = targetBuffer != NULL && numOutChannels == 2 &&
+                                    (event->currentNumChannels == 1 || lodTier != KWL_VOICE_LOD_FULL);
         int ch;
-        for (ch = 0; ch < numOutChannels; ch++)
+        if (mixMonoToStereo)
+        {
+            outSampleIdx = outFrameIdx * 2;
+            const int maxOutSampleIdx = maxOutFrameIdx * 2;
+            srcSampleIdx = event->currentPCMFrameIndex * event->currentNumChannels;
+            pitchAccumulator = event->pitchAccumulator;
+            
+            const float gainScale = soundGain / 32767.0f;
+            float gains[2];
+            float gainIncrs[2];
+            for (ch = 0; ch < 2; ch++)
+            {
+                gains[ch] = gainScale * (rampStartGain[ch] + outFrameIdx * rampGainIncrPerFrame[ch]);
+                gainIncrs[ch] = gainScale * rampGainIncrPerFrame[ch];
+            }
+            
+            if (unitPitch)
+            {
+                kwlInt16MixToStereoWithGainRamp(event->currentPCMBuffer,
+                                                targetBuffer,
+                                                maxOutSampleIdx,
+                                                &srcSampleIdx,
+                                                event->currentNumChannels,
+                                                &outSampleIdx,
+                                                gains,
+                                                gainIncrs);
+            }
+            else
+            {
+                kwlInt16MixToStereoWithGainRampAndPitch(event->currentPCMBuffer,
+                                                        targetBuffer,
+                                                        maxOutSampleIdx,
+                                                        &srcSampleIdx,
+                                                        event->currentNumChannels,
+                                                        &outSampleIdx,
+                                                        gains,
+                                                        gainIncrs,
+                                                        effectivePitch,
+                                                        &pitchAccumulator);
+            }
+        }
+        
+        /*This loop is where the actual mixing takes place.*/
+        for (ch = 0; ch < numOutChannels && !mixMonoToStereo; ch++)
         { 
+            /*
+             There are 4 possible combinations of input and output channel counts to consider:
+             1. mono in, stereo out: both out channels read the mono channel, with their own gain.
+             2. stereo in, mono out: the right input channel gets ignored.
+             3. mono in, mono out and 4. stereo in, stereo out: require no special handling.
+             */
+            const int srcChannel = ch < event->currentNumChannels ? ch : 0;
+            const int gainIdx = ch < 2 ? ch : 1;
+            
             outSampleIdx = outFrameIdx * numOutChannels + ch;
             const int maxOutSampleIdx = maxOutFrameIdx * numOutChannels + ch;
-            srcSampleIdx = event->currentPCMFrameIndex * event->currentNumChannels + ch;
+            srcSampleIdx = event->currentPCMFrameIndex * event->currentNumChannels + srcChannel;
             pitchAccumulator = event->pitchAccumulator;
             
+            if (targetBuffer == NULL)
+            {
+                /*Nothing is audible, so just advance the read position as if mixing.*/
+                const int numFramesToAdvance = maxOutFrameIdx - outFrameIdx;
+                outSampleIdx += numFramesToAdvance * numOutChannels;
+                if (unitPitch)
+                {
+                    srcSampleIdx += numFramesToAdvance * event->currentNumChannels;
+                }
+                else
+                {
+                    const float srcFramePos = pitchAccumulator + numFramesToAdvance * effectivePitch;
+                    const int integerPart = (int)srcFramePos;
+                    srcSampleIdx += integerPart * event->currentNumChannels;
+                    pitchAccumulator = srcFramePos - integerPart;
+                }
+                break;
+            }
+            
+            /*The ramp gain at the first frame of this run, scaled to convert from 16 bit.*/
+            const float gainScale = soundGain / 32767.0f;
+            float gain = gainScale * (rampStartGain[gainIdx] + outFrameIdx * rampGainIncrPerFrame[gainIdx]);
+            const float gainIncr = gainScale * rampGainIncrPerFrame[gainIdx];
+            
             if (unitPitch)
             {
                 /*a simplified mix loop without pitch shifting*/
-                kwlInt16ToFloatWithGain(event->currentPCMBuffer, 
-                                        outBuffer,
+                kwlInt16MixWithGainRamp(event->currentPCMBuffer, 
+                                        targetBuffer,
                                         maxOutSampleIdx,                    
                                         &srcSampleIdx,
                                         event->currentNumChannels,
                                         &outSampleIdx, 
                                         numOutChannels, 
-                                        soundGain);
+                                        &gain,
+                                        gainIncr);
                 KWL_ASSERT(srcSampleIdx >= 0);
             }
             else
             {
-                kwlInt16ToFloatWithGainAndPitch(event->currentPCMBuffer, 
-                                                outBuffer,
+                kwlInt16MixWithGainRampAndPitch(event->currentPCMBuffer, 
+                                                targetBuffer,
                                                 maxOutSampleIdx,                    
                                                 &srcSampleIdx,
                                                 event->currentNumChannels,
                                                 &outSampleIdx, 
                                                 numOutChannels, 
-                                                soundGain,
+                                                &gain,
+                                                gainIncr,
                                                 effectivePitch,
                                                 &pitchAccumulator);
             }
             
-            /*There are 4 possible combinations of input and output channel counts to consider:*/
-
-            /*1. mono in, stereo out: copy left out to right out and break the loop after the first of two channels*/
-            if (event->currentNumChannels == 1 && numOutChannels == 2)
-            {
-                int i;
-                for (i = outFrameIdx * numOutChannels + ch; i < maxOutSampleIdx;)
-                {
-                    outBuffer[i + 1] = outBuffer[i];
-                    i += 2;
-                }
-                break;
-            }
-                        
-            /*2. stereo in, mono out*/
-            /*If the input is stereo, its right channel gets ignored.*/
-            
-            /*3. mono in, mono out*/
-            /*Requires no special handling.*/
-            
-            /*4. stereo in, stereo out*/
-            /*Requires no special handling.*/
+            /*Keep the source position in terms of the first channel of the frame.*/
+            srcSampleIdx -= srcChannel;
         }
         
         KWL_ASSERT(srcSampleIdx >= 0);
@@ -434,6 +661,11 @@ int kwlEventInstance_render(kwlEventInstance* event,
                 /*decode the next buffer*/
                 donePlaying = kwlDecoder_decodeNewBufferForEvent(event->decoder, event);
             }
+            else if (event->pushStream != NULL)
+            {
+                /*play the next run of frames queued by the application*/
+                donePlaying = kwlPushStream_pickNextBufferForEvent(event->pushStream, event, 0);
+            }
             else
             {
                 /*get another pcm buffer from the event's sound*/
@@ -442,10 +674,7 @@ int kwlEventInstance_render(kwlEventInstance* event,
             
             if (donePlaying != 0)
             {
-                /*the event finished playing, fill the remainder of the out buffer with zeros*/
-                kwlClearFloatBuffer(&outBuffer[outFrameIdx * numOutChannels], 
-                                    (numFrames - outFrameIdx) * numOutChannels);
-                
+                /*the event finished playing. nothing is mixed into the remainder of the buffer.*/
                 break;
             }
             else
@@ -457,44 +686,33 @@ int kwlEventInstance_render(kwlEventInstance* event,
         else
         {
             /* if we made it here the end of the out buffer must have been reached. */
-            KWL_ASSERT(outFrameIdx == numFrames);
+            KWL_ASSERT(outFrameIdx == numRenderFrames);
             endOfOutBufferReached = 1;
         }
     }
     
-    /*Feed final event output through the event DSP unit, if any.*/
-    kwlDSPUnit* dspUnit = (kwlDSPUnit*)event->dspUnit.valueMixer;
     if (dspUnit != NULL)
     {
-        (*dspUnit->dspCallback)(outBuffer,
+        /*Feed the event output through the event DSP unit, then apply
+          the gain ramp and mix the result into the out buffer.*/
+        (*dspUnit->dspCallback)(scratchBuffer,
                                 numOutChannels,
                                 numFrames, 
                                 dspUnit->data);
-    }
-    
-    /* Apply per buffer gain with ramps if necessary*/
-    {
-        float effectiveGain[2] = 
-        {
-            event->fadeGain * event->gainLeft.valueMixer,
-            event->fadeGain * event->gainRight.valueMixer
-        };
         
-        if (event->prevEffectiveGain[0] < 0.0f)
-        {
-            event->prevEffectiveGain[0] = effectiveGain[0];
-            event->prevEffectiveGain[1] = effectiveGain[1];
-        }
-        
-        kwlApplyGainRamp(outBuffer, 
+        kwlApplyGainRamp(scratchBuffer, 
                          numOutChannels, 
                          numFrames, 
                          event->prevEffectiveGain, 
                          effectiveGain);
         
-        event->prevEffectiveGain[0] = effectiveGain[0];
-        event->prevEffectiveGain[1] = effectiveGain[1];
+        kwlMixFloatBuffer(scratchBuffer, 
+                          outBuffer,
+                          numOutChannels * numFrames);
     }
     
+    event->prevEffectiveGain[0] = effectiveGain[0];
+    event->prevEffectiveGain[1] = effectiveGain[1];
+    
     return donePlaying;
 }
@@ -26,6 +26,7 @@ freely, subject to the following restrictions:
 
 /*! \file */ 
 
+#include "kwl_automation.h"
 #include "kwl_decoder.h"
 #include "kwl_eventdefinition.h"
 #include "kwl_synchronization.h"
@@ -60,6 +61,26 @@ typedef enum
     KWL_PLAY_LAST_BUFFER_AND_STOP_REQUESTED,
 } kwlEventPlaybackState;
     
+/**
+ * The quality levels an event instance can be rendered at. Quiet events
+ * are moved to cheaper tiers by the engine, see \c kwlEngine_setVoiceLODThresholds.
+ */
+typedef enum
+{
+    /** Every source channel is converted, pitched and mixed at the output rate. */
+    KWL_VOICE_LOD_FULL = 0,
+    /** Stereo sources are summed to mono, which is interpolated once and panned. */
+    KWL_VOICE_LOD_MONO,
+    /** Like \c KWL_VOICE_LOD_MONO, but rendered at half the output rate and upsampled per mix bus. */
+    KWL_VOICE_LOD_HALF_RATE,
+    /** 
+     * The event is silent and out of range of the listener. Its playback position advances
+     * but nothing is mixed. Only set when the spatial index is enabled, 
+     * see \c kwlEngine_setSpatialIndexCellSize.
+     */
+    KWL_VOICE_LOD_VIRTUAL
+} kwlVoiceLODTier;
+    
 /** 
  * An event instance.
  */
@@ -73,6 +94,14 @@ typedef struct kwlEventInstance
     kwlSharedFloat gainRight;
     /** The effective pitch value. */
     kwlSharedFloat pitch;
+    /** Automated linear gain, applied on top of the effective gain. */
+    kwlAutomation gainAutomation;
+    /** Automated pitch, applied on top of the effective pitch. */
+    kwlAutomation pitchAutomation;
+    /** Automated balance, applied on top of the effective gain. */
+    kwlAutomation balanceAutomation;
+    /** The \c kwlVoiceLODTier to render the event at. */
+    kwlSharedInt lodTier;
 
     
     
@@ -97,6 +126,11 @@ typedef struct kwlEventInstance
      * Is NULL when the event is not playing.
      */
     struct kwlDecoder* decoder;
+    /** 
+     * The ring buffer providing the event with audio data fed by the application. 
+     * Used for push stream events only, NULL otherwise.
+     */
+    struct kwlPushStream* pushStream;
 
     /** The x component of the event's position (only used for positional events).*/
     float positionX;
@@ -135,6 +169,18 @@ typedef struct kwlEventInstance
     char isPaused;
     /** Non-zero if this instance is associated with an event handle*/
     char isAssociatedWithHandle;
+    /** The index of this instance in the free list of its definition, or -1. Accessed only from the engine thread.*/
+    int freeListIndex;
+    /** The index of this instance in the steal heap of its definition, or -1. Accessed only from the engine thread.*/
+    int stealHeapIndex;
+    /** 
+     * The state of the random number generator of the event, used by its sound to pick audio 
+     * data and gain and pitch variations. Seeded by the engine when the event starts and then
+     * accessed only from the mixer thread.
+     */
+    unsigned int randomState;
+    /** The value of the engine's start counter when the event was last started. Accessed only from the engine thread.*/
+    unsigned int startOrder;
     /** The current playback state of the event. Accessed only from the mixer thread.*/
     kwlEventPlaybackState playbackState;
     /** Non-zero if the event is currently playing, zero otherwise. Accessed only from the engine thread.*/
@@ -144,6 +190,10 @@ typedef struct kwlEventInstance
     short* currentPCMBuffer;
     /** */
     char currentNumChannels;
+    /** The sample rate of the current audio buffer in Hz, or 0 if it matches the output rate.*/
+    int currentSampleRate;
+    /** The output sample rate of the mixer, set by the mixer when the event starts.*/
+    float outputSampleRate;
     /** The number of frames in the current audio buffer.*/
     int currentPCMBufferSize;
     /** The read position (ie current frame) in the current audio buffer.*/
@@ -155,8 +205,20 @@ typedef struct kwlEventInstance
     
     /** Used for the linked list of playing events in the buses of the mixer. Only accessed from the mixer thread. */
     struct kwlEventInstance* nextEvent_mixer;
-    /** Used for the linked list of playing events in the engine. Only accessed from the engine thread. */
+    /** Used for the doubly linked list of playing events in the engine. Only accessed from the engine thread. */
     struct kwlEventInstance* nextEvent_engine;
+    /** The previous event in the engine's list of playing events, letting events be removed in constant time. */
+    struct kwlEventInstance* prevEvent_engine;
+    /** The coordinates of the spatial index cell containing the event. Accessed only from the engine thread.*/
+    int gridCell[3];
+    /** The spatial index bucket of the event, or -1 if the event is not in the spatial index.*/
+    int gridBucket;
+    /** The next event in the same spatial index bucket.*/
+    struct kwlEventInstance* nextInGridBucket;
+    /** The previous event in the same spatial index bucket.*/
+    struct kwlEventInstance* prevInGridBucket;
+    /** Equals the engine's query stamp if the last spatial index query found the event to be in range.*/
+    unsigned int spatialQueryStamp;
     /** The current fade gain. Used for fading events in and out.*/
     float fadeGain;
     /** The fade gain increment per frame. Depends on the sample rate and the requested fade time. */
@@ -196,6 +258,13 @@ kwlError kwlEventInstance_createFreeformEventFromAudioData(kwlEventInstance** ev
                                                    kwlEventType type, 
                                                    const char* eventId);
     
+/** Creates a freeform event playing audio from a push stream of a given capacity and latency in frames.*/
+kwlError kwlEventInstance_createFreeformEventFromPushStream(kwlEventInstance** event, 
+                                                   int numChannels,
+                                                   int capacity,
+                                                   int latency,
+                                                   kwlEventType type);
+    
 /** */
 void kwlEventInstance_releaseFreeformEvent(kwlEventInstance* event);
     
@@ -208,12 +277,30 @@ void kwlEventInstance_releaseFreeformEvent(kwlEventInstance* event);
 int kwlEventInstance_getNumRemainingOutFrames(kwlEventInstance* event, float pitch);    
 
 /** 
- * 
+ * Mixes the next \c numFrames frames of an event into a buffer, applying the event gain 
+ * as a ramp from the gain of the previous buffer.
+ * @param event The event to render.
+ * @param outBuffer The buffer to add the event output to. If NULL, the event is
+ * advanced without producing any output, e.g because it is in a muted mix bus.
+ * @param halfRateBuffer A buffer of half the length of \c outBuffer that events at 
+ * \c KWL_VOICE_LOD_HALF_RATE are mixed into at half the output rate. If NULL, such 
+ * events are rendered at \c KWL_VOICE_LOD_MONO.
+ * @param scratchBuffer A buffer the size of \c outBuffer. Only used if the event 
+ * has a DSP unit attached, in which case the event is rendered here first.
+ * @param numOutChannels The number of channels of \c outBuffer.
+ * @param numFrames The number of frames to mix.
+ * @param numOutputRateFrames The duration of the buffer in frames at the mixer output rate, used
+ * to advance automation and fades. Differs from \c numFrames in mix buses with a lower sample rate.
+ * @param accumulatedBusPitch The pitch of the mix bus the event belongs to.
+ * @return Non-zero if the event finished playing, zero otherwise.
  */
 int kwlEventInstance_render(kwlEventInstance* event, 
                     float* outBuffer,
+                    float* halfRateBuffer,
+                    float* scratchBuffer,
                     const int numOutChannels,
                     const int numFrames,
+                    const int numOutputRateFrames,
                     float accumulatedBusPitch);
 
 #ifdef __cplusplus
@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "kwl_handletable.h"
+#include "kowalski.h"
+#include "kwl_memory.h"
+#include "kwl_assert.h"
+
+void kwlHandleTable_init(kwlHandleTable* table)
+{
+    table->slots = NULL;
+    table->size = 0;
+    table->firstFree = -1;
+    table->numItems = 0;
+}
+
+void kwlHandleTable_free(kwlHandleTable* table)
+{
+    if (table->slots != NULL)
+    {
+        KWL_FREE(table->slots);
+    }
+    kwlHandleTable_init(table);
+}
+
+/** Doubles the number of slots, adding the new slots to the free list.*/
+static int kwlHandleTable_grow(kwlHandleTable* table)
+{
+    if (table->size >= KWL_HANDLE_TABLE_MAX_SIZE)
+    {
+        return 0;
+    }
+    
+    const int newSize = table->size == 0 ? KWL_HANDLE_TABLE_INITIAL_SIZE : 2 * table->size;
+    kwlHandleTableSlot* newSlots = 
+        (kwlHandleTableSlot*)KWL_MALLOC(newSize * sizeof(kwlHandleTableSlot), "handle table slots");
+    if (table->slots != NULL)
+    {
+        kwlMemcpy(newSlots, table->slots, table->size * sizeof(kwlHandleTableSlot));
+        KWL_FREE(table->slots);
+    }
+    
+    /*Chain the new slots in index order, so they are handed out in that order.*/
+    int i;
+    for (i = table->size; i < newSize; i++)
+    {
+        newSlots[i].item = NULL;
+        newSlots[i].generation = 1;
+        newSlots[i].nextFree = i + 1 < newSize ? i + 1 : table->firstFree;
+    }
+    
+    table->firstFree = table->size;
+    table->slots = newSlots;
+    table->size = newSize;
+    return 1;
+}
+
+int kwlHandleTable_add(kwlHandleTable* table, void* item)
+{
+    KWL_ASSERT(item != NULL);
+    
+    if (table->firstFree < 0 && !kwlHandleTable_grow(table))
+    {
+        return KWL_INVALID_HANDLE;
+    }
+    
+    const int index = table->firstFree;
+    kwlHandleTableSlot* slot = &table->slots[index];
+    table->firstFree = slot->nextFree;
+    slot->nextFree = -1;
+    slot->item = item;
+    table->numItems++;
+    
+    return (slot->generation << KWL_HANDLE_TABLE_INDEX_BITS) | index;
+}
+
+void kwlHandleTable_removeAt(kwlHandleTable* table, int slotIndex)
+{
+    KWL_ASSERT(slotIndex >= 0 && slotIndex < table->size);
+    kwlHandleTableSlot* slot = &table->slots[slotIndex];
+    KWL_ASSERT(slot->item != NULL);
+    
+    slot->item = NULL;
+    /*Wrap around to 1, since zero would match handles with the generation bits cleared.*/
+    slot->generation++;
+    if (slot->generation >= (1 << KWL_HANDLE_TABLE_GENERATION_BITS))
+    {
+        slot->generation = 1;
+    }
+    
+    slot->nextFree = table->firstFree;
+    table->firstFree = slotIndex;
+    table->numItems--;
+}
+
+void* kwlHandleTable_remove(kwlHandleTable* table, int handle)
+{
+    void* item = kwlHandleTable_lookup(table, handle);
+    if (item != NULL)
+    {
+        kwlHandleTable_removeAt(table, handle & (KWL_HANDLE_TABLE_MAX_SIZE - 1));
+    }
+    return item;
+}
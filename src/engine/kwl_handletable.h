@@ -0,0 +1,130 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+#ifndef KWL__HANDLE_TABLE_H
+#define KWL__HANDLE_TABLE_H
+
+/*! \file */ 
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/** The number of low handle bits holding the slot index.*/
+#define KWL_HANDLE_TABLE_INDEX_BITS 20
+    
+/** The maximum number of items in a handle table.*/
+#define KWL_HANDLE_TABLE_MAX_SIZE (1 << KWL_HANDLE_TABLE_INDEX_BITS)
+    
+/** 
+ * The number of handle bits above the slot index holding the generation. The sign bit 
+ * is left clear, so valid handles are non-negative and never equal \c KWL_INVALID_HANDLE.
+ */
+#define KWL_HANDLE_TABLE_GENERATION_BITS 11
+    
+/** The number of slots allocated when the first item is added.*/
+#define KWL_HANDLE_TABLE_INITIAL_SIZE 16
+    
+/** A slot in a handle table.*/
+typedef struct kwlHandleTableSlot
+{
+    /** The item, or NULL if the slot is free.*/
+    void* item;
+    /** 
+     * Incremented every time the slot is freed, so that handles to the previous 
+     * item in the slot no longer match. Never zero.
+     */
+    int generation;
+    /** The index of the next free slot if this slot is free, otherwise -1.*/
+    int nextFree;
+} kwlHandleTableSlot;
+
+/**
+ * A slot map from integer handles to items. A handle packs a slot index with the 
+ * generation of the slot when the handle was issued, so lookups are a bounds check, 
+ * an array access and a generation comparison, and handles to removed items are 
+ * detected even after their slot has been reused. Free slots are kept in a free list
+ * and the slot array grows geometrically.
+ */
+typedef struct kwlHandleTable
+{
+    /** The slots.*/
+    kwlHandleTableSlot* slots;
+    /** The number of slots.*/
+    int size;
+    /** The index of the first free slot, or -1 if all slots are in use.*/
+    int firstFree;
+    /** The number of items in the table.*/
+    int numItems;
+} kwlHandleTable;
+
+/** */
+void kwlHandleTable_init(kwlHandleTable* table);
+
+/** Releases the slots of a table. The items are not freed.*/
+void kwlHandleTable_free(kwlHandleTable* table);
+
+/** 
+ * Adds an item to a table.
+ * @param table The table.
+ * @param item The item. Must not be NULL.
+ * @return The handle of the item, or \c KWL_INVALID_HANDLE if the table is full.
+ */
+int kwlHandleTable_add(kwlHandleTable* table, void* item);
+
+/** 
+ * Removes the item associated with a handle, invalidating the handle.
+ * @return The removed item, or NULL if the handle is not valid.
+ */
+void* kwlHandleTable_remove(kwlHandleTable* table, int handle);
+
+/** 
+ * Removes the item in a given slot, invalidating its handle. Lets callers 
+ * iterating over \c slots remove items without knowing their handles.
+ */
+void kwlHandleTable_removeAt(kwlHandleTable* table, int slotIndex);
+
+/** 
+ * Returns the item associated with a handle.
+ * @return The item, or NULL if the handle is not valid, e.g because the item has been removed.
+ */
+static inline void* kwlHandleTable_lookup(const kwlHandleTable* table, int handle)
+{
+    const int index = handle & (KWL_HANDLE_TABLE_MAX_SIZE - 1);
+    /*The generation check also rejects negative handles, since generations are positive.*/
+    if (index >= table->size || 
+        table->slots[index].generation != (handle >> KWL_HANDLE_TABLE_INDEX_BITS))
+    {
+        return NULL;
+    }
+    
+    return table->slots[index].item;
+}
+    
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__HANDLE_TABLE_H*/
@@ -31,6 +31,109 @@ freely, subject to the following restrictions:
 #include <fcntl.h>
 #endif
 
+/** Returns non-zero if the stream gets its data from a file.*/
+static int kwlInputStream_isFileStream(kwlInputStream* const stream)
+{
+    return stream->file != NULL && stream->buffer == NULL;
+}
+
+/** 
+ * Returns the position one past the last readable byte of a stream, 
+ * or -1 if the size of the stream is unknown.
+ */
+static int kwlInputStream_getEndPos(kwlInputStream* const stream)
+{
+    if (stream->size > 0)
+    {
+        return stream->offset + stream->size;
+    }
+    return -1;
+}
+
+/** 
+ * Moves the file position of a file stream to the read position, unless 
+ * the read position is within the read-ahead buffer. 
+ * @return The result of \c fseek, or zero if no seek was needed.
+ */
+static int kwlInputStream_syncFilePosition(kwlInputStream* const stream)
+{
+    if (stream->readPos >= stream->readAheadStart && 
+        stream->readPos <= stream->readAheadStart + stream->readAheadLength)
+    {
+        return 0;
+    }
+    
+    stream->readAheadStart = stream->readPos;
+    stream->readAheadLength = 0;
+    return fseek(stream->file, stream->readPos, SEEK_SET);
+}
+
+/** 
+ * Refills the read-ahead buffer of a file stream, starting at the current read position.
+ * Must only be called when all buffered data has been consumed. 
+ */
+static void kwlInputStream_fillReadAheadBuffer(kwlInputStream* const stream)
+{
+    KWL_ASSERT(stream->readPos == stream->readAheadStart + stream->readAheadLength);
+    
+    int bytesToRead = KWL_INPUT_STREAM_READ_AHEAD_SIZE;
+    const int endPos = kwlInputStream_getEndPos(stream);
+    if (endPos >= 0 && stream->readPos + bytesToRead > endPos)
+    {
+        bytesToRead = endPos - stream->readPos;
+    }
+    
+    stream->readAheadStart = stream->readPos;
+    stream->readAheadLength = 0;
+    if (bytesToRead > 0)
+    {
+        stream->readAheadLength = fread(stream->readAheadBuffer, 1, bytesToRead, stream->file);
+    }
+}
+
+/** 
+ * Returns a pointer to the next \c numBytes bytes of a stream and advances the read position, 
+ * if these bytes are available in memory. Otherwise, NULL is returned and the read position is
+ * left untouched. This is the fast path for small fixed size reads.
+ */
+static const unsigned char* kwlInputStream_getContiguousBytes(kwlInputStream* const stream, int numBytes)
+{
+    if (stream->buffer != NULL)
+    {
+        if (stream->readPos + numBytes > stream->offset + stream->size)
+        {
+            return NULL;
+        }
+        const unsigned char* bytes = &((const unsigned char*)stream->buffer)[stream->readPos];
+        stream->readPos += numBytes;
+        return bytes;
+    }
+    
+    if (stream->readAheadBuffer == NULL)
+    {
+        return NULL;
+    }
+    
+    if (stream->readPos + numBytes > stream->readAheadStart + stream->readAheadLength)
+    {
+        /*Refill if the buffer is exhausted. Reads straddling the end of the buffer take the slow path.*/
+        if (stream->readPos != stream->readAheadStart + stream->readAheadLength)
+        {
+            return NULL;
+        }
+        kwlInputStream_fillReadAheadBuffer(stream);
+        if (numBytes > stream->readAheadLength)
+        {
+            return NULL;
+        }
+    }
+    
+    const unsigned char* bytes = 
+        (const unsigned char*)&stream->readAheadBuffer[stream->readPos - stream->readAheadStart];
+    stream->readPos += numBytes;
+    return bytes;
+}
+
 void kwlInputStream_free(kwlInputStream* stream)
 {
     kwlInputStream_close(stream);
@@ -44,6 +147,9 @@ void kwlInputStream_init(kwlInputStream* stream)
     stream->offset = 0;
     stream->readPos = 0;
     stream->buffer = NULL;
+    stream->readAheadBuffer = NULL;
+    stream->readAheadStart = 0;
+    stream->readAheadLength = 0;
 }
 
 FILE* kwlInputStream_openFile(kwlInputStream* stream, const char* const path)
@@ -72,6 +178,11 @@ kwlError kwlInputStream_initWithFile(kwlInputStream* const stream, const char* c
     stream->offset = 0;
     stream->readPos = 0;
     stream->buffer = NULL;
+    /*if this allocation fails, all reads go straight to the file.*/
+    stream->readAheadBuffer = (signed char*)KWL_MALLOC(KWL_INPUT_STREAM_READ_AHEAD_SIZE, 
+                                                       "input stream read-ahead buffer");
+    stream->readAheadStart = stream->offset;
+    stream->readAheadLength = 0;
     fseek(stream->file, stream->offset, SEEK_SET);
      
     return KWL_NO_ERROR;
@@ -93,6 +204,10 @@ kwlError kwlInputStream_initWithFileRegion(kwlInputStream* const stream, const c
     stream->offset = offset;
     stream->readPos = offset;
     stream->buffer = NULL;
+    stream->readAheadBuffer = (signed char*)KWL_MALLOC(KWL_INPUT_STREAM_READ_AHEAD_SIZE, 
+                                                       "input stream read-ahead buffer");
+    stream->readAheadStart = stream->offset;
+    stream->readAheadLength = 0;
     fseek(stream->file, stream->offset, SEEK_SET);
 
     return KWL_NO_ERROR;
@@ -113,11 +228,10 @@ void kwlInputStream_initWithBuffer(kwlInputStream* const stream, void* buffer, i
 
 void kwlInputStream_skip(kwlInputStream* const stream, size_t size)
 {
-    if (stream->file != NULL && stream->buffer == NULL)
+    if (kwlInputStream_isFileStream(stream))
     {
-        KWL_ASSERT(stream->file != NULL);
-        fseek(stream->file, size, SEEK_CUR);
-        stream->readPos = ftell(stream->file);
+        stream->readPos += size;
+        kwlInputStream_syncFilePosition(stream);
     }
     else if (stream->file == NULL && stream->buffer != NULL)
     {
@@ -137,9 +251,10 @@ void kwlInputStream_skip(kwlInputStream* const stream, size_t size)
 /** */
 void kwlInputStream_reset(kwlInputStream* const stream)
 {
-    if (stream->file != NULL && stream->buffer == NULL)
+    if (kwlInputStream_isFileStream(stream))
     {
-        fseek(stream->file, stream->offset, SEEK_SET);
+        stream->readPos = stream->offset;
+        kwlInputStream_syncFilePosition(stream);
     }
     else if (stream->file == NULL && stream->buffer != NULL)
     {
@@ -154,11 +269,12 @@ void kwlInputStream_reset(kwlInputStream* const stream)
 
 int kwlInputStream_isAtEndOfStream(kwlInputStream* const stream)
 {
-    if (stream->file != NULL && stream->buffer == NULL)
+    if (kwlInputStream_isFileStream(stream))
     {
         if (stream->size < 0)
         {
-            return feof(stream->file);
+            return stream->readPos >= stream->readAheadStart + stream->readAheadLength &&
+                   feof(stream->file);
         }
         else 
         {
@@ -178,9 +294,9 @@ int kwlInputStream_isAtEndOfStream(kwlInputStream* const stream)
 
 int kwlInputStream_tell(kwlInputStream* const stream)
 {
-    if (stream->file != NULL && stream->buffer == NULL)
+    if (kwlInputStream_isFileStream(stream))
     {
-        return ftell(stream->file) - stream->offset;
+        return stream->readPos - stream->offset;
     }
     else if (stream->file == NULL && stream->buffer != NULL)
     {
@@ -196,36 +312,39 @@ int kwlInputStream_tell(kwlInputStream* const stream)
 
 int kwlInputStream_seek(kwlInputStream* const stream, long pos, int p)
 {
-    if (stream->file != NULL && stream->buffer == NULL)
+    if (kwlInputStream_isFileStream(stream))
     {
         if (p == SEEK_SET)
         {
             stream->readPos = stream->offset + pos;
-            return fseek(stream->file, stream->offset + pos, p);
         }
         else if (p == SEEK_CUR)
         {
-            return fseek(stream->file, pos, p);
+            stream->readPos += pos;
         }
         else if (p == SEEK_END)
         {
             if (stream->size < 0)
             {
-                /*if the size is unknown, assume we're getting data from a file*/
-                fseek(stream->file, pos, p);
+                /*if the size is unknown, assume we're getting data from a file 
+                  and let the file system find the end.*/
+                const int rc = fseek(stream->file, pos, p);
+                stream->readPos = ftell(stream->file);
+                stream->readAheadStart = stream->readPos;
+                stream->readAheadLength = 0;
+                return rc;
             }
             else
             {
-                /*if we're getting data from file region, first go to the end of the region...*/
-                fseek(stream->file, stream->offset + stream->size, SEEK_SET);
-                /*then seek relative to the current position (ie the end).*/
-                fseek(stream->file, pos, SEEK_CUR);
+                /*if we're getting data from file region, seek relative to the end of the region.*/
+                stream->readPos = stream->offset + stream->size + pos;
             }
         }        
         else
         {
             KWL_ASSERT(0);
         }
+        return kwlInputStream_syncFilePosition(stream);
     }
     else if (stream->file == NULL && stream->buffer != NULL)
     {
@@ -262,21 +381,58 @@ int kwlInputStream_seek(kwlInputStream* const stream, long pos, int p)
 
 int kwlInputStream_read(kwlInputStream* const stream, signed char* data, int length)
 {
-    if (stream->file != NULL && stream->buffer == NULL)
+    if (kwlInputStream_isFileStream(stream))
     {
         int bytesToRead = length;
         
         /*Don't read past the end of streams with a known size*/
-        if (stream->readPos + length > stream->offset + stream->size && 
-            stream->size > 0)
+        const int endPos = kwlInputStream_getEndPos(stream);
+        if (endPos >= 0 && stream->readPos + length > endPos)
         {
-            bytesToRead = stream->offset + stream->size - stream->readPos;
+            bytesToRead = endPos - stream->readPos;
             KWL_ASSERT(bytesToRead >= 0);
         }
         
-        /* File based stream.*/
-        int bytesRead = fread(data, 1, bytesToRead, stream->file);
-        stream->readPos += bytesRead;
+        /*Start with whatever is left in the read-ahead buffer...*/
+        int bytesRead = stream->readAheadStart + stream->readAheadLength - stream->readPos;
+        if (bytesRead > bytesToRead)
+        {
+            bytesRead = bytesToRead;
+        }
+        if (bytesRead > 0)
+        {
+            kwlMemcpy(data, &stream->readAheadBuffer[stream->readPos - stream->readAheadStart], bytesRead);
+            stream->readPos += bytesRead;
+        }
+        else
+        {
+            bytesRead = 0;
+        }
+        
+        const int bytesRemaining = bytesToRead - bytesRead;
+        if (bytesRemaining > 0)
+        {
+            if (stream->readAheadBuffer == NULL || bytesRemaining >= KWL_INPUT_STREAM_READ_AHEAD_SIZE)
+            {
+                /*...then read large blocks straight from the file...*/
+                const int fileBytesRead = fread(&data[bytesRead], 1, bytesRemaining, stream->file);
+                stream->readPos += fileBytesRead;
+                stream->readAheadStart = stream->readPos;
+                stream->readAheadLength = 0;
+                bytesRead += fileBytesRead;
+            }
+            else
+            {
+                /*...or small ones through the read-ahead buffer.*/
+                kwlInputStream_fillReadAheadBuffer(stream);
+                const int bufferedBytes = bytesRemaining < stream->readAheadLength ? 
+                                          bytesRemaining : stream->readAheadLength;
+                kwlMemcpy(&data[bytesRead], stream->readAheadBuffer, bufferedBytes);
+                stream->readPos += bufferedBytes;
+                bytesRead += bufferedBytes;
+            }
+        }
+        
         return bytesRead;
     }
     else if (stream->file == NULL && stream->buffer != NULL)
@@ -300,28 +456,41 @@ int kwlInputStream_read(kwlInputStream* const stream, signed char* data, int len
     }
 }
 
+/** Returns a pointer to the next \c numBytes bytes, going through \c scratch if they are not contiguous in memory.*/
+static const unsigned char* kwlInputStream_readFixedSize(kwlInputStream* const stream, 
+                                                         unsigned char* scratch, 
+                                                         int numBytes)
+{
+    const unsigned char* c = kwlInputStream_getContiguousBytes(stream, numBytes);
+    if (c == NULL)
+    {
+        int r = kwlInputStream_read(stream, (signed char*)scratch, numBytes);
+        KWL_ASSERT(r == numBytes);
+        c = scratch;
+    }
+    return c;
+}
+
 int kwlInputStream_readIntBE(kwlInputStream* const stream)
 {
-    signed char c[4];
-    int r = kwlInputStream_read(stream, c, 4);
-    KWL_ASSERT(r == 4);
-    const int ret = ((c[0] & 0xff) << 24) |
-                    ((c[1] & 0xff) << 16) |
-                    ((c[2] & 0xff) << 8) |
-                    ((c[3] & 0xff) << 0);
+    unsigned char scratch[4];
+    const unsigned char* c = kwlInputStream_readFixedSize(stream, scratch, 4);
+    const int ret = (int)(((unsigned int)c[0] << 24) |
+                          ((unsigned int)c[1] << 16) |
+                          ((unsigned int)c[2] << 8) |
+                          ((unsigned int)c[3] << 0));
     
     return ret;
 }
 
 int kwlInputStream_readIntLE(kwlInputStream* const stream)
 {
-    signed char c[4];
-    int r = kwlInputStream_read(stream, c, 4);
-    KWL_ASSERT(r == 4);
-    const int ret = ((c[3] & 0xff) << 24) |
-    ((c[2] & 0xff) << 16) |
-    ((c[1] & 0xff) << 8) |
-    ((c[0] & 0xff) << 0);
+    unsigned char scratch[4];
+    const unsigned char* c = kwlInputStream_readFixedSize(stream, scratch, 4);
+    const int ret = (int)(((unsigned int)c[3] << 24) |
+                          ((unsigned int)c[2] << 16) |
+                          ((unsigned int)c[1] << 8) |
+                          ((unsigned int)c[0] << 0));
     
     return ret;
 }
@@ -329,35 +498,22 @@ int kwlInputStream_readIntLE(kwlInputStream* const stream)
 
 float kwlInputStream_readFloatBE(kwlInputStream* const stream)
 {
-    signed char c[4];
-    int r = kwlInputStream_read(stream, c, 4);
-    KWL_ASSERT(r == 4);
-    int bits = ((c[0] & 0xff) << 24) |
-                ((c[1] & 0xff) << 16) |
-                ((c[2] & 0xff) << 8) |
-                ((c[3] & 0xff) << 0);
+    int bits = kwlInputStream_readIntBE(stream);
     
     return *((float*)(&bits));
 }
 
 float kwlInputStream_readFloatLE(kwlInputStream* const stream)
 {
-    signed char c[4];
-    int r = kwlInputStream_read(stream, c, 4);
-    KWL_ASSERT(r == 4);
-    int bits = ((c[3] & 0xff) << 24) |
-    ((c[2] & 0xff) << 16) |
-    ((c[1] & 0xff) << 8) |
-    ((c[0] & 0xff) << 0);
+    int bits = kwlInputStream_readIntLE(stream);
     
     return *((float*)(&bits));
 }
 
 short kwlInputStream_readShortBE(kwlInputStream* const stream)
 {    
-    signed char c[2];
-    int r = kwlInputStream_read(stream, c, 2);
-    KWL_ASSERT(r == 2);
+    unsigned char scratch[2];
+    const unsigned char* c = kwlInputStream_readFixedSize(stream, scratch, 2);
 
     short ret = (c[0] << 8) |
                 (c[1] << 0);
@@ -366,9 +522,8 @@ short kwlInputStream_readShortBE(kwlInputStream* const stream)
 
 short kwlInputStream_readShortLE(kwlInputStream* const stream)
 {    
-    signed char c[2];
-    int r = kwlInputStream_read(stream, c, 2);
-    KWL_ASSERT(r == 2);
+    unsigned char scratch[2];
+    const unsigned char* c = kwlInputStream_readFixedSize(stream, scratch, 2);
     
     short ret = (c[0] << 0) |
                 (c[1] << 8);
@@ -377,10 +532,77 @@ short kwlInputStream_readShortLE(kwlInputStream* const stream)
 
 char kwlInputStream_readChar(kwlInputStream* const stream)
 {    
-    signed char c;
-    int r = kwlInputStream_read(stream, &c, 1);
-    KWL_ASSERT(r == 1);
-    return c;
+    unsigned char scratch[1];
+    const unsigned char* c = kwlInputStream_readFixedSize(stream, scratch, 1);
+    return (char)c[0];
+}
+
+/** Returns non-zero if the host byte order is big endian.*/
+static int kwlInputStream_isHostBigEndian()
+{
+    const int one = 1;
+    return *((const char*)&one) == 0;
+}
+
+/** Reverses the byte order of each \c elementSize sized element in a buffer.*/
+static void kwlInputStream_swapBytes(void* values, int count, int elementSize)
+{
+    unsigned char* bytes = (unsigned char*)values;
+    int i;
+    if (elementSize == 4)
+    {
+        for (i = 0; i < count; i++)
+        {
+            unsigned char* c = &bytes[4 * i];
+            unsigned char t = c[0]; c[0] = c[3]; c[3] = t;
+            t = c[1]; c[1] = c[2]; c[2] = t;
+        }
+    }
+    else if (elementSize == 2)
+    {
+        for (i = 0; i < count; i++)
+        {
+            unsigned char* c = &bytes[2 * i];
+            unsigned char t = c[0]; c[0] = c[1]; c[1] = t;
+        }
+    }
+}
+
+/** Reads a number of values with a given size and byte order, converting them to the host byte order.*/
+static int kwlInputStream_readValues(kwlInputStream* const stream, 
+                                     void* values, 
+                                     int count, 
+                                     int elementSize, 
+                                     int isBigEndian)
+{
+    const int bytesRead = kwlInputStream_read(stream, (signed char*)values, count * elementSize);
+    const int valuesRead = bytesRead / elementSize;
+    KWL_ASSERT(valuesRead == count);
+    if (isBigEndian != kwlInputStream_isHostBigEndian())
+    {
+        kwlInputStream_swapBytes(values, valuesRead, elementSize);
+    }
+    return valuesRead;
+}
+
+int kwlInputStream_readIntsBE(kwlInputStream* const stream, int* values, int count)
+{
+    return kwlInputStream_readValues(stream, values, count, 4, 1);
+}
+
+int kwlInputStream_readIntsLE(kwlInputStream* const stream, int* values, int count)
+{
+    return kwlInputStream_readValues(stream, values, count, 4, 0);
+}
+
+int kwlInputStream_readShortsBE(kwlInputStream* const stream, short* values, int count)
+{
+    return kwlInputStream_readValues(stream, values, count, 2, 1);
+}
+
+int kwlInputStream_readShortsLE(kwlInputStream* const stream, short* values, int count)
+{
+    return kwlInputStream_readValues(stream, values, count, 2, 0);
 }
 
 /** */
@@ -391,16 +613,32 @@ char* kwlInputStream_readASCIIString(kwlInputStream* const stream)
     KWL_ASSERT(stringLength < 10000 && "sanity check");
     
     char* returnString = (char*)KWL_MALLOC((stringLength + 1) * sizeof(char), "kwlInputStream_readASCIIString");
-    kwlMemset(returnString, 0, (stringLength + 1) * sizeof(char));
-    int i;
-    for (i = 0; i < stringLength; i++)
+    const int bytesRead = kwlInputStream_read(stream, (signed char*)returnString, stringLength);
+    KWL_ASSERT(bytesRead == stringLength);
+    returnString[bytesRead > 0 ? bytesRead : 0] = '\0';
+    
+    return returnString;
+}
+
+int kwlInputStream_readASCIIStringToBuffer(kwlInputStream* const stream, char* buffer, int bufferSize)
+{
+    const int stringLength = kwlInputStream_readIntBE(stream);
+    KWL_ASSERT(stringLength > 0);
+    KWL_ASSERT(bufferSize > 0);
+    
+    if (stringLength >= bufferSize)
     {
-        returnString[i] = kwlInputStream_readChar(stream);
-        /*printf("char %d: %c", i, returnString[i]);*/
+        /*The string does not fit. Skip it so the stream stays in sync.*/
+        kwlInputStream_skip(stream, stringLength);
+        buffer[0] = '\0';
+        return -1;
     }
-    returnString[stringLength] = '\0';
     
-    return returnString;
+    const int bytesRead = kwlInputStream_read(stream, (signed char*)buffer, stringLength);
+    KWL_ASSERT(bytesRead == stringLength);
+    buffer[bytesRead > 0 ? bytesRead : 0] = '\0';
+    
+    return stringLength;
 }
 
 /** */
@@ -410,9 +648,16 @@ void kwlInputStream_close(kwlInputStream* const stream)
     {
         fclose(stream->file);
     }
+    if (stream->readAheadBuffer != NULL)
+    {
+        KWL_FREE(stream->readAheadBuffer);
+    }
     stream->size = 0;
     stream->offset = 0;
     stream->readPos = 0;
     stream->buffer = NULL;
     stream->file = NULL;
+    stream->readAheadBuffer = NULL;
+    stream->readAheadStart = 0;
+    stream->readAheadLength = 0;
 }
@@ -34,6 +34,12 @@ extern "C"
 {
 #endif /* __cplusplus */
 
+/** 
+ * The size in bytes of the read-ahead buffer of file streams. Reads smaller than this
+ * are served from the buffer, larger reads go straight to the file.
+ */
+#define KWL_INPUT_STREAM_READ_AHEAD_SIZE 4096
+
 /** 
  * A struct representing an input stream, getting its data from 
  * either a file or a buffer.
@@ -53,6 +59,15 @@ typedef struct kwlInputStream
     int offset;
     /** The current byte position, relative to the start of the underlying data. */
     int readPos;
+    /** 
+     * Data read ahead from the file of a file stream, or NULL. The file position
+     * always corresponds to the end of the valid data in this buffer.
+     */
+    signed char* readAheadBuffer;
+    /** The file position of the first byte in \c readAheadBuffer. */
+    int readAheadStart;
+    /** The number of valid bytes in \c readAheadBuffer. */
+    int readAheadLength;
 } kwlInputStream;
 
 void kwlInputStream_init(kwlInputStream* stream);
@@ -160,6 +175,17 @@ char kwlInputStream_readChar(kwlInputStream* const stream);
  */
 char* kwlInputStream_readASCIIString(kwlInputStream* const stream);
 
+/** 
+ * Reads an ASCII string (encoded as described in \c kwlInputStream_readASCIIString) into
+ * a caller provided buffer, without allocating any memory. If the string does not fit
+ * in the buffer, it is skipped and an empty string is stored in the buffer.
+ * @param stream The input stream to read from.
+ * @param buffer The buffer to store the null terminated string in.
+ * @param bufferSize The size of \c buffer in bytes, including space for the null terminator.
+ * @return The length of the read string, or -1 if the string did not fit in the buffer.
+ */
+int kwlInputStream_readASCIIStringToBuffer(kwlInputStream* const stream, char* buffer, int bufferSize);
+
 /** 
  * Reads an \c int (big endian byte order) from a given stream and advances the read position by four bytes. 
  * @param stream The input stream to read from.
@@ -167,6 +193,36 @@ char* kwlInputStream_readASCIIString(kwlInputStream* const stream);
  */
 int kwlInputStream_readIntBE(kwlInputStream* const stream);
 
+/** 
+ * Reads a number of \c ints (big endian byte order) from a given stream in one go.
+ * @param stream The input stream to read from.
+ * @param values The array to store the read values in. Must have room for \c count values.
+ * @param count The number of values to read.
+ * @return The number of values actually read.
+ */
+int kwlInputStream_readIntsBE(kwlInputStream* const stream, int* values, int count);
+
+/** 
+ * Reads a number of \c ints (little endian byte order) from a given stream in one go.
+ * @see kwlInputStream_readIntsBE
+ */
+int kwlInputStream_readIntsLE(kwlInputStream* const stream, int* values, int count);
+
+/** 
+ * Reads a number of \c shorts (big endian byte order) from a given stream in one go.
+ * @param stream The input stream to read from.
+ * @param values The array to store the read values in. Must have room for \c count values.
+ * @param count The number of values to read.
+ * @return The number of values actually read.
+ */
+int kwlInputStream_readShortsBE(kwlInputStream* const stream, short* values, int count);
+
+/** 
+ * Reads a number of \c shorts (little endian byte order) from a given stream in one go.
+ * @see kwlInputStream_readShortsBE
+ */
+int kwlInputStream_readShortsLE(kwlInputStream* const stream, short* values, int count);
+
 /** 
  * Reads an \c int (litte endian byte order) from a given stream and advances the read position by four bytes. 
  * @param stream The input stream to read from.
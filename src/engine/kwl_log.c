@@ -0,0 +1,172 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "kwl_log.h"
+#include "kwl_synchronization.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+/** A message in the log ring buffer.*/
+typedef struct kwlLogRecord
+{
+    /**
+     * The ring buffer position this slot is ready for, minus the slot index, which lets 
+     * the ring buffer start out zero initialized. A producer may claim the slot when this
+     * matches the write position, and the consumer may read it when it is one ahead of 
+     * the read position.
+     */
+    volatile int sequence;
+    /** The level of the message.*/
+    kwlLogLevel level;
+    /** The null terminated message.*/
+    char message[KWL_LOG_MAX_MESSAGE_LENGTH];
+} kwlLogRecord;
+
+kwlLogLevel kwlLog_level = KWL_LOG_LEVEL_WARNING;
+
+/** 
+ * A bounded lock-free multiple producer, single consumer queue of messages, 
+ * shared by all engine contexts.
+ */
+static kwlLogRecord ring[KWL_LOG_RING_SIZE];
+/** The next position to write to. Producers claim positions by incrementing it.*/
+static volatile int writePosition = 0;
+/** The next position to read from. Only accessed by the thread holding \c isDraining.*/
+static int readPosition = 0;
+/** Non-zero while a thread is draining the ring buffer.*/
+static volatile int isDraining = 0;
+/** The number of messages dropped because the ring buffer was full.*/
+static volatile int numDroppedMessages = 0;
+
+static kwlLogCallback logCallback = NULL;
+static void* logCallbackUserData = NULL;
+
+/** Returns the ring buffer position a slot is ready for.*/
+static int kwlLog_getSequence(int slotIndex)
+{
+    return kwlAtomicLoadAcquire(&ring[slotIndex].sequence) + slotIndex;
+}
+
+void kwlLog_write(kwlLogLevel level, const char* const format, ...)
+{
+    /*Claim a slot.*/
+    int position = kwlAtomicLoadAcquire(&writePosition);
+    kwlLogRecord* record = NULL;
+    while (record == NULL)
+    {
+        const int slotIndex = position & (KWL_LOG_RING_SIZE - 1);
+        /*Positions wrap around, so compare them by their difference.*/
+        const int difference = (int)((unsigned int)kwlLog_getSequence(slotIndex) - (unsigned int)position);
+        if (difference == 0)
+        {
+            if (kwlAtomicCompareAndSwap(&writePosition, position, position + 1))
+            {
+                record = &ring[slotIndex];
+            }
+            else
+            {
+                position = kwlAtomicLoadAcquire(&writePosition);
+            }
+        }
+        else if (difference < 0)
+        {
+            /*The ring buffer is full.*/
+            int numDropped = kwlAtomicLoadAcquire(&numDroppedMessages);
+            while (!kwlAtomicCompareAndSwap(&numDroppedMessages, numDropped, numDropped + 1))
+            {
+                numDropped = kwlAtomicLoadAcquire(&numDroppedMessages);
+            }
+            return;
+        }
+        else
+        {
+            /*Another producer claimed this position.*/
+            position = kwlAtomicLoadAcquire(&writePosition);
+        }
+    }
+    
+    va_list args;
+    va_start(args, format);
+    vsnprintf(record->message, KWL_LOG_MAX_MESSAGE_LENGTH, format, args);
+    va_end(args);
+    record->level = level;
+    
+    /*Publish the message to the consumer.*/
+    const int slotIndex = position & (KWL_LOG_RING_SIZE - 1);
+    kwlAtomicStoreRelease(&record->sequence, position + 1 - slotIndex);
+}
+
+void kwlLog_drain(void)
+{
+    if (!kwlAtomicCompareAndSwap(&isDraining, 0, 1))
+    {
+        return;
+    }
+    
+    for (;;)
+    {
+        const int slotIndex = readPosition & (KWL_LOG_RING_SIZE - 1);
+        if (kwlLog_getSequence(slotIndex) != readPosition + 1)
+        {
+            break;
+        }
+        
+        kwlLogRecord* record = &ring[slotIndex];
+        if (logCallback != NULL)
+        {
+            logCallback(record->level, record->message, logCallbackUserData);
+        }
+        else
+        {
+            printf("%s\n", record->message);
+        }
+        
+        /*Hand the slot back to the producers for the next lap.*/
+        kwlAtomicStoreRelease(&record->sequence, readPosition + KWL_LOG_RING_SIZE - slotIndex);
+        readPosition++;
+    }
+    
+    const int numDropped = kwlAtomicLoadAcquire(&numDroppedMessages);
+    if (numDropped > 0 && kwlAtomicCompareAndSwap(&numDroppedMessages, numDropped, 0))
+    {
+        char message[KWL_LOG_MAX_MESSAGE_LENGTH];
+        snprintf(message, KWL_LOG_MAX_MESSAGE_LENGTH, "%d log messages dropped", numDropped);
+        if (logCallback != NULL)
+        {
+            logCallback(KWL_LOG_LEVEL_WARNING, message, logCallbackUserData);
+        }
+        else
+        {
+            printf("%s\n", message);
+        }
+    }
+    
+    kwlAtomicStoreRelease(&isDraining, 0);
+}
+
+void kwlLog_setCallback(kwlLogCallback callback, void* userData)
+{
+    logCallback = callback;
+    logCallbackUserData = userData;
+}
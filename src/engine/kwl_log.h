@@ -0,0 +1,91 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+#ifndef KWL__LOG_H
+#define KWL__LOG_H
+
+/*! \file */ 
+
+#include "kowalski_ext.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/** 
+ * The most verbose level compiled into the engine. Messages above this level
+ * are removed at compile time regardless of the run time level.
+ */
+#ifndef KWL_LOG_MAX_LEVEL
+    #define KWL_LOG_MAX_LEVEL KWL_LOG_LEVEL_INFO
+#endif /*KWL_LOG_MAX_LEVEL*/
+
+/** The number of messages the log ring buffer holds. Must be a power of two.*/
+#define KWL_LOG_RING_SIZE 256
+
+/** The maximum length of a log message, including the terminating null character. Longer messages are truncated.*/
+#define KWL_LOG_MAX_MESSAGE_LENGTH 128
+
+/** 
+ * Logs a printf style message at a given level. The message is only formatted if the
+ * level is enabled, both at compile time and at run time.
+ */
+#define KWL_LOG(level, ...) \
+    do \
+    { \
+        if ((level) <= KWL_LOG_MAX_LEVEL && (level) <= kwlLog_level) \
+        { \
+            kwlLog_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define KWL_LOG_ERROR(...) KWL_LOG(KWL_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define KWL_LOG_WARNING(...) KWL_LOG(KWL_LOG_LEVEL_WARNING, __VA_ARGS__)
+#define KWL_LOG_INFO(...) KWL_LOG(KWL_LOG_LEVEL_INFO, __VA_ARGS__)
+#define KWL_LOG_DEBUG(...) KWL_LOG(KWL_LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/** The run time log level. Read without synchronization, so a new level may take a while to be seen by other threads.*/
+extern kwlLogLevel kwlLog_level;
+
+/**
+ * Formats a message and queues it in the log ring buffer without blocking, so it is safe
+ * to call from the mixer thread. If the ring buffer is full, the message is dropped.
+ * Use the \c KWL_LOG macros rather than calling this directly.
+ */
+void kwlLog_write(kwlLogLevel level, const char* const format, ...);
+
+/**
+ * Passes the queued messages to the log callback. Called from the engine thread
+ * at the end of every update. If another thread is already draining the ring buffer, 
+ * this call returns immediately.
+ */
+void kwlLog_drain(void);
+
+/** Sets the callback that receives log messages, or restores the default (printing to stdout) if \c callback is NULL.*/
+void kwlLog_setCallback(kwlLogCallback callback, void* userData);
+    
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__LOG_H*/
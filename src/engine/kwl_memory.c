@@ -37,54 +37,414 @@ void* kwlMemset(void* location, int value, size_t size)
     return memset(location, value, size);
 }
 
-void* kwlMalloc(size_t size)
+static void* kwlDefaultAllocate(size_t size, void* userData)
 {
+    (void)userData;
     return malloc(size);
 }
 
-void kwlFree(void* pointer)
+static void kwlDefaultDeallocate(void* pointer, void* userData)
 {
+    (void)userData;
     free(pointer);
 }
 
+static void* (*kwlAllocate)(size_t size, void* userData) = kwlDefaultAllocate;
+static void (*kwlDeallocate)(void* pointer, void* userData) = kwlDefaultDeallocate;
+static void* kwlAllocatorUserData = NULL;
+
+void kwlMemory_setAllocator(void* (*allocate)(size_t size, void* userData), 
+                            void (*deallocate)(void* pointer, void* userData),
+                            void* userData)
+{
+    if (allocate == NULL || deallocate == NULL)
+    {
+        kwlAllocate = kwlDefaultAllocate;
+        kwlDeallocate = kwlDefaultDeallocate;
+        kwlAllocatorUserData = NULL;
+        return;
+    }
+    
+    kwlAllocate = allocate;
+    kwlDeallocate = deallocate;
+    kwlAllocatorUserData = userData;
+}
+
+void* kwlMalloc(size_t size)
+{
+    return kwlAllocate(size, kwlAllocatorUserData);
+}
+
+void kwlFree(void* pointer)
+{
+    kwlDeallocate(pointer, kwlAllocatorUserData);
+}
+
+/** Rounds a size up to the nearest multiple of the arena alignment.*/
+static size_t kwlArena_align(size_t size)
+{
+    return (size + KWL_ARENA_ALIGNMENT - 1) & ~((size_t)KWL_ARENA_ALIGNMENT - 1);
+}
+
+void kwlArena_init(kwlArena* arena, size_t blockSize, const char* tag)
+{
+    arena->tag = tag;
+    arena->blockSize = blockSize;
+    arena->blocks = NULL;
+    arena->bytesUsed = 0;
+    arena->bytesReserved = 0;
+    arena->highWaterMark = 0;
+}
+
+void* kwlArena_alloc(kwlArena* arena, size_t size)
+{
+    const size_t headerSize = kwlArena_align(sizeof(kwlArenaBlock));
+    size = kwlArena_align(size > 0 ? size : 1);
+    
+    kwlArenaBlock* block = arena->blocks;
+    if (block == NULL || block->used + size > block->size)
+    {
+        /*The current block is full. Get a new one, big enough for oversized requests.*/
+        size_t blockSize = arena->blockSize > 0 ? arena->blockSize : KWL_ARENA_DEFAULT_BLOCK_SIZE;
+        if (size > blockSize)
+        {
+            blockSize = size;
+        }
+        
+        block = (kwlArenaBlock*)KWL_MALLOC(headerSize + blockSize, 
+                                           arena->tag != NULL ? arena->tag : "arena block");
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        block->size = blockSize;
+        block->used = 0;
+        
+        if (arena->blocks != NULL && size == blockSize && 
+            arena->blocks->used + KWL_ARENA_ALIGNMENT <= arena->blocks->size)
+        {
+            /*An oversized block that leaves no room for others. Keep the 
+              current block first so its free space is not wasted.*/
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        }
+        else
+        {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+        arena->bytesReserved += blockSize;
+    }
+    
+    void* ptr = (char*)block + headerSize + block->used;
+    block->used += size;
+    arena->bytesUsed += size;
+    if (arena->bytesUsed > arena->highWaterMark)
+    {
+        arena->highWaterMark = arena->bytesUsed;
+    }
+    
+    return ptr;
+}
+
+void kwlArena_reset(kwlArena* arena)
+{
+    kwlArenaBlock* first = arena->blocks;
+    if (first == NULL)
+    {
+        return;
+    }
+    
+    kwlArenaBlock* block = first->next;
+    while (block != NULL)
+    {
+        kwlArenaBlock* next = block->next;
+        arena->bytesReserved -= block->size;
+        KWL_FREE(block);
+        block = next;
+    }
+    
+    first->next = NULL;
+    first->used = 0;
+    arena->bytesUsed = 0;
+}
+
+void kwlArena_free(kwlArena* arena)
+{
+    kwlArenaBlock* block = arena->blocks;
+    while (block != NULL)
+    {
+        kwlArenaBlock* next = block->next;
+        KWL_FREE(block);
+        block = next;
+    }
+    
+    arena->blocks = NULL;
+    arena->bytesUsed = 0;
+    arena->bytesReserved = 0;
+}
+
 #ifdef KWL_DEBUG_MEMORY
-int liveBytes = 0;
-int totalBytes = 0;
-void* kwlDebugMalloc(size_t size, const char* const tag)
+
+#include "kwl_synchronization.h"
+#include <stdint.h>
+
+/** An entry in the hash map of live allocations. A NULL address marks a free slot.*/
+typedef struct kwlDebugAllocation
 {
-    KWL_ASSERT(size > 0 && "zero size allocation detected");
+    void* address;
+    size_t size;
+    /** The index of the entry in the tag table the allocation is accounted to.*/
+    int tagIndex;
+} kwlDebugAllocation;
+
+/** Aggregate statistics for all allocations sharing a tag.*/
+typedef struct kwlDebugTagStats
+{
+    char tag[KWL_DEBUG_ALLOCATION_TAG_SIZE];
+    unsigned int tagHash;
+    int isUsed;
+    size_t liveBytes;
+    int liveCount;
+    size_t totalBytes;
+    int totalCount;
+    size_t highWaterMark;
+    int mixerThreadCount;
+} kwlDebugTagStats;
+
+static kwlDebugAllocation allocationTable[KWL_DEBUG_ALLOCATION_TABLE_SIZE];
+static kwlDebugTagStats tagTable[KWL_DEBUG_ALLOCATION_TAG_TABLE_SIZE];
+/** Accounts for allocations whose tags did not fit in the tag table.*/
+static kwlDebugTagStats overflowTagStats;
+static int numLiveAllocations = 0;
+static size_t liveBytes = 0;
+static size_t totalBytes = 0;
+static size_t highWaterMark = 0;
+static int numMixerThreadAllocations = 0;
+
+/** 
+ * Guards all of the above. Initialized on first use, which may happen on several 
+ * threads at once since contexts can be created concurrently.
+ */
+static kwlMutexLock debugMemoryLock;
+static kwlOnceFlag debugMemoryLockOnceFlag = KWL_ONCE_FLAG_INIT;
+/** The mixer threads of all engine contexts. Guarded by the lock too.*/
+static kwlThreadId mixerThreadIds[KWL_DEBUG_MAX_NUM_MIXER_THREADS];
+static int numMixerThreadIds = 0;
+/** The slot to overwrite when a new mixer thread is marked and all slots are in use.*/
+static int nextMixerThreadIdSlot = 0;
+/** Non-zero if the calling thread has already been marked as a mixer thread.*/
+static KWL_THREAD_LOCAL int isMixerThreadRegistered = 0;
+
+static void kwlDebugInitLock(void)
+{
+    kwlMutexLockInit(&debugMemoryLock);
+}
+
+static void kwlDebugAcquireLock()
+{
+    kwlCallOnce(&debugMemoryLockOnceFlag, kwlDebugInitLock);
+    kwlMutexLockAcquire(&debugMemoryLock);
+}
+
+static unsigned int kwlDebugHashAddress(void* address)
+{
+    /*Low bits are mostly alignment, so mix in the higher ones.*/
+    uintptr_t value = (uintptr_t)address;
+    value ^= value >> 17;
+    value *= (uintptr_t)0x9e3779b97f4a7c15ULL;
+    value ^= value >> 29;
+    return (unsigned int)value;
+}
+
+static unsigned int kwlDebugHashTag(const char* tag)
+{
+    /*FNV-1a over at most the characters that are stored.*/
+    unsigned int hash = 2166136261u;
+    int i;
+    for (i = 0; i < KWL_DEBUG_ALLOCATION_TAG_SIZE - 1 && tag[i] != '\0'; i++)
+    {
+        hash ^= (unsigned char)tag[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/** Returns the stats for a given tag, adding an entry if needed. The lock must be held.*/
+static kwlDebugTagStats* kwlDebugGetTagStats(const char* tag, int* tagIndex)
+{
+    const unsigned int mask = KWL_DEBUG_ALLOCATION_TAG_TABLE_SIZE - 1;
+    const unsigned int hash = kwlDebugHashTag(tag);
+    unsigned int index = hash & mask;
+    int numProbes;
     
-    /*find a free slot in the allocation table*/
-    int allocationSlotIndex = -1;
+    for (numProbes = 0; numProbes < KWL_DEBUG_ALLOCATION_TAG_TABLE_SIZE / 2; numProbes++)
+    {
+        kwlDebugTagStats* stats = &tagTable[index];
+        if (!stats->isUsed)
+        {
+            int i;
+            for (i = 0; i < KWL_DEBUG_ALLOCATION_TAG_SIZE - 1 && tag[i] != '\0'; i++)
+            {
+                stats->tag[i] = tag[i];
+            }
+            stats->tag[i] = '\0';
+            stats->tagHash = hash;
+            stats->isUsed = 1;
+            *tagIndex = (int)index;
+            return stats;
+        }
+        if (stats->tagHash == hash && 
+            strncmp(stats->tag, tag, KWL_DEBUG_ALLOCATION_TAG_SIZE - 1) == 0)
+        {
+            *tagIndex = (int)index;
+            return stats;
+        }
+        index = (index + 1) & mask;
+    }
+    
+    *tagIndex = -1;
+    return &overflowTagStats;
+}
+
+/** Returns the slot holding a given address, or -1 if it is not tracked. The lock must be held.*/
+static int kwlDebugFindAllocation(void* address)
+{
+    const unsigned int mask = KWL_DEBUG_ALLOCATION_TABLE_SIZE - 1;
+    unsigned int index = kwlDebugHashAddress(address) & mask;
+    while (allocationTable[index].address != NULL)
+    {
+        if (allocationTable[index].address == address)
+        {
+            return (int)index;
+        }
+        index = (index + 1) & mask;
+    }
+    return -1;
+}
+
+/** 
+ * Clears a slot in the allocation map, shifting subsequent entries of the 
+ * probe sequence back so that no tombstones are needed. The lock must be held.
+ */
+static void kwlDebugRemoveAllocation(unsigned int index)
+{
+    const unsigned int mask = KWL_DEBUG_ALLOCATION_TABLE_SIZE - 1;
+    unsigned int next = (index + 1) & mask;
+    while (allocationTable[next].address != NULL)
+    {
+        const unsigned int home = kwlDebugHashAddress(allocationTable[next].address) & mask;
+        /*Move the entry into the hole if its home slot is not between the hole and the entry.*/
+        if (((next - home) & mask) >= ((next - index) & mask))
+        {
+            allocationTable[index] = allocationTable[next];
+            index = next;
+        }
+        next = (next + 1) & mask;
+    }
+    allocationTable[index].address = NULL;
+    allocationTable[index].size = 0;
+    allocationTable[index].tagIndex = -1;
+}
+
+/** Returns non-zero if a given thread has been marked as a mixer thread. The lock must be held.*/
+static int kwlDebugIsMixerThread(kwlThreadId threadId)
+{
     int i;
-    for (i = 0; i < KWL_DEBUG_ALLOCATION_TABLE_SIZE; i++)
+    for (i = 0; i < numMixerThreadIds; i++)
     {
-        if (kwlDebugAllocationAddresses[i] == NULL)
+        if (kwlThreadIdEquals(mixerThreadIds[i], threadId))
         {
-            allocationSlotIndex = i;
-            break;
+            return 1;
         }
     }
-    KWL_ASSERT(allocationSlotIndex >= 0 && "no free allocation table slots");
-    /*printf("size = %d\n", size);*/
-    /*allocate the block*/
-    void* ptr = malloc(size);
+    return 0;
+}
+
+void kwlDebugSetMixerThread()
+{
+    if (isMixerThreadRegistered)
+    {
+        return;
+    }
     
-    /*record the allocation*/
-    kwlDebugAllocationAddresses[allocationSlotIndex] = ptr;
-    for (i = 0; i < KWL_DEBUG_ALLOCATION_TAG_SIZE - 1; i++)
+    const kwlThreadId currentThreadId = kwlThreadGetCurrentId();
+    
+    kwlDebugAcquireLock();
+    if (!kwlDebugIsMixerThread(currentThreadId))
     {
-        kwlDebugAllocationTags[allocationSlotIndex][i] = tag[i];
-        if (tag[i] == '\0')
+        if (numMixerThreadIds < KWL_DEBUG_MAX_NUM_MIXER_THREADS)
         {
-            break;
+            mixerThreadIds[numMixerThreadIds++] = currentThreadId;
+        }
+        else
+        {
+            /*Assume the longest known thread belongs to a context that no longer renders.*/
+            mixerThreadIds[nextMixerThreadIdSlot] = currentThreadId;
+            nextMixerThreadIdSlot = (nextMixerThreadIdSlot + 1) % KWL_DEBUG_MAX_NUM_MIXER_THREADS;
         }
     }
-    kwlDebugAllocationTags[allocationSlotIndex][KWL_DEBUG_ALLOCATION_TAG_SIZE - 1] = '\0';
-    kwlDebugAllocationSizes[allocationSlotIndex] = size;
+    kwlMutexLockRelease(&debugMemoryLock);
+    isMixerThreadRegistered = 1;
+}
+
+void* kwlDebugMalloc(size_t size, const char* const tag)
+{
+    KWL_ASSERT(size > 0 && "zero size allocation detected");
+    
+    /*allocate the block*/
+    void* ptr = kwlMalloc(size);
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+    
+    kwlDebugAcquireLock();
+    
+    KWL_ASSERT(numLiveAllocations < KWL_DEBUG_ALLOCATION_TABLE_SIZE - 1 && 
+               "no free allocation table slots");
+    
+    /*record the allocation*/
+    int tagIndex;
+    kwlDebugTagStats* stats = kwlDebugGetTagStats(tag, &tagIndex);
+    
+    const unsigned int mask = KWL_DEBUG_ALLOCATION_TABLE_SIZE - 1;
+    unsigned int index = kwlDebugHashAddress(ptr) & mask;
+    while (allocationTable[index].address != NULL)
+    {
+        KWL_ASSERT(allocationTable[index].address != ptr && "address allocated twice");
+        index = (index + 1) & mask;
+    }
+    allocationTable[index].address = ptr;
+    allocationTable[index].size = size;
+    allocationTable[index].tagIndex = tagIndex;
+    numLiveAllocations++;
+    
+    stats->liveBytes += size;
+    stats->liveCount++;
+    stats->totalBytes += size;
+    stats->totalCount++;
+    if (stats->liveBytes > stats->highWaterMark)
+    {
+        stats->highWaterMark = stats->liveBytes;
+    }
+    
     liveBytes += size;
     totalBytes += size;
-    /*printf("malloc: live bytes = %d\n", liveBytes);*/
+    if (liveBytes > highWaterMark)
+    {
+        highWaterMark = liveBytes;
+    }
+    
+    /*the mixer thread must not allocate, flag it if it does.*/
+    if (kwlDebugIsMixerThread(kwlThreadGetCurrentId()))
+    {
+        stats->mixerThreadCount++;
+        numMixerThreadAllocations++;
+    }
+    
+    kwlMutexLockRelease(&debugMemoryLock);
+    
     /*return a pointer to the allocated block*/
     return ptr;
 }
@@ -93,61 +453,97 @@ void kwlDebugFree(void* pointer)
 {
     KWL_ASSERT(pointer != NULL && "warning: freeing null pointer");
     
+    kwlDebugAcquireLock();
+    
     /*record the deletion*/
-    int allocationSlotIndex = -1;
-    int i;
-    for (i = 0; i < KWL_DEBUG_ALLOCATION_TABLE_SIZE; i++)
-    {
-        if (kwlDebugAllocationAddresses[i] == pointer)
-        {
-            allocationSlotIndex = i;
-            break;
-        }
-    }
+    const int allocationSlotIndex = kwlDebugFindAllocation(pointer);
     /*no matching slot found. this means that this is a double free
       or that the given address points to a block of memory that was
       not allocated using KWL_ALLOC.*/
     KWL_ASSERT(allocationSlotIndex >= 0 && "double free?");
-    
-    /*clear the allocation table entry*/
-    kwlDebugAllocationAddresses[allocationSlotIndex] = NULL;
-    for (i = 0; i < KWL_DEBUG_ALLOCATION_TAG_SIZE; i++)
+    if (allocationSlotIndex < 0)
     {
-        kwlDebugAllocationTags[allocationSlotIndex][i] = '\0';
+        kwlMutexLockRelease(&debugMemoryLock);
+        return;
     }
     
-    liveBytes -= kwlDebugAllocationSizes[allocationSlotIndex];
-    /*printf("free: live bytes = %d\n", liveBytes);*/
+    const kwlDebugAllocation* allocation = &allocationTable[allocationSlotIndex];
+    kwlDebugTagStats* stats = allocation->tagIndex >= 0 ? 
+                              &tagTable[allocation->tagIndex] : &overflowTagStats;
+    stats->liveBytes -= allocation->size;
+    stats->liveCount--;
+    liveBytes -= allocation->size;
+    numLiveAllocations--;
+    
+    kwlDebugRemoveAllocation((unsigned int)allocationSlotIndex);
+    
+    kwlMutexLockRelease(&debugMemoryLock);
+    
     /*free the memory block*/
-    free(pointer);
+    kwlFree(pointer);
 }
 
 int kwlDebugGetLiveBytes()
 {
-    return liveBytes;
+    return (int)liveBytes;
 }
 
 int kwlDebugGetTotalBytes()
 {
-    return totalBytes;
+    return (int)totalBytes;
 }
 
+int kwlDebugGetHighWaterMark()
+{
+    return (int)highWaterMark;
+}
+
+int kwlDebugGetNumMixerThreadAllocations()
+{
+    return numMixerThreadAllocations;
+}
+
+static void kwlDebugPrintTagStats(const kwlDebugTagStats* stats, const char* tag)
+{
+    printf("%s: %d live (%d bytes), %d total (%d bytes), peak %d bytes", 
+           tag,
+           stats->liveCount, (int)stats->liveBytes,
+           stats->totalCount, (int)stats->totalBytes,
+           (int)stats->highWaterMark);
+    if (stats->mixerThreadCount > 0)
+    {
+        printf(", %d ON MIXER THREAD", stats->mixerThreadCount);
+    }
+    printf("\n");
+}
 
 void kwlDebugPrintAllocationReport()
 {
-    printf("Live allocations, %d bytes total :\n", liveBytes);
+    kwlDebugAcquireLock();
+    
+    printf("Live allocations, %d bytes total (%d allocations), peak %d bytes :\n", 
+           (int)liveBytes, numLiveAllocations, (int)highWaterMark);
     printf("-----------------------------------------\n");
     int i;
-    for (i = 0; i < KWL_DEBUG_ALLOCATION_TABLE_SIZE; i++)
+    for (i = 0; i < KWL_DEBUG_ALLOCATION_TAG_TABLE_SIZE; i++)
     {
-        if (kwlDebugAllocationAddresses[i] != NULL)
+        if (tagTable[i].isUsed && (tagTable[i].liveCount > 0 || tagTable[i].mixerThreadCount > 0))
         {
-            printf("%s (%d bytes)\n", &kwlDebugAllocationTags[i][0], kwlDebugAllocationSizes[i]);
+            kwlDebugPrintTagStats(&tagTable[i], tagTable[i].tag);
         }
     }
+    if (overflowTagStats.totalCount > 0)
+    {
+        kwlDebugPrintTagStats(&overflowTagStats, "(other tags)");
+    }
+    if (numMixerThreadAllocations > 0)
+    {
+        printf("warning: %d allocations made from the mixer thread\n", numMixerThreadAllocations);
+    }
     printf("-----------------------------------------\n");
+    
+    kwlMutexLockRelease(&debugMemoryLock);
 }
 #else
 
 #endif /*KWL_DEBUG_MEMORY*/
-
@@ -37,9 +37,82 @@ extern "C"
 void* kwlMemcpy(void* to, const void* from, size_t size);
 /** */
 void* kwlMemset(void* location, int value, size_t size);
+/** Allocates a block of memory using the current backing allocator. */
 void* kwlMalloc(size_t size);
+/** Frees a block of memory allocated using \c kwlMalloc. */
 void kwlFree(void* pointer);
 
+/** 
+ * Sets the backing allocator used by \c kwlMalloc and \c kwlFree. Passing NULL 
+ * callbacks restores the default allocator (malloc and free).
+ * Must not be called while there are live allocations.
+ */
+void kwlMemory_setAllocator(void* (*allocate)(size_t size, void* userData), 
+                            void (*deallocate)(void* pointer, void* userData),
+                            void* userData);
+
+/** The alignment in bytes of blocks returned by \c kwlArena_alloc. */
+#define KWL_ARENA_ALIGNMENT 16
+
+/** The default size in bytes of the blocks an arena allocates from its backing allocator. */
+#define KWL_ARENA_DEFAULT_BLOCK_SIZE 16384
+
+/** A block of memory owned by an arena.*/
+typedef struct kwlArenaBlock
+{
+    /** The next (older) block, or NULL.*/
+    struct kwlArenaBlock* next;
+    /** The usable size of the block in bytes, excluding the header.*/
+    size_t size;
+    /** The number of bytes handed out from this block.*/
+    size_t used;
+} kwlArenaBlock;
+
+/**
+ * A linear allocator for memory sharing a lifetime, e.g engine data or per wave bank data.
+ * Allocations are individually never freed. Instead, all memory is released in one go by 
+ * \c kwlArena_reset or \c kwlArena_free. A zero initialized arena is valid and empty.
+ */
+typedef struct kwlArena
+{
+    /** The tag used for allocations from the backing allocator.*/
+    const char* tag;
+    /** The minimum size of blocks requested from the backing allocator.*/
+    size_t blockSize;
+    /** The most recently allocated block, or NULL.*/
+    kwlArenaBlock* blocks;
+    /** The number of bytes handed out since the last reset.*/
+    size_t bytesUsed;
+    /** The total size of all blocks owned by the arena.*/
+    size_t bytesReserved;
+    /** The highest value of \c bytesUsed seen so far.*/
+    size_t highWaterMark;
+} kwlArena;
+
+/** 
+ * Initializes an arena.
+ * @param arena The arena to initialize.
+ * @param blockSize The minimum size of blocks to request from the backing allocator. 
+ * Zero selects \c KWL_ARENA_DEFAULT_BLOCK_SIZE.
+ * @param tag A string identifying the arena in allocation reports.
+ */
+void kwlArena_init(kwlArena* arena, size_t blockSize, const char* tag);
+
+/** 
+ * Allocates a block of memory from an arena. The memory is not initialized.
+ * @return A pointer to a block of at least \c size bytes, aligned to \c KWL_ARENA_ALIGNMENT.
+ */
+void* kwlArena_alloc(kwlArena* arena, size_t size);
+
+/** 
+ * Invalidates all allocations made from an arena. The most recently allocated 
+ * block is kept for reuse and the rest are released.
+ */
+void kwlArena_reset(kwlArena* arena);
+
+/** Invalidates all allocations made from an arena and releases all its memory.*/
+void kwlArena_free(kwlArena* arena);
+
 
 #ifndef KWL_DEBUG_MEMORY
 
@@ -63,21 +136,32 @@ void kwlFree(void* pointer);
 
 #define KWL_MALLOC(size, tag) kwlDebugMalloc(size, tag)
 #define KWL_FREE(ptr) kwlDebugFree(ptr)
-/** The size of the debug allocation tracking table.*/
-#define KWL_DEBUG_ALLOCATION_TABLE_SIZE 1000
-/** The max length of an allocation tag.*/
-#define KWL_DEBUG_ALLOCATION_TAG_SIZE 50
-    
-/** A table of memory locations associated with individual calls to KWL_MALLOC.*/
-void* kwlDebugAllocationAddresses[KWL_DEBUG_ALLOCATION_TABLE_SIZE];
+#ifndef KWL_DEBUG_ALLOCATION_TABLE_SIZE
+/** 
+ * The capacity of the hash map tracking live allocations. Must be a power of two. 
+ * Lookups degrade as the map fills up, so keep it well above the expected number
+ * of live allocations.
+ */
+#define KWL_DEBUG_ALLOCATION_TABLE_SIZE 65536
+#endif /*KWL_DEBUG_ALLOCATION_TABLE_SIZE*/
     
-/** A table of block sizes associated with individual calls to KWL_MALLOC.*/
-int kwlDebugAllocationSizes[KWL_DEBUG_ALLOCATION_TABLE_SIZE];
+#ifndef KWL_DEBUG_ALLOCATION_TAG_TABLE_SIZE
+/** 
+ * The capacity of the table of per tag statistics. Must be a power of two. 
+ * Allocations with tags that do not fit are accounted to a shared overflow entry.
+ */
+#define KWL_DEBUG_ALLOCATION_TAG_TABLE_SIZE 512
+#endif /*KWL_DEBUG_ALLOCATION_TAG_TABLE_SIZE*/
+
+#ifndef KWL_DEBUG_MAX_NUM_MIXER_THREADS
+/** The maximum number of mixer threads, one per engine context, tracked by the debug allocator.*/
+#define KWL_DEBUG_MAX_NUM_MIXER_THREADS 16
+#endif /*KWL_DEBUG_MAX_NUM_MIXER_THREADS*/
     
-/** A table of tags associated with individual calls to KWL_MALLOC.*/
-char kwlDebugAllocationTags[KWL_DEBUG_ALLOCATION_TABLE_SIZE][KWL_DEBUG_ALLOCATION_TAG_SIZE];
+/** The max length of an allocation tag.*/
+#define KWL_DEBUG_ALLOCATION_TAG_SIZE 50
     
-/** Prints all recorded allocations that have not been deleted.*/    
+/** Prints all tags with live allocations along with aggregate statistics.*/    
 void kwlDebugPrintAllocationReport();
     
 /** Returns the number of currently allocated bytes.*/    
@@ -85,6 +169,21 @@ int kwlDebugGetLiveBytes();
     
 /** Returns the total number of bytes allocated in this run, including freed blocks.*/    
 int kwlDebugGetTotalBytes();
+
+/** Returns the highest number of simultaneously allocated bytes seen in this run.*/    
+int kwlDebugGetHighWaterMark();
+    
+/** Returns the number of allocations made from the mixer thread in this run.*/    
+int kwlDebugGetNumMixerThreadAllocations();
+    
+/** 
+ * Marks the calling thread as a mixer thread. Subsequent allocations from this thread 
+ * are counted and reported, since mixer threads must not allocate. Each engine context
+ * has its own mixer thread, and up to \c KWL_DEBUG_MAX_NUM_MIXER_THREADS are tracked at once.
+ * Device hosts call this from their audio callbacks. Only the first call on a thread
+ * takes the debug lock, later calls return immediately.
+ */
+void kwlDebugSetMixerThread();
     
 /** Allocates a block of memory and records the allocation. */
 void* kwlDebugMalloc(size_t size, const char* const tag);
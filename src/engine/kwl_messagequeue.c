@@ -70,6 +70,59 @@ int kwlMessageQueue_addMessageWithParam(kwlMessageQueue* queue, kwlMessageType t
     queue->messages[queue->numMessages].type = type;
     queue->messages[queue->numMessages].data = data;
     queue->messages[queue->numMessages].param = param;
+    queue->messages[queue->numMessages].frame = KWL_UNSCHEDULED;
     queue->numMessages++;
     return 1;
 }
+
+int kwlMessageQueue_addScheduledMessage(kwlMessageQueue* queue, kwlMessageType type, 
+                                        void* data, float param, long long frame)
+{
+    if (kwlMessageQueue_addMessageWithParam(queue, type, data, param) == 0)
+    {
+        return 0;
+    }
+    
+    queue->messages[queue->numMessages - 1].frame = frame;
+    return 1;
+}
+
+int kwlMessageQueue_insertSorted(kwlMessageQueue* queue, const kwlMessage* message)
+{
+    if (queue->numMessages >= queue->maxQueueSize)
+    {
+        return 0;
+    }
+    
+    /*Find the first message scheduled later than the inserted one.*/
+    int lo = 0;
+    int hi = queue->numMessages;
+    while (lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        if (queue->messages[mid].frame <= message->frame)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    
+    memmove(&queue->messages[lo + 1], 
+            &queue->messages[lo], 
+            (queue->numMessages - lo) * sizeof(kwlMessage));
+    queue->messages[lo] = *message;
+    queue->numMessages++;
+    return 1;
+}
+
+void kwlMessageQueue_removeMessage(kwlMessageQueue* queue, int index)
+{
+    KWL_ASSERT(index >= 0 && index < queue->numMessages);
+    memmove(&queue->messages[index], 
+            &queue->messages[index + 1], 
+            (queue->numMessages - index - 1) * sizeof(kwlMessage));
+    queue->numMessages--;
+}
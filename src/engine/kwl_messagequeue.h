@@ -40,6 +40,9 @@ extern "C"
  */
 #define KWL_MESSAGE_QUEUE_SIZE 500
 
+/** The frame of messages that should be processed as soon as they are received.*/
+#define KWL_UNSCHEDULED -1LL
+
 /**
  * An enumeration of valid types for messages sent between the mixer and engine threads.
  */
@@ -87,6 +90,11 @@ typedef struct
     void* data;
     /** An optional parameter assocaited with the message.*/
     float param;
+    /** 
+     * The frame on the mixer sample clock at which the message should be processed,
+     * or \c KWL_UNSCHEDULED.
+     */
+    long long frame;
 } kwlMessage;
 
 /**
@@ -128,6 +136,23 @@ void kwlMessageQueue_flushTo(kwlMessageQueue* srcQueue, kwlMessageQueue* destQue
 int kwlMessageQueue_addMessage(kwlMessageQueue* queue, kwlMessageType type, void* data);
     
 int kwlMessageQueue_addMessageWithParam(kwlMessageQueue* queue, kwlMessageType type, void* data, float param);
+
+/** 
+ * Adds a message that should be processed at a given frame on the mixer sample clock.
+ * @return A non zero integer if the message was successfully added or zero if the target queue is full.
+ */
+int kwlMessageQueue_addScheduledMessage(kwlMessageQueue* queue, kwlMessageType type, 
+                                        void* data, float param, long long frame);
+
+/** 
+ * Inserts a copy of a scheduled message into a queue kept sorted by frame. Messages 
+ * scheduled for the same frame keep the order they were inserted in.
+ * @return A non zero integer if the message was successfully inserted or zero if the queue is full.
+ */
+int kwlMessageQueue_insertSorted(kwlMessageQueue* queue, const kwlMessage* message);
+
+/** Removes the message at a given index, preserving the order of the remaining messages.*/
+void kwlMessageQueue_removeMessage(kwlMessageQueue* queue, int index);
     
 #ifdef __cplusplus
 }
@@ -22,9 +22,11 @@ freely, subject to the following restrictions:
 */
 
 #include "kwl_asm.h"
+#include "kwl_dspunit.h"
 #include "kwl_eventinstance.h"
 #include "kwl_memory.h"
 #include "kwl_mixbus.h"
+#include "kwl_rateconverter.h"
 #include "kwl_sound.h"
 
 kwlMixBus* kwlMixBus_alloc()
@@ -59,6 +61,11 @@ void kwlMixBus_init(kwlMixBus* mixBus)
     mixBus->mixPresetGainRight = 1.0f;
     mixBus->mixPresetPitch = 1.0f;
     
+    kwlAutomation_init(&mixBus->gainAutomation, 1.0f);
+    kwlAutomation_init(&mixBus->pitchAutomation, 1.0f);
+    mixBus->prevAccumulatedGain[0] = -1.0f;
+    mixBus->prevAccumulatedGain[1] = -1.0f;
+    
     mixBus->isMaster = 0;
     
     mixBus->numSubBuses = 0;
@@ -74,6 +81,59 @@ void kwlMixBus_dealloc(kwlMixBus* mixBus)
     KWL_FREE(mixBus);
 }
 
+/** Adds a given number of active nodes to a bus and all its ancestors.*/
+static void kwlMixBus_changeNumActiveNodes(kwlMixBus* bus, int delta)
+{
+    while (bus != NULL)
+    {
+        bus->numActiveNodes += delta;
+        KWL_ASSERT(bus->numActiveNodes >= 0);
+        if (bus->numActiveNodes == 0)
+        {
+            /*The bus is skipped from now on, so there is no gain to ramp from when it wakes up.*/
+            bus->prevAccumulatedGain[0] = -1.0f;
+            bus->prevAccumulatedGain[1] = -1.0f;
+            bus->halfRateHistory[0] = 0.0f;
+            bus->halfRateHistory[1] = 0.0f;
+        }
+        bus = bus->parent;
+    }
+}
+
+/** Stops processing the DSP tail of a bus, if it is running.*/
+static void kwlMixBus_endDSPTail(kwlMixBus* bus)
+{
+    if (bus->isDSPTailActive)
+    {
+        bus->isDSPTailActive = 0;
+        bus->dspTailFramesLeft = 0;
+        kwlMixBus_changeNumActiveNodes(bus, -1);
+    }
+}
+
+/** Returns non-zero if a DSP unit has to be processed on every buffer.*/
+static int kwlMixBus_hasUnknownTail(kwlDSPUnit* dspUnit)
+{
+    return dspUnit != NULL && dspUnit->tailLengthInFrames < 0;
+}
+
+void kwlMixBus_setMixerDSPUnit(kwlMixBus* bus, void* dspUnitVoid)
+{
+    kwlDSPUnit* dspUnit = (kwlDSPUnit*)dspUnitVoid;
+    kwlDSPUnit* prevDSPUnit = (kwlDSPUnit*)bus->dspUnit.valueMixer;
+    if (dspUnit == prevDSPUnit)
+    {
+        return;
+    }
+    
+    /*A tail belongs to the DSP unit that produced it.*/
+    kwlMixBus_endDSPTail(bus);
+    
+    kwlMixBus_changeNumActiveNodes(bus, kwlMixBus_hasUnknownTail(dspUnit) - 
+                                        kwlMixBus_hasUnknownTail(prevDSPUnit));
+    bus->dspUnit.valueMixer = dspUnit;
+}
+
 void kwlMixBus_addEvent(kwlMixBus* bus, kwlEventInstance* event)
 {
     /*printf("adding event %d to bus %s\n", (int)event, bus->id);
@@ -91,22 +151,21 @@ void kwlMixBus_addEvent(kwlMixBus* bus, kwlEventInstance* event)
     
     KWL_ASSERT(event->nextEvent_mixer == NULL && "event to add already has event(s) attached to it");
         
-    kwlEventInstance* eventi = bus->eventList;
-    if (eventi == NULL)
+    if (bus->eventListTail == NULL)
     {
         /*The list is empty. Make the incoming event the first item.*/
         bus->eventList = event;
     }
     else
     {
-        /*Find the last event in the list...*/
-        while (eventi->nextEvent_mixer != NULL)
-        {
-            eventi = eventi->nextEvent_mixer;
-        }
-        /*...and attach the new event to it*/
-        eventi->nextEvent_mixer = event;
+        /*Attach the new event to the last one.*/
+        bus->eventListTail->nextEvent_mixer = event;
     }
+    bus->eventListTail = event;
+    
+    /*The event feeds the DSP unit now, so any running tail is no longer separate from it.*/
+    kwlMixBus_endDSPTail(bus);
+    kwlMixBus_changeNumActiveNodes(bus, 1);
     
     /*printf("    event list after:\n");
     tempEvent = bus->eventList;
@@ -138,8 +197,15 @@ void kwlMixBus_removeEvent(kwlMixBus* bus, kwlEventInstance* event)
         prevEvent->nextEvent_mixer = eventi->nextEvent_mixer;
     }
     
+    if (bus->eventListTail == event)
+    {
+        bus->eventListTail = prevEvent;
+    }
+    
     event->nextEvent_mixer = NULL;
     
+    kwlMixBus_changeNumActiveNodes(bus, -1);
+    
     /*
     kwlEventInstance* current
     if (previousEvent)
@@ -153,17 +219,25 @@ void kwlMixBus_removeEvent(kwlMixBus* bus, kwlEventInstance* event)
 }
 
 
-void kwlMixBus_render(kwlMixBus* mixBus, 
-                      void* mixerVoid, //TODO: made this a void* to get things to compile. should be kwlMixer*
-                      int numOutChannels,
-                      int numFrames, 
-                      float* busScratchBuffer,
-                      float* eventScratchBuffer,
-                      float* outBuffer,
-                      float accumulatedPitch,
-                      float accumulatedGainLeft,
-                      float accumulatedGainRight)
+/** Renders a mix bus and its sub buses at the rate of \c outBuffer. @see kwlMixBus_render */
+static void kwlMixBus_renderSubtree(kwlMixBus* mixBus, 
+                                    void* mixerVoid,
+                                    int numOutChannels,
+                                    int numFrames, 
+                                    int numOutputRateFrames,
+                                    float* busScratchBuffer,
+                                    float* eventScratchBuffer,
+                                    float* outBuffer,
+                                    float accumulatedPitch,
+                                    float accumulatedGainLeft,
+                                    float accumulatedGainRight)
 {
+    /*Nothing in this subtree can produce output.*/
+    if (mixBus->numActiveNodes == 0)
+    {
+        return;
+    }
+    
     kwlMixer* mixer = (kwlMixer*)mixerVoid;
     const int numSubBuses = mixBus->numSubBuses;
     
@@ -171,35 +245,99 @@ void kwlMixBus_render(kwlMixBus* mixBus,
     for (int i = 0; i < numSubBuses; i++)
     {
         kwlMixBus* busi = mixBus->subBuses[i];
+        if (busi->numActiveNodes == 0)
+        {
+            continue;
+        }
         kwlMixBus_render(busi, 
                          mixer,
                          numOutChannels, 
                          numFrames,
+                         numOutputRateFrames,
                          busScratchBuffer,
                          eventScratchBuffer,
                          outBuffer,
-                         busi->totalPitch.valueMixer * accumulatedPitch,
-                         busi->totalGainLeft.valueMixer * accumulatedGainLeft,
-                         busi->totalGainRight.valueMixer *accumulatedGainRight);
+                         busi->totalPitch.valueMixer * busi->pitchAutomation.value * accumulatedPitch,
+                         busi->totalGainLeft.valueMixer * busi->gainAutomation.value * accumulatedGainLeft,
+                         busi->totalGainRight.valueMixer * busi->gainAutomation.value * accumulatedGainRight);
+    }
+    
+    /* 
+     If the bus is muted, events are only advanced and nothing is mixed. Since
+     gains multiply down the tree, this holds for the whole subtree.
+     */
+    const int isMuted = accumulatedGainLeft == 0.0f && accumulatedGainRight == 0.0f;
+    kwlDSPUnit* dspUnit = (kwlDSPUnit*)mixBus->dspUnit.valueMixer;
+    
+    /*Decide if the DSP unit, if any, should be processed for this buffer.*/
+    int processDSPUnit = 0;
+    int isProcessingTail = 0;
+    if (dspUnit != NULL)
+    {
+        if (mixBus->eventList != NULL || kwlMixBus_hasUnknownTail(dspUnit))
+        {
+            processDSPUnit = 1;
+        }
+        else if (mixBus->isDSPTailActive)
+        {
+            processDSPUnit = 1;
+            isProcessingTail = 1;
+            mixBus->dspTailFramesLeft -= numFrames;
+            if (mixBus->dspTailFramesLeft <= 0)
+            {
+                /*This is the last buffer of the tail.*/
+                kwlMixBus_endDSPTail(mixBus);
+            }
+        }
+    }
+    
+    if (mixBus->eventList == NULL && processDSPUnit == 0)
+    {
+        mixBus->prevAccumulatedGain[0] = -1.0f;
+        mixBus->prevAccumulatedGain[1] = -1.0f;
+        mixBus->halfRateHistory[0] = 0.0f;
+        mixBus->halfRateHistory[1] = 0.0f;
+        return;
+    }
+    
+    /* Mix the events of this bus into the bus buffer. */
+    float* eventTargetBuffer = isMuted ? NULL : busScratchBuffer;
+    if (!isMuted)
+    {
+        kwlClearFloatBuffer(busScratchBuffer, numOutChannels * numFrames);
     }
     
-    /* Mix the events of this bus into the out buffer. */
-    kwlClearFloatBuffer(busScratchBuffer, numOutChannels * numFrames);
+    /*Events rendered at half rate share a buffer that is cleared when the first one is mixed.*/
+    float* halfRateBuffer = isMuted ? NULL : mixer->tempHalfRateBuffer;
+    const int numHalfRateSamples = numOutChannels * (numFrames / 2);
+    int hasHalfRateOutput = 0;
+    
     kwlEventInstance* event = mixBus->eventList;
     int numEventsInBus = 0;    
     
     while (event != NULL)
     {
+        float* eventHalfRateBuffer = NULL;
+        if (halfRateBuffer != NULL && event->lodTier.valueMixer == KWL_VOICE_LOD_HALF_RATE)
+        {
+            if (hasHalfRateOutput == 0)
+            {
+                kwlClearFloatBuffer(halfRateBuffer, numHalfRateSamples);
+                hasHalfRateOutput = 1;
+            }
+            eventHalfRateBuffer = halfRateBuffer;
+        }
+        
+        /*mix the event straight into the mix bus temp buffer. Virtual events only advance.*/
         int eventFinishedPlaying = kwlEventInstance_render(event, 
+                                                   event->lodTier.valueMixer == KWL_VOICE_LOD_VIRTUAL ? 
+                                                   NULL : eventTargetBuffer, 
+                                                   eventHalfRateBuffer,
                                                    eventScratchBuffer, 
                                                    numOutChannels,
                                                    numFrames,
+                                                   numOutputRateFrames,
                                                    accumulatedPitch);
-                
-        /*mix event temp buffer into mixbus temp buffer*/
-        kwlMixFloatBuffer(eventScratchBuffer, 
-                          busScratchBuffer,
-                          numOutChannels * numFrames);
         
         numEventsInBus++;
             
@@ -223,10 +361,58 @@ void kwlMixBus_render(kwlMixBus* mixBus,
         }
     }
     
+    /*If the last event just finished, keep the DSP unit running for the duration of its tail.*/
+    if (numEventsInBus > 0 && mixBus->eventList == NULL && 
+        dspUnit != NULL && dspUnit->tailLengthInFrames > 0)
+    {
+        mixBus->isDSPTailActive = 1;
+        mixBus->dspTailFramesLeft = dspUnit->tailLengthInFrames;
+        kwlMixBus_changeNumActiveNodes(mixBus, 1);
+    }
+    
+    if (isMuted)
+    {
+        /*Ramp up from silence when the bus is unmuted.*/
+        mixBus->prevAccumulatedGain[0] = 0.0f;
+        mixBus->prevAccumulatedGain[1] = 0.0f;
+        mixBus->halfRateHistory[0] = 0.0f;
+        mixBus->halfRateHistory[1] = 0.0f;
+        return;
+    }
+    
+    /*
+     Upsample the output of half rate events into the bus buffer. This also runs for the
+     buffer after the last half rate event leaves, letting the upsampler settle to silence.
+     */
+    if (hasHalfRateOutput || mixBus->halfRateHistory[0] != 0.0f || mixBus->halfRateHistory[1] != 0.0f)
+    {
+        if ((numFrames & 1) == 0)
+        {
+            if (hasHalfRateOutput == 0)
+            {
+                kwlClearFloatBuffer(halfRateBuffer, numHalfRateSamples);
+            }
+            kwlUpsample2xAndMix(halfRateBuffer, 
+                                busScratchBuffer, 
+                                numOutChannels, 
+                                numFrames / 2, 
+                                mixBus->halfRateHistory);
+        }
+        else
+        {
+            /*Events are not rendered at half rate into odd length buffers, so just 
+              finish the interpolation towards silence.*/
+            for (int ch = 0; ch < numOutChannels; ch++)
+            {
+                busScratchBuffer[ch] += 0.5f * mixBus->halfRateHistory[ch];
+                mixBus->halfRateHistory[ch] = 0.0f;
+            }
+        }
+    }
+    
     /*Feed the bus output through the DSP unit if any.*/
-    if (mixBus->dspUnit.valueMixer)
+    if (processDSPUnit)
     {
-        kwlDSPUnit* dspUnit = (kwlDSPUnit*)mixBus->dspUnit.valueMixer;
         /*process and replace mixbus temp buffer*/
         (*dspUnit->dspCallback)(busScratchBuffer,
                                 numOutChannels,
@@ -234,23 +420,128 @@ void kwlMixBus_render(kwlMixBus* mixBus,
                                 dspUnit->data);
     }
 
-    /*if we have mixed any events for this bus, 
-      mix the result into the output buffer*/
-    if (numEventsInBus > 0)
+    /*if we have mixed any events for this bus or are processing a DSP tail,
+      mix the result into the output buffer, ramping from the previous mix bus gain
+      to the current one.*/
+    if (numEventsInBus > 0 || isProcessingTail)
     {
-        /*... and then mix the bus buffer into the out buffer, applying
-          the mix bus gain.*/
+        const float accumulatedGain[2] = { accumulatedGainLeft, accumulatedGainRight };
+        if (mixBus->prevAccumulatedGain[0] < 0.0f)
+        {
+            mixBus->prevAccumulatedGain[0] = accumulatedGain[0];
+            mixBus->prevAccumulatedGain[1] = accumulatedGain[1];
+        }
+        
         for (int ch = 0; ch < numOutChannels; ch++)
         {
-            kwlMixFloatBufferWithGain(busScratchBuffer, 
-                                      outBuffer, 
-                                      numOutChannels * numFrames, 
-                                      ch, 
-                                      numOutChannels, 
-                                      //TODO: propagate gain values
-                                      ch == 0 ? accumulatedGainLeft :
-                                                accumulatedGainRight);
+            const float startGain = mixBus->prevAccumulatedGain[ch == 0 ? 0 : 1];
+            const float endGain = accumulatedGain[ch == 0 ? 0 : 1];
+            if (startGain == endGain)
+            {
+                kwlMixFloatBufferWithGain(busScratchBuffer, 
+                                          outBuffer, 
+                                          numOutChannels * numFrames, 
+                                          ch, 
+                                          numOutChannels, 
+                                          endGain);
+            }
+            else
+            {
+                kwlMixFloatBufferWithGainRamp(busScratchBuffer, 
+                                              outBuffer, 
+                                              numOutChannels * numFrames, 
+                                              ch, 
+                                              numOutChannels, 
+                                              startGain,
+                                              (endGain - startGain) / numFrames);
+            }
+        }
+        
+        mixBus->prevAccumulatedGain[0] = accumulatedGain[0];
+        mixBus->prevAccumulatedGain[1] = accumulatedGain[1];
+    }
+    else
+    {
+        mixBus->prevAccumulatedGain[0] = -1.0f;
+        mixBus->prevAccumulatedGain[1] = -1.0f;
+    }
+}
+
+void kwlMixBus_render(kwlMixBus* mixBus, 
+                      void* mixerVoid, //TODO: made this a void* to get things to compile. should be kwlMixer*
+                      int numOutChannels,
+                      int numFrames, 
+                      int numOutputRateFrames,
+                      float* busScratchBuffer,
+                      float* eventScratchBuffer,
+                      float* outBuffer,
+                      float accumulatedPitch,
+                      float accumulatedGainLeft,
+                      float accumulatedGainRight)
+{
+    const int factor = mixBus->rateConversionFactor.valueMixer;
+    if (factor <= 1)
+    {
+        if (mixBus->isRateConverterTailActive)
+        {
+            /*The bus went back to the rate of its parent.*/
+            mixBus->isRateConverterTailActive = 0;
+            kwlMixBus_changeNumActiveNodes(mixBus, -1);
         }
+        mixBus->activeRateConverter = NULL;
+        
+        kwlMixBus_renderSubtree(mixBus, mixerVoid, numOutChannels, numFrames, numOutputRateFrames,
+                                busScratchBuffer, eventScratchBuffer, outBuffer,
+                                accumulatedPitch, accumulatedGainLeft, accumulatedGainRight);
+        return;
+    }
+    
+    /*Start from silence when the bus switches to a new rate.*/
+    kwlRateConverter* converter = mixBus->rateConverters[factor];
+    KWL_ASSERT(converter != NULL);
+    if (converter != mixBus->activeRateConverter)
+    {
+        kwlRateConverter_reset(converter);
+        mixBus->activeRateConverter = converter;
+    }
+    
+    if (mixBus->numActiveNodes == 0 && converter->hasHistory == 0)
+    {
+        return;
+    }
+    
+    /*
+     Mix the subtree at the lower rate into the converter input, then upsample it into the 
+     output. Pitches are scaled so that events play at the right speed. If no input frames are
+     needed for this buffer, the elapsed time is passed on to the next one.
+     */
+    const int numInputFrames = kwlRateConverter_getNumInputFrames(converter, numFrames);
+    float* inputBuffer = kwlRateConverter_getInputBuffer(converter);
+    mixBus->numPendingOutputRateFrames += numOutputRateFrames;
+    if (numInputFrames > 0)
+    {
+        kwlClearFloatBuffer(inputBuffer, numInputFrames * numOutChannels);
+        kwlMixBus_renderSubtree(mixBus, mixerVoid, numOutChannels, numInputFrames, 
+                                mixBus->numPendingOutputRateFrames,
+                                busScratchBuffer, eventScratchBuffer, inputBuffer,
+                                accumulatedPitch * factor, accumulatedGainLeft, accumulatedGainRight);
+        mixBus->numPendingOutputRateFrames = 0;
+    }
+    kwlRateConverter_process(converter, outBuffer, numFrames);
+    
+    /*
+     Keep the bus active until the converter output has decayed to silence, so that 
+     the end of the filter response is not cut off when the subtree goes idle.
+     */
+    if (converter->hasHistory && mixBus->isRateConverterTailActive == 0)
+    {
+        mixBus->isRateConverterTailActive = 1;
+        kwlMixBus_changeNumActiveNodes(mixBus, 1);
+    }
+    else if (converter->hasHistory == 0 && mixBus->isRateConverterTailActive)
+    {
+        mixBus->isRateConverterTailActive = 0;
+        kwlMixBus_changeNumActiveNodes(mixBus, -1);
     }
 }
 
@@ -25,8 +25,10 @@ freely, subject to the following restrictions:
 
 /*! \file */ 
 
+#include "kwl_automation.h"
 #include "kwl_synchronization.h"
 #include "kowalski_ext.h"
+#include "kwl_rateconverter.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -47,6 +49,10 @@ typedef struct kwlMixBus
     kwlSharedFloat totalGainRight;
     /** The total pitch, taking the parent buses into account*/
     kwlSharedFloat totalPitch;
+    /** Automated linear gain, applied on top of the total gain of this bus.*/
+    kwlAutomation gainAutomation;
+    /** Automated pitch, applied on top of the total pitch of this bus.*/
+    kwlAutomation pitchAutomation;
     /** The DSP unit, if any, that the output of this bus is fed through.*/
     kwlSharedVoidPointer dspUnit;
     
@@ -65,6 +71,8 @@ typedef struct kwlMixBus
     struct kwlMixBus** subBuses;
     /** A linked list of currently playing events in this bus. */
     struct kwlEventInstance* eventList;
+    /** The last event in \c eventList, letting events be appended in constant time. */
+    struct kwlEventInstance* eventListTail;
     
     /** The left channel user gain */
     float userGainLeft;
@@ -80,6 +88,51 @@ typedef struct kwlMixBus
     /** The pitch computed by blending contributions from mix presets. */
     float mixPresetPitch;
     
+    /** The parent of this bus, or NULL for root buses. */
+    struct kwlMixBus* parent;
+    /** 
+     * Mixer thread only. The number of things in the subtree rooted at this bus that
+     * may produce output: playing events, running DSP tails and DSP units with unknown tails. 
+     * A subtree where this is zero is skipped when rendering.
+     */
+    int numActiveNodes;
+    /** Mixer thread only. Non-zero while the DSP unit of this bus is processing its tail.*/
+    char isDSPTailActive;
+    /** Mixer thread only. The number of frames left of the DSP tail.*/
+    int dspTailFramesLeft;
+    /** 
+     * Mixer thread only. The accumulated gains the output of this bus was last mixed with, 
+     * used to ramp gain changes. Negative if the bus did not produce output in the last buffer.
+     */
+    float prevAccumulatedGain[2];
+    /** 
+     * Mixer thread only. The last frame of half rate event output mixed in this bus,
+     * where upsampling of the next buffer starts from.
+     */
+    float halfRateHistory[2];
+    
+    /** 
+     * Engine thread only. The output sample rate divided by the internal sample rate 
+     * requested for this bus, or 0 if the bus runs at the rate of its parent.
+     */
+    int sampleRateDivisor;
+    /** 
+     * The factor to upsample the output of this bus by to get the rate of its parent, 
+     * or 0 or 1 if the rates are the same.
+     */
+    kwlSharedInt rateConversionFactor;
+    /** 
+     * Converters by factor, allocated on the engine thread the first time 
+     * the bus needs a given factor and kept until the engine data is unloaded.
+     */
+    kwlRateConverter* rateConverters[KWL_MAX_RATE_CONVERSION_FACTOR + 1];
+    /** Mixer thread only. The converter used for the last rendered buffer.*/
+    kwlRateConverter* activeRateConverter;
+    /** Mixer thread only. Non-zero while the converter output has not yet decayed to silence.*/
+    char isRateConverterTailActive;
+    /** Mixer thread only. Output rate frames that passed without needing a new input frame.*/
+    int numPendingOutputRateFrames;
+    
 } kwlMixBus;
 
 /** */
@@ -91,10 +144,24 @@ void kwlMixBus_addEvent(kwlMixBus* bus, struct kwlEventInstance* event);
 /** Removes an event from a mix bus. */
 void kwlMixBus_removeEvent(kwlMixBus* bus, struct kwlEventInstance* event);
 
+/** 
+ * Sets the DSP unit of a mix bus on the mixer thread, keeping track of whether
+ * the DSP unit keeps the bus active. 
+ */
+void kwlMixBus_setMixerDSPUnit(kwlMixBus* bus, void* dspUnit);
+
+/** 
+ * Renders the events of a mix bus and, recursively, its sub buses into an output buffer.
+ * Subtrees without active nodes are skipped. Events in subtrees with zero gain are advanced
+ * without being mixed. Buses with a lower internal sample rate than their parent render their
+ * subtree at that rate and upsample the result into \c outBuffer. \c numOutputRateFrames is 
+ * the duration of the buffer in frames at the mixer output rate, used for automation and fades.
+ */
 void kwlMixBus_render(kwlMixBus* mixBus, 
                       void* mixer, //TODO: made this a void* to get things to compile. should be kwlMixer*
                       int numOutChannels,
                       int numFrames, 
+                      int numOutputRateFrames,
                       float* busScratchBuffer,
                       float* eventScratchBuffer,
                       float* outBuffer,
@@ -28,11 +28,13 @@ freely, subject to the following restrictions:
 #include "kwl_messagequeue.h"
 #include "kwl_mixbus.h"
 #include "kwl_mixer.h"
+#include "kwl_pushstream.h"
 #include "kwl_sound.h"
 #include "kwl_engine.h"
 
 #include "kwl_assert.h"
 #include <math.h>
+#include <string.h>
 
 kwlMixer* kwlMixer_new(void)
 {
@@ -42,6 +44,7 @@ kwlMixer* kwlMixer_new(void)
     kwlMessageQueue_init(&newMixer->toEngineQueue);
     kwlMessageQueue_init(&newMixer->toEngineQueueShared);
     kwlMessageQueue_init(&newMixer->fromEngineQueue);
+    kwlMessageQueue_init(&newMixer->scheduledQueue);
 
     kwlMixBus_init(&newMixer->freeformEventsBus);
     newMixer->freeformEventsBus.id = "freeform event bus";
@@ -57,12 +60,36 @@ void kwlMixer_allocateTempBuffers(kwlMixer* mixer)
     int tempBufferSize = sizeof(float) * KWL_TEMP_BUFFER_SIZE_IN_FRAMES * mixer->numOutChannels;
     mixer->tempMixBusBuffer = (float*)KWL_MALLOC(tempBufferSize, "mixer temp buffer");
     mixer->tempEventBuffer = (float*)KWL_MALLOC(tempBufferSize, "mixer temp buffer");
+    mixer->tempHalfRateBuffer = (float*)KWL_MALLOC(tempBufferSize / 2, "mixer temp half rate buffer");
     mixer->outBuffer = (float*)KWL_MALLOC(tempBufferSize, "mixer temp out buffer");
     
     if (mixer->numInChannels > 0)
     {
-        mixer->inBuffer = (float*)KWL_MALLOC(tempBufferSize, "mixer temp in buffer");
+        const int inBufferSize = sizeof(float) * KWL_TEMP_BUFFER_SIZE_IN_FRAMES * mixer->numInChannels;
+        mixer->inBuffer = (float*)KWL_MALLOC(inBufferSize, "mixer temp in buffer");
     }
+    
+    if (mixer->quantumSize > 0)
+    {
+        /*Topping up the queue renders at most one quantum past the render ahead size.*/
+        const int renderAheadBufferSize = 
+            sizeof(float) * (mixer->numRenderAheadFrames + mixer->quantumSize) * mixer->numOutChannels;
+        mixer->renderAheadBuffer = (float*)KWL_MALLOC(renderAheadBufferSize, "mixer render ahead buffer");
+    }
+}
+
+void kwlMixer_setRenderQuantum(kwlMixer* mixer, int quantumSize, int numQuantaAhead)
+{
+    KWL_ASSERT(mixer->renderAheadBuffer == NULL);
+    KWL_ASSERT(quantumSize >= 0 && quantumSize <= KWL_TEMP_BUFFER_SIZE_IN_FRAMES);
+    KWL_ASSERT(numQuantaAhead >= 0 && numQuantaAhead <= KWL_MAX_RENDER_AHEAD_QUANTA);
+    
+    mixer->quantumSize = quantumSize;
+    mixer->numRenderAheadFrames = quantumSize * numQuantaAhead;
+    mixer->renderAheadReadPosition = 0;
+    mixer->numRenderAheadFramesQueued = 0;
+    /*Make sure the first quantum picks up any pending messages and parameters.*/
+    mixer->numFramesSinceControlUpdate = KWL_CONTROL_PERIOD_IN_FRAMES;
 }
 
 void kwlMixer_free(kwlMixer* mixer)
@@ -70,11 +97,18 @@ void kwlMixer_free(kwlMixer* mixer)
     KWL_ASSERT(mixer != NULL);
     KWL_FREE(mixer->tempEventBuffer);
     KWL_FREE(mixer->tempMixBusBuffer);
+    KWL_FREE(mixer->tempHalfRateBuffer);
     KWL_FREE(mixer->outBuffer);
     
+    if (mixer->renderAheadBuffer != NULL)
+    {
+        KWL_FREE(mixer->renderAheadBuffer);
+    }
+    
     kwlMessageQueue_free(&mixer->toEngineQueue);
     kwlMessageQueue_free(&mixer->toEngineQueueShared);
     kwlMessageQueue_free(&mixer->fromEngineQueue);
+    kwlMessageQueue_free(&mixer->scheduledQueue);
     
     if (mixer->numInChannels > 0)
     {
@@ -105,6 +139,24 @@ void kwlMixer_updateInput(kwlMixer* mixer)
     }
 }
 
+/** Copies the shared parameters of an event to the mixer thread. Called while holding the engine/mixer lock.*/
+static void kwlMixer_updateEventParameters(kwlMixer* const mixer, kwlEventInstance* event)
+{
+    event->gainLeft.valueMixer = event->gainLeft.valueShared;
+    event->gainRight.valueMixer = event->gainRight.valueShared;
+    event->pitch.valueMixer = event->pitch.valueShared;
+    event->lodTier.valueMixer = event->lodTier.valueShared;
+    kwlAutomation_updateMixer(&event->gainAutomation, mixer->sampleRate, mixer->numFramesMixed.valueMixer);
+    kwlAutomation_updateMixer(&event->pitchAutomation, mixer->sampleRate, mixer->numFramesMixed.valueMixer);
+    kwlAutomation_updateMixer(&event->balanceAutomation, mixer->sampleRate, mixer->numFramesMixed.valueMixer);
+    event->dspUnit.valueMixer = event->dspUnit.valueShared;
+    if (event->dspUnit.valueMixer != NULL)
+    {
+        kwlDSPUnit* dspUnit = (kwlDSPUnit*)event->dspUnit.valueMixer;
+        dspUnit->updateDSPMixerCallback(dspUnit->data);
+    }
+}
+
 void kwlMixer_updateOutput(kwlMixer* const mixer)
 {
     /* 
@@ -129,39 +181,35 @@ void kwlMixer_updateOutput(kwlMixer* const mixer)
             bus->totalGainLeft.valueMixer = bus->totalGainLeft.valueShared;
             bus->totalGainRight.valueMixer = bus->totalGainRight.valueShared;
             bus->totalPitch.valueMixer = bus->totalPitch.valueShared;
-            bus->dspUnit.valueMixer = bus->dspUnit.valueShared;
+            bus->rateConversionFactor.valueMixer = bus->rateConversionFactor.valueShared;
+            kwlAutomation_updateMixer(&bus->gainAutomation, mixer->sampleRate, mixer->numFramesMixed.valueMixer);
+            kwlAutomation_updateMixer(&bus->pitchAutomation, mixer->sampleRate, mixer->numFramesMixed.valueMixer);
+            kwlMixBus_setMixerDSPUnit(bus, bus->dspUnit.valueShared);
         
             /*update parameters of playing events*/
             kwlEventInstance* eventList = bus->eventList;
             while (eventList != NULL)
             {
-                eventList->gainLeft.valueMixer = eventList->gainLeft.valueShared;
-                eventList->gainRight.valueMixer = eventList->gainRight.valueShared;
-                eventList->pitch.valueMixer = eventList->pitch.valueShared;
-                eventList->dspUnit.valueMixer = eventList->dspUnit.valueShared;
-                if (eventList->dspUnit.valueMixer != NULL)
-                {
-                    kwlDSPUnit* dspUnit = (kwlDSPUnit*)eventList->dspUnit.valueMixer;
-                    dspUnit->updateDSPMixerCallback(dspUnit->data);
-                }
-                
+                kwlMixer_updateEventParameters(mixer, eventList);
                 eventList = eventList->nextEvent_mixer;
             }
         }
         
+        /*update parameters of events that will start later in this buffer*/
+        for (i = 0; i < mixer->scheduledQueue.numMessages; i++)
+        {
+            kwlMessage* message = &mixer->scheduledQueue.messages[i];
+            if (message->type == KWL_EVENT_START)
+            {
+                kwlMixer_updateEventParameters(mixer, (kwlEventInstance*)message->data);
+            }
+        }
+        
         /* update freeform events */
         kwlEventInstance* eventList = mixer->freeformEventsBus.eventList;
         while (eventList != NULL)
         {
-            eventList->gainLeft.valueMixer = eventList->gainLeft.valueShared;
-            eventList->gainRight.valueMixer = eventList->gainRight.valueShared;
-            eventList->pitch.valueMixer = eventList->pitch.valueShared;
-            if (eventList->dspUnit.valueMixer!= NULL)
-            {
-                kwlDSPUnit* dspUnit = (kwlDSPUnit*)eventList->dspUnit.valueMixer;
-                dspUnit->updateDSPMixerCallback(dspUnit->data);
-            }
-            
+            kwlMixer_updateEventParameters(mixer, eventList);
             eventList = eventList->nextEvent_mixer;
         }
         
@@ -186,156 +234,264 @@ void kwlMixer_updateOutput(kwlMixer* const mixer)
     }
 }
 
+/** Returns non-zero if a given event plays audio data from a given wave bank.*/
+static int kwlMixer_eventReferencesWaveBank(kwlEventInstance* event, void* waveBank)
+{
+    int numReferencedWaveBanks = event->definition_mixer->numReferencedWaveBanks;
+    int i;
+    for (i = 0; i < numReferencedWaveBanks; i++)
+    {
+        if (event->definition_mixer->referencedWaveBanks[i] == waveBank)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Returns non-zero if a given event is data driven.*/
+static int kwlMixer_isDataDrivenEvent(kwlEventInstance* event, void* unused)
+{
+    (void)unused;
+    return event->definition_mixer->numReferencedWaveBanks != 0 &&
+           event->definition_mixer->referencedWaveBanks != NULL;
+}
+
+/** Returns non-zero if two events are the same.*/
+static int kwlMixer_isSameEvent(kwlEventInstance* event, void* otherEvent)
+{
+    return event == otherEvent;
+}
+
+/** 
+ * Removes scheduled messages concerning events that match a given predicate. Cancelled
+ * starts are reported back to the engine as if the event had played and stopped.
+ */
+static void kwlMixer_cancelScheduledMessages(kwlMixer* const mixer, 
+                                             int (*predicate)(kwlEventInstance*, void*),
+                                             void* predicateData)
+{
+    kwlMessageQueue* queue = &mixer->scheduledQueue;
+    int i = 0;
+    while (i < queue->numMessages)
+    {
+        kwlMessage* message = &queue->messages[i];
+        kwlEventInstance* event = (kwlEventInstance*)message->data;
+        if (predicate(event, predicateData))
+        {
+            if (message->type == KWL_EVENT_START)
+            {
+                kwlMixer_sendEventStoppedMessage(mixer, event);
+            }
+            kwlMessageQueue_removeMessage(queue, i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
 void kwlMixer_processMessages(kwlMixer* const mixer)
 {
+    const long long currentFrame = mixer->numFramesMixed.valueMixer;
     int numMessages = mixer->fromEngineQueue.numMessages;
     int i;
     for (i = 0; i < numMessages; i++)    
     {
         kwlMessage* message = &mixer->fromEngineQueue.messages[i];
-        kwlMessageType type = message->type;
-        void* messageData = message->data;
-        //printf("mixer: processing incoming message %d/%d of type %d\n", i, numMessages, 
-        //       type);
+        if (message->frame > currentFrame &&
+            kwlMessageQueue_insertSorted(&mixer->scheduledQueue, message) != 0)
+        {
+            /*Processed when rendering reaches the scheduled frame.*/
+            continue;
+        }
+        KWL_ASSERT((message->frame <= currentFrame || 
+                    mixer->scheduledQueue.numMessages < mixer->scheduledQueue.maxQueueSize) && 
+                   "mixer: scheduled message queue exhausted");
+        kwlMixer_processMessage(mixer, message);
+    }
+    
+    mixer->fromEngineQueue.numMessages = 0;
+}
+
+int kwlMixer_processScheduledMessages(kwlMixer* const mixer, long long currentFrame, int maxNumFrames)
+{
+    kwlMessageQueue* queue = &mixer->scheduledQueue;
+    while (queue->numMessages > 0 && queue->messages[0].frame <= currentFrame)
+    {
+        /*Copy the message, since processing it may modify the queue.*/
+        kwlMessage message = queue->messages[0];
+        kwlMessageQueue_removeMessage(queue, 0);
+        kwlMixer_processMessage(mixer, &message);
+    }
+    
+    if (queue->numMessages > 0 && queue->messages[0].frame - currentFrame < maxNumFrames)
+    {
+        return (int)(queue->messages[0].frame - currentFrame);
+    }
+    
+    return maxNumFrames;
+}
+
+void kwlMixer_processMessage(kwlMixer* const mixer, kwlMessage* message)
+{
+    kwlMessageType type = message->type;
+    void* messageData = message->data;
+    //printf("mixer: processing incoming message of type %d\n", type);
+    
+    if (type == KWL_EVENT_START ||
+        type == KWL_EVENT_RETRIGGER)
+    {   
+        KWL_ASSERT(messageData != NULL && "message data is null");
+        kwlEventInstance* event = (kwlEventInstance*)message->data;
+        /*Find the bus to put the event in.*/
+        kwlMixBus* targetBus = event->definition_mixer->mixBus;
+        if (targetBus == NULL)
+        {
+            /*If the bus in the event definition is null, we're dealing with a freeform event.*/
+            targetBus = &mixer->freeformEventsBus;
+        }
+        KWL_ASSERT(targetBus != NULL && "target bus is null");
         
-        if (type == KWL_EVENT_START ||
-            type == KWL_EVENT_RETRIGGER)
-        {   
-            KWL_ASSERT(messageData != NULL && "message data is null");
-            kwlEventInstance* event = (kwlEventInstance*)message->data;
-            /*Find the bus to put the event in.*/
-            kwlMixBus* targetBus = event->definition_mixer->mixBus;
-            if (targetBus == NULL)
-            {
-                /*If the bus in the event definition is null, we're dealing with a freeform event.*/
-                targetBus = &mixer->freeformEventsBus;
-            }
-            KWL_ASSERT(targetBus != NULL && "target bus is null");
-            
-            const int streamFromDisk = event->decoder != NULL;
-            const int retrigger = (type == KWL_EVENT_RETRIGGER);
+        const int streamFromDisk = event->decoder != NULL;
+        const int retrigger = (type == KWL_EVENT_RETRIGGER);
 
-            kwlEventInstance_start(event);
-            int shouldStop = 0; /*could be non-zero if the event is missing audio data*/
-            if (streamFromDisk == 0)
-            {
-                KWL_ASSERT(event->definition_mixer->streamAudioData == NULL);
-                shouldStop = kwlSound_pickNextBufferForEvent(event->definition_mixer->sound, event, 1);
-                /*KWL_ASSERT(result == 0 && "event should not signal stop on picking first buffer");*/
-            }
-            else 
-            {
-                KWL_ASSERT(event->definition_mixer->sound == NULL);
-                //shouldStop = kwlDecoder_decodeNewBufferForEvent(event->decoder, event, 1);
-            }
-            
-            /* check if this event should fade in */
-            float fadeOutTime = message->param;
-            if (fadeOutTime > 0.0f)
-            {
-                event->fadeGain = 0.0f;
-                event->fadeGainIncrPerFrame = 1.0f / (fadeOutTime * mixer->sampleRate);
-            }
-            else
-            {
-                event->fadeGain = 1.0f;
-                event->fadeGainIncrPerFrame = 0.0f;
-            }
-            
-            if (shouldStop != 0)
-            {
-                event->playbackState = KWL_STOP_REQUESTED;
-            }
-            
-            /*add the event to its bus.*/
-            if (retrigger == 0)
-            {
-                kwlMixBus_addEvent(targetBus, event);
-            }
+        kwlEventInstance_start(event);
+        int shouldStop = 0; /*could be non-zero if the event is missing audio data*/
+        if (event->pushStream != NULL)
+        {
+            shouldStop = kwlPushStream_pickNextBufferForEvent(event->pushStream, event, 1);
         }
-        else if (type == KWL_PREPARE_ENGINE_DATA_UNLOAD)
+        else if (streamFromDisk == 0)
         {
-            kwlMixer_stopAllDataDrivenEvents(mixer);
-            //printf("mixer: got KWL_PREPARE_ENGINE_DATA_UNLOAD, sending KWL_UNLOAD_ENGINE_DATA back to engine\n");
-            //int result = kwlMessageQueue_addMessage(&mixer->toEngineQueue, KWL_UNLOAD_ENGINE_DATA, NULL);
-            //KWL_ASSERT(result == 1 && "mixer: outgoing message queue exhausted ");
-            KWL_ASSERT(mixer->resetMixBusesRequested == 0);
-            mixer->resetMixBusesRequested = 1;
+            KWL_ASSERT(event->definition_mixer->streamAudioData == NULL);
+            shouldStop = kwlSound_pickNextBufferForEvent(event->definition_mixer->sound, event, 1);
+            /*KWL_ASSERT(result == 0 && "event should not signal stop on picking first buffer");*/
         }
-        else if (type == KWL_EVENT_STOP)
+        else 
         {
-            KWL_ASSERT(messageData != NULL);
-            kwlEventInstance* event = (kwlEventInstance*)message->data;
-            float fadeOutTime = message->param;
-            if (event->isPaused)
-            {
-                /*Always stop paused events immediately.*/
-                event->playbackState = KWL_STOP_REQUESTED;
-            }
-            else if (fadeOutTime > 0.0f)
-            {
-                /*Start the fade out. The event will get removed from the mixer when
-                  the fade gain reaches 0.*/
-                event->fadeGainIncrPerFrame = -1.0f / (fadeOutTime * mixer->sampleRate);
-            }
-            else if (event->definition_mixer->sound != NULL)
-            {
-                if (event->definition_mixer->sound->playbackMode == KWL_IN_RANDOM_OUT ||
-                    event->definition_mixer->sound->playbackMode == KWL_IN_RANDOM_NO_REPEAT_OUT ||
-                    event->definition_mixer->sound->playbackMode == KWL_IN_SEQUENTIAL_OUT)
-                {
-                    event->playbackState = KWL_PLAY_LAST_BUFFER_AND_STOP_REQUESTED;
-                }
-                else
-                {
-                    event->playbackState = KWL_STOP_REQUESTED;
-                }
-            }
-            else
-            {
-                event->playbackState = KWL_STOP_REQUESTED;
-            }
-            
+            /*Streaming events and sound driven events whose audio data is evicted 
+              and streamed from disk until it has been reloaded.*/
+            //shouldStop = kwlDecoder_decodeNewBufferForEvent(event->decoder, event, 1);
         }
-        else if (type == KWL_EVENT_PAUSE)
+        
+        event->outputSampleRate = mixer->sampleRate;
+        
+        /* check if this event should fade in */
+        float fadeOutTime = message->param;
+        if (fadeOutTime > 0.0f)
         {
-            kwlEventInstance* event = (kwlEventInstance*)message->data;
-            event->isPaused = 1;
+            event->fadeGain = 0.0f;
+            event->fadeGainIncrPerFrame = 1.0f / (fadeOutTime * mixer->sampleRate);
         }
-        else if (type == KWL_EVENT_RESUME)
+        else
         {
-            kwlEventInstance* event = (kwlEventInstance*)message->data;
-            event->isPaused = 0;
+            event->fadeGain = 1.0f;
+            event->fadeGainIncrPerFrame = 0.0f;
         }
-        else if (type == KWL_FREEFORM_EVENT_STOP)
+        
+        if (shouldStop != 0)
+        {
+            event->playbackState = KWL_STOP_REQUESTED;
+        }
+        
+        /*add the event to its bus.*/
+        if (retrigger == 0)
         {
-            kwlEventInstance* event = (kwlEventInstance*)message->data;
-            //printf("stopping freeform event %s\n", event->definition_mixer->id);
-            event->playbackState = KWL_STOP_AND_UNLOAD_REQUESTED;
+            kwlMixBus_addEvent(targetBus, event);
+        }
+    }
+    else if (type == KWL_PREPARE_ENGINE_DATA_UNLOAD)
+    {
+        kwlMixer_cancelScheduledMessages(mixer, kwlMixer_isDataDrivenEvent, NULL);
+        kwlMixer_stopAllDataDrivenEvents(mixer);
+        //printf("mixer: got KWL_PREPARE_ENGINE_DATA_UNLOAD, sending KWL_UNLOAD_ENGINE_DATA back to engine\n");
+        //int result = kwlMessageQueue_addMessage(&mixer->toEngineQueue, KWL_UNLOAD_ENGINE_DATA, NULL);
+        //KWL_ASSERT(result == 1 && "mixer: outgoing message queue exhausted ");
+        KWL_ASSERT(mixer->resetMixBusesRequested == 0);
+        mixer->resetMixBusesRequested = 1;
+    }
+    else if (type == KWL_EVENT_STOP)
+    {
+        KWL_ASSERT(messageData != NULL);
+        kwlEventInstance* event = (kwlEventInstance*)message->data;
+        float fadeOutTime = message->param;
+        if (message->frame == KWL_UNSCHEDULED)
+        {
+            /*A stop that is not scheduled overrides any scheduled start.*/
+            kwlMixer_cancelScheduledMessages(mixer, kwlMixer_isSameEvent, event);
+        }
+        
+        if (event->isPaused)
+        {
+            /*Always stop paused events immediately.*/
+            event->playbackState = KWL_STOP_REQUESTED;
         }
-        else if (type == KWL_STOP_ALL_EVENTS_REFERENCING_WAVE_BANK)
+        else if (fadeOutTime > 0.0f)
         {
-            kwlWaveBank* waveBank = (kwlWaveBank*)message->data;
-            kwlMixer_stopAllEventsReferencingWaveBank(mixer, waveBank);
-            /*printf("stopped all events referencing %s\n", waveBank->id);*/
-            /* Send a message to the engine thread indicating that it's safe to unload the wave bank.
-               IMPORTANT NOTE: This relies on kwlMixer_updateOutput being called BEFORE kwlMixer_processMessages*/
-            int result = kwlMessageQueue_addMessage(&mixer->toEngineQueue, KWL_UNLOAD_WAVEBANK, waveBank);
-            KWL_ASSERT(result == 1 && "mixer: outgoing message queue exhausted ");
+            /*Start the fade out. The event will get removed from the mixer when
+              the fade gain reaches 0.*/
+            event->fadeGainIncrPerFrame = -1.0f / (fadeOutTime * mixer->sampleRate);
         }
-        else if (type == KWL_SET_MASTER_BUS)
+        else if (event->definition_mixer->sound != NULL && event->decoder == NULL)
         {
-            kwlMixBus* newBusArray = (kwlMixBus*)message->data;
-            int numBuses = (int)message->param;
-            kwlMixer_setMixBusArray(mixer, newBusArray, numBuses);
+            if (event->definition_mixer->sound->playbackMode == KWL_IN_RANDOM_OUT ||
+                event->definition_mixer->sound->playbackMode == KWL_IN_RANDOM_NO_REPEAT_OUT ||
+                event->definition_mixer->sound->playbackMode == KWL_IN_SEQUENTIAL_OUT)
+            {
+                event->playbackState = KWL_PLAY_LAST_BUFFER_AND_STOP_REQUESTED;
+            }
+            else
+            {
+                event->playbackState = KWL_STOP_REQUESTED;
+            }
         }
         else
         {
-            KWL_ASSERT(NULL && "unknown message type");
+            event->playbackState = KWL_STOP_REQUESTED;
         }
+        
+    }
+    else if (type == KWL_EVENT_PAUSE)
+    {
+        kwlEventInstance* event = (kwlEventInstance*)message->data;
+        event->isPaused = 1;
+    }
+    else if (type == KWL_EVENT_RESUME)
+    {
+        kwlEventInstance* event = (kwlEventInstance*)message->data;
+        event->isPaused = 0;
+    }
+    else if (type == KWL_FREEFORM_EVENT_STOP)
+    {
+        kwlEventInstance* event = (kwlEventInstance*)message->data;
+        //printf("stopping freeform event %s\n", event->definition_mixer->id);
+        event->playbackState = KWL_STOP_AND_UNLOAD_REQUESTED;
+        /*An event that has not started yet is unloaded right away.*/
+        kwlMixer_cancelScheduledMessages(mixer, kwlMixer_isSameEvent, event);
+    }
+    else if (type == KWL_STOP_ALL_EVENTS_REFERENCING_WAVE_BANK)
+    {
+        kwlWaveBank* waveBank = (kwlWaveBank*)message->data;
+        kwlMixer_cancelScheduledMessages(mixer, kwlMixer_eventReferencesWaveBank, waveBank);
+        kwlMixer_stopAllEventsReferencingWaveBank(mixer, waveBank);
+        /*printf("stopped all events referencing %s\n", waveBank->id);*/
+        /* Send a message to the engine thread indicating that it's safe to unload the wave bank.
+           IMPORTANT NOTE: This relies on kwlMixer_updateOutput being called BEFORE kwlMixer_processMessages*/
+        int result = kwlMessageQueue_addMessage(&mixer->toEngineQueue, KWL_UNLOAD_WAVEBANK, waveBank);
+        KWL_ASSERT(result == 1 && "mixer: outgoing message queue exhausted ");
+    }
+    else if (type == KWL_SET_MASTER_BUS)
+    {
+        kwlMixBus* newBusArray = (kwlMixBus*)message->data;
+        int numBuses = (int)message->param;
+        kwlMixer_setMixBusArray(mixer, newBusArray, numBuses);
+    }
+    else
+    {
+        KWL_ASSERT(NULL && "unknown message type");
     }
-    
-    mixer->fromEngineQueue.numMessages = 0;
 }
 
 void kwlMixer_stopAllDataDrivenEvents(kwlMixer* mixer)
@@ -349,8 +505,7 @@ void kwlMixer_stopAllDataDrivenEvents(kwlMixer* mixer)
         kwlEventInstance* event = mixBusi->eventList;
         while (event != NULL)
         {
-            if (event->definition_mixer->numReferencedWaveBanks != 0 &&
-                event->definition_mixer->referencedWaveBanks != NULL)
+            if (kwlMixer_isDataDrivenEvent(event, NULL))
             {
                 event->playbackState = KWL_STOP_REQUESTED;
             }
@@ -371,16 +526,10 @@ void kwlMixer_stopAllEventsReferencingWaveBank(kwlMixer* mixer, kwlWaveBank* wav
         kwlEventInstance* event = mixBusi->eventList;
         while (event != NULL)
         {
-            int numReferencedWaveBanks = event->definition_mixer->numReferencedWaveBanks;
-            int i;
-            for (i = 0; i < numReferencedWaveBanks; i++)
+            if (kwlMixer_eventReferencesWaveBank(event, waveBank))
             {
-                if (event->definition_mixer->referencedWaveBanks[i] == waveBank)
-                {
-                    event->playbackState = KWL_STOP_REQUESTED;
-                    break;
-                }
-            }            
+                event->playbackState = KWL_STOP_REQUESTED;
+            }
             event = event->nextEvent_mixer;
         }
     }
@@ -446,16 +595,23 @@ void kwlMixer_resetMixBuses(kwlMixer* mixer)
     mixer->masterBus = NULL;
 }
 
-void kwlMixer_render(kwlMixer* mixer, 
-                             float* outBuffer, 
-                             int numFrames)
-{    
-    /*process any new messages from the engine thread before rendering.*/
+/**
+ * Processes any new messages from the engine thread and updates the parameters of 
+ * the mix buses and currently playing events.
+ */
+static void kwlMixer_updateControl(kwlMixer* mixer)
+{
     kwlMixer_processMessages(mixer);
-    
-    /*Update the parameters of the mix buses and currently playing events.*/
     kwlMixer_updateOutput(mixer);
-    
+}
+
+/**
+ * Mixes a buffer of a given size using the current mix bus and event parameters.
+ */
+static void kwlMixer_mix(kwlMixer* mixer, 
+                         float* outBuffer, 
+                         int numFrames)
+{
     /*Clear the output buffer.*/
     const int numOutChannels = mixer->numOutChannels;
     const int numSamples = numFrames * numOutChannels;
@@ -465,25 +621,50 @@ void kwlMixer_render(kwlMixer* mixer,
     if (mixer->isPaused.valueMixer == 0)
     {
         /* 
-         There are two root mix buses: one for freeform events and one for
-         data driven events.
+         The buffer is rendered in blocks that are split at the frames of scheduled 
+         messages, so that scheduled events start and stop on the exact frame.
          */
-        for (int i = 0; i < 2; i++)
+        int frameOffset = 0;
+        while (frameOffset < numFrames)
         {
-            kwlMixBus* bus = i == 0 ? &mixer->freeformEventsBus : mixer->masterBus;
-            if (bus != NULL)
+            const int numBlockFrames = 
+                kwlMixer_processScheduledMessages(mixer, 
+                                                  mixer->numFramesMixed.valueMixer + frameOffset,
+                                                  numFrames - frameOffset);
+            /* 
+             Advance mix bus automation to the end of this block. This is done for all buses,
+             including idle ones, so that automation runs in real time.
+             */
+            for (int i = 0; i < mixer->numMixBuses; i++)
             {
-                kwlMixBus_render(bus,
-                                 mixer,
-                                 numOutChannels, 
-                                 numFrames, 
-                                 mixer->tempMixBusBuffer, 
-                                 mixer->tempEventBuffer, 
-                                 outBuffer, 
-                                 bus->totalPitch.valueMixer, 
-                                 bus->totalGainLeft.valueMixer, 
-                                 bus->totalGainRight.valueMixer);
+                kwlAutomation_advance(&mixer->mixBuses[i].gainAutomation, numBlockFrames);
+                kwlAutomation_advance(&mixer->mixBuses[i].pitchAutomation, numBlockFrames);
+            }
+            
+            /* 
+             There are two root mix buses: one for freeform events and one for
+             data driven events.
+             */
+            for (int i = 0; i < 2; i++)
+            {
+                kwlMixBus* bus = i == 0 ? &mixer->freeformEventsBus : mixer->masterBus;
+                if (bus != NULL)
+                {
+                    kwlMixBus_render(bus,
+                                     mixer,
+                                     numOutChannels, 
+                                     numBlockFrames, 
+                                     numBlockFrames, 
+                                     mixer->tempMixBusBuffer, 
+                                     mixer->tempEventBuffer, 
+                                     &outBuffer[frameOffset * numOutChannels], 
+                                     bus->totalPitch.valueMixer * bus->pitchAutomation.value, 
+                                     bus->totalGainLeft.valueMixer * bus->gainAutomation.value, 
+                                     bus->totalGainRight.valueMixer * bus->gainAutomation.value);
+                }
             }
+            
+            frameOffset += numBlockFrames;
         }
         
         /*Clamp out buffer to [-1, 1]*/
@@ -540,6 +721,102 @@ void kwlMixer_render(kwlMixer* mixer,
     }
 }
 
+/**
+ * Mixes one quantum in low latency mode, syncing with the engine thread first if
+ * a control period has passed since the last sync.
+ */
+static void kwlMixer_renderQuantum(kwlMixer* mixer, float* outBuffer)
+{
+    if (mixer->numFramesSinceControlUpdate >= KWL_CONTROL_PERIOD_IN_FRAMES)
+    {
+        kwlMixer_updateControl(mixer);
+        mixer->numFramesSinceControlUpdate = 0;
+    }
+    
+    kwlMixer_mix(mixer, outBuffer, mixer->quantumSize);
+    mixer->numFramesSinceControlUpdate += mixer->quantumSize;
+}
+
+/**
+ * Fills a buffer of any size in low latency mode. Frames left over from partially 
+ * consumed quanta and frames rendered ahead are output first, whole quanta are then
+ * rendered directly into the output buffer and any remainder is taken from a new 
+ * quantum rendered into the render ahead queue. Finally, the queue is topped up to
+ * the render ahead size so that the next buffer can be served without mixing.
+ */
+static void kwlMixer_renderQuanta(kwlMixer* mixer, 
+                                  float* outBuffer, 
+                                  int numFrames)
+{
+    const int numOutChannels = mixer->numOutChannels;
+    const int quantumSize = mixer->quantumSize;
+    float* queue = mixer->renderAheadBuffer;
+    
+    int currFrame = 0;
+    while (currFrame < numFrames)
+    {
+        const int numFramesLeft = numFrames - currFrame;
+        if (mixer->numRenderAheadFramesQueued > 0)
+        {
+            int numFramesToCopy = mixer->numRenderAheadFramesQueued;
+            if (numFramesToCopy > numFramesLeft)
+            {
+                numFramesToCopy = numFramesLeft;
+            }
+            
+            kwlMemcpy(&outBuffer[currFrame * numOutChannels], 
+                      &queue[mixer->renderAheadReadPosition * numOutChannels], 
+                      sizeof(float) * numFramesToCopy * numOutChannels);
+            mixer->renderAheadReadPosition += numFramesToCopy;
+            mixer->numRenderAheadFramesQueued -= numFramesToCopy;
+            currFrame += numFramesToCopy;
+        }
+        else if (numFramesLeft >= quantumSize)
+        {
+            kwlMixer_renderQuantum(mixer, &outBuffer[currFrame * numOutChannels]);
+            currFrame += quantumSize;
+        }
+        else
+        {
+            kwlMixer_renderQuantum(mixer, queue);
+            mixer->renderAheadReadPosition = 0;
+            mixer->numRenderAheadFramesQueued = quantumSize;
+        }
+    }
+    
+    if (mixer->numRenderAheadFramesQueued < mixer->numRenderAheadFrames)
+    {
+        /*Move the queued frames to the start of the buffer, then top up the queue.*/
+        if (mixer->renderAheadReadPosition > 0)
+        {
+            memmove(queue, 
+                    &queue[mixer->renderAheadReadPosition * numOutChannels], 
+                    sizeof(float) * mixer->numRenderAheadFramesQueued * numOutChannels);
+            mixer->renderAheadReadPosition = 0;
+        }
+        
+        while (mixer->numRenderAheadFramesQueued < mixer->numRenderAheadFrames)
+        {
+            kwlMixer_renderQuantum(mixer, &queue[mixer->numRenderAheadFramesQueued * numOutChannels]);
+            mixer->numRenderAheadFramesQueued += quantumSize;
+        }
+    }
+}
+
+void kwlMixer_render(kwlMixer* mixer, 
+                     float* outBuffer, 
+                     int numFrames)
+{    
+    if (mixer->quantumSize > 0)
+    {
+        kwlMixer_renderQuanta(mixer, outBuffer, numFrames);
+        return;
+    }
+    
+    kwlMixer_updateControl(mixer);
+    kwlMixer_mix(mixer, outBuffer, numFrames);
+}
+
 void kwlMixer_processInputBuffer(kwlMixer* mixer, 
                                          const float* inBuffer,
                                          int numFrames)
@@ -558,3 +835,101 @@ void kwlMixer_processInputBuffer(kwlMixer* mixer,
                                 dspUnit->data);
     }
 }
+
+void kwlMixer_renderInterleaved(kwlMixer* mixer, 
+                                float* outBuffer, 
+                                int numFrames)
+{
+    const int numOutChannels = mixer->numOutChannels;
+    int currFrame = 0;
+    while (currFrame < numFrames)
+    {
+        int numFramesToMix = numFrames - currFrame;
+        if (numFramesToMix > KWL_TEMP_BUFFER_SIZE_IN_FRAMES)
+        {
+            numFramesToMix = KWL_TEMP_BUFFER_SIZE_IN_FRAMES;
+        }
+        
+        kwlMixer_render(mixer, &outBuffer[currFrame * numOutChannels], numFramesToMix);
+        currFrame += numFramesToMix;
+    }
+}
+
+void kwlMixer_renderPlanar(kwlMixer* mixer, 
+                           float** outBuffers, 
+                           int numFrames)
+{
+    const int numOutChannels = mixer->numOutChannels;
+    
+    /*A single channel is the same in both layouts, so mix in place.*/
+    if (numOutChannels == 1)
+    {
+        kwlMixer_renderInterleaved(mixer, outBuffers[0], numFrames);
+        return;
+    }
+    
+    int currFrame = 0;
+    while (currFrame < numFrames)
+    {
+        int numFramesToMix = numFrames - currFrame;
+        if (numFramesToMix > KWL_TEMP_BUFFER_SIZE_IN_FRAMES)
+        {
+            numFramesToMix = KWL_TEMP_BUFFER_SIZE_IN_FRAMES;
+        }
+        
+        kwlMixer_render(mixer, mixer->outBuffer, numFramesToMix);
+        
+        for (int ch = 0; ch < numOutChannels; ch++)
+        {
+            float* channel = &outBuffers[ch][currFrame];
+            const float* src = &mixer->outBuffer[ch];
+            for (int i = 0; i < numFramesToMix; i++)
+            {
+                channel[i] = src[i * numOutChannels];
+            }
+        }
+        
+        currFrame += numFramesToMix;
+    }
+}
+
+void kwlMixer_processInputPlanar(kwlMixer* mixer, 
+                                 const float* const* inBuffers, 
+                                 int numFrames)
+{
+    const int numInChannels = mixer->numInChannels;
+    if (numInChannels == 0 || inBuffers == NULL)
+    {
+        kwlMixer_processInputBuffer(mixer, NULL, numFrames);
+        return;
+    }
+    
+    if (numInChannels == 1)
+    {
+        kwlMixer_processInputBuffer(mixer, inBuffers[0], numFrames);
+        return;
+    }
+    
+    int currFrame = 0;
+    while (currFrame < numFrames)
+    {
+        int numFramesToProcess = numFrames - currFrame;
+        if (numFramesToProcess > KWL_TEMP_BUFFER_SIZE_IN_FRAMES)
+        {
+            numFramesToProcess = KWL_TEMP_BUFFER_SIZE_IN_FRAMES;
+        }
+        
+        for (int ch = 0; ch < numInChannels; ch++)
+        {
+            const float* channel = &inBuffers[ch][currFrame];
+            float* dst = &mixer->inBuffer[ch];
+            for (int i = 0; i < numFramesToProcess; i++)
+            {
+                dst[i * numInChannels] = channel[i];
+            }
+        }
+        
+        kwlMixer_processInputBuffer(mixer, mixer->inBuffer, numFramesToProcess);
+        currFrame += numFramesToProcess;
+    }
+}
@@ -39,6 +39,16 @@ extern "C"
     /*Ideally, the temp buffers should be bigger than the output buffers.*/
 #define KWL_TEMP_BUFFER_SIZE_IN_FRAMES 1024
     
+    /** 
+     * In low latency mode, the number of frames between consecutive processing of incoming
+     * messages and parameter syncing with the engine thread. Each sync is shared by all
+     * quanta rendered within this period.
+     */
+#define KWL_CONTROL_PERIOD_IN_FRAMES 256
+    
+    /** The maximum number of quanta that can be rendered ahead of the output in low latency mode.*/
+#define KWL_MAX_RENDER_AHEAD_QUANTA 8
+    
     /*forward declarations*/
     struct kwlEvent;
     
@@ -102,6 +112,8 @@ extern "C"
          * must be called proior to any manipulation to protect the data.
          */
         kwlMessageQueue toEngineQueueShared;
+        /** Messages from the engine thread scheduled for a later frame, sorted by frame. Mixer thread only.*/
+        kwlMessageQueue scheduledQueue;
         
         
         
@@ -121,6 +133,20 @@ extern "C"
         float* tempEventBuffer;
         /** A temporary buffer to mix the output of mix buses into.*/
         float* tempMixBusBuffer;
+        /** Events rendered at half rate are mixed here before being upsampled into their mix bus. */
+        float* tempHalfRateBuffer;
+        /** The size in frames of the fixed quanta rendered in low latency mode, or 0 if disabled.*/
+        int quantumSize;
+        /** The number of frames mixed since the last message processing and parameter sync in low latency mode.*/
+        int numFramesSinceControlUpdate;
+        /** The number of frames to keep rendered ahead of the output in low latency mode.*/
+        int numRenderAheadFrames;
+        /** Interleaved frames rendered but not yet output in low latency mode.*/
+        float* renderAheadBuffer;
+        /** The index of the first frame in \c renderAheadBuffer that has not been output.*/
+        int renderAheadReadPosition;
+        /** The number of frames in \c renderAheadBuffer that have not been output.*/
+        int numRenderAheadFramesQueued;
         /** Non-zero if the mix bus hierarchy should be reset, zero otherwise.*/
         int resetMixBusesRequested;
         /** */
@@ -143,12 +169,33 @@ extern "C"
     void kwlMixer_setMixBusArray(kwlMixer* mixer, kwlMixBus* buses, int numBuses);
     /** */
     void kwlMixer_resetMixBuses(kwlMixer* mixer);
-    /** Processes any enqueued incoming messages from the engine thread. */
+    /** 
+     * Processes any enqueued incoming messages from the engine thread. Messages scheduled
+     * for a later frame are moved to the scheduled message queue.
+     */
     void kwlMixer_processMessages(kwlMixer* mixer);
+    /** Processes a single message from the engine thread. */
+    void kwlMixer_processMessage(kwlMixer* mixer, kwlMessage* message);
+    /** 
+     * Processes the scheduled messages that are due at a given frame.
+     * @return The number of frames until the next scheduled message, at most \c maxNumFrames.
+     */
+    int kwlMixer_processScheduledMessages(kwlMixer* mixer, long long currentFrame, int maxNumFrames);
     void kwlMixer_updateOutput(kwlMixer* mixer);
     void kwlMixer_updateInput(kwlMixer* mixer);
     void kwlMixer_allocateTempBuffers(kwlMixer* mixer);
     
+    /**
+     * Enables low latency mode, in which output is rendered in fixed size quanta and the 
+     * per buffer overhead of message processing and parameter syncing is paid once per 
+     * KWL_CONTROL_PERIOD_IN_FRAMES rather than once per quantum. Must be called before
+     * \c kwlMixer_allocateTempBuffers.
+     * @param mixer The mixer.
+     * @param quantumSize The quantum size in frames, or 0 to disable low latency mode.
+     * @param numQuantaAhead The number of quanta to keep rendered ahead of the output.
+     */
+    void kwlMixer_setRenderQuantum(kwlMixer* mixer, int quantumSize, int numQuantaAhead);
+    
     /**
      * Performs mixing into an output buffer of a given size.
      * @param mixer The mixer responsible for the mixing.
@@ -165,6 +212,35 @@ extern "C"
      */
     void kwlMixer_processInputBuffer(kwlMixer* mixer, const float* inBuffer, int numFrames);
     
+    /**
+     * Mixes an interleaved output buffer of any size straight into the caller's memory.
+     * Requests larger than KWL_TEMP_BUFFER_SIZE_IN_FRAMES are rendered in multiple
+     * calls to kwlMixer_render, each writing to its own region of \c outBuffer.
+     * @param mixer The mixer responsible for the mixing.
+     * @param outBuffer The interleaved buffer to mix into.
+     * @numFrames The buffer size in frames.
+     */
+    void kwlMixer_renderInterleaved(kwlMixer* mixer, float* outBuffer, int numFrames);
+    
+    /**
+     * Mixes into one caller provided buffer per output channel. For mono output
+     * this renders directly into \c outBuffers[0], otherwise each chunk is mixed
+     * into the internal out buffer and deinterleaved into the channel buffers.
+     * @param mixer The mixer responsible for the mixing.
+     * @param outBuffers An array of \c numOutChannels channel buffers.
+     * @numFrames The buffer size in frames.
+     */
+    void kwlMixer_renderPlanar(kwlMixer* mixer, float** outBuffers, int numFrames);
+    
+    /**
+     * Passes one caller provided buffer per input channel to the input dsp unit, if any.
+     * The channels are interleaved into the internal in buffer chunk by chunk.
+     * @param mixer The mixer.
+     * @param inBuffers An array of \c numInChannels channel buffers.
+     * @numFrames The buffer size in frames.
+     */
+    void kwlMixer_processInputPlanar(kwlMixer* mixer, const float* const* inBuffers, int numFrames);
+    
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
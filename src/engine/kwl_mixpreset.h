@@ -59,6 +59,15 @@ typedef struct kwlMixPreset
     float targetWeight;
     /** The current blending weight of the preset. 0 - 1*/
     float weight;
+    /** The number of entries in \c sparseParameterSets.*/
+    int numSparseParameterSets;
+    /** 
+     * The differences between the parameter sets of this preset and those of the default 
+     * preset, only for mix buses where they differ. Used to blend presets incrementally.
+     */
+    kwlMixBusParameters* sparseParameterSets;
+    /** The weight the sparse differences of this preset were last blended with.*/
+    float blendedWeight;
 } kwlMixPreset;
 
 #ifdef __cplusplus
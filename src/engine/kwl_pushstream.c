@@ -0,0 +1,224 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "kwl_pushstream.h"
+#include "kwl_eventinstance.h"
+#include "kwl_memory.h"
+#include "kwl_assert.h"
+
+kwlPushStream* kwlPushStream_new(int numChannels, int capacity, int latency)
+{
+    KWL_ASSERT(numChannels == 1 || numChannels == 2);
+    KWL_ASSERT(capacity > 0);
+    KWL_ASSERT(latency >= 0 && latency <= capacity);
+    
+    kwlPushStream* stream = (kwlPushStream*)KWL_MALLOC(sizeof(kwlPushStream), "push stream");
+    kwlMemset(stream, 0, sizeof(kwlPushStream));
+    
+    stream->numChannels = numChannels;
+    stream->numSlots = capacity + 1;
+    /*At least one frame must be queued for playback to start.*/
+    stream->latency = latency > 0 ? latency : 1;
+    stream->isBuffering = 1;
+    
+    /*The silent buffer gets guard frames of its own, since pitch shifting may read past its end too.*/
+    const int numFrames = stream->numSlots + 2 * KWL_PUSH_STREAM_GUARD_FRAMES + KWL_PUSH_STREAM_SILENCE_FRAMES;
+    const int numBytes = sizeof(short) * numFrames * numChannels;
+    stream->samples = (short*)KWL_MALLOC(numBytes, "push stream samples");
+    kwlMemset(stream->samples, 0, numBytes);
+    
+    return stream;
+}
+
+void kwlPushStream_free(kwlPushStream* stream)
+{
+    KWL_FREE(stream->samples);
+    KWL_FREE(stream);
+}
+
+/** Returns the number of queued frames, given the read and write slots.*/
+static int kwlPushStream_getNumFramesBetween(kwlPushStream* stream, int readIndex, int writeIndex)
+{
+    return (writeIndex - readIndex + stream->numSlots) % stream->numSlots;
+}
+
+/** Returns the number of frames the producer can write without overwriting queued frames.*/
+static int kwlPushStream_getNumFreeFrames(kwlPushStream* stream)
+{
+    const int readIndex = kwlAtomicLoadAcquire(&stream->readIndex);
+    return stream->numSlots - 1 - kwlPushStream_getNumFramesBetween(stream, readIndex, stream->writeIndex);
+}
+
+/** Mirrors any of the given written frames that are among the first frames of the ring buffer into the guard frames.*/
+static void kwlPushStream_updateGuardFrames(kwlPushStream* stream, int firstSlot, int numFrames)
+{
+    if (firstSlot >= KWL_PUSH_STREAM_GUARD_FRAMES)
+    {
+        return;
+    }
+    
+    int numFramesToMirror = KWL_PUSH_STREAM_GUARD_FRAMES - firstSlot;
+    if (numFramesToMirror > numFrames)
+    {
+        numFramesToMirror = numFrames;
+    }
+    
+    const int numChannels = stream->numChannels;
+    kwlMemcpy(&stream->samples[(stream->numSlots + firstSlot) * numChannels], 
+              &stream->samples[firstSlot * numChannels], 
+              sizeof(short) * numFramesToMirror * numChannels);
+}
+
+/** 
+ * Returns the number of frames that can be written in one contiguous run
+ * starting at a given slot, given a total number of frames to write.
+ */
+static int kwlPushStream_getRunLength(kwlPushStream* stream, int slot, int numFrames)
+{
+    const int numFramesBeforeWrap = stream->numSlots - slot;
+    return numFrames < numFramesBeforeWrap ? numFrames : numFramesBeforeWrap;
+}
+
+int kwlPushStream_write(kwlPushStream* stream, const short* frames, int numFrames)
+{
+    const int numChannels = stream->numChannels;
+    const int numFreeFrames = kwlPushStream_getNumFreeFrames(stream);
+    const int numFramesToWrite = numFrames < numFreeFrames ? numFrames : numFreeFrames;
+    
+    int slot = stream->writeIndex;
+    int numFramesWritten = 0;
+    while (numFramesWritten < numFramesToWrite)
+    {
+        const int runLength = kwlPushStream_getRunLength(stream, slot, numFramesToWrite - numFramesWritten);
+        kwlMemcpy(&stream->samples[slot * numChannels], 
+                  &frames[numFramesWritten * numChannels], 
+                  sizeof(short) * runLength * numChannels);
+        kwlPushStream_updateGuardFrames(stream, slot, runLength);
+        
+        numFramesWritten += runLength;
+        slot = (slot + runLength) % stream->numSlots;
+    }
+    
+    /*Publish the new frames to the mixer thread.*/
+    kwlAtomicStoreRelease(&stream->writeIndex, slot);
+    return numFramesWritten;
+}
+
+int kwlPushStream_writeFloat(kwlPushStream* stream, const float* frames, int numFrames)
+{
+    const int numChannels = stream->numChannels;
+    const int numFreeFrames = kwlPushStream_getNumFreeFrames(stream);
+    const int numFramesToWrite = numFrames < numFreeFrames ? numFrames : numFreeFrames;
+    
+    int slot = stream->writeIndex;
+    int numFramesWritten = 0;
+    while (numFramesWritten < numFramesToWrite)
+    {
+        const int runLength = kwlPushStream_getRunLength(stream, slot, numFramesToWrite - numFramesWritten);
+        const float* src = &frames[numFramesWritten * numChannels];
+        short* dst = &stream->samples[slot * numChannels];
+        const int numSamples = runLength * numChannels;
+        for (int i = 0; i < numSamples; i++)
+        {
+            const float sample = src[i] > 1.0f ? 1.0f : (src[i] < -1.0f ? -1.0f : src[i]);
+            dst[i] = (short)(32767 * sample);
+        }
+        kwlPushStream_updateGuardFrames(stream, slot, runLength);
+        
+        numFramesWritten += runLength;
+        slot = (slot + runLength) % stream->numSlots;
+    }
+    
+    /*Publish the new frames to the mixer thread.*/
+    kwlAtomicStoreRelease(&stream->writeIndex, slot);
+    return numFramesWritten;
+}
+
+int kwlPushStream_getNumQueuedFrames(kwlPushStream* stream)
+{
+    const int readIndex = kwlAtomicLoadAcquire(&stream->readIndex);
+    const int writeIndex = kwlAtomicLoadAcquire(&stream->writeIndex);
+    return kwlPushStream_getNumFramesBetween(stream, readIndex, writeIndex);
+}
+
+int kwlPushStream_pickNextBufferForEvent(kwlPushStream* stream, kwlEventInstance* event, int firstBuffer)
+{
+    const int numChannels = stream->numChannels;
+    int readIndex = stream->readIndex;
+    int numQueuedFrames = 
+        kwlPushStream_getNumFramesBetween(stream, readIndex, kwlAtomicLoadAcquire(&stream->writeIndex));
+    
+    if (firstBuffer != 0)
+    {
+        stream->isBuffering = 1;
+    }
+    else if (stream->isBuffering == 0)
+    {
+        /*Release the frames played from the current buffer, including any
+          frames that pitch shifting stepped past its end into the next one.*/
+        int numFramesPlayed = event->currentPCMFrameIndex;
+        if (numFramesPlayed > numQueuedFrames)
+        {
+            numFramesPlayed = numQueuedFrames;
+        }
+        
+        readIndex = (readIndex + numFramesPlayed) % stream->numSlots;
+        numQueuedFrames -= numFramesPlayed;
+        kwlAtomicStoreRelease(&stream->readIndex, readIndex);
+        
+        if (numQueuedFrames < 2)
+        {
+            /*Out of frames. Play silence until the latency is built up again.*/
+            stream->isBuffering = 1;
+            kwlAtomicStoreRelease(&stream->numUnderruns, stream->numUnderruns + 1);
+        }
+    }
+    
+    if (stream->isBuffering != 0 && numQueuedFrames >= stream->latency && numQueuedFrames >= 2)
+    {
+        stream->isBuffering = 0;
+    }
+    
+    event->currentNumChannels = (char)numChannels;
+    event->currentPCMFrameIndex = 0;
+    
+    if (stream->isBuffering != 0)
+    {
+        const int silenceStart = stream->numSlots + KWL_PUSH_STREAM_GUARD_FRAMES;
+        event->currentPCMBuffer = &stream->samples[silenceStart * numChannels];
+        event->currentPCMBufferSize = KWL_PUSH_STREAM_SILENCE_FRAMES;
+    }
+    else
+    {
+        /*Play the queued frames in place, up to the end of the ring buffer. Pitch shifting 
+          interpolates towards the frame after the run, so the run ends at least one frame
+          before the write index, never at a slot the producer may be writing to.*/
+        const int numPlayableFrames = numQueuedFrames - 1;
+        const int numFramesToPlay = numPlayableFrames < KWL_PUSH_STREAM_MAX_RUN_FRAMES ? 
+                                    numPlayableFrames : KWL_PUSH_STREAM_MAX_RUN_FRAMES;
+        event->currentPCMBuffer = &stream->samples[readIndex * numChannels];
+        event->currentPCMBufferSize = kwlPushStream_getRunLength(stream, readIndex, numFramesToPlay);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+#ifndef KWL__PUSH_STREAM_H
+#define KWL__PUSH_STREAM_H
+
+/*! \file */ 
+
+#include "kowalski.h"
+#include "kwl_synchronization.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/** 
+ * The number of frames past the end of the ring buffer that mirror its first frames, 
+ * so that pitch shifting can interpolate across the wrap around point.
+ */
+#define KWL_PUSH_STREAM_GUARD_FRAMES 8
+    
+/** The size in frames of the silent buffer an event plays while its push stream is buffering.*/
+#define KWL_PUSH_STREAM_SILENCE_FRAMES 64
+    
+/** 
+ * The maximum number of queued frames an event plays as one buffer. Played frames are 
+ * released to the producer at the end of each buffer, so this bounds how long they stay
+ * reserved.
+ */
+#define KWL_PUSH_STREAM_MAX_RUN_FRAMES 128
+    
+struct kwlEventInstance;
+
+/**
+ * A wait-free single producer, single consumer ring buffer of 16 bit PCM frames 
+ * that the application feeds incrementally and an event plays from. The mixer
+ * reads the frames straight from the ring buffer.
+ */
+typedef struct kwlPushStream
+{
+    /** 
+     * The interleaved ring buffer samples, followed by \c KWL_PUSH_STREAM_GUARD_FRAMES
+     * guard frames and then \c KWL_PUSH_STREAM_SILENCE_FRAMES silent frames.
+     */
+    short* samples;
+    /** The number of channels. 1 or 2.*/
+    int numChannels;
+    /** 
+     * The number of frame slots in the ring buffer. One slot is always left
+     * empty to tell a full ring buffer from an empty one.
+     */
+    int numSlots;
+    /** The number of frames that must be queued before playback starts or resumes after an underrun.*/
+    int latency;
+    /** The slot the next frame is written to. Only written by the producer.*/
+    volatile int writeIndex;
+    /** The slot the next frame is read from. Only written by the mixer thread.*/
+    volatile int readIndex;
+    /** The number of times playback ran out of queued frames. Only written by the mixer thread.*/
+    volatile int numUnderruns;
+    /** 
+     * Non-zero if the event is playing silence while waiting for \c latency frames
+     * to be queued. Only accessed from the mixer thread.
+     */
+    int isBuffering;
+} kwlPushStream;
+
+/** 
+ * Creates a push stream holding up to \c capacity frames. 
+ * @param numChannels The number of channels, 1 or 2.
+ * @param capacity The maximum number of queued frames.
+ * @param latency The number of frames to queue before starting playback.
+ */
+kwlPushStream* kwlPushStream_new(int numChannels, int capacity, int latency);
+
+/** */
+void kwlPushStream_free(kwlPushStream* stream);
+
+/** 
+ * Queues as many of the given interleaved frames as there is room for. Called from the producer thread.
+ * @return The number of frames queued.
+ */
+int kwlPushStream_write(kwlPushStream* stream, const short* frames, int numFrames);
+
+/** 
+ * Converts and queues as many of the given interleaved frames in the range [-1, 1] as 
+ * there is room for. Called from the producer thread.
+ * @return The number of frames queued.
+ */
+int kwlPushStream_writeFloat(kwlPushStream* stream, const float* frames, int numFrames);
+
+/** Returns the number of frames queued but not yet played. Can be called from any thread.*/
+int kwlPushStream_getNumQueuedFrames(kwlPushStream* stream);
+
+/**
+ * Releases the frames the event played from its current buffer and points the event 
+ * at the next contiguous run of queued frames, or at a silent buffer if the stream is 
+ * buffering or just ran out of frames. The last queued frame is held back until the next
+ * one is written, since pitch shifting interpolates towards it. Called from the mixer thread.
+ * @param stream The stream.
+ * @param event The event playing the stream.
+ * @param firstBuffer Non-zero if the event was just started.
+ * @return Zero, since a push stream plays until the event is stopped.
+ */
+int kwlPushStream_pickNextBufferForEvent(kwlPushStream* stream, struct kwlEventInstance* event, int firstBuffer);
+    
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__PUSH_STREAM_H*/
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+#ifndef KWL__RANDOM_H
+#define KWL__RANDOM_H
+
+/*! \file 
+ Small, explicitly seeded random number generators. Used instead of \c rand() so that 
+ the random choices of the engine and the mixer, e.g random playback modes, gain and 
+ pitch variation and instance stealing, can be reproduced from a seed and do not depend 
+ on shared state.
+ */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/** The generator state used in place of a zero seed, which xorshift cannot leave.*/
+#define KWL_RANDOM_DEFAULT_STATE 0x9e3779b9u
+    
+/** 
+ * Returns a generator state for a seed. The seed is scrambled, so that states made 
+ * from nearby seeds, or from consecutive outputs of another generator, give 
+ * uncorrelated sequences.
+ */
+static inline unsigned int kwlRandom_seed(unsigned int seed)
+{
+    /*The murmur3 finalizer.*/
+    unsigned int x = seed;
+    x ^= x >> 16;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16;
+    return x != 0 ? x : KWL_RANDOM_DEFAULT_STATE;
+}
+
+/** Advances a xorshift32 generator and returns its new state, which is never zero.*/
+static inline unsigned int kwlRandom_next(unsigned int* state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/** Returns a random integer in the range [0, n). \c n must be greater than zero.*/
+static inline int kwlRandom_nextInt(unsigned int* state, int n)
+{
+    return (int)(kwlRandom_next(state) % (unsigned int)n);
+}
+    
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__RANDOM_H*/
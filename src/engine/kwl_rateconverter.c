@@ -0,0 +1,176 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "kwl_rateconverter.h"
+#include "kwl_asm.h"
+#include "kwl_assert.h"
+
+#include <math.h>
+#include <string.h>
+
+void kwlRateConverter_init(kwlRateConverter* converter, int factor, int numChannels, 
+                           int maxOutputFrames, kwlArena* arena)
+{
+    KWL_ASSERT(factor >= 2 && factor <= KWL_MAX_RATE_CONVERSION_FACTOR);
+    KWL_ASSERT(numChannels == 1 || numChannels == 2);
+    
+    const int numTaps = KWL_RATE_CONVERTER_TAPS_PER_PHASE;
+    const int maxInputFrames = (maxOutputFrames + factor - 1) / factor;
+    
+    converter->factor = factor;
+    converter->numChannels = numChannels;
+    converter->coefficients = (float*)kwlArena_alloc(arena, sizeof(float) * factor * numTaps);
+    converter->buffer = 
+        (float*)kwlArena_alloc(arena, sizeof(float) * (numTaps + maxInputFrames) * numChannels);
+    
+    /*
+     Design a Blackman windowed sinc lowpass filter at the output rate, cutting off a bit 
+     below the Nyquist frequency of the input. Inserting factor - 1 zeros between input 
+     frames and applying this filter gives the output. Only every factor-th coefficient 
+     meets a non-zero input frame, so each output frame needs numTaps coefficients, 
+     picked by its phase.
+     */
+    const int length = factor * numTaps;
+    const double center = 0.5 * (length - 1);
+    const double cutoff = 0.45 / factor;
+    const double pi = 3.14159265358979323846;
+    
+    for (int phase = 0; phase < factor; phase++)
+    {
+        float* phaseCoefficients = &converter->coefficients[phase * numTaps];
+        double sum = 0.0;
+        for (int tap = 0; tap < numTaps; tap++)
+        {
+            /*Tap 0 applies to the latest input frame, stored last.*/
+            const int i = phase + factor * tap;
+            const double t = i - center;
+            const double sinc = t == 0.0 ? 1.0 : sin(2.0 * pi * cutoff * t) / (2.0 * pi * cutoff * t);
+            const double window = 0.42 - 0.5 * cos(2.0 * pi * (i + 0.5) / length) + 
+                                  0.08 * cos(4.0 * pi * (i + 0.5) / length);
+            const double h = sinc * window;
+            phaseCoefficients[numTaps - 1 - tap] = (float)h;
+            sum += h;
+        }
+        
+        /*Normalize each phase to unit gain at DC, so that constant input gives constant output.*/
+        for (int tap = 0; tap < numTaps; tap++)
+        {
+            phaseCoefficients[tap] = (float)(phaseCoefficients[tap] / sum);
+        }
+    }
+    
+    kwlRateConverter_reset(converter);
+}
+
+void kwlRateConverter_reset(kwlRateConverter* converter)
+{
+    kwlClearFloatBuffer(converter->buffer, KWL_RATE_CONVERTER_TAPS_PER_PHASE * converter->numChannels);
+    converter->phase = 0;
+    converter->hasHistory = 0;
+}
+
+int kwlRateConverter_getNumInputFrames(const kwlRateConverter* converter, int numOutputFrames)
+{
+    /*A new input frame is consumed by each output frame at phase 0.*/
+    const int factor = converter->factor;
+    const int firstNewFrame = (factor - converter->phase) % factor;
+    if (firstNewFrame >= numOutputFrames)
+    {
+        return 0;
+    }
+    
+    return 1 + (numOutputFrames - 1 - firstNewFrame) / factor;
+}
+
+float* kwlRateConverter_getInputBuffer(kwlRateConverter* converter)
+{
+    return &converter->buffer[KWL_RATE_CONVERTER_TAPS_PER_PHASE * converter->numChannels];
+}
+
+void kwlRateConverter_process(kwlRateConverter* converter, float* outBuffer, int numOutputFrames)
+{
+    const int numTaps = KWL_RATE_CONVERTER_TAPS_PER_PHASE;
+    const int numChannels = converter->numChannels;
+    const int factor = converter->factor;
+    const float* buffer = converter->buffer;
+    
+    /*The buffer index of the first of the numTaps input frames the current output frame depends on.*/
+    int firstFrame = 0;
+    int phase = converter->phase;
+    
+    for (int i = 0; i < numOutputFrames; i++)
+    {
+        if (phase == 0)
+        {
+            firstFrame++;
+        }
+        
+        const float* coefficients = &converter->coefficients[phase * numTaps];
+        const float* in = &buffer[firstFrame * numChannels];
+        
+        /*The stereo case is written out so that both channels share the loop over taps.*/
+        if (numChannels == 2)
+        {
+            float left = 0.0f;
+            float right = 0.0f;
+            for (int tap = 0; tap < numTaps; tap++)
+            {
+                left += coefficients[tap] * in[2 * tap];
+                right += coefficients[tap] * in[2 * tap + 1];
+            }
+            outBuffer[2 * i] += left;
+            outBuffer[2 * i + 1] += right;
+        }
+        else
+        {
+            float sum = 0.0f;
+            for (int tap = 0; tap < numTaps; tap++)
+            {
+                sum += coefficients[tap] * in[tap];
+            }
+            outBuffer[i] += sum;
+        }
+        
+        phase = phase + 1 == factor ? 0 : phase + 1;
+    }
+    
+    /*Keep the last numTaps input frames for the next call.*/
+    const int numHistorySamples = numTaps * numChannels;
+    if (firstFrame > 0)
+    {
+        memmove(converter->buffer, 
+                &converter->buffer[firstFrame * numChannels], 
+                sizeof(float) * numHistorySamples);
+    }
+    converter->phase = phase;
+    
+    converter->hasHistory = 0;
+    for (int i = 0; i < numHistorySamples; i++)
+    {
+        if (converter->buffer[i] != 0.0f)
+        {
+            converter->hasHistory = 1;
+            break;
+        }
+    }
+}
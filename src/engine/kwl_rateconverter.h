@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+#ifndef KWL__RATE_CONVERTER_H
+#define KWL__RATE_CONVERTER_H
+
+/*! \file */ 
+
+#include "kwl_memory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/** The number of input frames each output frame is computed from.*/
+#define KWL_RATE_CONVERTER_TAPS_PER_PHASE 16
+    
+/** The largest supported upsampling factor.*/
+#define KWL_MAX_RATE_CONVERSION_FACTOR 4
+
+/**
+ * Upsamples interleaved audio by an integer factor using a polyphase windowed sinc 
+ * filter. Input is written straight into the input buffer of the converter, after
+ * the input frames kept from the previous call. The output lags the input by 
+ * (factor * KWL_RATE_CONVERTER_TAPS_PER_PHASE - 1) / 2 output frames.
+ */
+typedef struct kwlRateConverter
+{
+    /** The ratio of the output rate to the input rate.*/
+    int factor;
+    /** The number of interleaved channels.*/
+    int numChannels;
+    /** The number of output frames produced so far, modulo \c factor.*/
+    int phase;
+    /** 
+     * \c KWL_RATE_CONVERTER_TAPS_PER_PHASE filter coefficients per phase, in the order 
+     * of the input frames they are applied to. 
+     */
+    float* coefficients;
+    /** The last \c KWL_RATE_CONVERTER_TAPS_PER_PHASE input frames, followed by room for new input.*/
+    float* buffer;
+    /** Non-zero if any of the kept input frames is non-zero, i.e if the output is not yet silent.*/
+    int hasHistory;
+} kwlRateConverter;
+
+/** 
+ * Sets up a converter, allocating its coefficients and buffer from an arena.
+ * @param converter The converter to initialize.
+ * @param factor The upsampling factor, in the range [2, KWL_MAX_RATE_CONVERSION_FACTOR].
+ * @param numChannels The number of channels.
+ * @param maxOutputFrames The largest number of output frames produced by a single call.
+ * @param arena The arena to allocate from.
+ */
+void kwlRateConverter_init(kwlRateConverter* converter, int factor, int numChannels, 
+                           int maxOutputFrames, kwlArena* arena);
+
+/** Clears the kept input frames and restarts the phase.*/
+void kwlRateConverter_reset(kwlRateConverter* converter);
+
+/** Returns the number of new input frames needed to produce a given number of output frames.*/
+int kwlRateConverter_getNumInputFrames(const kwlRateConverter* converter, int numOutputFrames);
+
+/** 
+ * Returns the buffer to write the input frames for the next call to 
+ * \c kwlRateConverter_process to.
+ */
+float* kwlRateConverter_getInputBuffer(kwlRateConverter* converter);
+
+/** 
+ * Converts the input frames written to the input buffer and adds the result 
+ * to an output buffer.
+ * @param converter The converter.
+ * @param outBuffer The interleaved buffer to add the output to.
+ * @param numOutputFrames The number of output frames to produce. The input buffer must
+ * hold the number of frames returned by \c kwlRateConverter_getNumInputFrames.
+ */
+void kwlRateConverter_process(kwlRateConverter* converter, float* outBuffer, int numOutputFrames);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__RATE_CONVERTER_H*/
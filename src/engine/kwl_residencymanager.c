@@ -0,0 +1,379 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "kwl_assert.h"
+#include "kwl_engine.h"
+#include "kwl_eventdefinition.h"
+#include "kwl_memory.h"
+#include "kwl_residencymanager.h"
+#include "kwl_sound.h"
+
+void kwlResidencyManager_init(kwlResidencyManager* manager)
+{
+    kwlMemset(manager, 0, sizeof(kwlResidencyManager));
+    kwlMutexLockInit(&manager->lock);
+}
+
+void kwlResidencyManager_free(kwlResidencyManager* manager)
+{
+    if (manager->isReloadThreadRunning != 0)
+    {
+        manager->threadJoinRequested = 1;
+        kwlSemaphorePost(manager->semaphore);
+        kwlThreadJoin(&manager->reloadThread);
+        kwlSemaphoreDestroy(manager->semaphore, manager->semaphoreName);
+        manager->isReloadThreadRunning = 0;
+    }
+    
+    int i;
+    for (i = 0; i < KWL_MAX_PENDING_RELOADS; i++)
+    {
+        kwlReloadRequest* request = &manager->requests[i];
+        if (request->bytes != NULL)
+        {
+            KWL_FREE(request->bytes);
+            request->bytes = NULL;
+        }
+        request->state = KWL_RELOAD_REQUEST_FREE;
+        request->audioData = NULL;
+    }
+}
+
+/** Requests a reload of a given evicted audio data entry, unless a reload is already pending.*/
+static void kwlResidencyManager_requestReload(kwlResidencyManager* manager, kwlAudioData* audioData)
+{
+    if (audioData->isEvicted == 0 || audioData->isReloadPending != 0)
+    {
+        return;
+    }
+    
+    const char* path = audioData->waveBank->waveBankFilePath;
+    if (path == NULL || strlen(path) >= KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH)
+    {
+        return;
+    }
+    
+    kwlMutexLockAcquire(&manager->lock);
+    kwlReloadRequest* request = NULL;
+    int i;
+    for (i = 0; i < KWL_MAX_PENDING_RELOADS; i++)
+    {
+        if (manager->requests[i].state == KWL_RELOAD_REQUEST_FREE)
+        {
+            request = &manager->requests[i];
+            break;
+        }
+    }
+    
+    if (request == NULL)
+    {
+        /*All request slots are taken. The reload is requested again the next time
+          the audio data is needed.*/
+        kwlMutexLockRelease(&manager->lock);
+        return;
+    }
+    
+    request->audioData = audioData;
+    strcpy(request->filePath, path);
+    request->fileOffset = audioData->fileOffset;
+    request->numBytes = audioData->numBytes;
+    request->bytes = NULL;
+    request->state = KWL_RELOAD_REQUEST_PENDING;
+    audioData->isReloadPending = 1;
+    kwlMutexLockRelease(&manager->lock);
+    
+    if (manager->isReloadThreadRunning == 0)
+    {
+        /*Create a semaphore with a unique name based on the full address of the manager*/
+        sprintf(manager->semaphoreName, "residency%p", (void*)manager);
+        manager->semaphore = kwlSemaphoreOpen(manager->semaphoreName);
+        manager->threadJoinRequested = 0;
+        kwlThreadCreate(&manager->reloadThread, kwlResidencyManager_reloadThreadEntryPoint, manager);
+        manager->isReloadThreadRunning = 1;
+    }
+    
+    kwlSemaphorePost(manager->semaphore);
+}
+
+void* kwlResidencyManager_reloadThreadEntryPoint(void* userData)
+{
+    kwlResidencyManager* manager = (kwlResidencyManager*)userData;
+    
+    while (1)
+    {
+        kwlSemaphoreWait(manager->semaphore);
+        
+        if (manager->threadJoinRequested != 0)
+        {
+            return NULL;
+        }
+        
+        /*Serve all pending requests.*/
+        while (1)
+        {
+            kwlMutexLockAcquire(&manager->lock);
+            kwlReloadRequest* request = NULL;
+            int i;
+            for (i = 0; i < KWL_MAX_PENDING_RELOADS; i++)
+            {
+                if (manager->requests[i].state == KWL_RELOAD_REQUEST_PENDING)
+                {
+                    request = &manager->requests[i];
+                    request->state = KWL_RELOAD_REQUEST_LOADING;
+                    break;
+                }
+            }
+            kwlMutexLockRelease(&manager->lock);
+            
+            if (request == NULL)
+            {
+                break;
+            }
+            
+            /*The path, offset and size of a loading request are not modified by the engine thread.*/
+            void* bytes = NULL;
+            kwlInputStream stream;
+            if (kwlInputStream_initWithFileRegion(&stream, 
+                                                  request->filePath, 
+                                                  request->fileOffset, 
+                                                  request->numBytes) == KWL_NO_ERROR)
+            {
+                bytes = KWL_MALLOC(request->numBytes, "reloaded audio data");
+                if (kwlInputStream_read(&stream, (signed char*)bytes, request->numBytes) != request->numBytes)
+                {
+                    KWL_FREE(bytes);
+                    bytes = NULL;
+                }
+            }
+            kwlInputStream_close(&stream);
+            
+            kwlMutexLockAcquire(&manager->lock);
+            request->bytes = bytes;
+            request->state = KWL_RELOAD_REQUEST_DONE;
+            kwlMutexLockRelease(&manager->lock);
+        }
+    }
+    
+    return NULL;
+}
+
+/** Hands audio data read by the reload thread to the audio data entries it was read for.*/
+static void kwlResidencyManager_installReloads(kwlResidencyManager* manager)
+{
+    kwlMutexLockAcquire(&manager->lock);
+    int i;
+    for (i = 0; i < KWL_MAX_PENDING_RELOADS; i++)
+    {
+        kwlReloadRequest* request = &manager->requests[i];
+        if (request->state != KWL_RELOAD_REQUEST_DONE)
+        {
+            continue;
+        }
+        
+        kwlAudioData* audioData = request->audioData;
+        void* bytes = request->bytes;
+        request->audioData = NULL;
+        request->bytes = NULL;
+        request->state = KWL_RELOAD_REQUEST_FREE;
+        
+        if (audioData != NULL && audioData->isLoaded != 0 && audioData->isEvicted != 0 && bytes != NULL)
+        {
+            kwlWaveBank_setAudioDataBytes(audioData->waveBank, audioData, bytes);
+            audioData->isReloadPending = 0;
+            audioData->lastUseUpdate = manager->updateIndex;
+            /*Publish the bytes to the mixer thread.*/
+            kwlAtomicStoreRelease(&audioData->isEvicted, 0);
+        }
+        else
+        {
+            /*The request was cancelled, the audio data was unloaded or reloaded 
+              some other way in the meantime, or reading failed.*/
+            if (bytes != NULL)
+            {
+                KWL_FREE(bytes);
+            }
+            if (audioData != NULL)
+            {
+                audioData->isReloadPending = 0;
+            }
+        }
+    }
+    kwlMutexLockRelease(&manager->lock);
+}
+
+void kwlResidencyManager_cancelReloads(kwlResidencyManager* manager)
+{
+    kwlMutexLockAcquire(&manager->lock);
+    int i;
+    for (i = 0; i < KWL_MAX_PENDING_RELOADS; i++)
+    {
+        kwlReloadRequest* request = &manager->requests[i];
+        request->audioData = NULL;
+        if (request->state == KWL_RELOAD_REQUEST_PENDING)
+        {
+            request->state = KWL_RELOAD_REQUEST_FREE;
+        }
+        /*Loading requests are freed when they are done.*/
+    }
+    kwlMutexLockRelease(&manager->lock);
+}
+
+/** Orders audio data entries by increasing time of last use.*/
+static int kwlResidencyManager_compareLastUse(const void* a, const void* b)
+{
+    const kwlAudioData* audioDataA = *(const kwlAudioData* const*)a;
+    const kwlAudioData* audioDataB = *(const kwlAudioData* const*)b;
+    return audioDataA->lastUseUpdate - audioDataB->lastUseUpdate;
+}
+
+/** Evicts least recently used audio data until the engine is within budget or there is nothing left to evict.*/
+static void kwlResidencyManager_evict(kwlResidencyManager* manager, kwlEngine* engine)
+{
+    kwlEngineData* data = &engine->engineData;
+    const int updateIndex = manager->updateIndex;
+    
+    /*Mark the audio data that the mixer may be reading. Sound driven events may
+      pick any piece of audio data of their sound when they start a new buffer.*/
+    kwlEventInstance* event = engine->playingEventList;
+    while (event != NULL)
+    {
+        kwlEventDefinition* definition = event->definition_engine;
+        if (definition->sound != NULL)
+        {
+            int i;
+            for (i = 0; i < definition->sound->numAudioDataEntries; i++)
+            {
+                definition->sound->audioDataEntries[i]->playingMarkUpdate = updateIndex;
+            }
+        }
+        if (definition->streamAudioData != NULL)
+        {
+            definition->streamAudioData->playingMarkUpdate = updateIndex;
+        }
+        event = event->nextEvent_engine;
+    }
+    
+    /*Collect the resident, non-streaming wave bank audio data that is not in use...*/
+    kwlAudioData** candidates = 
+        (kwlAudioData**)kwlArena_alloc(&engine->scratchArena, 
+                                       data->totalNumAudioDataEntries * sizeof(kwlAudioData*));
+    int numCandidates = 0;
+    int i;
+    for (i = 0; i < data->totalNumAudioDataEntries; i++)
+    {
+        kwlAudioData* audioData = &data->audioDataEntries[i];
+        if (audioData->isLoaded != 0 && 
+            audioData->waveBank != NULL &&
+            audioData->streamFromDisk == 0 &&
+            audioData->bytes != NULL &&
+            audioData->isEvicted == 0 &&
+            audioData->playingMarkUpdate != updateIndex)
+        {
+            candidates[numCandidates++] = audioData;
+        }
+    }
+    
+    /*...and evict the least recently used first.*/
+    qsort(candidates, numCandidates, sizeof(kwlAudioData*), kwlResidencyManager_compareLastUse);
+    
+    for (i = 0; i < numCandidates && engine->audioDataStore->numResidentBytes > manager->budget; i++)
+    {
+        kwlAudioData* audioData = candidates[i];
+        kwlAtomicStoreRelease(&audioData->isEvicted, 1);
+        kwlWaveBank_releaseAudioDataBytes(audioData->waveBank, audioData);
+    }
+}
+
+void kwlResidencyManager_update(kwlResidencyManager* manager, kwlEngine* engine)
+{
+    manager->updateIndex++;
+    kwlResidencyManager_installReloads(manager);
+    
+    kwlEngineData* data = &engine->engineData;
+    if (manager->budget <= 0 || data->isLoaded == 0)
+    {
+        return;
+    }
+    
+    /*Pick up the audio data used by the mixer since the last update.*/
+    const int updateIndex = manager->updateIndex;
+    int i;
+    for (i = 0; i < data->totalNumAudioDataEntries; i++)
+    {
+        kwlAudioData* audioData = &data->audioDataEntries[i];
+        if (audioData->isLoaded == 0)
+        {
+            continue;
+        }
+        
+        const int numUses = audioData->numUses;
+        if (audioData->lastUseUpdate == 0 || numUses != audioData->numUsesSeen)
+        {
+            /*Treat newly loaded audio data as just used.*/
+            audioData->lastUseUpdate = updateIndex;
+            audioData->numUsesSeen = numUses;
+        }
+    }
+    
+    if (engine->audioDataStore->numResidentBytes > manager->budget)
+    {
+        kwlResidencyManager_evict(manager, engine);
+    }
+}
+
+void kwlResidencyManager_prepareAudioData(kwlResidencyManager* manager, kwlAudioData* audioData)
+{
+    audioData->lastUseUpdate = manager->updateIndex;
+    if (audioData->isEvicted != 0)
+    {
+        kwlResidencyManager_requestReload(manager, audioData);
+    }
+}
+
+kwlAudioData* kwlResidencyManager_prepareSound(kwlResidencyManager* manager, kwlSound* sound)
+{
+    kwlAudioData* firstEvictedAudioData = NULL;
+    int numResident = 0;
+    int i;
+    for (i = 0; i < sound->numAudioDataEntries; i++)
+    {
+        kwlAudioData* audioData = sound->audioDataEntries[i];
+        kwlResidencyManager_prepareAudioData(manager, audioData);
+        if (audioData->isEvicted != 0)
+        {
+            if (firstEvictedAudioData == NULL)
+            {
+                firstEvictedAudioData = audioData;
+            }
+        }
+        else if (audioData->bytes != NULL)
+        {
+            numResident++;
+        }
+    }
+    
+    return numResident == 0 ? firstEvictedAudioData : NULL;
+}
@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef KWL__RESIDENCY_MANAGER_H
+#define KWL__RESIDENCY_MANAGER_H
+
+/*! \file */ 
+
+#include "kowalski.h"
+#include "kwl_audiodata.h"
+#include "kwl_synchronization.h"
+#include "kwl_wavebank.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+struct kwlEngine;
+struct kwlSound;
+    
+/** The maximum number of evicted audio data entries being reloaded at any given time.*/
+#define KWL_MAX_PENDING_RELOADS 16
+    
+/** The state of a reload request.*/
+typedef enum kwlReloadRequestState
+{
+    /** The request slot is unused.*/
+    KWL_RELOAD_REQUEST_FREE = 0,
+    /** The request is waiting for the reload thread.*/
+    KWL_RELOAD_REQUEST_PENDING,
+    /** The reload thread is reading the audio data.*/
+    KWL_RELOAD_REQUEST_LOADING,
+    /** The audio data has been read and is waiting to be installed by the engine thread.*/
+    KWL_RELOAD_REQUEST_DONE
+} kwlReloadRequestState;
+
+/** A request to read the bytes of an evicted audio data entry from its wave bank file.*/
+typedef struct kwlReloadRequest
+{
+    /** The state of the request. Protected by the residency manager lock.*/
+    kwlReloadRequestState state;
+    /** 
+     * The audio data entry to reload, or NULL if the request was cancelled. 
+     * Only accessed from the engine thread.
+     */
+    kwlAudioData* audioData;
+    /** The path of the wave bank file to read from.*/
+    char filePath[KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH];
+    /** The offset of the audio data bytes in the wave bank file.*/
+    int fileOffset;
+    /** The number of audio data bytes.*/
+    int numBytes;
+    /** The bytes read by the reload thread, or NULL if reading failed.*/
+    void* bytes;
+} kwlReloadRequest;
+
+/**
+ * Keeps the memory used by non-streaming wave bank audio data within a budget. Audio data
+ * that is not referenced by any playing event is evicted in least recently used order when
+ * the budget is exceeded, and reloaded on a separate thread when an event referencing it is 
+ * started. Events started while the audio data they need is evicted stream it from the wave 
+ * bank file instead. All functions except the reload thread entry point are called from the 
+ * engine thread.
+ */
+typedef struct kwlResidencyManager
+{
+    /** The audio memory budget in bytes, or 0 if there is no budget.*/
+    int budget;
+    /** The number of residency updates performed. Used as the clock for least recently used eviction.*/
+    int updateIndex;
+    /** Reload requests, protected by \c lock.*/
+    kwlReloadRequest requests[KWL_MAX_PENDING_RELOADS];
+    /** Protects the reload requests.*/
+    kwlMutexLock lock;
+    /** The thread reading evicted audio data. Started when the first reload is requested.*/
+    kwlThread reloadThread;
+    /** Non-zero if \c reloadThread has been started.*/
+    int isReloadThreadRunning;
+    /** Non-zero if the reload thread should exit.*/
+    volatile int threadJoinRequested;
+    /** Posted when there are pending reload requests.*/
+    kwlSemaphore* semaphore;
+    /** The unique name of the reload semaphore.*/
+    char semaphoreName[64];
+} kwlResidencyManager;
+
+/** */
+void kwlResidencyManager_init(kwlResidencyManager* manager);
+
+/** Stops the reload thread and frees any reloaded audio data that was not installed.*/
+void kwlResidencyManager_free(kwlResidencyManager* manager);
+
+/**
+ * Installs reloaded audio data, tracks audio data usage and evicts least recently used audio
+ * data not referenced by any playing event while the engine is over budget. Called once per 
+ * engine update, after the messages from the mixer have been processed.
+ */
+void kwlResidencyManager_update(kwlResidencyManager* manager, struct kwlEngine* engine);
+
+/**
+ * Prepares a given sound for playback by marking its audio data as used and requesting reloads
+ * of any evicted audio data.
+ * @return The audio data entry to stream if none of the audio data of the sound is resident, 
+ * NULL otherwise.
+ */
+kwlAudioData* kwlResidencyManager_prepareSound(kwlResidencyManager* manager, struct kwlSound* sound);
+
+/**
+ * Marks a given audio data entry as used and requests a reload if it is evicted.
+ */
+void kwlResidencyManager_prepareAudioData(kwlResidencyManager* manager, kwlAudioData* audioData);
+
+/** 
+ * Cancels all reload requests. Must be called before the audio data entries of the engine 
+ * data are freed.
+ */
+void kwlResidencyManager_cancelReloads(kwlResidencyManager* manager);
+
+/** The entry point of the reload thread.*/
+void* kwlResidencyManager_reloadThreadEntryPoint(void* userData);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__RESIDENCY_MANAGER_H*/
@@ -22,10 +22,11 @@ freely, subject to the following restrictions:
 */
 
 #include "kwl_memory.h"
+#include "kwl_random.h"
 #include "kwl_sound.h"
+#include "kwl_synchronization.h"
 
 #include "kwl_assert.h"
-#include <stdlib.h>
 
 void kwlSound_init(kwlSound* sound)
 {
@@ -67,7 +68,8 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
                      sound->playbackCount >= 0;
     
     /*compute new pitch*/
-    float randVal = -1 + 0.0002f * (rand() % 10000);
+    unsigned int* randomState = &event->randomState;
+    float randVal = -1 + 0.0002f * kwlRandom_nextInt(randomState, 10000);
     float newPitch = sound->pitch + randVal * 0.01f * sound->pitchVariation;
     if (newPitch < PITCH_EPSILON)
     {
@@ -77,7 +79,7 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
     event->soundPitch = newPitch;
     
     /*compute new gain*/
-    randVal = -1 + 0.0002f * (rand() % 10000);
+    randVal = -1 + 0.0002f * kwlRandom_nextInt(randomState, 10000);
     float newGain = sound->gain + randVal * 0.01f * sound->gainVariation;
     if (newGain < 0.0f)
     {
@@ -89,13 +91,13 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
     if (sound->playbackMode == KWL_RANDOM)
     {
         /*Pick a new random audio data index.*/
-        newIndex = rand() % sound->numAudioDataEntries;
+        newIndex = kwlRandom_nextInt(randomState, sound->numAudioDataEntries);
     }
     else if (sound->playbackMode == KWL_RANDOM_NO_REPEAT)
     {
         /*Pick a new random audio data index and make sure it's not the same
          as the last one (it will be in the degenerate case of 1 item).*/
-        newIndex = rand() % sound->numAudioDataEntries;
+        newIndex = kwlRandom_nextInt(randomState, sound->numAudioDataEntries);
         if (newIndex == event->currentAudioDataIndex)
         {
             newIndex = (newIndex + 1) % sound->numAudioDataEntries;
@@ -128,14 +130,14 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
                 newIndex = sound->numAudioDataEntries - 1;
                 event->playbackState = KWL_PLAYING_LAST_BUFFER;
             }
-            else if (sound->numAudioDataEntries < 2)
+            else if (sound->numAudioDataEntries < 3)
             {
-                //degenerate case. keep playing the first item.
+                //degenerate case, there are no items between the first and the last. keep playing the first item.
                 newIndex = 0;
             }
             else
             {
-                newIndex = 1 + rand() % (sound->numAudioDataEntries - 2);
+                newIndex = 1 + kwlRandom_nextInt(randomState, sound->numAudioDataEntries - 2);
             }
         }
     }
@@ -154,14 +156,14 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
                 newIndex = sound->numAudioDataEntries - 1;
                 event->playbackState = KWL_PLAYING_LAST_BUFFER;
             }
-            else if (sound->numAudioDataEntries < 2)
+            else if (sound->numAudioDataEntries < 3)
             {
-                //degenerate case. keep playing the first item.
+                //degenerate case, there are no items between the first and the last. keep playing the first item.
                 newIndex = 0;
             }
             else
             {
-                newIndex = 1 + rand() % (sound->numAudioDataEntries - 2);
+                newIndex = 1 + kwlRandom_nextInt(randomState, sound->numAudioDataEntries - 2);
                 if (newIndex == event->currentAudioDataIndex)
                 {
                     newIndex = (newIndex + 1) % (sound->numAudioDataEntries - 2);
@@ -184,9 +186,9 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
                 newIndex = sound->numAudioDataEntries - 1;
                 event->playbackState = KWL_PLAYING_LAST_BUFFER;
             }
-            else if (sound->numAudioDataEntries < 2)
+            else if (sound->numAudioDataEntries < 3)
             {
-                //degenerate case. keep playing the first item.
+                //degenerate case, there are no items between the first and the last. keep playing the first item.
                 newIndex = 0;
             }
             else
@@ -201,12 +203,32 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
     }
     
     kwlAudioData* nextAudioData = sound->audioDataEntries[newIndex];
-    if (nextAudioData->bytes == NULL)
+    if (kwlAtomicLoadAcquire(&nextAudioData->isEvicted) != 0)
+    {
+        /*The audio data was evicted to stay within the audio memory budget and is being
+          reloaded. Play the next resident piece of audio data of the sound in the meantime.*/
+        int i;
+        for (i = 1; i < sound->numAudioDataEntries; i++)
+        {
+            kwlAudioData* candidate = sound->audioDataEntries[(newIndex + i) % sound->numAudioDataEntries];
+            if (kwlAtomicLoadAcquire(&candidate->isEvicted) == 0 && candidate->bytes != NULL)
+            {
+                newIndex = (newIndex + i) % sound->numAudioDataEntries;
+                nextAudioData = candidate;
+                break;
+            }
+        }
+    }
+    
+    if (kwlAtomicLoadAcquire(&nextAudioData->isEvicted) != 0 || nextAudioData->bytes == NULL)
     {
         /*If the new piece of audio data has not been loaded, return 1 to indicate that
          playback should end.*/
         return 1;
     }
+    
+    /*Let the residency manager know that the audio data is in use.*/
+    nextAudioData->numUses++;
     KWL_ASSERT(nextAudioData->numChannels > 0);
     
     /*Set the new event state*/
@@ -233,6 +255,7 @@ int kwlSound_pickNextBufferForEvent(kwlSound* sound, kwlEventInstance* event, in
     event->currentPCMBuffer = (short*)nextAudioData->bytes;
     event->currentPCMBufferSize = numFrames - 1;
     event->currentNumChannels = nextAudioData->numChannels;
+    event->currentSampleRate = nextAudioData->sampleRate;
     
     /*Finally, return 0 to indicate that playback should continue.*/
     return 0;
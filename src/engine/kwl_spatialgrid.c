@@ -0,0 +1,244 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "kwl_spatialgrid.h"
+#include "kwl_eventinstance.h"
+#include "kwl_memory.h"
+#include "kwl_assert.h"
+
+#include <math.h>
+
+/** Returns the clamped coordinate of the cell containing a position along one axis.*/
+static int kwlSpatialGrid_getCellCoordinate(const kwlSpatialGrid* grid, float position)
+{
+    const float maxCoordinate = (float)KWL_SPATIAL_GRID_MAX_CELL_COORDINATE;
+    float cell = floorf(position * grid->cellSizeInv);
+    /*Written so that NaN positions end up in a valid cell too.*/
+    if (!(cell > -maxCoordinate))
+    {
+        cell = -maxCoordinate;
+    }
+    else if (cell > maxCoordinate)
+    {
+        cell = maxCoordinate;
+    }
+    return (int)cell;
+}
+
+/** Returns the bucket of a cell.*/
+static int kwlSpatialGrid_getBucket(int cellX, int cellY, int cellZ)
+{
+    const unsigned int hash = ((unsigned int)cellX * 73856093u) ^ 
+                              ((unsigned int)cellY * 19349663u) ^ 
+                              ((unsigned int)cellZ * 83492791u);
+    return (int)(hash & (KWL_SPATIAL_GRID_NUM_BUCKETS - 1));
+}
+
+/** Links an instance into the bucket of its current cell.*/
+static void kwlSpatialGrid_link(kwlSpatialGrid* grid, kwlEventInstance* event)
+{
+    const int bucket = kwlSpatialGrid_getBucket(event->gridCell[0], event->gridCell[1], event->gridCell[2]);
+    kwlEventInstance* head = grid->buckets[bucket];
+    event->gridBucket = bucket;
+    event->prevInGridBucket = NULL;
+    event->nextInGridBucket = head;
+    if (head != NULL)
+    {
+        head->prevInGridBucket = event;
+    }
+    grid->buckets[bucket] = event;
+}
+
+/** Unlinks an instance from its bucket.*/
+static void kwlSpatialGrid_unlink(kwlSpatialGrid* grid, kwlEventInstance* event)
+{
+    if (event->prevInGridBucket == NULL)
+    {
+        KWL_ASSERT(grid->buckets[event->gridBucket] == event);
+        grid->buckets[event->gridBucket] = event->nextInGridBucket;
+    }
+    else
+    {
+        event->prevInGridBucket->nextInGridBucket = event->nextInGridBucket;
+    }
+    
+    if (event->nextInGridBucket != NULL)
+    {
+        event->nextInGridBucket->prevInGridBucket = event->prevInGridBucket;
+    }
+    
+    event->nextInGridBucket = NULL;
+    event->prevInGridBucket = NULL;
+    event->gridBucket = -1;
+}
+
+void kwlSpatialGrid_init(kwlSpatialGrid* grid)
+{
+    grid->buckets = NULL;
+    grid->cellSize = 0.0f;
+    grid->cellSizeInv = 0.0f;
+    grid->numEvents = 0;
+}
+
+void kwlSpatialGrid_enable(kwlSpatialGrid* grid, float cellSize)
+{
+    KWL_ASSERT(grid->buckets == NULL && "the grid is already enabled");
+    KWL_ASSERT(cellSize > 0.0f);
+    
+    const int bucketsSize = sizeof(kwlEventInstance*) * KWL_SPATIAL_GRID_NUM_BUCKETS;
+    grid->buckets = (kwlEventInstance**)KWL_MALLOC(bucketsSize, "spatial grid buckets");
+    kwlMemset(grid->buckets, 0, bucketsSize);
+    grid->cellSize = cellSize;
+    grid->cellSizeInv = 1.0f / cellSize;
+    grid->numEvents = 0;
+}
+
+void kwlSpatialGrid_free(kwlSpatialGrid* grid)
+{
+    if (grid->buckets != NULL)
+    {
+        KWL_FREE(grid->buckets);
+    }
+    kwlSpatialGrid_init(grid);
+}
+
+void kwlSpatialGrid_insert(kwlSpatialGrid* grid, kwlEventInstance* event)
+{
+    KWL_ASSERT(grid->buckets != NULL);
+    KWL_ASSERT(event->gridBucket < 0 && "the event is already in the grid");
+    
+    event->gridCell[0] = kwlSpatialGrid_getCellCoordinate(grid, event->positionX);
+    event->gridCell[1] = kwlSpatialGrid_getCellCoordinate(grid, event->positionY);
+    event->gridCell[2] = kwlSpatialGrid_getCellCoordinate(grid, event->positionZ);
+    kwlSpatialGrid_link(grid, event);
+    grid->numEvents++;
+}
+
+void kwlSpatialGrid_remove(kwlSpatialGrid* grid, kwlEventInstance* event)
+{
+    if (event->gridBucket < 0)
+    {
+        return;
+    }
+    
+    kwlSpatialGrid_unlink(grid, event);
+    grid->numEvents--;
+}
+
+void kwlSpatialGrid_update(kwlSpatialGrid* grid, kwlEventInstance* event)
+{
+    if (event->gridBucket < 0)
+    {
+        return;
+    }
+    
+    const int cellX = kwlSpatialGrid_getCellCoordinate(grid, event->positionX);
+    const int cellY = kwlSpatialGrid_getCellCoordinate(grid, event->positionY);
+    const int cellZ = kwlSpatialGrid_getCellCoordinate(grid, event->positionZ);
+    if (cellX == event->gridCell[0] && cellY == event->gridCell[1] && cellZ == event->gridCell[2])
+    {
+        /*Still in the same cell, which is the common case for small moves.*/
+        return;
+    }
+    
+    kwlSpatialGrid_unlink(grid, event);
+    event->gridCell[0] = cellX;
+    event->gridCell[1] = cellY;
+    event->gridCell[2] = cellZ;
+    kwlSpatialGrid_link(grid, event);
+}
+
+/** Marks the instances of a bucket that are in a cell within the given bounds.*/
+static int kwlSpatialGrid_markBucket(kwlSpatialGrid* grid, int bucket, 
+                                     const int* minCell, const int* maxCell, 
+                                     unsigned int stamp)
+{
+    int numMarked = 0;
+    kwlEventInstance* event = grid->buckets[bucket];
+    while (event != NULL)
+    {
+        /*Distant cells may share the bucket, so check the cell of every instance.*/
+        if (event->spatialQueryStamp != stamp &&
+            event->gridCell[0] >= minCell[0] && event->gridCell[0] <= maxCell[0] &&
+            event->gridCell[1] >= minCell[1] && event->gridCell[1] <= maxCell[1] &&
+            event->gridCell[2] >= minCell[2] && event->gridCell[2] <= maxCell[2])
+        {
+            event->spatialQueryStamp = stamp;
+            numMarked++;
+        }
+        event = event->nextInGridBucket;
+    }
+    return numMarked;
+}
+
+int kwlSpatialGrid_markEventsInRange(kwlSpatialGrid* grid, 
+                                     float x, float y, float z, 
+                                     float radius, 
+                                     unsigned int stamp)
+{
+    KWL_ASSERT(grid->buckets != NULL);
+    KWL_ASSERT(radius >= 0.0f);
+    
+    const int minCell[3] = 
+    {
+        kwlSpatialGrid_getCellCoordinate(grid, x - radius),
+        kwlSpatialGrid_getCellCoordinate(grid, y - radius),
+        kwlSpatialGrid_getCellCoordinate(grid, z - radius)
+    };
+    const int maxCell[3] = 
+    {
+        kwlSpatialGrid_getCellCoordinate(grid, x + radius),
+        kwlSpatialGrid_getCellCoordinate(grid, y + radius),
+        kwlSpatialGrid_getCellCoordinate(grid, z + radius)
+    };
+    
+    int numMarked = 0;
+    const double numCells = (double)(maxCell[0] - minCell[0] + 1) * 
+                            (double)(maxCell[1] - minCell[1] + 1) * 
+                            (double)(maxCell[2] - minCell[2] + 1);
+    if (numCells > KWL_SPATIAL_GRID_NUM_BUCKETS)
+    {
+        /*The cells are small compared to the range, so visiting every bucket once is cheaper.*/
+        int bucket;
+        for (bucket = 0; bucket < KWL_SPATIAL_GRID_NUM_BUCKETS; bucket++)
+        {
+            numMarked += kwlSpatialGrid_markBucket(grid, bucket, minCell, maxCell, stamp);
+        }
+        return numMarked;
+    }
+    
+    int cellX, cellY, cellZ;
+    for (cellZ = minCell[2]; cellZ <= maxCell[2]; cellZ++)
+    {
+        for (cellY = minCell[1]; cellY <= maxCell[1]; cellY++)
+        {
+            for (cellX = minCell[0]; cellX <= maxCell[0]; cellX++)
+            {
+                const int bucket = kwlSpatialGrid_getBucket(cellX, cellY, cellZ);
+                numMarked += kwlSpatialGrid_markBucket(grid, bucket, minCell, maxCell, stamp);
+            }
+        }
+    }
+    
+    return numMarked;
+}
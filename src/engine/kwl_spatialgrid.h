@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+#ifndef KWL__SPATIAL_GRID_H
+#define KWL__SPATIAL_GRID_H
+
+/*! \file */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+struct kwlEventInstance;
+    
+/** The number of buckets in a spatial grid. Must be a power of two.*/
+#define KWL_SPATIAL_GRID_NUM_BUCKETS 4096
+    
+/** 
+ * Cell coordinates are clamped to this magnitude, so that positions far from the 
+ * origin map to the outermost cells instead of overflowing.
+ */
+#define KWL_SPATIAL_GRID_MAX_CELL_COORDINATE (1 << 20)
+
+/**
+ * A uniform grid of cubic cells indexing positional event instances by position. 
+ * Space is unbounded, so cells are hashed into a fixed number of buckets and 
+ * distant cells may share a bucket. Each bucket is an intrusive doubly linked list 
+ * of the instances in its cells, so inserting, removing and moving an instance 
+ * takes constant time and the grid never allocates after being enabled.
+ */
+typedef struct kwlSpatialGrid
+{
+    /** The bucket list heads, or NULL if the grid is disabled.*/
+    struct kwlEventInstance** buckets;
+    /** The edge length of a cell.*/
+    float cellSize;
+    /** The reciprocal of \c cellSize.*/
+    float cellSizeInv;
+    /** The number of instances in the grid.*/
+    int numEvents;
+} kwlSpatialGrid;
+
+/** Initializes a disabled grid.*/
+void kwlSpatialGrid_init(kwlSpatialGrid* grid);
+
+/** 
+ * Allocates the buckets of a disabled grid.
+ * @param grid The grid.
+ * @param cellSize The edge length of a cell. Must be greater than zero.
+ */
+void kwlSpatialGrid_enable(kwlSpatialGrid* grid, float cellSize);
+
+/** 
+ * Releases the buckets of a grid, disabling it. Instances in the grid are 
+ * not unlinked, so callers must reset their grid fields.
+ */
+void kwlSpatialGrid_free(kwlSpatialGrid* grid);
+
+/** Adds an instance to the grid cell containing its position.*/
+void kwlSpatialGrid_insert(kwlSpatialGrid* grid, struct kwlEventInstance* event);
+
+/** Removes an instance from the grid. Does nothing if the instance is not in the grid.*/
+void kwlSpatialGrid_remove(kwlSpatialGrid* grid, struct kwlEventInstance* event);
+
+/** 
+ * Moves an instance to the cell containing its current position. Should be called
+ * whenever the position changes. Does nothing if the instance is not in the grid.
+ */
+void kwlSpatialGrid_update(kwlSpatialGrid* grid, struct kwlEventInstance* event);
+
+/**
+ * Sets the \c spatialQueryStamp of every instance in a cell overlapping the axis aligned 
+ * box enclosing a sphere. Every instance within \c radius of the center gets marked, along 
+ * with some instances that are slightly further away.
+ * @param grid The grid.
+ * @param x The x coordinate of the sphere center.
+ * @param y The y coordinate of the sphere center.
+ * @param z The z coordinate of the sphere center.
+ * @param radius The sphere radius.
+ * @param stamp The value to mark instances with.
+ * @return The number of marked instances.
+ */
+int kwlSpatialGrid_markEventsInRange(kwlSpatialGrid* grid, 
+                                     float x, float y, float z, 
+                                     float radius, 
+                                     unsigned int stamp);
+    
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /*KWL__SPATIAL_GRID_H*/
@@ -40,6 +40,9 @@ extern "C"
 #ifdef _WIN32
     #include <windows.h>
     typedef CRITICAL_SECTION kwlMutexLock;
+    typedef DWORD kwlThreadId;
+    typedef INIT_ONCE kwlOnceFlag;
+    #define KWL_ONCE_FLAG_INIT INIT_ONCE_STATIC_INIT
     //TODO kwlSemaphore
     //TODO kwlThread
 #else
@@ -49,6 +52,16 @@ extern "C"
     typedef sem_t kwlSemaphore;
     typedef pthread_mutex_t kwlMutexLock;
     typedef pthread_t kwlThread;
+    typedef pthread_t kwlThreadId;
+    typedef pthread_once_t kwlOnceFlag;
+    #define KWL_ONCE_FLAG_INIT PTHREAD_ONCE_INIT
+#endif //_WIN32
+
+/** Declares a variable with one instance per thread.*/
+#ifdef _WIN32
+    #define KWL_THREAD_LOCAL __declspec(thread)
+#else
+    #define KWL_THREAD_LOCAL __thread
 #endif //_WIN32
 
 /**
@@ -148,6 +161,73 @@ typedef struct kwlSharedInt
     int valueEngine;
 }  kwlSharedInt;
 
+/**
+ * Loads an int written by another thread, with acquire semantics: memory
+ * written by that thread before the matching \c kwlAtomicStoreRelease is
+ * visible after this call. Meant for lock-free single producer, single 
+ * consumer exchange between threads.
+ */
+static inline int kwlAtomicLoadAcquire(volatile int* value)
+{
+#ifdef _WIN32
+    int result = *value;
+    MemoryBarrier();
+    return result;
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif //_WIN32
+}
+
+/**
+ * Stores an int to be read by another thread, with release semantics: memory
+ * written before this call is visible to a thread that loads the new value
+ * with \c kwlAtomicLoadAcquire.
+ */
+static inline void kwlAtomicStoreRelease(volatile int* value, int newValue)
+{
+#ifdef _WIN32
+    MemoryBarrier();
+    *value = newValue;
+#else
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#endif //_WIN32
+}
+
+/**
+ * Atomically replaces an int with \c newValue if it equals \c expectedValue,
+ * with acquire and release semantics. Lets several threads claim slots 
+ * in a lock-free structure.
+ * @return Non-zero if the value was replaced, zero otherwise.
+ */
+static inline int kwlAtomicCompareAndSwap(volatile int* value, int expectedValue, int newValue)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange((volatile LONG*)value, newValue, expectedValue) == expectedValue;
+#else
+    return __atomic_compare_exchange_n(value, &expectedValue, newValue, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif //_WIN32
+}
+
+/**
+ * Acquires a spin lock, i.e an int that is zero when the lock is free. Unlike a 
+ * \c kwlMutexLock, a spin lock needs no initialization, so it can guard process wide
+ * state that is set up before any mutex exists. Only meant for short critical sections
+ * that are rarely contended, e.g creating and destroying engine contexts.
+ */
+static inline void kwlSpinLockAcquire(volatile int* lock)
+{
+    while (!kwlAtomicCompareAndSwap(lock, 0, 1))
+    {
+        /*Spin.*/
+    }
+}
+
+/** Releases a spin lock acquired with \c kwlSpinLockAcquire.*/
+static inline void kwlSpinLockRelease(volatile int* lock)
+{
+    kwlAtomicStoreRelease(lock, 0);
+}
+
 /**
  * 
  */    
@@ -173,6 +253,13 @@ void kwlSemaphorePost(kwlSemaphore* semaphore);
  */
 void kwlMutexLockInit(kwlMutexLock* lock);
 
+/**
+ * Calls a given function exactly once per flag, even if several threads get here at the
+ * same time. No caller returns before the function has returned. Flags must be 
+ * initialized with \c KWL_ONCE_FLAG_INIT. Useful for initializing process wide locks.
+ */
+void kwlCallOnce(kwlOnceFlag* flag, void (*function)(void));
+
 /**
  * 
  */
@@ -194,6 +281,16 @@ void kwlThreadCreate(kwlThread* thread, kwlThreadEntryPoint entryPoint, void* da
     
 void kwlThreadJoin(kwlThread* thread);
 
+/**
+ * Returns an identifier for the calling thread.
+ */
+kwlThreadId kwlThreadGetCurrentId(void);
+
+/**
+ * Returns non-zero if the two thread identifiers refer to the same thread.
+ */
+int kwlThreadIdEquals(kwlThreadId a, kwlThreadId b);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -26,6 +26,7 @@ freely, subject to the following restrictions:
 #include <semaphore.h>
 #include <pthread.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 
 int debugSemaphoreCount = 0;
@@ -158,6 +159,12 @@ void kwlMutexLockInit(kwlMutexLock* lock)
     KWL_ASSERT(rc == 0);
 }
 
+void kwlCallOnce(kwlOnceFlag* flag, void (*function)(void))
+{
+    int rc = pthread_once(flag, function);
+    KWL_ASSERT(rc == 0);
+}
+
 /**
  * 
  */
@@ -170,8 +177,8 @@ kwlMutexLockAcquisitionResult kwlMutexLockTryAcquire(kwlMutexLock* lock)
 
 void kwlMutexLockAcquire(kwlMutexLock* lock)
 {
-    int rc = pthread_mutex_trylock(lock);
-    KWL_ASSERT(rc == 0 || rc == EBUSY);
+    int rc = pthread_mutex_lock(lock);
+    KWL_ASSERT(rc == 0);
 }
 
 void kwlMutexLockRelease(kwlMutexLock* lock)
@@ -213,3 +220,13 @@ void kwlThreadJoin(kwlThread* thread)
     
     debugThreadCount--;
 }
+
+kwlThreadId kwlThreadGetCurrentId(void)
+{
+    return pthread_self();
+}
+
+int kwlThreadIdEquals(kwlThreadId a, kwlThreadId b)
+{
+    return pthread_equal(a, b);
+}
@@ -47,7 +47,20 @@ void kwlSemaphorePost(kwlSemaphore* semaphore)
 
 void kwlMutexLockInit(kwlMutexLock* lock)
 {
-    InitializeCriticalSection(&criticalSection);
+    InitializeCriticalSection(lock);
+}
+
+/** Adapts a kwlCallOnce function to the callback signature of InitOnceExecuteOnce.*/
+static BOOL CALLBACK kwlCallOnceCallback(PINIT_ONCE flag, PVOID function, PVOID* context)
+{
+    ((void (*)(void))function)();
+    return TRUE;
+}
+
+void kwlCallOnce(kwlOnceFlag* flag, void (*function)(void))
+{
+    BOOL result = InitOnceExecuteOnce(flag, kwlCallOnceCallback, (PVOID)function, NULL);
+    KWL_ASSERT(result);
 }
 
 /**
@@ -67,5 +80,15 @@ void kwlMutexLockAcquire(kwlMutexLock* lock)
 
 void kwlMutexLockRelease(kwlMutexLock* lock)
 {
-    LeaveCriticalSection(&lock);
+    LeaveCriticalSection(lock);
+}
+
+kwlThreadId kwlThreadGetCurrentId(void)
+{
+    return GetCurrentThreadId();
+}
+
+int kwlThreadIdEquals(kwlThreadId a, kwlThreadId b)
+{
+    return a == b;
 }
@@ -27,8 +27,50 @@
 #include "kwl_memory.h"
 #include "kwl_assert.h"
 #include "kwl_engine.h"
+#include "kwl_log.h"
 #include "kwl_wavebank.h"
 
+void kwlWaveBank_setAudioDataBytes(kwlWaveBank* waveBank, kwlAudioData* audioData, void* bytes)
+{
+    KWL_ASSERT(audioData->bytes == NULL);
+    audioData->bytes = bytes;
+    audioData->isInAudioDataStore = 0;
+    
+    kwlAudioDataStore* store = waveBank->audioDataStore;
+    if (store == NULL)
+    {
+        return;
+    }
+    
+    /*Hand the payload to the store, which may already hold an identical one.*/
+    void* residentBytes = kwlAudioDataStore_insert(store, audioData->contentHash, bytes, audioData->numBytes);
+    if (residentBytes != NULL)
+    {
+        if (residentBytes != bytes)
+        {
+            KWL_FREE(bytes);
+        }
+        audioData->bytes = residentBytes;
+        audioData->isInAudioDataStore = 1;
+    }
+}
+
+void kwlWaveBank_releaseAudioDataBytes(kwlWaveBank* waveBank, kwlAudioData* audioData)
+{
+    if (audioData->isInAudioDataStore != 0)
+    {
+        KWL_ASSERT(waveBank->audioDataStore != NULL);
+        kwlAudioDataStore_release(waveBank->audioDataStore, audioData->contentHash);
+        audioData->bytes = NULL;
+        audioData->isInAudioDataStore = 0;
+    }
+    else if (audioData->bytes != NULL)
+    {
+        KWL_FREE(audioData->bytes);
+        audioData->bytes = NULL;
+    }
+}
+
 kwlError kwlWaveBank_verifyWaveBankBinary(kwlEngine* engine, 
                                           const char* const waveBankPath,
                                           kwlWaveBank** waveBank)
@@ -55,19 +97,24 @@ kwlError kwlWaveBank_verifyWaveBankBinary(kwlEngine* engine,
     }
     
     /*Read the ID from the wave bank binary file and find a matching wave bank struct.*/
-    const char* waveBankToLoadId = kwlInputStream_readASCIIString(&stream);
+    char idBuffer[KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH];
+    if (kwlInputStream_readASCIIStringToBuffer(&stream, idBuffer, KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH) < 0)
+    {
+        kwlInputStream_close(&stream);
+        return KWL_WAVE_BANK_ID_TOO_LONG;
+    }
     const int waveBankToLoadnumAudioDataEntries = kwlInputStream_readIntBE(&stream);
     const int numWaveBanks = engine->engineData.numWaveBanks;
     kwlWaveBank* matchingWaveBank = NULL;
     for (i = 0; i < numWaveBanks; i++)
     {
-        if (strcmp(waveBankToLoadId, engine->engineData.waveBanks[i].id) == 0)
+        if (strcmp(idBuffer, engine->engineData.waveBanks[i].id) == 0)
         {
             matchingWaveBank = &engine->engineData.waveBanks[i];
+            break;
         }
     }
     
-    KWL_FREE((void*)waveBankToLoadId);
     if (matchingWaveBank == NULL)
     {
         /*No matching bank was found. Close the file stream and return an error.*/
@@ -89,28 +136,15 @@ kwlError kwlWaveBank_verifyWaveBankBinary(kwlEngine* engine,
         return KWL_NO_ERROR;
     }
     
-    /*Store the path the wave bank was loaded from (used when streaming from disk).*/
-    const int pathLen = strlen(waveBankPath);
-    matchingWaveBank->waveBankFilePath = (char*)KWL_MALLOC((pathLen + 1) * sizeof(char), "wave bank path string");
-    strcpy(matchingWaveBank->waveBankFilePath, waveBankPath);
-    
     /*Make sure that the entries of the wave bank to load and the wave bank struct line up.*/
     for (i = 0; i < waveBankToLoadnumAudioDataEntries; i++)
     {
-        const char* filePathi = kwlInputStream_readASCIIString(&stream);
-        
-        int matchingEntryIndex = -1;
-        int j = 0;
-        for (j = 0; j < waveBankToLoadnumAudioDataEntries; j++)
+        if (kwlInputStream_readASCIIStringToBuffer(&stream, idBuffer, KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH) < 0)
         {
-            if (strcmp(matchingWaveBank->audioDataItems[j].filePath, filePathi) == 0)
-            {
-                matchingEntryIndex = j;
-                break;
-            }
+            kwlInputStream_close(&stream);
+            return KWL_WAVE_BANK_ID_TOO_LONG;
         }
-        
-        KWL_FREE((void*)filePathi);
+        const int matchingEntryIndex = kwlWaveBank_findAudioDataIndex(matchingWaveBank, idBuffer, i);
         
         if (matchingEntryIndex < 0)
         {
@@ -129,8 +163,74 @@ kwlError kwlWaveBank_verifyWaveBankBinary(kwlEngine* engine,
         kwlInputStream_skip(&stream, numBytes);
     }
     
-    /* Reading went well. */
+    /* Reading went well. Reset the arena holding data from the previous load, if any.*/
+    kwlArena_free(&matchingWaveBank->arena);
+    kwlArena_init(&matchingWaveBank->arena, KWL_WAVE_BANK_ARENA_BLOCK_SIZE, "wave bank arena");
+    matchingWaveBank->audioDataStore = engine->audioDataStore;
+    
+    /* Read the content hash and sample rate tables, if present. Binaries written by older 
+       wave bank builders end right after the last entry or the content hash table.*/
+    matchingWaveBank->contentHashes = NULL;
+    matchingWaveBank->sampleRates = NULL;
+    unsigned char tagBytes[4];
+    int tag = 0;
+    if (kwlInputStream_read(&stream, (signed char*)tagBytes, 4) == 4)
+    {
+        tag = (tagBytes[0] << 24) | (tagBytes[1] << 16) | (tagBytes[2] << 8) | tagBytes[3];
+    }
+    
+    if (tag == KWL_WAVE_BANK_CONTENT_HASH_TABLE_TAG)
+    {
+        const int numHashBytes = 8 * waveBankToLoadnumAudioDataEntries;
+        unsigned char* hashBytes = (unsigned char*)kwlArena_alloc(&matchingWaveBank->arena, numHashBytes);
+        if (kwlInputStream_read(&stream, (signed char*)hashBytes, numHashBytes) != numHashBytes)
+        {
+            kwlInputStream_close(&stream);
+            return KWL_CORRUPT_BINARY_DATA;
+        }
+        
+        /*Decode the hashes in place. Each decoded hash only overwrites its own bytes.*/
+        unsigned long long* hashes = (unsigned long long*)hashBytes;
+        for (i = 0; i < waveBankToLoadnumAudioDataEntries; i++)
+        {
+            unsigned long long hash = 0;
+            int j;
+            for (j = 0; j < 8; j++)
+            {
+                hash = (hash << 8) | hashBytes[8 * i + j];
+            }
+            hashes[i] = hash;
+        }
+        matchingWaveBank->contentHashes = hashes;
+        
+        tag = 0;
+        if (kwlInputStream_read(&stream, (signed char*)tagBytes, 4) == 4)
+        {
+            tag = (tagBytes[0] << 24) | (tagBytes[1] << 16) | (tagBytes[2] << 8) | tagBytes[3];
+        }
+    }
+    
+    if (tag == KWL_WAVE_BANK_SAMPLE_RATE_TABLE_TAG)
+    {
+        int* sampleRates = (int*)kwlArena_alloc(&matchingWaveBank->arena, 
+                                                sizeof(int) * waveBankToLoadnumAudioDataEntries);
+        for (i = 0; i < waveBankToLoadnumAudioDataEntries; i++)
+        {
+            sampleRates[i] = kwlInputStream_readIntBE(&stream);
+            if (sampleRates[i] < 0)
+            {
+                kwlInputStream_close(&stream);
+                return KWL_CORRUPT_BINARY_DATA;
+            }
+        }
+        matchingWaveBank->sampleRates = sampleRates;
+    }
+    
+    /* Store the path the wave bank was loaded from (used when streaming from disk).*/
     kwlInputStream_close(&stream);
+    const int pathLen = strlen(waveBankPath);
+    matchingWaveBank->waveBankFilePath = (char*)kwlArena_alloc(&matchingWaveBank->arena, (pathLen + 1) * sizeof(char));
+    strcpy(matchingWaveBank->waveBankFilePath, waveBankPath);
     *waveBank = matchingWaveBank;
     return KWL_NO_ERROR;
 }
@@ -173,23 +273,18 @@ kwlError kwlWaveBank_loadAudioDataItems(kwlWaveBank* waveBank, kwlInputStream* s
     
     const int waveBankToLoadnumAudioDataEntries = waveBank->numAudioDataEntries;
     
+    char waveEntryId[KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH];
     for (int i = 0; i < waveBankToLoadnumAudioDataEntries; i++)
     {
-        char* const waveEntryIdi = kwlInputStream_readASCIIString(stream);
-        
-        kwlAudioData* matchingAudioData = NULL;
-        int j;
-        for (int j = 0; j < waveBankToLoadnumAudioDataEntries; j++)
+        if (kwlInputStream_readASCIIStringToBuffer(stream, waveEntryId, KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH) < 0)
         {
-            kwlAudioData* entryj = &waveBank->audioDataItems[j];
-            if (strcmp(entryj->filePath, waveEntryIdi) == 0)
-            {
-                matchingAudioData = entryj;
-                break;
-            }
+            /*The entries were verified before loading, so the file must have changed since.*/
+            KWL_ASSERT(0 && "wave bank entry ID too long");
+            return KWL_WAVE_BANK_ID_TOO_LONG;
         }
-        //printf("    loading %s\n", waveEntryIdi);
-        KWL_FREE(waveEntryIdi);
+        
+        const int matchingIndex = kwlWaveBank_findAudioDataIndex(waveBank, waveEntryId, i);
+        kwlAudioData* matchingAudioData = matchingIndex < 0 ? NULL : &waveBank->audioDataItems[matchingIndex];
         
         const kwlAudioEncoding encoding = (kwlAudioEncoding)kwlInputStream_readIntBE(stream);
         const int streamFromDisk = kwlInputStream_readIntBE(stream);
@@ -215,6 +310,7 @@ kwlError kwlWaveBank_loadAudioDataItems(kwlWaveBank* waveBank, kwlInputStream* s
         }
         
         /*free any old data*/
+        kwlWaveBank_releaseAudioDataBytes(waveBank, matchingAudioData);
         kwlAudioData_free(matchingAudioData);
         
         /*Store audio meta data.*/
@@ -222,28 +318,55 @@ kwlError kwlWaveBank_loadAudioDataItems(kwlWaveBank* waveBank, kwlInputStream* s
         matchingAudioData->numChannels = numChannels;
         matchingAudioData->numBytes = numBytes;
         matchingAudioData->encoding = (kwlAudioEncoding)encoding;
+        matchingAudioData->sampleRate = waveBank->sampleRates != NULL ? waveBank->sampleRates[i] : 0;
         matchingAudioData->streamFromDisk = streamFromDisk;
         matchingAudioData->isLoaded = 1;
         matchingAudioData->bytes = NULL;
         
+        /*Store the offset into the wave bank binary file. Used for streaming entries and 
+          for streaming or reloading entries evicted by the residency manager.*/
+        matchingAudioData->fileOffset = kwlInputStream_tell(stream);
+        
         if (streamFromDisk == 0)
         {
-            /*This entry should not be streamed, so allocate audio data up front.*/
-            matchingAudioData->bytes = KWL_MALLOC(numBytes, "kwlEngine_loadWaveBank");
+            /*This entry should not be streamed. If the binary provides the content hash
+              and an identical payload is already resident, share it and skip the bytes.*/
+            kwlAudioDataStore* store = waveBank->audioDataStore;
+            if (store != NULL && waveBank->contentHashes != NULL)
+            {
+                const unsigned long long hash = waveBank->contentHashes[i];
+                void* residentBytes = kwlAudioDataStore_acquire(store, hash, numBytes);
+                if (residentBytes != NULL)
+                {
+                    matchingAudioData->bytes = residentBytes;
+                    matchingAudioData->contentHash = hash;
+                    matchingAudioData->isInAudioDataStore = 1;
+                    kwlInputStream_skip(stream, numBytes);
+                    continue;
+                }
+            }
+            
+            /*Otherwise allocate audio data up front.*/
+            void* bytes = KWL_MALLOC(numBytes, "kwlEngine_loadWaveBank");
             
             int bytesRead = kwlInputStream_read(stream, 
-                                                (signed char*)matchingAudioData->bytes, 
+                                                (signed char*)bytes, 
                                                 numBytes);
             if (bytesRead != numBytes)
             {
+                KWL_FREE(bytes);
                 KWL_ASSERT(0 && "error reading wave bank audio data bytes");
                 return KWL_CORRUPT_BINARY_DATA;
             }
+            
+            /*The store may already hold an identical payload loaded in the meantime 
+              or from a binary without content hashes.*/
+            matchingAudioData->contentHash = waveBank->contentHashes != NULL ? 
+                waveBank->contentHashes[i] : kwlAudioDataStore_computeContentHash(bytes, numBytes);
+            kwlWaveBank_setAudioDataBytes(waveBank, matchingAudioData, bytes);
         }
         else
         {
-            /*Store the offset into the wave bank binary files for streaming entries.*/
-            matchingAudioData->fileOffset = kwlInputStream_tell(stream);
             kwlInputStream_skip(stream, numBytes);
         }
     }
@@ -254,7 +377,7 @@ kwlError kwlWaveBank_loadAudioDataItems(kwlWaveBank* waveBank, kwlInputStream* s
 
 void* kwlWaveBank_loadingThreadEntryPoint(void* userData)
 {
-    printf("starting threaded wb load\n"); 
+    KWL_LOG_DEBUG("starting threaded wave bank load");
     kwlWaveBank* waveBank = (kwlWaveBank*)userData;
     kwlError result = kwlWaveBank_loadAudioDataItems(waveBank->loadingThread.waveBank, 
                                                      &waveBank->loadingThread.inputStream);
@@ -268,7 +391,7 @@ void* kwlWaveBank_loadingThreadEntryPoint(void* userData)
         waveBank->loadingThread.callback(KWL_INVALID_HANDLE, waveBank->loadingThread.callbackUserData);
     }
     
-    printf("threaded wb done.\n"); 
+    KWL_LOG_DEBUG("threaded wave bank load done");
     return NULL;
 }
 
@@ -285,8 +408,84 @@ void kwlWaveBank_unload(kwlWaveBank* waveBank)
     for (i = 0; i < numAudioDataEntriesInBank; i++)
     {
         kwlAudioData* wavei = &waveBank->audioDataItems[i];
+        kwlWaveBank_releaseAudioDataBytes(waveBank, wavei);
         kwlAudioData_free(wavei);
     }
     waveBank->isLoaded = 0;
-    KWL_FREE(waveBank->waveBankFilePath);
-}
\ No newline at end of file
+    waveBank->waveBankFilePath = NULL;
+    waveBank->contentHashes = NULL;
+    waveBank->sampleRates = NULL;
+    kwlArena_free(&waveBank->arena);
+}
+
+/** FNV-1a hash of a null terminated string.*/
+static unsigned int kwlWaveBank_hashEntryId(const char* entryId)
+{
+    unsigned int hash = 2166136261u;
+    while (*entryId != '\0')
+    {
+        hash ^= (unsigned char)*entryId;
+        hash *= 16777619u;
+        entryId++;
+    }
+    return hash;
+}
+
+void kwlWaveBank_buildEntryLookupTable(kwlWaveBank* waveBank, kwlArena* arena)
+{
+    KWL_ASSERT(waveBank->entryLookupTable == NULL);
+    
+    /*Use a power of two table size with a load factor of at most 0.5*/
+    int tableSize = 1;
+    while (tableSize < 2 * waveBank->numAudioDataEntries)
+    {
+        tableSize <<= 1;
+    }
+    
+    waveBank->entryLookupTableSize = tableSize;
+    waveBank->entryLookupTable = (int*)kwlArena_alloc(arena, tableSize * sizeof(int));
+    int i;
+    for (i = 0; i < tableSize; i++)
+    {
+        waveBank->entryLookupTable[i] = -1;
+    }
+    
+    for (i = 0; i < waveBank->numAudioDataEntries; i++)
+    {
+        int slot = kwlWaveBank_hashEntryId(waveBank->audioDataItems[i].filePath) & (tableSize - 1);
+        while (waveBank->entryLookupTable[slot] >= 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        waveBank->entryLookupTable[slot] = i;
+    }
+}
+
+int kwlWaveBank_findAudioDataIndex(kwlWaveBank* waveBank, const char* const entryId, int expectedIndex)
+{
+    /*Fast path: the entries of a wave bank binary are written in engine data order.*/
+    if (expectedIndex >= 0 && expectedIndex < waveBank->numAudioDataEntries &&
+        strcmp(waveBank->audioDataItems[expectedIndex].filePath, entryId) == 0)
+    {
+        return expectedIndex;
+    }
+    
+    if (waveBank->entryLookupTable == NULL)
+    {
+        return -1;
+    }
+    
+    const int mask = waveBank->entryLookupTableSize - 1;
+    int slot = kwlWaveBank_hashEntryId(entryId) & mask;
+    while (waveBank->entryLookupTable[slot] >= 0)
+    {
+        const int index = waveBank->entryLookupTable[slot];
+        if (strcmp(waveBank->audioDataItems[index].filePath, entryId) == 0)
+        {
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    return -1;
+}
@@ -28,7 +28,9 @@ freely, subject to the following restrictions:
 
 #include "kowalski.h"
 #include "kowalski_ext.h"
+#include "kwl_audiodatastore.h"
 #include "kwl_inputstream.h"
+#include "kwl_memory.h"
 #include "kwl_synchronization.h"
 
 #ifdef __cplusplus
@@ -50,6 +52,31 @@ static const char KWL_WAVE_BANK_BINARY_FILE_IDENTIFIER[KWL_WAVE_BANK_BINARY_FILE
     0xAB, 'K', 'W', 'B', 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
 };
 
+/** 
+ * The maximum length of wave bank and wave bank entry IDs read while 
+ * loading wave bank binaries, including the null terminator.
+ */
+#define KWL_MAX_WAVE_BANK_ENTRY_ID_LENGTH 1024
+
+/** 
+ * The tag of the optional content hash table following the last entry of a wave bank binary,
+ * i.e the big endian bytes 'KWBH'. The tag is followed by one big endian 64 bit content hash
+ * per entry, in entry order. Binaries without the table are still loadable; the hashes are
+ * then computed from the loaded audio data.
+ */
+#define KWL_WAVE_BANK_CONTENT_HASH_TABLE_TAG 0x4B574248
+
+/** 
+ * The tag of the optional sample rate table following the content hash table,
+ * i.e the big endian bytes 'KWBR'. The tag is followed by one big endian 32 bit sample rate 
+ * in Hz per entry, in entry order. Entries with a sample rate of 0, and all entries of binaries
+ * without the table, are assumed to have the same sample rate as the engine output.
+ */
+#define KWL_WAVE_BANK_SAMPLE_RATE_TABLE_TAG 0x4B574252
+
+/** The block size of per wave bank arenas. */
+#define KWL_WAVE_BANK_ARENA_BLOCK_SIZE 1024
+
 typedef void (*kwlWaveBankFinishedLoadingCallback)(kwlWaveBankHandle handle, void* userData);
     
 /** 
@@ -85,8 +112,29 @@ typedef struct kwlWaveBank
     struct kwlAudioData* audioDataItems;
     /** The number of audio data entries in the wave bank. */
     int numAudioDataEntries;
+    /** 
+     * An open addressing hash table of indices into \c audioDataItems, keyed
+     * on the entry file paths. Empty slots are -1.
+     */
+    int* entryLookupTable;
+    /** The number of slots in \c entryLookupTable. Always a power of two.*/
+    int entryLookupTableSize;
+    /** 
+     * The content hashes of the entries, in the order they appear in the wave bank binary.
+     * NULL if the binary has no content hash table.
+     */
+    unsigned long long* contentHashes;
+    /** 
+     * The sample rates of the entries in Hz, in the order they appear in the wave bank binary.
+     * NULL if the binary has no sample rate table.
+     */
+    int* sampleRates;
+    /** The store that non-streaming audio data of the wave bank is shared through.*/
+    kwlAudioDataStore* audioDataStore;
     /** Used for threaded loading (if requested). */
     kwlWaveBankLoadingThread loadingThread;
+    /** Holds memory allocated while the wave bank is loaded, released on unload. */
+    kwlArena arena;
 } kwlWaveBank;
 
 /** 
@@ -119,6 +167,42 @@ void* kwlWaveBank_loadingThreadEntryPoint(void* userData);
 /** */
 void kwlWaveBank_unload(kwlWaveBank* waveBank);
 
+/**
+ * Sets the bytes of a loaded, non-streaming audio data entry of a given wave bank, sharing 
+ * them through the audio data store of the wave bank if possible. \c contentHash must be set.
+ * @param waveBank The wave bank containing the entry.
+ * @param audioData The entry, which must not have any bytes.
+ * @param bytes The payload, allocated using \c KWL_MALLOC. Ownership passes to the entry 
+ * or the store, which may free it in favor of an identical resident payload.
+ */
+void kwlWaveBank_setAudioDataBytes(kwlWaveBank* waveBank, struct kwlAudioData* audioData, void* bytes);
+
+/**
+ * Frees the bytes of an audio data entry of a given wave bank or, if they are 
+ * shared through the audio data store, releases the reference to them.
+ */
+void kwlWaveBank_releaseAudioDataBytes(kwlWaveBank* waveBank, struct kwlAudioData* audioData);
+
+/** 
+ * Builds the entry lookup table of a given wave bank. Must be called
+ * once the file paths of all audio data entries are known.
+ * @param waveBank The wave bank to build the lookup table for.
+ * @param arena The arena to allocate the table from.
+ */
+void kwlWaveBank_buildEntryLookupTable(kwlWaveBank* waveBank, kwlArena* arena);
+
+/**
+ * Returns the index of the audio data entry with a given ID. Wave bank binaries
+ * store their entries in the same order as the engine data, so the entry at 
+ * \c expectedIndex is checked first and the lookup table is only consulted if 
+ * that entry does not match.
+ * @param waveBank The wave bank to search.
+ * @param entryId The ID (relative file path) of the entry to look for.
+ * @param expectedIndex The most likely index of the entry.
+ * @return The index of the matching entry or -1 if there is no such entry.
+ */
+int kwlWaveBank_findAudioDataIndex(kwlWaveBank* waveBank, const char* const entryId, int expectedIndex);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */    
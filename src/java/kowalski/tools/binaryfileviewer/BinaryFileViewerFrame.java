@@ -24,7 +24,9 @@ freely, subject to the following restrictions:
 package kowalski.tools.binaryfileviewer;
 
 import java.awt.BorderLayout;
+import java.io.BufferedInputStream;
 import java.io.DataInputStream;
+import java.io.EOFException;
 import java.io.File;
 import java.io.FileInputStream;
 import java.io.IOException;
@@ -57,6 +59,8 @@ public class BinaryFileViewerFrame extends JFrameWithKowalskiIcon
     private int numStreamingBytes = -1;
     /** The total number of bytes of non-streaming audio. Wave banks only.*/
     private int numNonStreamingBytes = -1;
+    /** The string table of version 2 engine data binaries, null otherwise.*/
+    private byte[] stringTable = null;
 
     /**
      * Creates a new viewer frame.
@@ -145,7 +149,7 @@ public class BinaryFileViewerFrame extends JFrameWithKowalskiIcon
         dis.close();
         
         fis = new FileInputStream(binaryFile);
-        dis = new DataInputStream(fis);
+        dis = new DataInputStream(new BufferedInputStream(fis));
 
         //create a wave bank or engine data viewer tree
         DefaultMutableTreeNode rootNode = new DefaultMutableTreeNode(binaryFile);
@@ -180,11 +184,13 @@ public class BinaryFileViewerFrame extends JFrameWithKowalskiIcon
         int numEntries = dis.readInt();
         rootNode.add(new BinaryFileViewerTreeNode("Audio data entry count", numEntries));
 
+        DefaultMutableTreeNode[] entryNodes = new DefaultMutableTreeNode[numEntries];
         for (int i = 0; i < numEntries; i++)
         {
             String filename = readASCIIString(dis);
 
             DefaultMutableTreeNode entryNode = new DefaultMutableTreeNode(toHTMLBold("Audio data entry (" + i + ")"));
+            entryNodes[i] = entryNode;
             entryNode.add(new BinaryFileViewerTreeNode("Filename", filename));
             rootNode.add(entryNode);
             int encoding  = dis.readInt();
@@ -206,6 +212,45 @@ public class BinaryFileViewerFrame extends JFrameWithKowalskiIcon
             dis.skip(numBytes);
             entryNode.add(new DefaultMutableTreeNode("Audio data"));
         }
+
+        //wave banks written by older builders have no content hash table
+        int tag;
+        try
+        {
+            tag = dis.readInt();
+        }
+        catch (EOFException e)
+        {
+            return;
+        }
+
+        if (tag == WaveBankBuilder.CONTENT_HASH_TABLE_TAG)
+        {
+            for (int i = 0; i < numEntries; i++)
+            {
+                long hash = dis.readLong();
+                entryNodes[i].add(new BinaryFileViewerTreeNode("Content hash", String.format("%016x", hash)));
+            }
+
+            //wave banks written by older builders have no sample rate table
+            try
+            {
+                tag = dis.readInt();
+            }
+            catch (EOFException e)
+            {
+                return;
+            }
+        }
+
+        if (tag == WaveBankBuilder.SAMPLE_RATE_TABLE_TAG)
+        {
+            for (int i = 0; i < numEntries; i++)
+            {
+                int sampleRate = dis.readInt();
+                entryNodes[i].add(new BinaryFileViewerTreeNode("Sample rate", sampleRate));
+            }
+        }
     }
 
     private void populateEngineDataTree(DataInputStream dis, DefaultMutableTreeNode rootNode)
@@ -216,6 +261,24 @@ public class BinaryFileViewerFrame extends JFrameWithKowalskiIcon
         dis.read(identifier);
         rootNode.add(new BinaryFileViewerTreeNode("File identifier", identifier));
 
+        //Version 2 binaries start with a table of contents followed by a string table
+        stringTable = null;
+        dis.mark(4);
+        int firstChunkId = dis.readInt();
+        dis.reset();
+        if (firstChunkId == EngineDataBuilder.TABLE_OF_CONTENTS_CHUNK_ID)
+        {
+            DefaultMutableTreeNode tocNode =
+                new DefaultMutableTreeNode(toHTMLBold("Table of contents chunk"));
+            rootNode.add(tocNode);
+            populateTableOfContentsSubTree(dis, tocNode);
+
+            DefaultMutableTreeNode stringsNode =
+                new DefaultMutableTreeNode(toHTMLBold("String table chunk"));
+            rootNode.add(stringsNode);
+            populateStringTableSubTree(dis, stringsNode);
+        }
+
         //Wave banks chunk
         DefaultMutableTreeNode waveBanksNode =
                 new DefaultMutableTreeNode(toHTMLBold("Wave banks chunk"));
@@ -245,6 +308,68 @@ public class BinaryFileViewerFrame extends JFrameWithKowalskiIcon
                 new DefaultMutableTreeNode(toHTMLBold("Events chunk"));
         rootNode.add(eventsNode);
         populateEventsSubTree(dis, eventsNode);
+
+        //optional event stealing modes chunk
+        if (dis.available() >= 4)
+        {
+            dis.mark(4);
+            int nextChunkId = dis.readInt();
+            dis.reset();
+            if (nextChunkId == EngineDataBuilder.EVENT_STEALING_MODES_CHUNK_ID)
+            {
+                DefaultMutableTreeNode stealingModesNode =
+                    new DefaultMutableTreeNode(toHTMLBold("Event stealing modes chunk"));
+                rootNode.add(stealingModesNode);
+                populateEventStealingModesSubTree(dis, stealingModesNode);
+            }
+        }
+    }
+
+    private void populateEventStealingModesSubTree(DataInputStream dis, DefaultMutableTreeNode node)
+            throws IOException
+    {
+        node.add(new BinaryFileViewerTreeNode("Chunk ID", dis.readInt()));
+        node.add(new BinaryFileViewerTreeNode("Chunk size", dis.readInt()));
+        int count = dis.readInt();
+        node.add(new BinaryFileViewerTreeNode("Event definition count", count));
+        for (int i = 0; i < count; i++)
+        {
+            node.add(new BinaryFileViewerTreeNode("Stealing mode (" + i + ")", dis.readInt()));
+        }
+    }
+
+    private void populateTableOfContentsSubTree(DataInputStream dis, DefaultMutableTreeNode tocNode)
+            throws IOException
+    {
+        int chunkId = dis.readInt();
+        tocNode.add(new BinaryFileViewerTreeNode("Chunk ID", chunkId));
+        tocNode.add(new BinaryFileViewerTreeNode("Chunk size", dis.readInt()));
+        tocNode.add(new BinaryFileViewerTreeNode("Format version", dis.readInt()));
+        int numChunks = dis.readInt();
+        tocNode.add(new BinaryFileViewerTreeNode("Chunk count", numChunks));
+        for (int i = 0; i < numChunks; i++)
+        {
+            DefaultMutableTreeNode entryNode = new DefaultMutableTreeNode(toHTMLBold("Entry (" + i + ")"));
+            tocNode.add(entryNode);
+            entryNode.add(new BinaryFileViewerTreeNode("Chunk ID", dis.readInt()));
+            entryNode.add(new BinaryFileViewerTreeNode("Offset", dis.readInt()));
+            entryNode.add(new BinaryFileViewerTreeNode("Size", dis.readInt()));
+        }
+    }
+
+    private void populateStringTableSubTree(DataInputStream dis, DefaultMutableTreeNode stringsNode)
+            throws IOException
+    {
+        int chunkId = dis.readInt();
+        if (chunkId != EngineDataBuilder.STRINGS_CHUNK_ID)
+        {
+            throw new IOException("Expected string table chunk identifier, got " + chunkId);
+        }
+        stringsNode.add(new BinaryFileViewerTreeNode("Chunk ID", chunkId));
+        int size = dis.readInt();
+        stringsNode.add(new BinaryFileViewerTreeNode("Chunk size", size));
+        stringTable = new byte[size];
+        dis.readFully(stringTable);
     }
 
     private void populateWaveBanksSubTree(DataInputStream dis, DefaultMutableTreeNode waveBanksNode)
@@ -474,6 +599,18 @@ public class BinaryFileViewerFrame extends JFrameWithKowalskiIcon
     private String readASCIIString(DataInputStream dis)
             throws IOException
     {
+        if (stringTable != null)
+        {
+            //version 2 engine data, strings are stored as string table offsets
+            int offset = dis.readInt();
+            int end = offset;
+            while (end < stringTable.length && stringTable[end] != 0)
+            {
+                end++;
+            }
+            return new String(stringTable, offset, end - offset);
+        }
+
         int numChars = dis.readInt();
         byte[] bytes = new byte[numChars];
         dis.read(bytes);
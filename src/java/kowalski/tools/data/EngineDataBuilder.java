@@ -37,6 +37,7 @@ import javax.xml.bind.JAXBException;
 import kowalski.tools.data.xml.AudioData;
 import kowalski.tools.data.xml.AudioDataReference;
 import kowalski.tools.data.xml.Event;
+import kowalski.tools.data.xml.EventInstanceStealingMode;
 import kowalski.tools.data.xml.EventRetriggerMode;
 import kowalski.tools.data.xml.KowalskiProject;
 import kowalski.tools.data.xml.MixBus;
@@ -71,6 +72,24 @@ public class EngineDataBuilder extends DataBuilder
     public static final int MIX_PRESETS_CHUNK_ID = 0x7270786d;
     /** The wave bank chunk identifier (wbks)*/
     public static final int WAVE_BANKS_CHUNK_ID = 0x736b6277;
+    /** The table of contents chunk identifier (ctoc). Format version 2 and later. */
+    public static final int TABLE_OF_CONTENTS_CHUNK_ID = 0x636f7463;
+    /** The string table chunk identifier (strs). Format version 2 and later. */
+    public static final int STRINGS_CHUNK_ID = 0x73727473;
+    /** The event instance stealing modes chunk identifier (stlm). Format version 2 and later. */
+    public static final int EVENT_STEALING_MODES_CHUNK_ID = 0x6d6c7473;
+    /** The most recent engine data format version. */
+    public static final int ENGINE_DATA_FORMAT_VERSION = 2;
+    /** The size in bytes of a chunk header, i.e the chunk ID and the chunk size. */
+    private static final int CHUNK_HEADER_SIZE = 8;
+    /** The size in bytes of a table of contents entry. */
+    private static final int TABLE_OF_CONTENTS_ENTRY_SIZE = 12;
+    /** The format version to write. */
+    private int formatVersion = ENGINE_DATA_FORMAT_VERSION;
+    /** The string table being built (format version 2 and later). */
+    private ByteArrayOutputStream stringTable;
+    /** Offsets into the string table by string. */
+    private Map<String, Integer> stringTableOffsets;
     /**The directory containing the project XML file.*/
     private File projectDirectory;
     /** A map of mix presets by hierarchy path.*/
@@ -123,6 +142,14 @@ public class EngineDataBuilder extends DataBuilder
     private static final int RETRIGGER = 0;
     /** */
     private static final int NO_RETRIGGER = 1;
+    /** */
+    private static final int STEAL_QUIETEST = 0;
+    /** */
+    private static final int STEAL_RANDOM = 1;
+    /** */
+    private static final int DONT_STEAL = 2;
+    /** */
+    private static final int STEAL_OLDEST = 3;
 
     /**
      * Constructor.
@@ -133,6 +160,30 @@ public class EngineDataBuilder extends DataBuilder
         
     }
 
+    /**
+     * Sets the engine data format version to write. Version 1 binaries store strings
+     * inline and have no table of contents. Version 2 binaries start with a table of
+     * contents chunk giving the offset of every other chunk and store all strings in
+     * a single string table chunk, referenced by offset.
+     * @param formatVersion 1 or 2.
+     */
+    public void setFormatVersion(int formatVersion)
+    {
+        if (formatVersion < 1 || formatVersion > ENGINE_DATA_FORMAT_VERSION)
+        {
+            throw new IllegalArgumentException("Unsupported engine data format version " + formatVersion);
+        }
+        this.formatVersion = formatVersion;
+    }
+
+    /**
+     * @return The engine data format version to write.
+     */
+    public int getFormatVersion()
+    {
+        return formatVersion;
+    }
+
     public void buildEngineData(String projectPath,
                                 String binPath)
         throws IOException, JAXBException, ProjectDataException
@@ -217,52 +268,165 @@ public class EngineDataBuilder extends DataBuilder
         log("Writing Kowalski engine data binary");
         log("to " + binFile);
 
-        FileOutputStream fos = new FileOutputStream(binFile);
-        DataOutputStream binaryFileOutputStream = new DataOutputStream(fos);
+        stringTable = new ByteArrayOutputStream();
+        stringTableOffsets = new HashMap<String, Integer>();
+
         ByteArrayOutputStream byteStream = new ByteArrayOutputStream();
         DataOutputStream tempOutputStream = new DataOutputStream(byteStream);
-        log("    Wrote file identifier, " + ENGINE_DATA_FILE_IDENTIFIER.length + " bytes.");
-        binaryFileOutputStream.write(ENGINE_DATA_FILE_IDENTIFIER);
+        List<Integer> chunkIds = new ArrayList<Integer>();
+        List<byte[]> chunks = new ArrayList<byte[]>();
 
         serializeWaveBankData(project, tempOutputStream);
-        binaryFileOutputStream.writeInt(WAVE_BANKS_CHUNK_ID);
-        binaryFileOutputStream.writeInt(byteStream.size());
-        log("    Wrote wave bank chunk, " + byteStream.size() + " bytes.");
-        binaryFileOutputStream.write(byteStream.toByteArray());
+        chunkIds.add(WAVE_BANKS_CHUNK_ID);
+        chunks.add(byteStream.toByteArray());
         byteStream.reset();
 
         serializeMixBusData(tempOutputStream);
-        binaryFileOutputStream.writeInt(MIX_BUSES_CHUNK_ID);
-        binaryFileOutputStream.writeInt(byteStream.size());
-        binaryFileOutputStream.write(byteStream.toByteArray());
-        log("    Wrote mix bus chunk, " + byteStream.size() + " bytes.");
+        chunkIds.add(MIX_BUSES_CHUNK_ID);
+        chunks.add(byteStream.toByteArray());
         byteStream.reset();
 
         serializeMixPresetData(tempOutputStream);
-        binaryFileOutputStream.writeInt(MIX_PRESETS_CHUNK_ID);
-        binaryFileOutputStream.writeInt(byteStream.size());
-        binaryFileOutputStream.write(byteStream.toByteArray());
-        log("    Wrote mix preset chunk, " + byteStream.size() + " bytes.");
+        chunkIds.add(MIX_PRESETS_CHUNK_ID);
+        chunks.add(byteStream.toByteArray());
         byteStream.reset();
 
         serializeSoundData(tempOutputStream, project);
-        binaryFileOutputStream.writeInt(SOUNDS_CHUNK_ID);
-        binaryFileOutputStream.writeInt(byteStream.size());
-        binaryFileOutputStream.write(byteStream.toByteArray());
-        log("    Wrote sounds chunk, " + byteStream.size() + " bytes.");
+        chunkIds.add(SOUNDS_CHUNK_ID);
+        chunks.add(byteStream.toByteArray());
         byteStream.reset();
 
         serializeEventData(project, tempOutputStream);
-        binaryFileOutputStream.writeInt(EVENTS_CHUNK_ID);
-        //System.out.println(byteStream.size());
-        binaryFileOutputStream.writeInt(byteStream.size());
-        binaryFileOutputStream.write(byteStream.toByteArray());
-        log("    Wrote events chunk, " + byteStream.size() + " bytes.");
+        chunkIds.add(EVENTS_CHUNK_ID);
+        chunks.add(byteStream.toByteArray());
         byteStream.reset();
 
+        if (formatVersion >= 2)
+        {
+            //older engines skip this chunk and fall back to STEAL_QUIETEST
+            serializeEventStealingModes(tempOutputStream);
+            chunkIds.add(EVENT_STEALING_MODES_CHUNK_ID);
+            chunks.add(byteStream.toByteArray());
+            byteStream.reset();
+        }
+        tempOutputStream.close();
+
+        if (formatVersion >= 2)
+        {
+            //all strings are known at this point
+            chunkIds.add(0, STRINGS_CHUNK_ID);
+            chunks.add(0, stringTable.toByteArray());
+        }
+
+        FileOutputStream fos = new FileOutputStream(binFile);
+        DataOutputStream binaryFileOutputStream = new DataOutputStream(fos);
+        log("    Wrote file identifier, " + ENGINE_DATA_FILE_IDENTIFIER.length + " bytes.");
+        binaryFileOutputStream.write(ENGINE_DATA_FILE_IDENTIFIER);
+
+        if (formatVersion >= 2)
+        {
+            writeTableOfContents(binaryFileOutputStream, chunkIds, chunks);
+        }
+
+        for (int i = 0; i < chunks.size(); i++)
+        {
+            binaryFileOutputStream.writeInt(chunkIds.get(i));
+            binaryFileOutputStream.writeInt(chunks.get(i).length);
+            binaryFileOutputStream.write(chunks.get(i));
+            log("    Wrote " + getChunkName(chunkIds.get(i)) + " chunk, " + chunks.get(i).length + " bytes.");
+        }
+
         log("    Total size: " + binaryFileOutputStream.size() + " bytes.");
         log("");
-        tempOutputStream.close();
+        binaryFileOutputStream.close();
+    }
+
+    /**
+     * Writes a table of contents chunk, listing the offset from the start of the file
+     * to the payload of each of the given chunks, as well as their sizes. The chunks are
+     * assumed to be written in the given order directly after the table of contents.
+     * @param dos
+     * @param chunkIds
+     * @param chunks
+     * @throws IOException
+     */
+    private void writeTableOfContents(DataOutputStream dos, List<Integer> chunkIds, List<byte[]> chunks)
+            throws IOException
+    {
+        final int numChunks = chunks.size();
+        final int tableOfContentsSize = 8 + numChunks * TABLE_OF_CONTENTS_ENTRY_SIZE;
+        dos.writeInt(TABLE_OF_CONTENTS_CHUNK_ID);
+        dos.writeInt(tableOfContentsSize);
+        dos.writeInt(formatVersion);
+        dos.writeInt(numChunks);
+
+        int offset = ENGINE_DATA_FILE_IDENTIFIER.length + CHUNK_HEADER_SIZE + tableOfContentsSize;
+        for (int i = 0; i < numChunks; i++)
+        {
+            offset += CHUNK_HEADER_SIZE;
+            dos.writeInt(chunkIds.get(i));
+            dos.writeInt(offset);
+            dos.writeInt(chunks.get(i).length);
+            offset += chunks.get(i).length;
+        }
+        log("    Wrote table of contents chunk (format version " + formatVersion + "), " +
+            tableOfContentsSize + " bytes.");
+    }
+
+    /**
+     * Writes a string to a chunk. Version 1 binaries store the length of the string
+     * followed by its characters. Version 2 binaries store the offset of the
+     * string in the string table, where identical strings are only stored once.
+     * @param dos
+     * @param str
+     * @throws IOException
+     */
+    private void writeString(DataOutputStream dos, String str)
+            throws IOException
+    {
+        if (formatVersion < 2)
+        {
+            dos.writeInt(str.length());
+            dos.write(str.getBytes());
+            return;
+        }
+
+        Integer offset = stringTableOffsets.get(str);
+        if (offset == null)
+        {
+            offset = stringTable.size();
+            stringTable.write(str.getBytes());
+            stringTable.write(0);
+            stringTableOffsets.put(str, offset);
+        }
+        dos.writeInt(offset);
+    }
+
+    /**
+     * @param chunkId
+     * @return A human readable name of the chunk with the given ID.
+     */
+    private String getChunkName(int chunkId)
+    {
+        switch (chunkId)
+        {
+            case WAVE_BANKS_CHUNK_ID:
+                return "wave bank";
+            case MIX_BUSES_CHUNK_ID:
+                return "mix bus";
+            case MIX_PRESETS_CHUNK_ID:
+                return "mix preset";
+            case SOUNDS_CHUNK_ID:
+                return "sounds";
+            case EVENTS_CHUNK_ID:
+                return "events";
+            case STRINGS_CHUNK_ID:
+                return "string table";
+            case EVENT_STEALING_MODES_CHUNK_ID:
+                return "event stealing modes";
+            default:
+                return "unknown";
+        }
     }
 
     /**
@@ -344,8 +508,7 @@ public class EngineDataBuilder extends DataBuilder
             MixPreset preseti = it.next();
             String presetID = getHierarchyPathsByMixPreset.get(preseti);
             //write mix preset id
-            dos.writeInt(presetID.length());
-            dos.write(presetID.getBytes());
+            writeString(dos, presetID);
 
             //write default flag
             dos.writeInt(preseti.isDefault() ? 1 : 0);
@@ -447,8 +610,7 @@ public class EngineDataBuilder extends DataBuilder
         for (int i = 0; i < numMixBuses; i++)
         {
             MixBus busi = mixBusList.get(i);
-            dos.writeInt(busi.getID().length());
-            dos.write(busi.getID().getBytes());
+            writeString(dos, busi.getID());
 
             List<MixBus> subBuses = busi.getSubBuses();
             final int numSubBuses = subBuses.size();
@@ -670,8 +832,7 @@ public class EngineDataBuilder extends DataBuilder
             int numReferencedWaveBanks = referencedWaveBanks.size();
             
             //write the data for this event definition
-            dos.writeInt(eventHierarchyPath.length());
-            dos.write(eventHierarchyPath.getBytes());
+            writeString(dos, eventHierarchyPath);
             dos.writeInt(instanceCount);
             
             dos.writeFloat(eventi.getGain());
@@ -698,6 +859,39 @@ public class EngineDataBuilder extends DataBuilder
         }
     }
 
+    /**
+     * Writes the event instance stealing modes chunk, one mode per event
+     * in the same order as the events chunk.
+     * @param dos
+     * @throws IOException
+     */
+    private void serializeEventStealingModes(DataOutputStream dos)
+            throws IOException
+    {
+        dos.writeInt(eventList.size());
+        for (int i = 0; i < eventList.size(); i++)
+        {
+            dos.writeInt(getEventStealingModeInt(eventList.get(i).getIstanceStealingMode()));
+        }
+    }
+
+    private int getEventStealingModeInt(EventInstanceStealingMode mode)
+    {
+        switch (mode)
+        {
+            case STEAL_QUIETEST:
+                return STEAL_QUIETEST;
+            case STEAL_RANDOM:
+                return STEAL_RANDOM;
+            case DONT_STEAL:
+                return DONT_STEAL;
+            case STEAL_OLDEST:
+                return STEAL_OLDEST;
+            default:
+                throw new RuntimeException("Invalid instance stealing mode: " + mode);
+        }
+    }
+
     private int getEventRetriggerModeInt(EventRetriggerMode mode)
     {
         final String retriggerMode = mode.value();
@@ -743,16 +937,14 @@ public class EngineDataBuilder extends DataBuilder
         {
             String path = it.next();
             WaveBank waveBanki = waveBanksByHierarchyPath.get(path);
-            dos.writeInt(path.length());
-            dos.write(path.getBytes());
+            writeString(dos, path);
 
             List<AudioData> audioDataItems = waveBanki.getAudioDataList();
             dos.writeInt(audioDataItems.size());
             for (int i = 0; i < audioDataItems.size(); i++)
             {
                 AudioData audioDatai = audioDataItems.get(i);
-                dos.writeInt(audioDatai.getRelativePath().length());
-                dos.write(audioDatai.getRelativePath().getBytes());
+                writeString(dos, audioDatai.getRelativePath());
             }
         }
     }
@@ -65,12 +65,45 @@ public class WaveBankBuilder extends DataBuilder
     private static final int KWL_ENCODING_AAC = 3;
     /** An unknown encoding.*/
     private static final int KWL_ENCODING_UNKNOWN = 4;
+    /** 
+     * The tag ('KWBH') of the content hash table written after the last entry. The tag
+     * is followed by one 64 bit content hash per entry, in entry order.
+     */
+    public static final int CONTENT_HASH_TABLE_TAG = 0x4B574248;
+    /**
+     * The tag ('KWBR') of the sample rate table written after the content hash table.
+     * The tag is followed by the sample rate in Hz of each entry, in entry order, or 0
+     * if the sample rate is unknown.
+     */
+    public static final int SAMPLE_RATE_TABLE_TAG = 0x4B574252;
+    /** The FNV-1a 64 bit offset basis.*/
+    private static final long CONTENT_HASH_OFFSET_BASIS = 0xcbf29ce484222325L;
+    /** The FNV-1a 64 bit prime.*/
+    private static final long CONTENT_HASH_PRIME = 0x100000001b3L;
 
 
     public WaveBankBuilder()
     {
         
     }
+
+    /**
+     * Computes the content hash of a piece of audio data, i.e the FNV-1a 64 bit hash
+     * of its bytes. The engine uses content hashes to share identical audio data
+     * between wave banks.
+     * @param bytes The audio data bytes.
+     * @return The content hash.
+     */
+    public static long computeContentHash(byte[] bytes)
+    {
+        long hash = CONTENT_HASH_OFFSET_BASIS;
+        for (int i = 0; i < bytes.length; i++)
+        {
+            hash ^= (bytes[i] & 0xff);
+            hash *= CONTENT_HASH_PRIME;
+        }
+        return hash;
+    }
     
     private void buildWaveBank(KowalskiProject project,
                                File projectFile,
@@ -141,7 +174,6 @@ public class WaveBankBuilder extends DataBuilder
         }
         
         //TODO: serialize into memory and then to disk?
-        //TODO: treat entries shared between wavebanks somehow. or don't allow that?
         FileOutputStream fileOutputStream = new FileOutputStream(waveBankFile);
 
         DataOutputStream dos = new DataOutputStream(fileOutputStream);
@@ -160,6 +192,8 @@ public class WaveBankBuilder extends DataBuilder
 
         //write the number of waves in the bank
         dos.writeInt(numAudioDataItems);
+        long[] contentHashes = new long[numAudioDataItems];
+        int[] sampleRates = new int[numAudioDataItems];
         for (int i = 0; i < numAudioDataItems; i++)
         {
             AudioData audioDatai = audioDataList.get(i);
@@ -170,6 +204,7 @@ public class WaveBankBuilder extends DataBuilder
             byte[] audioDataBytes = null;
             AudioFileDescription.Encoding encoding;
             int numChannels = 0;
+            float sampleRate = 0;
 
             /*
              * Possible scenarios:
@@ -197,6 +232,7 @@ public class WaveBankBuilder extends DataBuilder
 
                 AudioFormat format = audioInputStream.getFormat();
                 numChannels = format.getChannels();
+                sampleRate = format.getSampleRate();
 
                 if (!audioDatai.isStreamFromDisk())
                 {
@@ -231,6 +267,7 @@ public class WaveBankBuilder extends DataBuilder
                 fis.read(audioDataBytes);
                 fis.close();
                 encoding = f.getEncoding();
+                sampleRate = f.getSampleRate();
                 
             }
 
@@ -251,10 +288,30 @@ public class WaveBankBuilder extends DataBuilder
             dos.writeInt(audioDataBytes.length);
            
             dos.write(audioDataBytes);
+            contentHashes[i] = computeContentHash(audioDataBytes);
+            //unspecified sample rates are negative in javax.sound
+            sampleRates[i] = sampleRate > 0 ? Math.round(sampleRate) : 0;
             
             log("        Wrote " + audioDataBytes.length + " bytes of " +
-                      encoding.toString() + " audio data.");
+                      encoding.toString() + " audio data" +
+                      (sampleRates[i] > 0 ? " at " + sampleRates[i] + " Hz." : "."));
+        }
+
+        //write the content hash table, letting the engine share identical
+        //audio data between wave banks
+        dos.writeInt(CONTENT_HASH_TABLE_TAG);
+        for (int i = 0; i < numAudioDataItems; i++)
+        {
+            dos.writeLong(contentHashes[i]);
         }
+
+        //write the sample rate table, letting the engine play entries at their native rates
+        dos.writeInt(SAMPLE_RATE_TABLE_TAG);
+        for (int i = 0; i < numAudioDataItems; i++)
+        {
+            dos.writeInt(sampleRates[i]);
+        }
+        
         log("");
         fileOutputStream.close();
     }
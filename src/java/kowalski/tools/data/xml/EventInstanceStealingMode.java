@@ -23,6 +23,7 @@ import javax.xml.bind.annotation.XmlType;
  *     &lt;enumeration value="STEAL_QUIETEST"/>
  *     &lt;enumeration value="STEAL_RANDOM"/>
  *     &lt;enumeration value="DONT_STEAL"/>
+ *     &lt;enumeration value="STEAL_OLDEST"/>
  *   &lt;/restriction>
  * &lt;/simpleType>
  * </pre>
@@ -34,7 +35,8 @@ public enum EventInstanceStealingMode {
 
     STEAL_QUIETEST,
     STEAL_RANDOM,
-    DONT_STEAL;
+    DONT_STEAL,
+    STEAL_OLDEST;
 
     public String value() {
         return name();
@@ -0,0 +1,632 @@
+/*
+Copyright (c) 2010-2013 Per Gantelius
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+/*! \file
+ Golden output regression test. Renders a set of scripted scenarios, i.e demo engine data,
+ a sequence of API calls and a random seed, through the external host and \c kwlRender
+ and compares the output against golden values checked in next to this file.
+ Scenarios rendered at full quality must match their golden hash exactly. Scenarios using
+ reduced quality tiers are compared against the full quality output of a reference scenario
+ and must reach a golden signal to noise ratio. See README.md for build instructions.
+ */
+
+#include "kowalski.h"
+#include "kowalski_ext.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define KWL_GOLDEN_SAMPLE_RATE 44100
+#define KWL_GOLDEN_NUM_CHANNELS 2
+#define KWL_GOLDEN_BLOCK_SIZE 512
+#define KWL_GOLDEN_NUM_BLOCKS 1000
+#define KWL_GOLDEN_NUM_SAMPLES (KWL_GOLDEN_NUM_CHANNELS * KWL_GOLDEN_BLOCK_SIZE * KWL_GOLDEN_NUM_BLOCKS)
+/** The largest output delay, in frames, considered when aligning output with a reference.*/
+#define KWL_GOLDEN_MAX_LAG 64
+/** The margin, in dB, below the measured signal to noise ratio of new golden thresholds.*/
+#define KWL_GOLDEN_SNR_MARGIN 1.0
+/** 
+ * The highest new golden threshold in dB. Output that only differs from its reference 
+ * by rounding, or not at all, gets this threshold.
+ */
+#define KWL_GOLDEN_MAX_SNR_THRESHOLD 120.0
+#define KWL_GOLDEN_MAX_PATH_LENGTH 1024
+#define KWL_GOLDEN_MAX_LINE_LENGTH 256
+#define KWL_GOLDEN_NUM_EMITTERS 16
+#define KWL_GOLDEN_STREAM_NUM_FRAMES (KWL_GOLDEN_SAMPLE_RATE * 3)
+#define KWL_GOLDEN_STREAM_PITCH 1.37f
+/** The number of frames per push stream write, small enough to keep runs short.*/
+#define KWL_GOLDEN_PUSH_CHUNK_FRAMES 37
+/** 
+ * The number of frames the push stream is topped up to before each block. A block plays
+ * about 700 frames at \c KWL_GOLDEN_STREAM_PITCH, so played runs often end just before
+ * the write position without running out of frames.
+ */
+#define KWL_GOLDEN_PUSH_QUEUED_FRAMES 860
+
+/** A scripted scenario.*/
+typedef struct kwlGoldenScenario
+{
+    /** The name of the scenario in the golden file.*/
+    const char* name;
+    /** Makes the API calls of the scenario before a given block is rendered.*/
+    void (*update)(int blockIndex);
+    /**
+     * NULL if the output must match the golden hash, otherwise the name of the scenario
+     * whose output this scenario is compared against.
+     */
+    const char* reference;
+} kwlGoldenScenario;
+
+/** A golden value, i.e a hash or a minimum signal to noise ratio in dB.*/
+typedef struct kwlGoldenValue
+{
+    unsigned long long hash;
+    double snr;
+    int isSet;
+} kwlGoldenValue;
+
+static const char* dataDirectory = "../../res/demodata/final";
+static volatile int isRenderThreadRunning = 0;
+
+static const char* const eventIds[] =
+{
+    "complexevents/random",
+    "complexevents/random_2",
+    "complexevents/in_random_out",
+    "complexevents/random_no_repeat",
+    "complexevents/in_random_no_repeat_out"
+};
+
+#define KWL_GOLDEN_NUM_EVENTS ((int)(sizeof(eventIds) / sizeof(eventIds[0])))
+
+static kwlEventHandle events[KWL_GOLDEN_NUM_EVENTS];
+
+static short emitterSamples[KWL_GOLDEN_SAMPLE_RATE * 2];
+static kwlEventHandle emitters[KWL_GOLDEN_NUM_EMITTERS];
+
+static short streamSamples[KWL_GOLDEN_STREAM_NUM_FRAMES * 2];
+static kwlEventHandle streamEvent;
+static kwlPushStreamHandle pushStream;
+static int numPushedFrames;
+
+/** Returns the path of a file in the data directory. The returned string is overwritten by the next call.*/
+static const char* kwlGolden_getDataPath(const char* fileName)
+{
+    static char path[KWL_GOLDEN_MAX_PATH_LENGTH];
+    snprintf(path, KWL_GOLDEN_MAX_PATH_LENGTH, "%s/%s", dataDirectory, fileName);
+    return path;
+}
+
+/** Keeps the mixer running while data is unloaded, since unloading waits for the mixer.*/
+static void* kwlGolden_renderThread(void* unused)
+{
+    static float buffer[KWL_GOLDEN_NUM_CHANNELS * KWL_GOLDEN_BLOCK_SIZE];
+    (void)unused;
+    while (isRenderThreadRunning)
+    {
+        kwlRender(buffer, KWL_GOLDEN_BLOCK_SIZE);
+        usleep(1000);
+    }
+    return NULL;
+}
+
+/** Starts, and every 250 blocks restarts, events with random playback modes.*/
+static void kwlGolden_startEvents(int blockIndex)
+{
+    int i;
+    if (blockIndex == 0)
+    {
+        for (i = 0; i < KWL_GOLDEN_NUM_EVENTS; i++)
+        {
+            events[i] = kwlEventGetHandle(eventIds[i]);
+        }
+    }
+
+    if (blockIndex % 250 != 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < KWL_GOLDEN_NUM_EVENTS; i++)
+    {
+        kwlEventStart(events[i]);
+    }
+}
+
+static void kwlGolden_events(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        kwlSetRandomSeed(7);
+    }
+    kwlGolden_startEvents(blockIndex);
+}
+
+/** Starts a looping stereo event with noise on the left channel and a tone on the right.*/
+static void kwlGolden_stereoEvents(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        kwlSetRandomSeed(7);
+        kwlEventStart(kwlEventGetHandle("balancedemo/mono_and_stereo"));
+    }
+}
+
+static void kwlGolden_voiceLODMono(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        /*The event is quieter than the mono threshold, so its channels are mixed down.*/
+        kwlSetVoiceLODThresholds(10.0f, 0.0f);
+    }
+    kwlGolden_stereoEvents(blockIndex);
+}
+
+static void kwlGolden_voiceLODHalfRate(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        kwlSetVoiceLODThresholds(10.0f, 10.0f);
+    }
+    kwlGolden_events(blockIndex);
+}
+
+static void kwlGolden_busRate22050(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        kwlMixBusSetSampleRate(kwlMixBusGetHandle("sfx"), 22050);
+    }
+    kwlGolden_events(blockIndex);
+}
+
+static void kwlGolden_busRate11025(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        kwlMixBusSetSampleRate(kwlMixBusGetHandle("sfx"), 11025);
+    }
+    kwlGolden_events(blockIndex);
+}
+
+/**
+ * Moving positional freeform events around a moving listener, with doppler shift and the
+ * spatial index enabled, so that emitters move in and out of range.
+ */
+static void kwlGolden_positional(int blockIndex)
+{
+    const float t = blockIndex * KWL_GOLDEN_BLOCK_SIZE / (float)KWL_GOLDEN_SAMPLE_RATE;
+    int i;
+
+    if (blockIndex == 0)
+    {
+        kwlSetRandomSeed(11);
+        kwlSetDistanceAttenuationModel(KWL_INV_DISTANCE, 1, 40.0f, 1.0f, 2.0f);
+        kwlSetDopplerShiftParameters(340.0f, 1.0f);
+        kwlSetSpatialIndexCellSize(20.0f);
+
+        for (i = 0; i < KWL_GOLDEN_SAMPLE_RATE * 2; i++)
+        {
+            emitterSamples[i] = (short)(8000.0f * sinf(2.0f * 3.14159265f * 220.0f * i / KWL_GOLDEN_SAMPLE_RATE));
+        }
+
+        kwlPCMBuffer buffer;
+        buffer.numFrames = KWL_GOLDEN_SAMPLE_RATE * 2;
+        buffer.numChannels = 1;
+        buffer.pcmData = emitterSamples;
+        for (i = 0; i < KWL_GOLDEN_NUM_EMITTERS; i++)
+        {
+            emitters[i] = kwlEventCreateWithBuffer(&buffer, KWL_POSITIONAL);
+            kwlEventSetPitch(emitters[i], 0.5f + 0.1f * i);
+        }
+    }
+
+    if (blockIndex % 150 == 0)
+    {
+        for (i = 0; i < KWL_GOLDEN_NUM_EMITTERS; i++)
+        {
+            kwlEventStart(emitters[i]);
+        }
+    }
+
+    /*Emitters circle the origin at different radii, the listener passes by along the x axis.*/
+    for (i = 0; i < KWL_GOLDEN_NUM_EMITTERS; i++)
+    {
+        const float radius = 5.0f + 4.0f * i;
+        const float angularVelocity = 0.5f + 0.05f * i;
+        const float angle = angularVelocity * t + i;
+        kwlEventSetPosition(emitters[i], radius * cosf(angle), 0.0f, radius * sinf(angle));
+        kwlEventSetVelocity(emitters[i],
+                            -radius * angularVelocity * sinf(angle),
+                            0.0f,
+                            radius * angularVelocity * cosf(angle));
+    }
+    kwlListenerSetPosition(-50.0f + 8.0f * t, 0.0f, 0.0f);
+    kwlListenerSetVelocity(8.0f, 0.0f, 0.0f);
+}
+
+/** Fills the stereo stream samples with a tone on the left channel and a chirp on the right.*/
+static void kwlGolden_initStreamSamples()
+{
+    int i;
+    for (i = 0; i < KWL_GOLDEN_STREAM_NUM_FRAMES; i++)
+    {
+        const float t = i / (float)KWL_GOLDEN_SAMPLE_RATE;
+        streamSamples[2 * i] = (short)(8000.0f * sinf(2.0f * 3.14159265f * 440.0f * t));
+        streamSamples[2 * i + 1] = (short)(8000.0f * sinf(2.0f * 3.14159265f * (200.0f + 600.0f * t) * t));
+    }
+}
+
+/** A pitch shifted stereo freeform event playing the stream samples from a buffer.*/
+static void kwlGolden_bufferPitch(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        kwlGolden_initStreamSamples();
+        kwlPCMBuffer buffer;
+        buffer.numFrames = KWL_GOLDEN_STREAM_NUM_FRAMES;
+        buffer.numChannels = 2;
+        buffer.pcmData = streamSamples;
+        streamEvent = kwlEventCreateWithBuffer(&buffer, KWL_NONPOSITIONAL);
+        kwlEventSetPitch(streamEvent, KWL_GOLDEN_STREAM_PITCH);
+        kwlEventStart(streamEvent);
+    }
+}
+
+/**
+ * Like \c kwlGolden_bufferPitch, but the stream samples are pushed to a push stream event
+ * in small chunks, keeping only a little more than a block's worth of frames queued.
+ */
+static void kwlGolden_pushStreamPitch(int blockIndex)
+{
+    if (blockIndex == 0)
+    {
+        kwlGolden_initStreamSamples();
+        streamEvent = kwlEventCreatePushStream(2, 4 * KWL_GOLDEN_PUSH_QUEUED_FRAMES, 
+                                               KWL_GOLDEN_PUSH_CHUNK_FRAMES, KWL_NONPOSITIONAL);
+        pushStream = kwlEventGetPushStream(streamEvent);
+        numPushedFrames = 0;
+    }
+    
+    while (numPushedFrames < KWL_GOLDEN_STREAM_NUM_FRAMES &&
+           kwlPushStreamGetNumQueuedFrames(pushStream) < KWL_GOLDEN_PUSH_QUEUED_FRAMES)
+    {
+        int numFrames = KWL_GOLDEN_STREAM_NUM_FRAMES - numPushedFrames;
+        if (numFrames > KWL_GOLDEN_PUSH_CHUNK_FRAMES)
+        {
+            numFrames = KWL_GOLDEN_PUSH_CHUNK_FRAMES;
+        }
+        numPushedFrames += kwlPushStreamWrite(pushStream, &streamSamples[2 * numPushedFrames], numFrames);
+    }
+    
+    if (blockIndex == 0)
+    {
+        kwlEventSetPitch(streamEvent, KWL_GOLDEN_STREAM_PITCH);
+        kwlEventStart(streamEvent);
+    }
+}
+
+static const kwlGoldenScenario scenarios[] =
+{
+    {"events", kwlGolden_events, NULL},
+    {"positional", kwlGolden_positional, NULL},
+    {"stereo_events", kwlGolden_stereoEvents, NULL},
+    {"voice_lod_mono", kwlGolden_voiceLODMono, "stereo_events"},
+    {"voice_lod_half_rate", kwlGolden_voiceLODHalfRate, "events"},
+    {"bus_rate_22050", kwlGolden_busRate22050, "events"},
+    {"bus_rate_11025", kwlGolden_busRate11025, "events"},
+    {"buffer_pitch", kwlGolden_bufferPitch, NULL},
+    {"push_stream_pitch", kwlGolden_pushStreamPitch, "buffer_pitch"}
+};
+
+#define KWL_GOLDEN_NUM_SCENARIOS ((int)(sizeof(scenarios) / sizeof(scenarios[0])))
+
+/**
+ * Renders a given scenario into a buffer of \c KWL_GOLDEN_NUM_SAMPLES interleaved samples.
+ * Returns non-zero if an engine error occurred.
+ */
+static int kwlGolden_render(const kwlGoldenScenario* scenario, float* output)
+{
+    int i;
+    kwlInitialize(KWL_GOLDEN_SAMPLE_RATE, KWL_GOLDEN_NUM_CHANNELS, 0, KWL_GOLDEN_BLOCK_SIZE);
+    kwlEngineDataLoad(kwlGolden_getDataPath("demoproject.kwl"));
+    kwlWaveBankHandle numbers = kwlWaveBankLoad(kwlGolden_getDataPath("numbers.kwb"));
+    kwlWaveBankHandle sfx = kwlWaveBankLoad(kwlGolden_getDataPath("sfx.kwb"));
+    kwlError error = kwlGetError();
+
+    for (i = 0; i < KWL_GOLDEN_NUM_EMITTERS; i++)
+    {
+        emitters[i] = KWL_INVALID_HANDLE;
+    }
+    streamEvent = KWL_INVALID_HANDLE;
+    for (i = 0; i < KWL_GOLDEN_NUM_BLOCKS && error == KWL_NO_ERROR; i++)
+    {
+        scenario->update(i);
+        kwlUpdate(KWL_GOLDEN_BLOCK_SIZE / (float)KWL_GOLDEN_SAMPLE_RATE);
+        kwlRender(output + i * KWL_GOLDEN_NUM_CHANNELS * KWL_GOLDEN_BLOCK_SIZE, KWL_GOLDEN_BLOCK_SIZE);
+        error = kwlGetError();
+    }
+
+    if (error != KWL_NO_ERROR)
+    {
+        fprintf(stderr, "%s: engine error %d\n", scenario->name, error);
+    }
+
+    /*Tear down with the mixer running on its own thread, like a regular host.*/
+    isRenderThreadRunning = 1;
+    pthread_t renderThread;
+    pthread_create(&renderThread, NULL, kwlGolden_renderThread, NULL);
+    for (i = 0; i < KWL_GOLDEN_NUM_EMITTERS; i++)
+    {
+        if (emitters[i] != KWL_INVALID_HANDLE)
+        {
+            kwlEventRelease(emitters[i]);
+        }
+    }
+    if (streamEvent != KWL_INVALID_HANDLE)
+    {
+        kwlEventRelease(streamEvent);
+    }
+    for (i = 0; i < 10; i++)
+    {
+        kwlUpdate(0.01f);
+        usleep(5000);
+    }
+    kwlWaveBankUnload(numbers);
+    kwlWaveBankUnload(sfx);
+    kwlEngineDataUnload();
+    isRenderThreadRunning = 0;
+    pthread_join(renderThread, NULL);
+    kwlDeinitialize();
+
+    return error != KWL_NO_ERROR;
+}
+
+/** Returns the 64 bit FNV-1a hash of the bytes of a given buffer.*/
+static unsigned long long kwlGolden_hash(const float* samples, int numSamples)
+{
+    const unsigned char* bytes = (const unsigned char*)samples;
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    int i;
+    for (i = 0; i < numSamples * (int)sizeof(float); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Returns the signal to noise ratio, in dB, of a given output with respect to a reference,
+ * at the delay of up to \c KWL_GOLDEN_MAX_LAG frames that gives the highest ratio.
+ */
+static double kwlGolden_getSNR(const float* output, const float* reference)
+{
+    double bestSNR = -1000.0;
+    int lag;
+    for (lag = 0; lag <= KWL_GOLDEN_MAX_LAG; lag++)
+    {
+        const int offset = lag * KWL_GOLDEN_NUM_CHANNELS;
+        double signal = 0.0;
+        double noise = 0.0;
+        int i;
+        for (i = 0; i < KWL_GOLDEN_NUM_SAMPLES - offset; i++)
+        {
+            const double difference = output[i + offset] - reference[i];
+            signal += reference[i] * reference[i];
+            noise += difference * difference;
+        }
+
+        const double snr = noise > 0.0 ? 10.0 * log10(signal / noise) : 1000.0;
+        if (snr > bestSNR)
+        {
+            bestSNR = snr;
+        }
+    }
+    return bestSNR;
+}
+
+/** Reads golden values from a file. Lines are "<scenario> hash <hex>" or "<scenario> snr <dB>".*/
+static void kwlGolden_readValues(const char* path, kwlGoldenValue* values)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return;
+    }
+
+    char line[KWL_GOLDEN_MAX_LINE_LENGTH];
+    while (fgets(line, KWL_GOLDEN_MAX_LINE_LENGTH, file) != NULL)
+    {
+        char name[KWL_GOLDEN_MAX_LINE_LENGTH];
+        char check[KWL_GOLDEN_MAX_LINE_LENGTH];
+        char value[KWL_GOLDEN_MAX_LINE_LENGTH];
+        if (line[0] == '#' || sscanf(line, "%255s %255s %255s", name, check, value) != 3)
+        {
+            continue;
+        }
+
+        int i;
+        for (i = 0; i < KWL_GOLDEN_NUM_SCENARIOS; i++)
+        {
+            if (strcmp(scenarios[i].name, name) != 0)
+            {
+                continue;
+            }
+
+            if (strcmp(check, "hash") == 0)
+            {
+                values[i].hash = strtoull(value, NULL, 16);
+                values[i].isSet = 1;
+            }
+            else if (strcmp(check, "snr") == 0)
+            {
+                values[i].snr = strtod(value, NULL);
+                values[i].isSet = 1;
+            }
+        }
+    }
+    fclose(file);
+}
+
+static int kwlGolden_writeValues(const char* path, const kwlGoldenValue* values)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "could not write %s\n", path);
+        return 1;
+    }
+
+    fprintf(file, "# Golden output of kwl_golden_test. Regenerate hashes with kwl_golden_test -u.\n");
+    fprintf(file, "# hash: FNV-1a hash of the rendered float samples, which must match exactly.\n");
+    fprintf(file, "# snr: minimum signal to noise ratio in dB with respect to the reference scenario.\n");
+    int i;
+    for (i = 0; i < KWL_GOLDEN_NUM_SCENARIOS; i++)
+    {
+        if (!values[i].isSet)
+        {
+            continue;
+        }
+        else if (scenarios[i].reference == NULL)
+        {
+            fprintf(file, "%-20s hash %016llx\n", scenarios[i].name, values[i].hash);
+        }
+        else
+        {
+            fprintf(file, "%-20s snr  %.1f\n", scenarios[i].name, values[i].snr);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+static int kwlGolden_getScenarioIndex(const char* name)
+{
+    int i;
+    for (i = 0; i < KWL_GOLDEN_NUM_SCENARIOS; i++)
+    {
+        if (strcmp(scenarios[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    int update = 0;
+    const char* goldenPath = "golden.txt";
+    int argi = 1;
+    if (argi < argc && strcmp(argv[argi], "-u") == 0)
+    {
+        update = 1;
+        argi++;
+    }
+    if (argi < argc)
+    {
+        dataDirectory = argv[argi++];
+    }
+    if (argi < argc)
+    {
+        goldenPath = argv[argi++];
+    }
+
+    kwlGoldenValue values[KWL_GOLDEN_NUM_SCENARIOS];
+    memset(values, 0, sizeof(values));
+    kwlGolden_readValues(goldenPath, values);
+
+    float* outputs[KWL_GOLDEN_NUM_SCENARIOS];
+    float* repeatedOutput = (float*)malloc(KWL_GOLDEN_NUM_SAMPLES * sizeof(float));
+    int numFailures = 0;
+    int i;
+    for (i = 0; i < KWL_GOLDEN_NUM_SCENARIOS; i++)
+    {
+        const kwlGoldenScenario* scenario = &scenarios[i];
+        outputs[i] = (float*)calloc(KWL_GOLDEN_NUM_SAMPLES, sizeof(float));
+        if (kwlGolden_render(scenario, outputs[i]))
+        {
+            numFailures++;
+            continue;
+        }
+
+        if (scenario->reference == NULL)
+        {
+            /*Rendering the same scenario twice must give the same output.*/
+            const unsigned long long hash = kwlGolden_hash(outputs[i], KWL_GOLDEN_NUM_SAMPLES);
+            kwlGolden_render(scenario, repeatedOutput);
+            const unsigned long long repeatedHash = kwlGolden_hash(repeatedOutput, KWL_GOLDEN_NUM_SAMPLES);
+
+            int passed = hash == repeatedHash;
+            if (update)
+            {
+                values[i].hash = hash;
+                values[i].isSet = 1;
+            }
+            passed = passed && values[i].isSet && values[i].hash == hash;
+            printf("%-20s hash %016llx %s\n", scenario->name, hash,
+                   hash != repeatedHash ? "NOT DETERMINISTIC" :
+                   !values[i].isSet ? "NO GOLDEN VALUE" : passed ? "ok" : "MISMATCH");
+            numFailures += !passed;
+        }
+        else
+        {
+            const int referenceIndex = kwlGolden_getScenarioIndex(scenario->reference);
+            const double snr = kwlGolden_getSNR(outputs[i], outputs[referenceIndex]);
+            if (update && !values[i].isSet)
+            {
+                /*Keep hand tuned thresholds, only add missing ones.*/
+                values[i].snr = floor(snr - KWL_GOLDEN_SNR_MARGIN);
+                if (values[i].snr > KWL_GOLDEN_MAX_SNR_THRESHOLD)
+                {
+                    values[i].snr = KWL_GOLDEN_MAX_SNR_THRESHOLD;
+                }
+                values[i].isSet = 1;
+            }
+            const int passed = values[i].isSet && snr >= values[i].snr;
+            printf("%-20s snr  %.1f dB (min %.1f) %s\n", scenario->name, snr, values[i].snr,
+                   !values[i].isSet ? "NO GOLDEN VALUE" : passed ? "ok" : "BELOW THRESHOLD");
+            numFailures += !passed;
+        }
+    }
+
+    for (i = 0; i < KWL_GOLDEN_NUM_SCENARIOS; i++)
+    {
+        free(outputs[i]);
+    }
+    free(repeatedOutput);
+
+    if (update)
+    {
+        return kwlGolden_writeValues(goldenPath, values);
+    }
+
+    printf("%d of %d scenarios failed\n", numFailures, KWL_GOLDEN_NUM_SCENARIOS);
+    return numFailures > 0 ? 1 : 0;
+}
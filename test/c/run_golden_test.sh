@@ -0,0 +1,12 @@
+#!/bin/sh
+# Builds the golden output test against the external host and runs it from this directory.
+# Arguments are passed on to kwl_golden_test, e.g -u to regenerate golden.txt.
+cd "$(dirname "$0")"
+ENGINE=../../src/engine
+${CC:-cc} -std=gnu99 -O2 -I$ENGINE -I$ENGINE/tremor \
+    kwl_golden_test.c \
+    $(ls $ENGINE/*.c | grep -v _win.c) \
+    $ENGINE/hosts/external/kwl_engine_external.c \
+    $ENGINE/tremor/*.c \
+    -lpthread -lm -o kwl_golden_test || exit 1
+./kwl_golden_test "$@"
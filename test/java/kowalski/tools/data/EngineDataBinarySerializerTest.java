@@ -1,13 +1,18 @@
 package kowalski.tools.data;
 
+import java.io.File;
 import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Set;
 import javax.xml.bind.JAXBException;
-import junit.framework.TestCase;
 
 /**
  *
  */
-public class EngineDataBinarySerializerTest extends TestCase
+public class EngineDataBinarySerializerTest extends TestCaseBase
 {
     public void testSerializeProjectWithNoEvents()
     {
@@ -42,4 +47,177 @@ public class EngineDataBinarySerializerTest extends TestCase
         //TODO
         fail();
     }
+
+    public void testTableOfContents()
+            throws Exception
+    {
+        ByteBuffer data = ByteBuffer.wrap(buildEngineData(2));
+        final int start = EngineDataBuilder.ENGINE_DATA_FILE_IDENTIFIER.length;
+        assertEquals(EngineDataBuilder.TABLE_OF_CONTENTS_CHUNK_ID, data.getInt(start));
+        final int tableOfContentsSize = data.getInt(start + 4);
+        assertEquals(2, data.getInt(start + 8));
+
+        //the string table comes first, since other chunks reference it
+        final int[] expectedChunkIds = {EngineDataBuilder.STRINGS_CHUNK_ID,
+                                        EngineDataBuilder.WAVE_BANKS_CHUNK_ID,
+                                        EngineDataBuilder.MIX_BUSES_CHUNK_ID,
+                                        EngineDataBuilder.MIX_PRESETS_CHUNK_ID,
+                                        EngineDataBuilder.SOUNDS_CHUNK_ID,
+                                        EngineDataBuilder.EVENTS_CHUNK_ID,
+                                        EngineDataBuilder.EVENT_STEALING_MODES_CHUNK_ID};
+        final int numChunks = data.getInt(start + 12);
+        assertEquals(expectedChunkIds.length, numChunks);
+        assertEquals(8 + 12 * numChunks, tableOfContentsSize);
+
+        //every entry points to the payload of the chunk with the same ID and size,
+        //and the chunks follow each other up to the end of the file
+        int chunkStart = start + 8 + tableOfContentsSize;
+        for (int i = 0; i < numChunks; i++)
+        {
+            final int entry = start + 16 + 12 * i;
+            final int chunkId = data.getInt(entry);
+            final int offset = data.getInt(entry + 4);
+            final int size = data.getInt(entry + 8);
+            assertEquals(expectedChunkIds[i], chunkId);
+            assertEquals(chunkStart + 8, offset);
+            assertEquals(chunkId, data.getInt(offset - 8));
+            assertEquals(size, data.getInt(offset - 4));
+            chunkStart = offset + size;
+        }
+        assertEquals(data.capacity(), chunkStart);
+    }
+
+    public void testStringTable()
+            throws Exception
+    {
+        ByteBuffer data = ByteBuffer.wrap(buildEngineData(2));
+        final int stringTableOffset = getChunkOffset(data, EngineDataBuilder.STRINGS_CHUNK_ID);
+        final int stringTableSize = data.getInt(stringTableOffset - 4);
+
+        //every string is stored once, even if referenced more than once
+        List<String> strings = new ArrayList<String>();
+        int stringStart = stringTableOffset;
+        for (int i = stringTableOffset; i < stringTableOffset + stringTableSize; i++)
+        {
+            if (data.get(i) == 0)
+            {
+                strings.add(new String(data.array(), stringStart, i - stringStart));
+                stringStart = i + 1;
+            }
+        }
+        assertEquals(stringTableOffset + stringTableSize, stringStart);
+        Set<String> uniqueStrings = new HashSet<String>(strings);
+        assertEquals(strings.size(), uniqueStrings.size());
+        assertTrue(uniqueStrings.contains("master"));
+        assertTrue(uniqueStrings.contains("bank"));
+        assertTrue(uniqueStrings.contains(AUDIO_FILE_22050));
+        assertTrue(uniqueStrings.contains(AUDIO_FILE_44100));
+
+        //the wave bank chunk starts with the total number of audio data entries and the
+        //number of wave banks, followed by the string table offset of the wave bank ID
+        final int waveBanksOffset = getChunkOffset(data, EngineDataBuilder.WAVE_BANKS_CHUNK_ID);
+        assertEquals(2, data.getInt(waveBanksOffset));
+        assertEquals(1, data.getInt(waveBanksOffset + 4));
+        final int idOffset = data.getInt(waveBanksOffset + 8);
+        assertEquals("bank", new String(data.array(), stringTableOffset + idOffset, 4));
+        assertEquals(0, data.get(stringTableOffset + idOffset + 4));
+    }
+
+    public void testFormatVersion1Fallback()
+            throws Exception
+    {
+        ByteBuffer data = ByteBuffer.wrap(buildEngineData(1));
+
+        //version 1 binaries have no table of contents, string table or stealing modes
+        final int[] expectedChunkIds = {EngineDataBuilder.WAVE_BANKS_CHUNK_ID,
+                                        EngineDataBuilder.MIX_BUSES_CHUNK_ID,
+                                        EngineDataBuilder.MIX_PRESETS_CHUNK_ID,
+                                        EngineDataBuilder.SOUNDS_CHUNK_ID,
+                                        EngineDataBuilder.EVENTS_CHUNK_ID};
+        int chunkStart = EngineDataBuilder.ENGINE_DATA_FILE_IDENTIFIER.length;
+        for (int i = 0; i < expectedChunkIds.length; i++)
+        {
+            assertEquals(expectedChunkIds[i], data.getInt(chunkStart));
+            chunkStart += 8 + data.getInt(chunkStart + 4);
+        }
+        assertEquals(data.capacity(), chunkStart);
+
+        //strings are stored inline, as a length followed by the characters
+        final int waveBanksOffset = EngineDataBuilder.ENGINE_DATA_FILE_IDENTIFIER.length + 8;
+        assertEquals(4, data.getInt(waveBanksOffset + 8));
+        assertEquals("bank", new String(data.array(), waveBanksOffset + 12, 4));
+    }
+
+    public void testEventStealingModes()
+            throws Exception
+    {
+        ByteBuffer data = ByteBuffer.wrap(buildEngineData(2));
+        final int offset = getChunkOffset(data, EngineDataBuilder.EVENT_STEALING_MODES_CHUNK_ID);
+
+        //one mode per event, in the order of the events chunk
+        assertEquals(4 + 2 * 4, data.getInt(offset - 4));
+        assertEquals(2, data.getInt(offset));
+        assertEquals(data.getInt(getChunkOffset(data, EngineDataBuilder.EVENTS_CHUNK_ID)),
+                     data.getInt(offset));
+        //event "a" steals the oldest instance, event "b" does not steal
+        assertEquals(3, data.getInt(offset + 4));
+        assertEquals(2, data.getInt(offset + 8));
+    }
+
+    public void testUnsupportedFormatVersion()
+    {
+        EngineDataBuilder builder = new EngineDataBuilder();
+        try
+        {
+            builder.setFormatVersion(EngineDataBuilder.ENGINE_DATA_FORMAT_VERSION + 1);
+            fail();
+        }
+        catch (IllegalArgumentException e)
+        {
+            //the expected outcome
+        }
+        assertEquals(EngineDataBuilder.ENGINE_DATA_FORMAT_VERSION, builder.getFormatVersion());
+    }
+
+    /**
+     * Builds engine data from the project written by createSerializableProject.
+     * @param formatVersion
+     * @return The engine data binary.
+     * @throws Exception
+     */
+    protected byte[] buildEngineData(int formatVersion)
+            throws Exception
+    {
+        File dir = createTempDirectory();
+        File projectFile = createSerializableProject(dir);
+        File binFile = new File(dir, "project" + EngineDataBuilder.ENGINE_DATA_FILE_SUFFIX);
+
+        EngineDataBuilder builder = new EngineDataBuilder();
+        builder.setFormatVersion(formatVersion);
+        builder.buildEngineData(projectFile.getPath(), binFile.getPath());
+
+        return readFile(binFile);
+    }
+
+    /**
+     * @param data A version 2 engine data binary.
+     * @param chunkId
+     * @return The offset of the payload of the chunk with the given ID, according to the
+     * table of contents.
+     */
+    protected int getChunkOffset(ByteBuffer data, int chunkId)
+    {
+        final int start = EngineDataBuilder.ENGINE_DATA_FILE_IDENTIFIER.length;
+        final int numChunks = data.getInt(start + 12);
+        for (int i = 0; i < numChunks; i++)
+        {
+            final int entry = start + 16 + 12 * i;
+            if (data.getInt(entry) == chunkId)
+            {
+                return data.getInt(entry + 4);
+            }
+        }
+        fail("No chunk with ID " + Integer.toHexString(chunkId));
+        return -1;
+    }
 }
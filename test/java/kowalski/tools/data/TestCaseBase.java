@@ -4,8 +4,18 @@ package kowalski.tools.data;
  * and open the template in the editor.
  */
 
+import java.io.ByteArrayInputStream;
+import java.io.DataInputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileWriter;
+import java.io.IOException;
 import java.io.InputStream;
 import java.util.List;
+import javax.sound.sampled.AudioFileFormat;
+import javax.sound.sampled.AudioFormat;
+import javax.sound.sampled.AudioInputStream;
+import javax.sound.sampled.AudioSystem;
 import javax.xml.bind.JAXBException;
 import junit.framework.TestCase;
 import kowalski.tools.data.xml.KowalskiProject;
@@ -17,6 +27,120 @@ class TestCaseBase extends TestCase
 {
     protected ResourceLoader loader = new ResourceLoader();
 
+    /** The file name of the 22050 Hz audio file written by createSerializableProject. */
+    protected static final String AUDIO_FILE_22050 = "tone22050.wav";
+    /** The file name of the 44100 Hz audio file written by createSerializableProject. */
+    protected static final String AUDIO_FILE_44100 = "tone44100.wav";
+
+    /**
+     * Writes a small project that passes validation for serialization, along with
+     * the audio files it references, to a given directory. The project has one wave
+     * bank "bank" containing a 22050 Hz and a 44100 Hz mono file, event "a" playing
+     * the sound "tone" with STEAL_OLDEST and event "b" referencing the 44100 Hz audio
+     * data directly with DONT_STEAL. The default mix preset shares its ID with the
+     * mix bus "master".
+     * @param dir
+     * @return The project file.
+     * @throws IOException
+     */
+    protected File createSerializableProject(File dir)
+            throws IOException
+    {
+        writeSineWave(new File(dir, AUDIO_FILE_22050), 22050, 441);
+        writeSineWave(new File(dir, AUDIO_FILE_44100), 44100, 441);
+
+        File projectFile = new File(dir, "project.xml");
+        FileWriter writer = new FileWriter(projectFile);
+        writer.write(
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" +
+            "<KowalskiProject version=\"1.0\" audioFileRootDirectory=\"\">\n" +
+            "  <WaveBankGroup id=\"root\">\n" +
+            "    <WaveBank id=\"bank\">\n" +
+            "      <AudioData relativePath=\"" + AUDIO_FILE_22050 + "\"/>\n" +
+            "      <AudioData relativePath=\"" + AUDIO_FILE_44100 + "\"/>\n" +
+            "    </WaveBank>\n" +
+            "  </WaveBankGroup>\n" +
+            "  <SoundGroup id=\"root\">\n" +
+            "    <Sound id=\"tone\" playbackMode=\"SEQUENTIAL\" playbackCount=\"1\">\n" +
+            "      <AudioDataReference relativePath=\"" + AUDIO_FILE_22050 + "\" waveBank=\"bank\"/>\n" +
+            "    </Sound>\n" +
+            "  </SoundGroup>\n" +
+            "  <EventGroup id=\"root\">\n" +
+            "    <Event bus=\"master\" id=\"a\" istanceStealingMode=\"STEAL_OLDEST\">\n" +
+            "      <SoundReference sound=\"tone\"/>\n" +
+            "    </Event>\n" +
+            "    <Event bus=\"master\" id=\"b\" istanceStealingMode=\"DONT_STEAL\">\n" +
+            "      <AudioDataReference relativePath=\"" + AUDIO_FILE_44100 + "\" waveBank=\"bank\"/>\n" +
+            "    </Event>\n" +
+            "  </EventGroup>\n" +
+            "  <MixBus id=\"master\"/>\n" +
+            "  <MixPresetGroup id=\"root\">\n" +
+            "    <MixPreset id=\"master\" default=\"true\">\n" +
+            "      <MixBusParameters mixBus=\"master\" leftGain=\"1\" rightGain=\"1\" pitch=\"1\"/>\n" +
+            "    </MixPreset>\n" +
+            "  </MixPresetGroup>\n" +
+            "</KowalskiProject>\n");
+        writer.close();
+
+        return projectFile;
+    }
+
+    /**
+     * Writes a mono 16 bit wav file containing a sine wave.
+     * @param file
+     * @param sampleRate
+     * @param numFrames
+     * @throws IOException
+     */
+    protected void writeSineWave(File file, int sampleRate, int numFrames)
+            throws IOException
+    {
+        byte[] samples = new byte[2 * numFrames];
+        for (int i = 0; i < numFrames; i++)
+        {
+            short sample = (short)(8000 * Math.sin(2 * Math.PI * 441 * i / sampleRate));
+            samples[2 * i] = (byte)(sample & 0xff);
+            samples[2 * i + 1] = (byte)((sample >> 8) & 0xff);
+        }
+
+        AudioFormat format = new AudioFormat(sampleRate, 16, 1, true, false);
+        AudioInputStream stream =
+            new AudioInputStream(new ByteArrayInputStream(samples), format, numFrames);
+        AudioSystem.write(stream, AudioFileFormat.Type.WAVE, file);
+        stream.close();
+    }
+
+    /**
+     * Creates an empty temporary directory.
+     * @return The directory.
+     * @throws IOException
+     */
+    protected File createTempDirectory()
+            throws IOException
+    {
+        File dir = File.createTempFile("kowalskitest", "");
+        if (!dir.delete() || !dir.mkdir())
+        {
+            fail("Could not create temporary directory " + dir);
+        }
+        return dir;
+    }
+
+    /**
+     * @param file
+     * @return The contents of a given file.
+     * @throws IOException
+     */
+    protected byte[] readFile(File file)
+            throws IOException
+    {
+        byte[] bytes = new byte[(int)file.length()];
+        DataInputStream dis = new DataInputStream(new FileInputStream(file));
+        dis.readFully(bytes);
+        dis.close();
+        return bytes;
+    }
+
     protected void verifyValidationThrowsProjectDataExpection(String xmlFile, KowalskiProject project)
     {
         try
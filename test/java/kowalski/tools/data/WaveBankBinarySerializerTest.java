@@ -1,11 +1,12 @@
 package kowalski.tools.data;
 
-import junit.framework.TestCase;
+import java.io.File;
+import java.nio.ByteBuffer;
 
 /**
  *
  */
-public class WaveBankBinarySerializerTest extends TestCase
+public class WaveBankBinarySerializerTest extends TestCaseBase
 {
     public void testSerializeProjectWithNoAudioData()
     {
@@ -19,4 +20,56 @@ public class WaveBankBinarySerializerTest extends TestCase
         //TODO
         fail(); 
     }
+
+    public void testContentHash()
+    {
+        //FNV-1a 64 bit reference values
+        assertEquals(0xcbf29ce484222325L, WaveBankBuilder.computeContentHash(new byte[0]));
+        assertEquals(0xaf63dc4c8601ec8cL, WaveBankBuilder.computeContentHash(new byte[] {'a'}));
+        assertEquals(0x85944171f73967e8L, WaveBankBuilder.computeContentHash("foobar".getBytes()));
+    }
+
+    public void testSampleRateTable()
+            throws Exception
+    {
+        File dir = createTempDirectory();
+        File projectFile = createSerializableProject(dir);
+        File outputDir = new File(dir, "out");
+        new WaveBankBuilder().buildWavebanks(projectFile.getPath(), outputDir.getPath());
+        ByteBuffer data = ByteBuffer.wrap(readFile(new File(outputDir, "bank" + WaveBankBuilder.WAVE_BANK_FILE_SUFFIX)));
+
+        //skip the file identifier and the wave bank ID
+        int pos = WaveBankBuilder.WAVE_BANK_FILE_IDENTIFIER.length;
+        pos += 4 + data.getInt(pos);
+        final int numEntries = data.getInt(pos);
+        assertEquals(2, numEntries);
+        pos += 4;
+
+        //skip the entries, i.e path, encoding, streaming flag, channel count and audio data
+        long[] contentHashes = new long[numEntries];
+        for (int i = 0; i < numEntries; i++)
+        {
+            pos += 4 + data.getInt(pos);
+            pos += 12;
+            final int numBytes = data.getInt(pos);
+            pos += 4;
+            byte[] audioData = new byte[numBytes];
+            System.arraycopy(data.array(), pos, audioData, 0, numBytes);
+            contentHashes[i] = WaveBankBuilder.computeContentHash(audioData);
+            pos += numBytes;
+        }
+
+        //the content hash table is followed by the sample rate table, which ends the file
+        assertEquals(WaveBankBuilder.CONTENT_HASH_TABLE_TAG, data.getInt(pos));
+        pos += 4;
+        for (int i = 0; i < numEntries; i++)
+        {
+            assertEquals(contentHashes[i], data.getLong(pos));
+            pos += 8;
+        }
+        assertEquals(WaveBankBuilder.SAMPLE_RATE_TABLE_TAG, data.getInt(pos));
+        assertEquals(22050, data.getInt(pos + 4));
+        assertEquals(44100, data.getInt(pos + 8));
+        assertEquals(data.capacity(), pos + 4 + 4 * numEntries);
+    }
 }